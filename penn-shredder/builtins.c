@@ -0,0 +1,460 @@
+#include "builtins.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "env.h"
+#include "fd_copy.h"
+#include "path_cache.h"
+#include "stats.h"
+
+// Global Variables
+static builtin_request pending = {0};  // from the last builtin in the shell
+
+// true if no argument is an option, apart from "-" for standard input
+static bool no_options(char* argv[]) {
+  for (char** arg = &argv[1]; *arg != NULL; arg++) {
+    if ((*arg)[0] == '-' && (*arg)[1] != '\0') {
+      return false;
+    }
+  }
+  return true;
+}
+
+// ===========================================================
+// cat [file ...]
+// ===========================================================
+static int builtin_cat(char* argv[]) {
+  static char* const kStdin[] = {"-", NULL};
+  char* const* files = argv[1] != NULL ? &argv[1] : kStdin;
+  int res = EXIT_SUCCESS;
+  for (char* const* file = files; *file != NULL; file++) {
+    bool is_stdin = strcmp(*file, "-") == 0;
+    int fd = is_stdin ? STDIN_FILENO : open(*file, O_RDONLY | O_CLOEXEC);
+    if (fd < 0 || fd_copy(fd, STDOUT_FILENO) != 0) {
+      fprintf(stderr, "cat: %s: %s\n", *file, strerror(errno));
+      res = EXIT_FAILURE;
+    }
+    if (fd >= 0 && !is_stdin) {
+      close(fd);
+    }
+  }
+  return res;
+}
+
+// ===========================================================
+// tee [file ...]
+// ===========================================================
+static int builtin_tee(char* argv[]) {
+  size_t num_files = 0;
+  while (argv[num_files + 1] != NULL) {
+    num_files++;
+  }
+  int* outs = malloc((num_files + 1) * sizeof(int));
+  if (!outs) {
+    perror("malloc failed");
+    exit(EXIT_FAILURE);
+  }
+  int res = EXIT_SUCCESS;
+  size_t count = 0;
+  outs[count++] = STDOUT_FILENO;
+  for (size_t i = 1; i <= num_files; i++) {
+    int fd = open(argv[i], O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0) {
+      fprintf(stderr, "tee: %s: %s\n", argv[i], strerror(errno));
+      res = EXIT_FAILURE;
+    } else {
+      outs[count++] = fd;
+    }
+  }
+  if (fd_tee(STDIN_FILENO, outs, count) != 0) {
+    perror("tee");
+    res = EXIT_FAILURE;
+  }
+  for (size_t i = 1; i < count; i++) {
+    close(outs[i]);
+  }
+  free(outs);
+  return res;
+}
+
+// ===========================================================
+// cp source target, cp source ... directory
+// ===========================================================
+static bool copy_operands(char* argv[]) {
+  return no_options(argv) && argv[1] != NULL && argv[2] != NULL;
+}
+
+// copies one file, with the permissions of the source
+static int copy_file(const char* source, const char* target) {
+  int in = open(source, O_RDONLY | O_CLOEXEC);
+  struct stat in_st;
+  if (in < 0 || fstat(in, &in_st) == -1) {
+    fprintf(stderr, "cp: %s: %s\n", source, strerror(errno));
+    if (in >= 0) {
+      close(in);
+    }
+    return EXIT_FAILURE;
+  }
+  struct stat out_st;
+  if (S_ISDIR(in_st.st_mode)) {
+    fprintf(stderr, "cp: %s: is a directory\n", source);
+    close(in);
+    return EXIT_FAILURE;
+  }
+  if (stat(target, &out_st) == 0 && out_st.st_dev == in_st.st_dev &&
+      out_st.st_ino == in_st.st_ino) {
+    fprintf(stderr, "cp: %s and %s are the same file\n", source, target);
+    close(in);
+    return EXIT_FAILURE;
+  }
+
+  int res = EXIT_SUCCESS;
+  int out = open(target, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                 in_st.st_mode & 0777);
+  if (out < 0 || fd_copy(in, out) != 0) {
+    fprintf(stderr, "cp: %s: %s\n", target, strerror(errno));
+    res = EXIT_FAILURE;
+  }
+  if (out >= 0) {
+    close(out);
+  }
+  close(in);
+  return res;
+}
+
+static int builtin_cp(char* argv[]) {
+  size_t count = 0;
+  while (argv[count + 1] != NULL) {
+    count++;
+  }
+  char* target = argv[count];
+  struct stat st;
+  bool to_dir = stat(target, &st) == 0 && S_ISDIR(st.st_mode);
+  if (count > 2 && !to_dir) {
+    fprintf(stderr, "cp: %s: not a directory\n", target);
+    return EXIT_FAILURE;
+  }
+
+  int res = EXIT_SUCCESS;
+  for (size_t i = 1; i < count; i++) {
+    if (!to_dir) {
+      res = copy_file(argv[i], target);
+      continue;
+    }
+    // into the directory, under the last part of the source path
+    const char* base = strrchr(argv[i], '/');
+    base = base != NULL ? base + 1 : argv[i];
+    size_t len = strlen(target) + strlen(base) + 2;
+    char* path = malloc(len);
+    if (!path) {
+      perror("malloc failed");
+      exit(EXIT_FAILURE);
+    }
+    snprintf(path, len, "%s/%s", target, base);
+    if (copy_file(argv[i], path) != EXIT_SUCCESS) {
+      res = EXIT_FAILURE;
+    }
+    free(path);
+  }
+  return res;
+}
+
+// ===========================================================
+// stats
+// ===========================================================
+static bool no_arguments(char* argv[]) {
+  return argv[1] == NULL;
+}
+
+static int builtin_stats(char* argv[]) {
+  (void)argv;
+  stats_print(stdout);
+  // a forked child leaves with _exit, which does not flush
+  fflush(stdout);
+  return EXIT_SUCCESS;
+}
+
+// ===========================================================
+// true, false
+// ===========================================================
+static int builtin_true(char* argv[]) {
+  (void)argv;
+  return EXIT_SUCCESS;
+}
+
+static int builtin_false(char* argv[]) {
+  (void)argv;
+  return EXIT_FAILURE;
+}
+
+// ===========================================================
+// echo [-n] [word ...]
+// ===========================================================
+static int builtin_echo(char* argv[]) {
+  char** word = &argv[1];
+  bool newline = true;
+  if (*word != NULL && strcmp(*word, "-n") == 0) {
+    newline = false;
+    word++;
+  }
+  for (char** first = word; *word != NULL; word++) {
+    if (word != first) {
+      fputc(' ', stdout);
+    }
+    fputs(*word, stdout);
+  }
+  if (newline) {
+    fputc('\n', stdout);
+  }
+  if (fflush(stdout) != 0) {
+    perror("echo");
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+// ===========================================================
+// pwd, cd [dir]
+// ===========================================================
+static int builtin_pwd(char* argv[]) {
+  (void)argv;
+  char* cwd = getcwd(NULL, 0);
+  if (cwd == NULL) {
+    perror("pwd");
+    return EXIT_FAILURE;
+  }
+  puts(cwd);
+  free(cwd);
+  fflush(stdout);
+  return EXIT_SUCCESS;
+}
+
+// changes to the directory, HOME without one, or OLDPWD for "-", and
+// keeps PWD and OLDPWD up to date
+static int builtin_cd(char* argv[]) {
+  if (argv[1] != NULL && argv[2] != NULL) {
+    fprintf(stderr, "cd: too many arguments\n");
+    return EXIT_FAILURE;
+  }
+  const char* dir = argv[1];
+  const char* var = NULL;
+  if (dir == NULL) {
+    var = "HOME";
+  } else if (strcmp(dir, "-") == 0) {
+    var = "OLDPWD";
+  }
+  if (var != NULL) {
+    dir = env_get(var);
+    if (dir == NULL) {
+      fprintf(stderr, "cd: %s not set\n", var);
+      return EXIT_FAILURE;
+    }
+  }
+
+  char* old = getcwd(NULL, 0);
+  if (chdir(dir) == -1) {
+    fprintf(stderr, "cd: %s: %s\n", dir, strerror(errno));
+    free(old);
+    return EXIT_FAILURE;
+  }
+  // dir may be the value of OLDPWD, which is replaced now
+  bool print = argv[1] != NULL && var != NULL;
+  char* cwd = getcwd(NULL, 0);
+  if (old != NULL) {
+    env_set("OLDPWD", old);
+  }
+  if (cwd != NULL) {
+    env_set("PWD", cwd);
+    if (print) {
+      puts(cwd);
+      fflush(stdout);
+    }
+  }
+  free(cwd);
+  free(old);
+  return EXIT_SUCCESS;
+}
+
+// ===========================================================
+// exit [status]
+// ===========================================================
+static int builtin_exit(char* argv[]) {
+  if (argv[1] == NULL) {
+    return EXIT_SUCCESS;
+  }
+  if (argv[2] != NULL) {
+    fprintf(stderr, "exit: too many arguments\n");
+    return EXIT_FAILURE;
+  }
+  char* end;
+  long status = strtol(argv[1], &end, 10);
+  if (end == argv[1] || *end != '\0') {
+    fprintf(stderr, "exit: %s: numeric argument required\n", argv[1]);
+    return 2;
+  }
+  return (int)(status & 0xff);
+}
+
+static int exit_in_shell(char* argv[]) {
+  int res = builtin_exit(argv);
+  // like other shells, it stays with too many arguments
+  pending.exit = argv[1] == NULL || argv[2] == NULL;
+  return res;
+}
+
+// ===========================================================
+// export [name[=value] ...], unset [name ...]
+// ===========================================================
+// names are a letter or '_', then letters, digits and '_'
+static bool valid_name(const char* name, size_t len) {
+  if (len == 0 || (name[0] >= '0' && name[0] <= '9')) {
+    return false;
+  }
+  for (size_t i = 0; i < len; i++) {
+    char c = name[i];
+    if (!(c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+          (c >= '0' && c <= '9'))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// keeps the path cache on the PATH the commands get
+static void check_path(const char* name) {
+  if (strcmp(name, "PATH") == 0) {
+    path_cache_set_path(env_get("PATH"));
+  }
+}
+
+// sets every name=value. Every variable is exported, so a name alone has
+// nothing to do, and without arguments the environment is printed
+static int builtin_export(char* argv[]) {
+  if (argv[1] == NULL) {
+    for (char** var = env_array(); *var != NULL; var++) {
+      puts(*var);
+    }
+    fflush(stdout);
+    return EXIT_SUCCESS;
+  }
+  int res = EXIT_SUCCESS;
+  for (char** arg = &argv[1]; *arg != NULL; arg++) {
+    char* equals = strchr(*arg, '=');
+    size_t len = equals != NULL ? (size_t)(equals - *arg) : strlen(*arg);
+    if (!valid_name(*arg, len)) {
+      fprintf(stderr, "export: %s: not a valid identifier\n", *arg);
+      res = EXIT_FAILURE;
+    } else if (equals != NULL) {
+      *equals = '\0';
+      env_set(*arg, equals + 1);
+      check_path(*arg);
+      *equals = '=';
+    }
+  }
+  return res;
+}
+
+static int builtin_unset(char* argv[]) {
+  int res = EXIT_SUCCESS;
+  for (char** arg = &argv[1]; *arg != NULL; arg++) {
+    if (!valid_name(*arg, strlen(*arg))) {
+      fprintf(stderr, "unset: %s: not a valid identifier\n", *arg);
+      res = EXIT_FAILURE;
+    } else {
+      env_unset(*arg);
+      check_path(*arg);
+    }
+  }
+  return res;
+}
+
+// ===========================================================
+// sleep duration
+// ===========================================================
+// parses a duration like GNU sleep: seconds, which may have a fraction,
+// with an optional s, m, h or d suffix. It is rounded up to milliseconds
+static bool parse_duration(const char* text, uint64_t* ms) {
+  static const struct {
+    const char* suffix;
+    double scale;
+  } kUnits[] = {{"", 1000}, {"s", 1000}, {"m", 60e3}, {"h", 3600e3},
+                {"d", 86400e3}};
+  char* end;
+  double value = strtod(text, &end);
+  if (end == text || !(value >= 0)) {
+    return false;
+  }
+  for (size_t i = 0; i < sizeof(kUnits) / sizeof(kUnits[0]); i++) {
+    double total = value * kUnits[i].scale;
+    if (strcmp(end, kUnits[i].suffix) == 0 &&
+        total <= (double)UINT32_MAX * 1000) {
+      *ms = (uint64_t)total;
+      *ms += (double)*ms < total;
+      return true;
+    }
+  }
+  return false;
+}
+
+// one duration, as sleep with several or "infinity" is left to the program
+static bool one_duration(char* argv[]) {
+  uint64_t ms;
+  return argv[1] != NULL && argv[2] == NULL && parse_duration(argv[1], &ms);
+}
+
+static int builtin_sleep(char* argv[]) {
+  uint64_t ms = 0;
+  parse_duration(argv[1], &ms);
+  struct timespec left = {(time_t)(ms / 1000), (long)(ms % 1000) * 1000000};
+  while (nanosleep(&left, &left) == -1 && errno == EINTR) {
+  }
+  return EXIT_SUCCESS;
+}
+
+// the shell finishes the command once the time has passed, on its timers
+static int sleep_in_shell(char* argv[]) {
+  parse_duration(argv[1], &pending.sleep_ms);
+  return EXIT_SUCCESS;
+}
+
+// ===========================================================
+// The table of builtins
+// ===========================================================
+static const builtin kBuiltins[] = {
+    {"cat", builtin_cat, no_options, NULL},
+    {"cd", builtin_cd, NULL, builtin_cd},
+    {"cp", builtin_cp, copy_operands, NULL},
+    {"echo", builtin_echo, NULL, builtin_echo},
+    {"exit", builtin_exit, NULL, exit_in_shell},
+    {"export", builtin_export, NULL, builtin_export},
+    {"false", builtin_false, NULL, builtin_false},
+    {"pwd", builtin_pwd, no_arguments, builtin_pwd},
+    {"sleep", builtin_sleep, one_duration, sleep_in_shell},
+    {"stats", builtin_stats, no_arguments, builtin_stats},
+    {"tee", builtin_tee, no_options, NULL},
+    {"true", builtin_true, NULL, builtin_true},
+    {"unset", builtin_unset, NULL, builtin_unset},
+};
+#define NUM_BUILTINS (sizeof(kBuiltins) / sizeof(kBuiltins[0]))
+
+const builtin* builtins_find(char* argv[]) {
+  for (size_t i = 0; i < NUM_BUILTINS; i++) {
+    const builtin* cur = &kBuiltins[i];
+    if (strcmp(argv[0], cur->name) == 0 &&
+        (cur->accepts == NULL || cur->accepts(argv))) {
+      return cur;
+    }
+  }
+  return NULL;
+}
+
+builtin_request builtins_take_request(void) {
+  builtin_request res = pending;
+  pending = (builtin_request){0};
+  return res;
+}
@@ -0,0 +1,64 @@
+#ifndef BUILTINS_H_
+#define BUILTINS_H_
+
+#include <stdint.h>
+#include "launch.h"
+
+/*!
+ * Commands penn-shredder implements itself instead of running a program.
+ *
+ * A builtin runs in a child forked from the shell, in place of the
+ * program of the same name, so it can be a stage of a pipeline or have
+ * its output redirected. One with a run_in_shell function runs in the
+ * shell itself when it is the whole command line, with no process started
+ * at all, which takes microseconds instead of a fork and an execve. That
+ * is how cd, exit, export and unset change the shell: in a child they
+ * only change the child, as in other shells. Builtins that can block for
+ * long, like cp on a large file, always run in a child, since the shell
+ * would handle no Ctrl+C, timeouts or other jobs until they return.
+ *
+ * export and unset change the environment of the commands (see env.h),
+ * and setting PATH points the path cache at the new directories. sleep in
+ * the shell only asks for its command to finish later, so the shell goes
+ * on handling Ctrl+C, timeouts and other jobs meanwhile.
+ *
+ * cat, tee and cp move their data in the kernel (see fd_copy.h), so it
+ * never passes through user space. A builtin only replaces the program
+ * for the arguments it supports, e.g. cp without options, and the program
+ * runs otherwise.
+ *
+ * To add a builtin, write its function and add it to kBuiltins in
+ * builtins.c.
+ */
+
+typedef struct builtin_st {
+  const char* name;
+  launch_fn run;  // in a child, returns the exit status
+  // whether the builtin supports these arguments, NULL if it supports any
+  bool (*accepts)(char* argv[]);
+  // in the shell when not in a pipeline, NULL if it always needs a child
+  launch_fn run_in_shell;
+} builtin;
+
+/* What a builtin run in the shell asks the shell to do once it returns. */
+typedef struct builtin_request_st {
+  bool exit;          // stop reading commands, with the builtin's status
+  uint64_t sleep_ms;  // finish the command this much later, 0 for now
+} builtin_request;
+
+/*!
+ * Finds the builtin that runs a command.
+ *
+ * @param argv the NULL terminated arguments of the command.
+ * @returns the builtin, or NULL if the program should run instead.
+ */
+const builtin* builtins_find(char* argv[]);
+
+/*!
+ * Takes what the last builtin run in the shell asked for, and clears it.
+ *
+ * @returns the request, all zero if there is none.
+ */
+builtin_request builtins_take_request(void);
+
+#endif  // BUILTINS_H_
@@ -0,0 +1,116 @@
+#include "env.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_CAPACITY 16
+
+// Global Variables
+static char** vars = NULL;  // "NAME=value", followed by NULL
+static size_t num_vars = 0;
+static size_t capacity = 0;  // including the NULL
+
+static char* checked_strdup(const char* str) {
+  char* res = strdup(str);
+  if (!res) {
+    perror("strdup failed");
+    exit(EXIT_FAILURE);
+  }
+  return res;
+}
+
+static void reserve(size_t count) {
+  if (count + 1 <= capacity) {
+    return;
+  }
+  size_t new_capacity = capacity < MIN_CAPACITY ? MIN_CAPACITY : capacity;
+  while (new_capacity < count + 1) {
+    new_capacity *= 2;
+  }
+  char** grown = realloc(vars, new_capacity * sizeof(char*));
+  if (!grown) {
+    perror("realloc failed");
+    exit(EXIT_FAILURE);
+  }
+  vars = grown;
+  capacity = new_capacity;
+}
+
+// the index of a variable, or num_vars if it is not set
+static size_t find(const char* name) {
+  size_t len = strlen(name);
+  for (size_t i = 0; i < num_vars; i++) {
+    if (strncmp(vars[i], name, len) == 0 && vars[i][len] == '=') {
+      return i;
+    }
+  }
+  return num_vars;
+}
+
+void env_init(char* envp[]) {
+  env_free();
+  size_t count = 0;
+  while (envp[count] != NULL) {
+    count++;
+  }
+  reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    vars[i] = checked_strdup(envp[i]);
+  }
+  num_vars = count;
+  vars[num_vars] = NULL;
+}
+
+const char* env_get(const char* name) {
+  size_t idx = find(name);
+  return idx < num_vars ? vars[idx] + strlen(name) + 1 : NULL;
+}
+
+void env_set(const char* name, const char* value) {
+  size_t len = strlen(name) + strlen(value) + 2;
+  char* var = malloc(len);
+  if (!var) {
+    perror("malloc failed");
+    exit(EXIT_FAILURE);
+  }
+  snprintf(var, len, "%s=%s", name, value);
+
+  size_t idx = find(name);
+  if (idx < num_vars) {
+    free(vars[idx]);
+  } else {
+    reserve(num_vars + 1);
+    num_vars++;
+    vars[num_vars] = NULL;
+  }
+  vars[idx] = var;
+}
+
+void env_unset(const char* name) {
+  size_t idx = find(name);
+  if (idx == num_vars) {
+    return;
+  }
+  free(vars[idx]);
+  // the order does not matter, so the last one takes its place
+  vars[idx] = vars[--num_vars];
+  vars[num_vars] = NULL;
+}
+
+char** env_array(void) {
+  if (vars == NULL) {
+    reserve(0);
+    vars[0] = NULL;
+  }
+  return vars;
+}
+
+void env_free(void) {
+  for (size_t i = 0; i < num_vars; i++) {
+    free(vars[i]);
+  }
+  free(vars);
+  vars = NULL;
+  num_vars = 0;
+  capacity = 0;
+}
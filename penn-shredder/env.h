@@ -0,0 +1,59 @@
+#ifndef ENV_H_
+#define ENV_H_
+
+/*!
+ * The environment the shell gives the commands it runs.
+ *
+ * It starts as a copy of the environment of the shell, and the export and
+ * unset builtins change it, so the environ of the shell itself is left
+ * alone. Variables are kept as "NAME=value" strings in one NULL terminated
+ * array, the form execve takes, so starting a command copies nothing. A
+ * lookup scans the array, which rarely holds more than a few dozen
+ * variables.
+ */
+
+/*!
+ * Copies an environment.
+ *
+ * @param envp the NULL terminated "NAME=value" strings, e.g. from main.
+ * @post if memory allocation fails, the program exits.
+ */
+void env_init(char* envp[]);
+
+/*!
+ * Finds the value of a variable.
+ *
+ * @param name the name of the variable.
+ * @returns its value, which stays valid until it is changed, or NULL if it
+ *          is not set.
+ */
+const char* env_get(const char* name);
+
+/*!
+ * Sets a variable, replacing its value if it is set already.
+ *
+ * @param name  the name, which must not contain '='.
+ * @param value the value.
+ * @post if memory allocation fails, the program exits.
+ */
+void env_set(const char* name, const char* value);
+
+/*!
+ * Removes a variable, if it is set.
+ *
+ * @param name the name of the variable.
+ */
+void env_unset(const char* name);
+
+/*!
+ * The environment to start a command with.
+ *
+ * @returns the NULL terminated "NAME=value" strings, which stay valid until
+ *          the next change.
+ */
+char** env_array(void);
+
+/* Frees the environment. */
+void env_free(void);
+
+#endif  // ENV_H_
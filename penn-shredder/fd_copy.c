@@ -0,0 +1,193 @@
+#define _GNU_SOURCE  // copy_file_range, splice, tee, F_GETPIPE_SZ
+#include "fd_copy.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// the most bytes moved by one system call
+#define CHUNK_SIZE (1 << 20)
+// the buffer of the fallback that copies in user space
+#define BUFFER_SIZE (64 * 1024)
+
+static bool is_type(int fd, mode_t type) {
+  struct stat st;
+  return fstat(fd, &st) == 0 && (st.st_mode & S_IFMT) == type;
+}
+
+static int write_all(int fd, const char* buf, size_t len) {
+  while (len > 0) {
+    ssize_t written = write(fd, buf, len);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    buf += written;
+    len -= (size_t)written;
+  }
+  return 0;
+}
+
+// reads `in` until its end, or `limit` bytes if it is not -1, and writes
+// what it reads to every output
+static int copy_buffered(int in, const int* outs, size_t count, ssize_t limit) {
+  char* buf = malloc(BUFFER_SIZE);
+  if (!buf) {
+    perror("malloc failed");
+    exit(EXIT_FAILURE);
+  }
+  int res = 0;
+  while (limit != 0) {
+    size_t want = BUFFER_SIZE;
+    if (limit > 0 && (size_t)limit < want) {
+      want = (size_t)limit;
+    }
+    ssize_t num_bytes = read(in, buf, want);
+    if (num_bytes < 0 && errno == EINTR) {
+      continue;
+    }
+    if (num_bytes <= 0) {
+      res = (int)num_bytes;
+      break;
+    }
+    for (size_t i = 0; i < count && res == 0; i++) {
+      res = write_all(outs[i], buf, (size_t)num_bytes);
+    }
+    if (res != 0) {
+      break;
+    }
+    if (limit > 0) {
+      limit -= num_bytes;
+    }
+  }
+  free(buf);
+  return res;
+}
+
+typedef enum copy_call_en {
+  COPY_FILE_RANGE,
+  COPY_SPLICE,
+  COPY_SENDFILE,
+} copy_call;
+
+// moves data with a system call that copies in the kernel until the end
+// of `in`. Returns 1 without moving anything if the kernel cannot do it
+// for these descriptors, so the caller can fall back
+static int copy_in_kernel(int in, int out, copy_call call) {
+  bool moved = false;
+  while (true) {
+    ssize_t num_bytes;
+    if (call == COPY_FILE_RANGE) {
+      num_bytes = copy_file_range(in, NULL, out, NULL, CHUNK_SIZE, 0);
+    } else if (call == COPY_SPLICE) {
+      num_bytes = splice(in, NULL, out, NULL, CHUNK_SIZE,
+                         SPLICE_F_MOVE | SPLICE_F_MORE);
+    } else {
+      num_bytes = sendfile(out, in, NULL, CHUNK_SIZE);
+    }
+    if (num_bytes == 0) {
+      return 0;
+    }
+    if (num_bytes > 0) {
+      moved = true;
+    } else if (!moved && (errno == EINVAL || errno == EXDEV ||
+                          errno == EBADF || errno == EOPNOTSUPP ||
+                          errno == ENOSYS)) {
+      // e.g. files on two file systems on kernels before 5.19, or an
+      // output opened for appending
+      return 1;
+    } else if (errno != EINTR) {
+      return -1;
+    }
+  }
+}
+
+int fd_copy(int in, int out) {
+  int res = 1;
+  bool in_regular = is_type(in, S_IFREG);
+  if (in_regular && is_type(out, S_IFREG)) {
+    res = copy_in_kernel(in, out, COPY_FILE_RANGE);
+  }
+  if (res == 1 && (is_type(in, S_IFIFO) || is_type(out, S_IFIFO))) {
+    res = copy_in_kernel(in, out, COPY_SPLICE);
+  }
+  if (res == 1 && in_regular) {
+    res = copy_in_kernel(in, out, COPY_SENDFILE);
+  }
+  if (res == 1) {
+    res = copy_buffered(in, &out, 1, -1);
+  }
+  return res;
+}
+
+// splices `len` bytes out of the pipe `in`, which holds at least that many
+static int drain(int in, int out, size_t len) {
+  while (len > 0) {
+    ssize_t num_bytes = splice(in, NULL, out, NULL, len, SPLICE_F_MOVE);
+    if (num_bytes > 0) {
+      len -= (size_t)num_bytes;
+    } else if (num_bytes < 0 && errno == EINVAL) {
+      // e.g. a terminal, or a file opened for appending
+      return copy_buffered(in, &out, 1, (ssize_t)len);
+    } else if (num_bytes == 0 || errno != EINTR) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int fd_tee(int in, const int* outs, size_t count) {
+  if (count == 1) {
+    return fd_copy(in, outs[0]);
+  }
+  if (!is_type(in, S_IFIFO)) {
+    return copy_buffered(in, outs, count, -1);
+  }
+
+  // a pipe as large as the input, so a tee into it never comes up short
+  int scratch[2];
+  if (pipe2(scratch, O_CLOEXEC) == -1) {
+    return -1;
+  }
+  int in_size = fcntl(in, F_GETPIPE_SZ);
+  if (in_size > 0) {
+    fcntl(scratch[1], F_SETPIPE_SZ, in_size);
+  }
+
+  int res = 0;
+  bool ended = false;
+  while (res == 0 && !ended) {
+    // duplicate what the input holds for every output but the last, and
+    // move it into the scratch pipe for the last one
+    ssize_t len = CHUNK_SIZE;
+    for (size_t i = 0; i < count && res == 0; i++) {
+      ssize_t num_bytes;
+      do {
+        num_bytes = i + 1 < count
+                        ? tee(in, scratch[1], (size_t)len, 0)
+                        : splice(in, NULL, scratch[1], NULL, (size_t)len, 0);
+      } while (num_bytes < 0 && errno == EINTR);
+      if (num_bytes < 0) {
+        res = -1;
+      } else if (i == 0 && num_bytes == 0) {
+        ended = true;
+        break;
+      } else if (i > 0 && num_bytes != len) {
+        errno = EIO;
+        res = -1;
+      } else {
+        len = num_bytes;
+        res = drain(scratch[0], outs[i], (size_t)len);
+      }
+    }
+  }
+  close(scratch[0]);
+  close(scratch[1]);
+  return res;
+}
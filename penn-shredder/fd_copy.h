@@ -0,0 +1,42 @@
+#ifndef FD_COPY_H_
+#define FD_COPY_H_
+
+#include <stddef.h>
+
+/*!
+ * Copies data between file descriptors without it passing through user
+ * space where the kernel allows it.
+ *
+ * Between two regular files, copy_file_range(2) copies in the kernel, or
+ * only shares the blocks on file systems with reflinks. When either side
+ * is a pipe, the data is moved with splice(2), which hands the pages of
+ * the pipe buffer over instead of copying them. From a regular file to
+ * anything else, sendfile(2) copies in the kernel. Only when none of them
+ * applies, e.g. from a terminal to a file, is the data read into a buffer
+ * and written out again.
+ */
+
+/*!
+ * Copies everything from `in` until its end to `out`.
+ *
+ * @param in  the descriptor to read, from its current offset.
+ * @param out the descriptor to write, at its current offset.
+ * @returns 0 on success, or -1 with errno set if a read or write failed.
+ */
+int fd_copy(int in, int out);
+
+/*!
+ * Copies everything from `in` until its end to each of `outs`.
+ *
+ * If `in` is a pipe, tee(2) duplicates its contents into a pipe of our
+ * own for all but the last output, which is then spliced out, and the
+ * last output takes the data itself, so nothing is copied in user space.
+ *
+ * @param in    the descriptor to read.
+ * @param outs  the descriptors to write.
+ * @param count the number of outputs, at least 1.
+ * @returns 0 on success, or -1 with errno set if a read or write failed.
+ */
+int fd_tee(int in, const int* outs, size_t count);
+
+#endif  // FD_COPY_H_
@@ -0,0 +1,271 @@
+#include "jobs.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+
+#define MIN_TABLE_SIZE 8
+#define MIN_REPORTS 16
+
+// a running process and its job
+typedef struct slot_st {
+  pid_t pid;
+  job* owner;  // NULL if the slot is free
+} slot;
+
+// the exit status of a finished job, waiting for the ones before it
+typedef struct report_st {
+  bool ready;
+  bool timed_out;
+  int status;
+  char* name;
+} report;
+
+// Global Variables
+volatile sig_atomic_t jobs_running = 0;
+static slot* table = NULL;     // open addressing, linear probing
+static size_t table_size = 0;  // a power of two, at least 2 * table_used
+static size_t table_used = 0;  // running processes
+static size_t next_seq = 0;    // the seq of the next job
+
+static bool reporting = false;
+static report* reports = NULL;   // a ring of the jobs from report_seq on
+static size_t reports_size = 0;  // a power of two
+static size_t report_seq = 0;    // the first job not reported yet
+
+static void* checked_calloc(size_t count, size_t size) {
+  void* res = calloc(count, size);
+  if (!res) {
+    perror("calloc failed");
+    exit(EXIT_FAILURE);
+  }
+  return res;
+}
+
+static char* checked_strdup(const char* str) {
+  char* res = strdup(str);
+  if (!res) {
+    perror("strdup failed");
+    exit(EXIT_FAILURE);
+  }
+  return res;
+}
+
+static size_t slot_of(pid_t pid, size_t size) {
+  // Fibonacci hashing, pids are mostly consecutive
+  return (size_t)(((uint64_t)pid * 11400714819323198485ULL) >> 32) &
+         (size - 1);
+}
+
+static void insert(slot* slots, size_t size, pid_t pid, job* owner) {
+  size_t idx = slot_of(pid, size);
+  while (slots[idx].owner != NULL) {
+    idx = (idx + 1) & (size - 1);
+  }
+  slots[idx].pid = pid;
+  slots[idx].owner = owner;
+}
+
+static void grow_table(void) {
+  size_t new_size = table_size * 2;
+  slot* slots = checked_calloc(new_size, sizeof(slot));
+  for (size_t i = 0; i < table_size; i++) {
+    if (table[i].owner != NULL) {
+      insert(slots, new_size, table[i].pid, table[i].owner);
+    }
+  }
+  free(table);
+  table = slots;
+  table_size = new_size;
+}
+
+// removes the slot of a pid
+static void remove_pid(pid_t pid) {
+  // backward shift deletion: move later entries of the probe sequence
+  // into the hole, so lookups never need tombstones
+  size_t hole = slot_of(pid, table_size);
+  while (table[hole].pid != pid || table[hole].owner == NULL) {
+    hole = (hole + 1) & (table_size - 1);
+  }
+  size_t idx = hole;
+  while (true) {
+    idx = (idx + 1) & (table_size - 1);
+    if (table[idx].owner == NULL) {
+      break;
+    }
+    size_t home = slot_of(table[idx].pid, table_size);
+    // the entry may move to the hole if its home is not in (hole, idx]
+    bool stays = hole <= idx ? (hole < home && home <= idx)
+                             : (hole < home || home <= idx);
+    if (!stays) {
+      table[hole] = table[idx];
+      hole = idx;
+    }
+  }
+  table[hole].owner = NULL;
+  table_used--;
+}
+
+// ===========================================================
+// Reports in the order jobs were started
+// ===========================================================
+static void grow_reports(void) {
+  size_t new_size = reports_size == 0 ? MIN_REPORTS : reports_size * 2;
+  report* ring = checked_calloc(new_size, sizeof(report));
+  for (size_t seq = report_seq; seq < next_seq; seq++) {
+    ring[seq & (new_size - 1)] = reports[seq & (reports_size - 1)];
+  }
+  free(reports);
+  reports = ring;
+  reports_size = new_size;
+}
+
+static void print_report(size_t seq, const report* rep) {
+  if (rep->timed_out) {
+    fprintf(stderr, "[%zu] %s: timed out\n", seq + 1, rep->name);
+  } else if (WIFSIGNALED(rep->status)) {
+    fprintf(stderr, "[%zu] %s: signal %d\n", seq + 1, rep->name,
+            WTERMSIG(rep->status));
+  } else {
+    fprintf(stderr, "[%zu] %s: exit %d\n", seq + 1, rep->name,
+            WEXITSTATUS(rep->status));
+  }
+}
+
+// prints every report that no longer waits for an earlier job
+static void flush_reports(void) {
+  while (report_seq < next_seq) {
+    report* rep = &reports[report_seq & (reports_size - 1)];
+    if (!rep->ready) {
+      break;
+    }
+    print_report(report_seq, rep);
+    free(rep->name);
+    rep->name = NULL;
+    rep->ready = false;
+    report_seq++;
+  }
+}
+
+// ===========================================================
+// Public functions
+// ===========================================================
+void jobs_init(size_t max_jobs, bool report_status) {
+  table_size = MIN_TABLE_SIZE;
+  while (table_size < 2 * max_jobs) {
+    table_size *= 2;
+  }
+  table = checked_calloc(table_size, sizeof(slot));
+  reporting = report_status;
+}
+
+job* jobs_add(const char* name, size_t max_procs) {
+  if (reporting && next_seq - report_seq == reports_size) {
+    grow_reports();
+  }
+  job* res = checked_calloc(1, sizeof(job));
+  res->seq = next_seq++;
+  res->timed_out = false;
+  res->status = W_EXITCODE(EXIT_FAILURE, 0);
+  res->procs = checked_calloc(max_procs, sizeof(process));
+  res->name = checked_strdup(name);
+  jobs_running++;
+  return res;
+}
+
+process* jobs_add_process(job* self, pid_t pid, const char* name, bool last) {
+  if (2 * (table_used + 1) > table_size) {
+    grow_table();
+  }
+  insert(table, table_size, pid, self);
+  table_used++;
+
+  if (self->num_procs == 0) {
+    self->pgid = pid;
+  }
+  if (last) {
+    self->last_pid = pid;
+  }
+  process* res = &self->procs[self->num_procs++];
+  res->pid = pid;
+  res->pidfd = -1;
+  res->reaped = false;
+  res->name = checked_strdup(name);
+  self->num_running++;
+  return res;
+}
+
+job* jobs_find(pid_t pid, process** proc) {
+  size_t idx = slot_of(pid, table_size);
+  while (table[idx].owner != NULL) {
+    if (table[idx].pid == pid) {
+      job* owner = table[idx].owner;
+      for (size_t i = 0; i < owner->num_procs; i++) {
+        if (owner->procs[i].pid == pid) {
+          *proc = &owner->procs[i];
+        }
+      }
+      return owner;
+    }
+    idx = (idx + 1) & (table_size - 1);
+  }
+  return NULL;
+}
+
+void jobs_reap_process(job* self, process* proc, int status) {
+  remove_pid(proc->pid);
+  proc->reaped = true;
+  self->num_running--;
+  if (proc->pid == self->last_pid) {
+    self->status = status;
+  }
+}
+
+void jobs_finish(job* self) {
+  if (reporting) {
+    report* rep = &reports[self->seq & (reports_size - 1)];
+    rep->ready = true;
+    rep->timed_out = self->timed_out;
+    rep->status = self->status;
+    rep->name = self->name;
+    flush_reports();
+  } else {
+    free(self->name);
+  }
+  jobs_running--;
+  for (size_t i = 0; i < self->num_procs; i++) {
+    free(self->procs[i].name);
+  }
+  free(self->procs);
+  free(self);
+}
+
+void jobs_signal_all(int signo) {
+  for (size_t i = 0; i < table_size; i++) {
+    // once per job: from the slot of its first running process
+    job* owner = table[i].owner;
+    if (owner == NULL) {
+      continue;
+    }
+    size_t first = 0;
+    while (owner->procs[first].reaped) {
+      first++;
+    }
+    if (owner->procs[first].pid == table[i].pid) {
+      kill(-owner->pgid, signo);
+      // a stopped job only acts on the signal once it runs again
+      kill(-owner->pgid, SIGCONT);
+    }
+  }
+}
+
+void jobs_free(void) {
+  free(table);
+  table = NULL;
+  table_size = 0;
+  table_used = 0;
+  free(reports);
+  reports = NULL;
+  reports_size = 0;
+}
@@ -0,0 +1,128 @@
+#ifndef JOBS_H_
+#define JOBS_H_
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "timer_wheel.h"
+
+/*!
+ * The table of running commands, keyed by pid.
+ *
+ * A job is a command line: one process, or one per stage of a pipeline,
+ * all in the process group of the first. It finishes when all of them
+ * have been reaped, with the exit status of the last stage.
+ *
+ * Every job gets a sequence number in the order it was started. When a
+ * job finishes, its exit status can be reported, in that order: a job
+ * that finishes early waits in a queue until all jobs started before it
+ * have been reported.
+ *
+ * The table is an open addressing hash table from the pid of every
+ * running process to its job, so looking up a reaped child costs a hash
+ * and usually one compare. It grows with the number of processes. Jobs
+ * are allocated one by one, so a job stays at the same address while it
+ * runs, as its timer needs.
+ */
+
+typedef struct process_st {
+  pid_t pid;
+  int pidfd;            // readable once it exits, -1 if there is none
+  bool reaped;          // set once it has exited and been waited for
+  uint64_t started_us;  // CLOCK_MONOTONIC, for its wall time
+  char* name;           // the command name, for the statistics
+} process;
+
+typedef struct job_st {
+  pid_t pgid;          // the process group, the pid of the first process
+  size_t seq;          // the order the job was started in
+  Timer timer;         // scheduled while the job has a timeout
+  bool timed_out;      // set once the job was killed for its timeout
+  int status;          // the status of the last stage once it is reaped
+  process* procs;      // in pipeline order
+  size_t num_procs;    // started so far
+  size_t num_running;  // started and not reaped yet
+  pid_t last_pid;      // the last stage, 0 if it did not start
+  char* name;          // the command names, for the report
+  // for `time` and for jobs without processes, like sleep in the shell
+  bool timed;           // print its times when it finishes
+  uint64_t started_us;  // CLOCK_MONOTONIC
+  uint64_t user_us;     // CPU time of the processes reaped so far
+  uint64_t sys_us;
+} job;
+
+/* Number of running jobs. */
+extern volatile sig_atomic_t jobs_running;
+
+/*!
+ * Sets up an empty table.
+ *
+ * @param max_jobs the most jobs that can run at once, at least 1.
+ * @param report_status whether to print the exit status of every job, in the
+ *                      order the jobs were started.
+ * @post if memory allocation fails, the program exits.
+ */
+void jobs_init(size_t max_jobs, bool report_status);
+
+/*!
+ * Adds a job with no processes and no timer scheduled yet. There must be
+ * fewer than max_jobs running. Until its last stage is reaped, its status
+ * is that of a command that failed to start.
+ *
+ * @param name      the command names, which are copied.
+ * @param max_procs the number of stages.
+ * @returns the new job.
+ * @post if memory allocation fails, the program exits.
+ */
+job* jobs_add(const char* name, size_t max_procs);
+
+/*!
+ * Adds a started process to a job, with no pidfd yet. The first one gives
+ * the job its process group.
+ *
+ * @param self the job.
+ * @param pid  the pid of the child.
+ * @param name the command name, which is copied.
+ * @param last true if it is the last stage of the pipeline.
+ * @returns the new process.
+ * @post if memory allocation fails, the program exits.
+ */
+process* jobs_add_process(job* self, pid_t pid, const char* name, bool last);
+
+/*!
+ * Finds the job a pid belongs to.
+ *
+ * @param pid  the pid.
+ * @param proc set to its process, if found.
+ * @returns the job, or NULL if the pid is not one of ours.
+ */
+job* jobs_find(pid_t pid, process** proc);
+
+/*!
+ * Takes a reaped process out of the table. Its pidfd must be closed
+ * already.
+ *
+ * @param self   the job.
+ * @param proc   the process.
+ * @param status the status from wait4.
+ */
+void jobs_reap_process(job* self, process* proc, int status);
+
+/*!
+ * Removes a job whose processes have all been reaped, reporting its exit
+ * status if reports are on, and frees it. Its timer must be cancelled
+ * already.
+ *
+ * @param self the job.
+ */
+void jobs_finish(job* self);
+
+/* Sends a signal, then SIGCONT, to the process group of every running job. */
+void jobs_signal_all(int signo);
+
+/* Frees the table. Every job must have finished. */
+void jobs_free(void);
+
+#endif  // JOBS_H_
@@ -0,0 +1,256 @@
+#define _GNU_SOURCE  // clone
+#include "launch.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// the signals penn-shredder installs handlers for: SIGIO, from the inotify
+// of the path cache. The others are blocked and read from a signalfd. The
+// child resets them to the default before it can receive anything
+static const int kCaughtSignals[] = {SIGIO};
+#define NUM_CAUGHT_SIGNALS \
+  (sizeof(kCaughtSignals) / sizeof(kCaughtSignals[0]))
+
+// the vfork child only runs until execve, so it needs very little stack
+#define VFORK_STACK_SIZE (64 * 1024)
+
+bool launch_backend_parse(const char* name, launch_backend* backend) {
+  if (strcmp(name, "fork") == 0) {
+    *backend = LAUNCH_FORK;
+  } else if (strcmp(name, "spawn") == 0) {
+    *backend = LAUNCH_SPAWN;
+  } else if (strcmp(name, "vfork") == 0) {
+    *backend = LAUNCH_VFORK;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+static void reset_child_signals(void) {
+  struct sigaction dfl = {0};
+  dfl.sa_handler = SIG_DFL;
+  sigemptyset(&dfl.sa_mask);
+  for (size_t i = 0; i < NUM_CAUGHT_SIGNALS; i++) {
+    sigaction(kCaughtSignals[i], &dfl, NULL);
+  }
+  sigset_t none;
+  sigemptyset(&none);
+  sigprocmask(SIG_SETMASK, &none, NULL);
+}
+
+// joins the process group and moves the file descriptors into place, in
+// the child. Only makes system calls, so a vfork child may call it.
+// Returns the path of the redirection that failed, with errno set, or NULL
+static const char* setup_child_io(const launch_io* io) {
+  setpgid(0, io->pgid);
+  if (io->stdin_fd >= 0) {
+    dup2(io->stdin_fd, STDIN_FILENO);
+  }
+  if (io->stdout_fd >= 0) {
+    dup2(io->stdout_fd, STDOUT_FILENO);
+  }
+  for (size_t i = 0; i < io->num_redirects; i++) {
+    const launch_redirect* redirect = &io->redirects[i];
+    int fd = open(redirect->path, redirect->flags, 0666);
+    if (fd < 0) {
+      return redirect->path;
+    }
+    if (fd != redirect->fd) {
+      dup2(fd, redirect->fd);
+      close(fd);
+    }
+  }
+  return NULL;
+}
+
+// for a child that has stdio to itself
+static void exit_if_failed(const char* failed) {
+  if (failed != NULL) {
+    fprintf(stderr, "%s: %s\n", failed, strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+}
+
+// the same from the parent, in case it runs before the child does
+static void setup_parent_pgid(pid_t pid, const launch_io* io) {
+  setpgid(pid, io->pgid == 0 ? pid : io->pgid);
+}
+
+// ===========================================================
+// fork
+// ===========================================================
+static pid_t launch_fork(const char* path,
+                         char* argv[],
+                         char* envp[],
+                         const launch_io* io) {
+  pid_t pid = fork();
+  if (pid < 0) {
+    perror("fork failed");
+    return -1;
+  }
+  if (pid == 0) {
+    exit_if_failed(setup_child_io(io));
+    reset_child_signals();
+    execve(path, argv, envp);
+    perror("execve failed");
+    exit(EXIT_FAILURE);
+  }
+  setup_parent_pgid(pid, io);
+  return pid;
+}
+
+// ===========================================================
+// posix_spawn
+// ===========================================================
+static pid_t launch_posix(const char* path,
+                          char* argv[],
+                          char* envp[],
+                          const launch_io* io) {
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  if (io->stdin_fd >= 0) {
+    posix_spawn_file_actions_adddup2(&actions, io->stdin_fd, STDIN_FILENO);
+  }
+  if (io->stdout_fd >= 0) {
+    posix_spawn_file_actions_adddup2(&actions, io->stdout_fd, STDOUT_FILENO);
+  }
+  for (size_t i = 0; i < io->num_redirects; i++) {
+    const launch_redirect* redirect = &io->redirects[i];
+    posix_spawn_file_actions_addopen(&actions, redirect->fd, redirect->path,
+                                     redirect->flags, 0666);
+  }
+
+  posix_spawnattr_t attr;
+  posix_spawnattr_init(&attr);
+  sigset_t defaults;
+  sigemptyset(&defaults);
+  for (size_t i = 0; i < NUM_CAUGHT_SIGNALS; i++) {
+    sigaddset(&defaults, kCaughtSignals[i]);
+  }
+  sigset_t none;
+  sigemptyset(&none);
+  posix_spawnattr_setsigdefault(&attr, &defaults);
+  posix_spawnattr_setsigmask(&attr, &none);
+  posix_spawnattr_setpgroup(&attr, io->pgid);
+  posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGDEF |
+                                      POSIX_SPAWN_SETSIGMASK |
+                                      POSIX_SPAWN_SETPGROUP);
+
+  pid_t pid;
+  int err = posix_spawn(&pid, path, &actions, &attr, argv, envp);
+  posix_spawnattr_destroy(&attr);
+  posix_spawn_file_actions_destroy(&actions);
+  if (err != 0) {
+    // glibc reports a failed execve here instead of in the child, and a
+    // failed redirection the same way
+    errno = err;
+    perror(io->num_redirects > 0 ? "execve or redirection failed"
+                                 : "execve failed");
+    return -1;
+  }
+  return pid;
+}
+
+// ===========================================================
+// clone(CLONE_VM | CLONE_VFORK)
+// ===========================================================
+typedef struct vfork_args_st {
+  const char* path;
+  char** argv;
+  char** envp;
+  const launch_io* io;
+  int err;             // set by the child if execve or a redirection fails
+  const char* failed;  // the redirection that failed
+} vfork_args;
+
+static int vfork_child(void* arg) {
+  // this runs on the parent's memory while the parent is suspended, so it
+  // must not touch anything but its arguments
+  vfork_args* args = (vfork_args*)arg;
+  args->failed = setup_child_io(args->io);
+  if (args->failed != NULL) {
+    args->err = errno;
+    _exit(EXIT_FAILURE);
+  }
+  reset_child_signals();
+  execve(args->path, args->argv, args->envp);
+  args->err = errno;
+  _exit(EXIT_FAILURE);
+}
+
+static pid_t launch_vfork(const char* path,
+                          char* argv[],
+                          char* envp[],
+                          const launch_io* io) {
+  static char stack[VFORK_STACK_SIZE] __attribute__((aligned(16)));
+
+  // no handler of the shell may run in the child before it resets them,
+  // so every signal stays blocked until then
+  sigset_t all;
+  sigset_t old;
+  sigfillset(&all);
+  sigprocmask(SIG_SETMASK, &all, &old);
+
+  vfork_args args = {path, argv, envp, io, 0, NULL};
+  pid_t pid = clone(vfork_child, stack + VFORK_STACK_SIZE,
+                    CLONE_VM | CLONE_VFORK | SIGCHLD, &args);
+  int clone_errno = errno;
+  sigprocmask(SIG_SETMASK, &old, NULL);
+
+  if (pid < 0) {
+    errno = clone_errno;
+    perror("clone failed");
+    return -1;
+  }
+  if (args.err != 0) {
+    // the child is gone already, reap it so it is not mistaken for a job
+    waitpid(pid, NULL, 0);
+    errno = args.err;
+    perror(args.failed != NULL ? args.failed : "execve failed");
+    return -1;
+  }
+  return pid;
+}
+
+pid_t launch_command(launch_backend backend,
+                     const char* path,
+                     char* argv[],
+                     char* envp[],
+                     const launch_io* io) {
+  switch (backend) {
+    case LAUNCH_SPAWN:
+      return launch_posix(path, argv, envp, io);
+    case LAUNCH_VFORK:
+      return launch_vfork(path, argv, envp, io);
+    case LAUNCH_FORK:
+    default:
+      return launch_fork(path, argv, envp, io);
+  }
+}
+
+pid_t launch_function(launch_fn fn, char* argv[], const launch_io* io) {
+  pid_t pid = fork();
+  if (pid < 0) {
+    perror("fork failed");
+    return -1;
+  }
+  if (pid == 0) {
+    exit_if_failed(setup_child_io(io));
+    // no execve closes the shell's descriptors, e.g. the ends of the other
+    // pipes, which would keep their readers from seeing the end of input
+    close_range(STDERR_FILENO + 1, ~0U, 0);
+    reset_child_signals();
+    // _exit, so the child does not flush what the shell has buffered
+    _exit(fn(argv));
+  }
+  setup_parent_pgid(pid, io);
+  return pid;
+}
@@ -0,0 +1,97 @@
+#ifndef LAUNCH_H_
+#define LAUNCH_H_
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+/*!
+ * Ways of starting a child process.
+ *
+ * fork() copies the page tables of the shell before the child can execve,
+ * so its cost grows with the shell's address space. The other two
+ * backends share the parent's memory until the child calls execve, so
+ * starting a command costs the same no matter how big the shell is:
+ *
+ * - LAUNCH_SPAWN uses posix_spawn(), which glibc implements with
+ *   clone(CLONE_VM | CLONE_VFORK).
+ * - LAUNCH_VFORK calls clone(CLONE_VM | CLONE_VFORK) directly on a small
+ *   stack of its own.
+ *
+ * Every backend starts the child with the shell's signal handlers reset
+ * to the default and no blocked signals, so Ctrl+C still reaches it.
+ *
+ * Each child is put into a process group, so a whole pipeline can be
+ * signalled at once. The child joins it before execve, and the parent
+ * sets it as well, so it is in place whichever of them runs first.
+ *
+ * Redirections are opened by the child, between fork and execve, and
+ * moved onto their descriptor with dup2, so the shell never has them open.
+ */
+typedef enum launch_backend_en {
+  LAUNCH_FORK,
+  LAUNCH_SPAWN,
+  LAUNCH_VFORK,
+} launch_backend;
+
+/* A file the child opens in place of one of its descriptors. */
+typedef struct launch_redirect_st {
+  int fd;            // the descriptor to replace, e.g. 2 for `2> file`
+  const char* path;  // the file to open
+  int flags;         // for open(2), files are created with mode 0666
+} launch_redirect;
+
+/* The descriptors of a child and its process group. */
+typedef struct launch_io_st {
+  int stdin_fd;   // becomes standard input of the child, -1 for the shell's
+  int stdout_fd;  // becomes standard output of the child, -1 for the shell's
+  pid_t pgid;     // the process group to join, 0 to start a new one
+  // opened after stdin_fd and stdout_fd are in place, so they win
+  const launch_redirect* redirects;
+  size_t num_redirects;
+} launch_io;
+
+/* What a child started with launch_function() runs. */
+typedef int (*launch_fn)(char* argv[]);
+
+/*!
+ * Looks up a backend by name: "fork", "spawn" or "vfork".
+ *
+ * @param name    the name of the backend.
+ * @param backend set to the backend found.
+ * @returns true if the name is known, false otherwise.
+ */
+bool launch_backend_parse(const char* name, launch_backend* backend);
+
+/*!
+ * Starts a program with the given arguments and environment.
+ *
+ * @param backend how to start the child.
+ * @param path    the path of the program.
+ * @param argv    NULL terminated arguments, starting with the command name.
+ * @param envp    NULL terminated environment of the child.
+ * @param io      the file descriptors and process group of the child.
+ * @returns the pid of the child, or -1 if it could not be started.
+ * @post an error is printed to stderr if the child could not be started.
+ *       With LAUNCH_FORK a failed execve or redirection is only seen by
+ *       the child, which prints it and exits with EXIT_FAILURE.
+ */
+pid_t launch_command(launch_backend backend,
+                     const char* path,
+                     char* argv[],
+                     char* envp[],
+                     const launch_io* io);
+
+/*!
+ * Forks a child that runs a function of the shell instead of a program,
+ * e.g. a builtin in a pipeline. The child closes every file descriptor
+ * but 0, 1 and 2, and exits with what the function returns, or with
+ * EXIT_FAILURE if a redirection fails.
+ *
+ * @param fn   the function.
+ * @param argv NULL terminated arguments for it.
+ * @param io   the file descriptors and process group of the child.
+ * @returns the pid of the child, or -1 if it could not be started.
+ */
+pid_t launch_function(launch_fn fn, char* argv[], const launch_io* io);
+
+#endif  // LAUNCH_H_
@@ -0,0 +1,110 @@
+#include "line_reader.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define INITIAL_CAPACITY (64 * 1024)
+
+LineReader line_reader_new(int fd) {
+  LineReader res = {fd, NULL, INITIAL_CAPACITY, 0, 0, 0, false};
+  res.buf = malloc(res.capacity);
+  if (!res.buf) {
+    perror("malloc failed");
+    exit(EXIT_FAILURE);
+  }
+  return res;
+}
+
+// makes room after end: moves the unconsumed bytes to the front, or grows
+// the buffer if they fill all of it
+static void make_room(LineReader* self) {
+  if (self->start > 0) {
+    size_t len = self->end - self->start;
+    memmove(self->buf, &self->buf[self->start], len);
+    self->scanned -= self->start;
+    self->end = len;
+    self->start = 0;
+    return;
+  }
+  size_t new_capacity = self->capacity * 2;
+  char* buf = realloc(self->buf, new_capacity);
+  if (!buf) {
+    perror("realloc failed");
+    exit(EXIT_FAILURE);
+  }
+  self->buf = buf;
+  self->capacity = new_capacity;
+}
+
+// returns [start, line_end) as a line, line_end becomes its terminator
+static ssize_t take_line(LineReader* self, size_t line_end, char** line) {
+  self->buf[line_end] = '\0';
+  *line = &self->buf[self->start];
+  ssize_t len = (ssize_t)(line_end - self->start);
+  self->start = line_end < self->end ? line_end + 1 : line_end;
+  self->scanned = self->start;
+  return len;
+}
+
+bool line_reader_has_line(LineReader* self) {
+  if (self->eof ||
+      memchr(&self->buf[self->scanned], '\n', self->end - self->scanned)) {
+    return true;
+  }
+  self->scanned = self->end;
+  return false;
+}
+
+ssize_t line_reader_fill(LineReader* self) {
+  if (self->start == self->end) {
+    self->start = 0;
+    self->end = 0;
+    self->scanned = 0;
+  } else if (self->end == self->capacity) {
+    make_room(self);
+  }
+  ssize_t num_bytes =
+      read(self->fd, &self->buf[self->end], self->capacity - self->end);
+  if (num_bytes == 0) {
+    self->eof = true;
+  }
+  if (num_bytes > 0) {
+    self->end += (size_t)num_bytes;
+  }
+  return num_bytes;
+}
+
+ssize_t line_reader_next(LineReader* self, char** line) {
+  while (!line_reader_has_line(self)) {
+    if (line_reader_fill(self) < 0) {
+      return -1;
+    }
+  }
+
+  char* newline =
+      memchr(&self->buf[self->scanned], '\n', self->end - self->scanned);
+  if (newline != NULL) {
+    return take_line(self, (size_t)(newline - self->buf), line);
+  }
+  // at the end of the input
+  if (self->start == self->end) {
+    errno = 0;
+    return -1;
+  }
+  // the last line has no newline, it still needs room for the NUL
+  if (self->end == self->capacity) {
+    make_room(self);
+  }
+  return take_line(self, self->end, line);
+}
+
+void line_reader_destroy(LineReader* self) {
+  free(self->buf);
+  self->buf = NULL;
+  self->capacity = 0;
+  self->start = 0;
+  self->end = 0;
+  self->scanned = 0;
+}
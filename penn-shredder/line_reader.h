@@ -0,0 +1,78 @@
+#ifndef LINE_READER_H_
+#define LINE_READER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+/*!
+ * Splits the input of a file descriptor into lines.
+ *
+ * Input is read in large blocks into one buffer, and lines are found in it
+ * with memchr. A read that returns several lines, like from a pipe or a
+ * script, is served without another read, and a line that does not fit in
+ * the buffer makes it grow, so lines can be any length.
+ *
+ *   [ consumed | next lines ... | free ]
+ *              ^start           ^end
+ *
+ * When the free space at the end runs out, the unconsumed bytes are moved
+ * back to the front of the buffer, so it is reused like a ring without a
+ * line ever wrapping around.
+ */
+
+typedef struct line_reader_st {
+  int fd;
+  char* buf;
+  size_t capacity;
+  size_t start;    // the first byte not returned yet
+  size_t end;      // one past the last byte read
+  size_t scanned;  // [start, scanned) has no newline
+  bool eof;
+} LineReader;
+
+/*!
+ * Creates a line reader for a file descriptor, which it does not own.
+ *
+ * @param fd the file descriptor to read.
+ * @returns a new reader.
+ * @post if memory allocation fails, the program exits.
+ */
+LineReader line_reader_new(int fd);
+
+/*!
+ * Reads the next line.
+ *
+ * @param self the reader.
+ * @param line set to the line, without its newline and NUL terminated. It
+ *             stays valid until the next call.
+ * @returns the length of the line, or -1 if there are no more lines or the
+ *          read failed. errno is 0 at the end of the input, otherwise it
+ *          tells why the read failed. After EINTR the next call resumes
+ *          the same line.
+ */
+ssize_t line_reader_next(LineReader* self, char** line);
+
+/*!
+ * Checks whether line_reader_next() can return without reading, because a
+ * whole line is buffered or the input has ended.
+ *
+ * @param self the reader.
+ * @returns true if the next line is ready.
+ */
+bool line_reader_has_line(LineReader* self);
+
+/*!
+ * Reads once from the file descriptor into the buffer, for callers that
+ * wait for input themselves, e.g. with epoll.
+ *
+ * @param self the reader.
+ * @returns the bytes read, 0 at the end of the input, or -1 with errno set.
+ * @post if memory allocation fails, the program exits.
+ */
+ssize_t line_reader_fill(LineReader* self);
+
+/* Frees the buffer of the reader. */
+void line_reader_destroy(LineReader* self);
+
+#endif  // LINE_READER_H_
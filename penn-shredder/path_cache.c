@@ -0,0 +1,306 @@
+#define _GNU_SOURCE  // F_SETSIG
+#include "path_cache.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define DEFAULT_PATH "/bin:/usr/bin"
+#define MIN_TABLE_SIZE 256
+#define WATCH_EVENTS                                                 \
+  (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB | \
+   IN_DELETE_SELF | IN_MOVE_SELF)
+
+typedef struct entry_st {
+  char* name;  // NULL if the slot is free
+  char* path;  // in the same allocation as name
+} entry;
+
+typedef struct dir_st {
+  char* path;
+  struct timespec mtime;  // when it was listed, for the fallback check
+} dir;
+
+// Global Variables
+static entry* table = NULL;    // open addressing, linear probing
+static size_t table_size = 0;  // always a power of two
+static size_t table_used = 0;
+static char* path_var = NULL;  // the current PATH
+static dir* dirs = NULL;       // the directories in it
+static size_t num_dirs = 0;
+static int inotify_fd = -1;              // -1 if not available
+static volatile sig_atomic_t stale = 1;  // the table must be rebuilt
+
+static void* checked_malloc(size_t size) {
+  void* res = malloc(size);
+  if (!res) {
+    perror("malloc failed");
+    exit(EXIT_FAILURE);
+  }
+  return res;
+}
+
+// ===========================================================
+// Change notification
+// ===========================================================
+static void handle_sigio(int signo) {
+  (void)signo;
+  stale = 1;
+}
+
+// opens a new inotify instance that sends SIGIO on changes. rebuild()
+// adds the directories to it. Leaves inotify_fd at -1 if that is not
+// possible
+static void open_inotify(void) {
+  if (inotify_fd >= 0) {
+    close(inotify_fd);
+  }
+  inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify_fd < 0) {
+    return;
+  }
+
+  struct sigaction io_action = {0};
+  io_action.sa_handler = handle_sigio;
+  sigemptyset(&io_action.sa_mask);
+  io_action.sa_flags = SA_RESTART;
+  if (sigaction(SIGIO, &io_action, NULL) == -1 ||
+      fcntl(inotify_fd, F_SETOWN, getpid()) == -1 ||
+      fcntl(inotify_fd, F_SETSIG, SIGIO) == -1 ||
+      fcntl(inotify_fd, F_SETFL, O_ASYNC | O_NONBLOCK) == -1) {
+    close(inotify_fd);
+    inotify_fd = -1;
+  }
+}
+
+// empties the inotify queue. Unread events would pile up until the queue
+// overflows, and the kernel merges an event into the same one queued last,
+// and then no more SIGIO arrives. The table is rebuilt anyway, so only an
+// overflow, which may have lost changes, matters here
+static void drain_inotify(void) {
+  char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+  while (true) {
+    ssize_t len = read(inotify_fd, buf, sizeof(buf));
+    if (len < 0 && errno == EINTR) {
+      continue;
+    }
+    if (len <= 0) {
+      return;
+    }
+    const struct inotify_event* event;
+    for (char* ptr = buf; ptr < buf + len;
+         ptr += sizeof(struct inotify_event) + event->len) {
+      event = (const struct inotify_event*)ptr;
+      if (event->mask & IN_Q_OVERFLOW) {
+        stale = 1;
+      }
+    }
+  }
+}
+
+// the fallback when inotify is not available
+static bool dirs_changed(void) {
+  for (size_t i = 0; i < num_dirs; i++) {
+    struct stat st;
+    if (stat(dirs[i].path, &st) == -1 ||
+        st.st_mtim.tv_sec != dirs[i].mtime.tv_sec ||
+        st.st_mtim.tv_nsec != dirs[i].mtime.tv_nsec) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// ===========================================================
+// Hash table
+// ===========================================================
+static size_t hash_name(const char* name) {
+  // FNV-1a
+  uint64_t hash = 14695981039346656037ULL;
+  for (const char* c = name; *c != '\0'; c++) {
+    hash = (hash ^ (unsigned char)*c) * 1099511628211ULL;
+  }
+  return (size_t)hash;
+}
+
+static entry* find_slot(entry* slots, size_t size, const char* name) {
+  size_t idx = hash_name(name) & (size - 1);
+  while (slots[idx].name != NULL && strcmp(slots[idx].name, name) != 0) {
+    idx = (idx + 1) & (size - 1);
+  }
+  return &slots[idx];
+}
+
+static void clear_table(void) {
+  for (size_t i = 0; i < table_size; i++) {
+    free(table[i].name);
+    table[i].name = NULL;
+  }
+  table_used = 0;
+}
+
+static void grow_table(void) {
+  size_t new_size = table_size == 0 ? MIN_TABLE_SIZE : table_size * 2;
+  entry* slots = checked_malloc(new_size * sizeof(entry));
+  memset(slots, 0, new_size * sizeof(entry));
+  for (size_t i = 0; i < table_size; i++) {
+    if (table[i].name != NULL) {
+      *find_slot(slots, new_size, table[i].name) = table[i];
+    }
+  }
+  free(table);
+  table = slots;
+  table_size = new_size;
+}
+
+// adds dir/name unless an earlier directory already had name
+static void add_program(const char* dir_path, const char* name) {
+  if (2 * (table_used + 1) > table_size) {
+    grow_table();
+  }
+  entry* slot = find_slot(table, table_size, name);
+  if (slot->name != NULL) {
+    return;
+  }
+  size_t name_len = strlen(name);
+  size_t dir_len = strlen(dir_path);
+  char* buf = checked_malloc(name_len + 1 + dir_len + 1 + name_len + 1);
+  memcpy(buf, name, name_len + 1);
+  slot->name = buf;
+  slot->path = buf + name_len + 1;
+  memcpy(slot->path, dir_path, dir_len);
+  slot->path[dir_len] = '/';
+  memcpy(slot->path + dir_len + 1, name, name_len + 1);
+  table_used++;
+}
+
+// ===========================================================
+// Listing the PATH directories
+// ===========================================================
+static void free_dirs(void) {
+  for (size_t i = 0; i < num_dirs; i++) {
+    free(dirs[i].path);
+  }
+  free(dirs);
+  dirs = NULL;
+  num_dirs = 0;
+}
+
+static void split_path(void) {
+  free_dirs();
+  size_t max_dirs = 1;
+  for (const char* c = path_var; *c != '\0'; c++) {
+    max_dirs += *c == ':';
+  }
+  dirs = checked_malloc(max_dirs * sizeof(dir));
+
+  const char* start = path_var;
+  while (true) {
+    const char* end = strchr(start, ':');
+    size_t len = end ? (size_t)(end - start) : strlen(start);
+    if (len > 0 && start[0] == '/') {
+      char* path = checked_malloc(len + 1);
+      memcpy(path, start, len);
+      path[len] = '\0';
+      dirs[num_dirs].path = path;
+      dirs[num_dirs].mtime = (struct timespec){0};
+      num_dirs++;
+    }
+    if (end == NULL) {
+      break;
+    }
+    start = end + 1;
+  }
+}
+
+static void rebuild(void) {
+  // changes that happen while listing mark the table stale again
+  stale = 0;
+  if (inotify_fd >= 0) {
+    drain_inotify();
+  }
+  clear_table();
+  for (size_t i = 0; i < num_dirs; i++) {
+    // adding a watch again is harmless, and picks up directories that were
+    // replaced since the last time
+    if (inotify_fd >= 0) {
+      inotify_add_watch(inotify_fd, dirs[i].path, WATCH_EVENTS);
+    }
+    DIR* listing = opendir(dirs[i].path);
+    if (listing == NULL) {
+      continue;
+    }
+    struct stat st;
+    if (fstat(dirfd(listing), &st) == 0) {
+      dirs[i].mtime = st.st_mtim;
+    }
+    struct dirent* ent;
+    while ((ent = readdir(listing)) != NULL) {
+      if (ent->d_type == DT_DIR || strcmp(ent->d_name, ".") == 0 ||
+          strcmp(ent->d_name, "..") == 0) {
+        continue;
+      }
+      add_program(dirs[i].path, ent->d_name);
+    }
+    closedir(listing);
+  }
+}
+
+// ===========================================================
+// Public functions
+// ===========================================================
+void path_cache_set_path(const char* path) {
+  if (path == NULL) {
+    path = DEFAULT_PATH;
+  }
+  if (path_var != NULL && strcmp(path_var, path) == 0) {
+    return;
+  }
+  free(path_var);
+  size_t len = strlen(path);
+  path_var = checked_malloc(len + 1);
+  memcpy(path_var, path, len + 1);
+  split_path();
+  open_inotify();
+  stale = 1;
+}
+
+const char* path_cache_lookup(const char* name) {
+  if (strchr(name, '/') != NULL) {
+    return name;
+  }
+  if (path_var == NULL) {
+    path_cache_set_path(getenv("PATH"));
+  }
+  if (stale || (inotify_fd < 0 && dirs_changed())) {
+    rebuild();
+  }
+  if (table_size == 0) {
+    return NULL;
+  }
+  entry* slot = find_slot(table, table_size, name);
+  return slot->name == NULL ? NULL : slot->path;
+}
+
+void path_cache_free(void) {
+  clear_table();
+  free(table);
+  table = NULL;
+  table_size = 0;
+  free_dirs();
+  free(path_var);
+  path_var = NULL;
+  if (inotify_fd >= 0) {
+    close(inotify_fd);
+    inotify_fd = -1;
+  }
+  stale = 1;
+}
@@ -0,0 +1,45 @@
+#ifndef PATH_CACHE_H_
+#define PATH_CACHE_H_
+
+/*!
+ * Resolves command names through the directories in PATH.
+ *
+ * Searching PATH on every command costs one stat or failed execve per
+ * directory. Instead the directories are listed once and every name is
+ * kept in a hash table, mapped to the path in the first directory that
+ * has it, so a lookup only hashes the name.
+ *
+ * The table is rebuilt on the next lookup after a directory changes. The
+ * directories are watched with inotify, which sends SIGIO when a file is
+ * added, removed, renamed or has its mode changed, so checking for changes
+ * costs no system call. If inotify is not available, the modification
+ * times of the directories are compared on every lookup instead.
+ *
+ * Relative PATH entries are skipped, since what they point to changes with
+ * the working directory. Directories that do not exist yet are not watched.
+ */
+
+/*!
+ * Sets the PATH to search, e.g. the value of the PATH variable. The table
+ * is rebuilt on the next lookup if it changed.
+ *
+ * @param path a colon separated list of directories, or NULL for the
+ *             default "/bin:/usr/bin".
+ * @post if memory allocation fails, the program exits.
+ */
+void path_cache_set_path(const char* path);
+
+/*!
+ * Finds the program a command name runs.
+ *
+ * @param name the first word of a command.
+ * @returns the path of the program, which stays valid until the next call,
+ *          name itself if it contains a '/', or NULL if no directory in
+ *          PATH has it.
+ */
+const char* path_cache_lookup(const char* name);
+
+/* Frees the table and stops watching the directories. */
+void path_cache_free(void);
+
+#endif  // PATH_CACHE_H_
@@ -1,37 +1,95 @@
+#define _GNU_SOURCE  // F_SETPIPE_SZ, pipe2
 #include "penn-shredder.h"
 #include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
 #include <signal.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <sys/timerfd.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <termios.h>
 #include <unistd.h>
+#include "builtins.h"
+#include "env.h"
+#include "jobs.h"
+#include "launch.h"
+#include "line_reader.h"
+#include "path_cache.h"
+#include "stats.h"
+#include "timer_wheel.h"
+
+// the most events handled per epoll_wait
+#define MAX_EVENTS 64
+// the buffer size of the pipes between stages, 16 times the default, so a
+// fast writer blocks less often
+#define PIPE_SIZE (1024 * 1024)
+
+// what an epoll event is about. Job events carry the pid of the job too
+typedef enum event_kind_en {
+  EVENT_INPUT,
+  EVENT_SIGNAL,
+  EVENT_EXIT,   // the pidfd of a job
+  EVENT_TIMER,  // the timerfd of the timer wheel
+} event_kind;
+
+// a command of a pipeline
+typedef struct stage_st {
+  char** argv;  // without the redirections, NULL if there is no command
+  launch_redirect* redirects;
+  size_t num_redirects;
+} stage;
+
+// a sleep builtin in the shell: a job without processes that its timer
+// finishes
+typedef struct sleeper_st {
+  job* owner;
+  bool times_out;  // its timeout comes before the end of the sleep
+} sleeper;
 
 // Global Variables
-static volatile pid_t current_child = 0;      // current child pid for parent
-                                              // process
-static volatile sig_atomic_t alarm_flag = 0;  // track if the alarm happened
-static int timeout = 0;                       // timeout settings
-
-// ===========================================================
-// Signal Handlers
-// ===========================================================
-void handle_sigalrm(int signo) {
-  (void)signo;
-  alarm_flag = 1;
-  kill(current_child, SIGKILL);
-}
-
-void handle_sigint(int signo) {
-  (void)signo;
-  if (current_child == 0) {
-    write(STDERR_FILENO, "\n", 1);
-  } else {
-    kill(current_child, SIGINT);
-  }
-}
+static uint64_t timeout_ms = 0;  // timeout settings, 0 for none
+static int epoll_fd = -1;        // the event loop
+static int signal_fd = -1;       // reads SIGINT and SIGCHLD
+static bool use_pidfd = true;    // false if the kernel has no pidfd_open
+// processes without a pidfd although the kernel has them, reaped on SIGCHLD
+static size_t num_unwatched = 0;
+
+// the timeouts of all jobs, in milliseconds, behind one timerfd
+static TimerWheel wheel;
+static int timer_fd = -1;
+static uint64_t armed_tick = 0;  // when timer_fd goes off, 0 if disarmed
+
+// how children are started, set with -s
+static launch_backend backend = LAUNCH_SPAWN;
+// false when reading a script or a pipe, which gets no prompts
+static bool interactive = true;
+// set when the next read of a command should be prompted for
+static bool need_prompt = true;
+// the most commands that run at once, set with -j
+static size_t max_jobs = 1;
+// where to write the statistics at exit, set with --stats-json
+static FILE* stats_json = NULL;
+// true if each job gets the terminal while it runs
+static bool job_control = false;
+// /dev/null when stdin is a terminal the jobs do not get, since reading it
+// from a background process group would stop them; -1 otherwise
+static int job_stdin = -1;
+// the sleep builtins running in the shell, at most max_jobs
+static sleeper* sleepers = NULL;
+static size_t num_sleepers = 0;
+// set by the exit builtin, after which no more commands are read
+static bool exit_requested = false;
+static int exit_status = EXIT_SUCCESS;
 
 // ===========================================================
 // strdup helper function
@@ -122,128 +180,711 @@ static char** parse(char* cmd, int* argc) {
 }
 
 // ===========================================================
-// Read Command Line from standard input
+// Epoll helpers
 // ===========================================================
-bool readCommandLine(char* cmdBuffer, size_t buffer_size) {
-  if (write(STDERR_FILENO, PROMPT, strlen(PROMPT)) < 0) {
-    perror("write failed");
-    return false;
+static uint64_t eventKey(event_kind kind, pid_t pid) {
+  return (uint64_t)kind << 32 | (uint32_t)pid;
+}
+
+static void watchFd(int fd, uint64_t key) {
+  struct epoll_event event = {0};
+  event.events = EPOLLIN;
+  event.data.u64 = key;
+  if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
+    perror("epoll_ctl failed");
+    exit(EXIT_FAILURE);
   }
+}
 
-  size_t numBytes = read(STDIN_FILENO, cmdBuffer, buffer_size - 1);
-  if (numBytes == -1) {
-    if (errno == EINTR) {
-      cmdBuffer[0] = '\0';
-      return true;
-    }
-    perror("read failed");
+// ===========================================================
+// Timeouts: parsing, and the timer wheel behind the timerfd
+// ===========================================================
+bool parseTimeout(const char* text, uint64_t* ms) {
+  char* end;
+  double value = strtod(text, &end);
+  double scale;
+  if (end == text || !(value >= 0)) {
     return false;
   }
-
-  if (numBytes == 0) {
+  if (*end == '\0' || strcmp(end, "s") == 0) {
+    scale = 1000;
+  } else if (strcmp(end, "ms") == 0) {
+    scale = 1;
+  } else {
     return false;
   }
-
-  cmdBuffer[numBytes] = '\0';
+  double total = value * scale;
+  if (total > (double)UINT32_MAX * 1000) {
+    return false;
+  }
+  // round up, so a timeout is never shorter than asked for
+  *ms = (uint64_t)total;
+  if ((double)*ms < total) {
+    (*ms)++;
+  }
   return true;
 }
 
+// the current CLOCK_MONOTONIC millisecond. If `ns` is not NULL it gets the
+// nanoseconds past it
+static uint64_t nowTick(long* ns) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  if (ns != NULL) {
+    *ns = now.tv_nsec % 1000000;
+  }
+  return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+}
+
+// the current CLOCK_MONOTONIC microsecond
+static uint64_t nowUs(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+}
+
+// points timer_fd at the next tick the wheel needs to advance at
+static void rearmTimer(void) {
+  uint64_t next = 0;
+  timer_wheel_next(&wheel, &next);
+  if (next == armed_tick) {
+    return;
+  }
+  struct itimerspec spec = {0};
+  spec.it_value.tv_sec = (time_t)(next / 1000);
+  spec.it_value.tv_nsec = (long)(next % 1000) * 1000000;
+  timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, NULL);
+  armed_tick = next;
+}
+
+static void wakeSleeper(job* cur, int signo);
+
+static void expireJob(Timer* timer) {
+  job* cur = (job*)timer->arg;
+  if (cur->num_procs == 0) {
+    wakeSleeper(cur, 0);
+    return;
+  }
+  kill(-cur->pgid, SIGKILL);
+  cur->timed_out = true;
+}
+
+static void scheduleTimeout(job* cur, uint64_t ms) {
+  long ns;
+  uint64_t now = nowTick(&ns);
+  timer_wheel_advance(&wheel, now, expireJob);
+  cur->timer.arg = cur;
+  // the millisecond that has begun already does not count
+  timer_wheel_add(&wheel, &cur->timer, now + ms + (ns > 0));
+  rearmTimer();
+}
+
+static void handleTimer(void) {
+  uint64_t expirations;
+  read(timer_fd, &expirations, sizeof(expirations));
+  armed_tick = 0;
+  timer_wheel_advance(&wheel, nowTick(NULL), expireJob);
+  rearmTimer();
+}
+
 // ===========================================================
-// use sigaction to setup signal handlers for parent
+// Event loop setup
 // ===========================================================
-void setupParentSignals(void) {
-  // Set up signal handlers
-  struct sigaction alarm_action = {0};
-  alarm_action.sa_handler = handle_sigalrm;
-  sigemptyset(&alarm_action.sa_mask);
-  alarm_action.sa_flags = 0;
-  if (sigaction(SIGALRM, &alarm_action, NULL) == -1) {
-    perror("SIGALRM error");
+void setupEventLoop(void) {
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGINT);
+  sigaddset(&mask, SIGCHLD);
+  // taking the terminal back from a job raises SIGTTOU, unless it is
+  // blocked. It is not read from the signalfd
+  sigaddset(&mask, SIGTTOU);
+  if (sigprocmask(SIG_BLOCK, &mask, NULL) == -1) {
+    perror("sigprocmask failed");
     exit(EXIT_FAILURE);
   }
-
-  struct sigaction signal_action = {0};
-  signal_action.sa_handler = handle_sigint;
-  sigemptyset(&signal_action.sa_mask);
-  signal_action.sa_flags = 0;
-  if (sigaction(SIGINT, &signal_action, NULL) == -1) {
-    perror("SIGINT error");
+  sigdelset(&mask, SIGTTOU);
+  signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+  epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (signal_fd < 0 || epoll_fd < 0 || timer_fd < 0) {
+    perror("event loop setup failed");
     exit(EXIT_FAILURE);
   }
+  watchFd(signal_fd, eventKey(EVENT_SIGNAL, 0));
+  watchFd(timer_fd, eventKey(EVENT_TIMER, 0));
+  wheel = timer_wheel_new(nowTick(NULL));
 }
 
 // ===========================================================
-// parse and execute the command by forking a child process
-// to execute and wait for it to terminate
+// Jobs: starting, timing out and reaping
 // ===========================================================
-void runCommand(char* cmd, char* envp[]) {
-  int argc_child = 0;
-  char* cmd_copy = my_strdup(cmd);
-  char** argv1 = parse(cmd, &argc_child);
-  if (!argv1) {
-    free(cmd_copy);
+static uint64_t timevalUs(struct timeval tv) {
+  return (uint64_t)tv.tv_sec * 1000000 + (uint64_t)tv.tv_usec;
+}
+
+// adds what the kernel reported about a command to the statistics
+static void recordUsage(const char* name,
+                        uint64_t started_us,
+                        int status,
+                        bool timed_out,
+                        const struct rusage* ru) {
+  command_usage usage;
+  usage.wall_us = nowUs() - started_us;
+  usage.user_us = timevalUs(ru->ru_utime);
+  usage.sys_us = timevalUs(ru->ru_stime);
+  usage.max_rss_kb = (uint64_t)ru->ru_maxrss;
+  usage.voluntary_switches = (uint64_t)ru->ru_nvcsw;
+  usage.involuntary_switches = (uint64_t)ru->ru_nivcsw;
+  bool failed = !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+  stats_record(name, &usage, failed, timed_out);
+}
+
+// lends the terminal to a job, so it can read it and Ctrl+C reaches it
+static void giveTerminal(const job* cur) {
+  tcsetpgrp(STDIN_FILENO, cur->pgid);
+  // a stage that read the terminal before it had it was stopped
+  kill(-cur->pgid, SIGCONT);
+}
+
+// the report of `time`, in the format of other shells
+static void printTimes(const job* done) {
+  static const char* const kLabels[] = {"real", "user", "sys"};
+  uint64_t times[] = {nowUs() - done->started_us, done->user_us,
+                      done->sys_us};
+  for (size_t i = 0; i < 3; i++) {
+    uint64_t us = times[i];
+    fprintf(stderr, "%s\t%" PRIu64 "m%" PRIu64 ".%03" PRIu64 "s\n", kLabels[i],
+            us / 60000000, us / 1000000 % 60, us / 1000 % 1000);
+  }
+}
+
+static void finishJob(job* done) {
+  if (timer_scheduled(&done->timer)) {
+    timer_wheel_cancel(&wheel, &done->timer);
+    rearmTimer();
+  }
+  if (done->timed_out) {
+    write(STDERR_FILENO, CATCHPHRASE, strlen(CATCHPHRASE));
+  }
+  if (done->timed) {
+    printTimes(done);
+  }
+  if (job_control && done->num_procs > 0) {
+    tcsetpgrp(STDIN_FILENO, getpgrp());
+  }
+  jobs_finish(done);
+}
+
+// the job is done when its last process is reaped
+static void reapProcess(job* owner,
+                        process* proc,
+                        int status,
+                        const struct rusage* ru) {
+  recordUsage(proc->name, proc->started_us, status, owner->timed_out, ru);
+  owner->user_us += timevalUs(ru->ru_utime);
+  owner->sys_us += timevalUs(ru->ru_stime);
+  // closing the pidfd also takes it out of the epoll set
+  if (proc->pidfd >= 0) {
+    close(proc->pidfd);
+  } else if (use_pidfd) {
+    num_unwatched--;
+  }
+  jobs_reap_process(owner, proc, status);
+  if (owner->num_running == 0) {
+    finishJob(owner);
+  }
+}
+
+static void reapPid(pid_t pid) {
+  process* proc;
+  job* owner = jobs_find(pid, &proc);
+  int status;
+  struct rusage ru;
+  // an earlier event in the same batch may have reaped it already
+  if (owner != NULL && wait4(pid, &status, WNOHANG, &ru) > 0) {
+    reapProcess(owner, proc, status, &ru);
+  }
+}
+
+// reaps every child that exited, when some have no pidfd to tell which
+static void reapChildren(void) {
+  int status;
+  struct rusage ru;
+  pid_t pid;
+  while ((pid = wait4(-1, &status, WNOHANG, &ru)) > 0) {
+    process* proc;
+    job* owner = jobs_find(pid, &proc);
+    if (owner != NULL) {
+      reapProcess(owner, proc, status, &ru);
+    }
+  }
+}
+
+// gives a new process a pidfd that becomes readable when it exits
+static void watchProcess(process* proc) {
+  if (use_pidfd) {
+    proc->pidfd = (int)syscall(SYS_pidfd_open, proc->pid, 0);
+    if (proc->pidfd >= 0) {
+      watchFd(proc->pidfd, eventKey(EVENT_EXIT, proc->pid));
+    } else if (errno == ENOSYS) {
+      use_pidfd = false;
+    } else {
+      // e.g. EMFILE. Its SIGCHLD stays pending in the signalfd even if it
+      // exited already, so it is still reaped
+      num_unwatched++;
+    }
+  }
+}
+
+// a pipe between two stages, both ends close on execve
+static int openPipe(int fds[2]) {
+  if (pipe2(fds, O_CLOEXEC) == -1) {
+    return -1;
+  }
+  // past the pipe memory limit of the user this fails, and the pipe keeps
+  // the default size
+  fcntl(fds[1], F_SETPIPE_SZ, PIPE_SIZE);
+  return 0;
+}
+
+static pid_t startStage(const stage* cur,
+                         int stdin_fd,
+                         int stdout_fd,
+                         pid_t pgid) {
+  launch_io io = {stdin_fd, stdout_fd, pgid, cur->redirects,
+                  cur->num_redirects};
+  const builtin* found = builtins_find(cur->argv);
+  if (found != NULL) {
+    return launch_function(found->run, cur->argv, &io);
+  }
+  // names that are not found in PATH are run as they are, so execve reports
+  // the error
+  const char* path = path_cache_lookup(cur->argv[0]);
+  if (path == NULL) {
+    path = cur->argv[0];
+  }
+  return launch_command(backend, path, cur->argv, env_array(), &io);
+}
+
+// starts every stage of a pipeline at once, each reading the output of the
+// one before it, as one job. `timed` is true for a `time` prefix
+static void startJob(const stage* stages,
+                     size_t num_stages,
+                     uint64_t ms,
+                     bool timed) {
+  // the job is named after its commands, e.g. "cat | wc"
+  size_t name_len = 0;
+  for (size_t i = 0; i < num_stages; i++) {
+    name_len += strlen(stages[i].argv[0]) + 3;
+  }
+  char* name = malloc(name_len);
+  if (!name) {
+    perror("malloc failed");
+    exit(EXIT_FAILURE);
+  }
+  name[0] = '\0';
+  for (size_t i = 0; i < num_stages; i++) {
+    strcat(strcat(name, i > 0 ? " | " : ""), stages[i].argv[0]);
+  }
+  job* started = jobs_add(name, num_stages);
+  free(name);
+  started->timed = timed;
+  started->started_us = nowUs();
+
+  int prev_read = -1;
+  for (size_t i = 0; i < num_stages; i++) {
+    bool last = i + 1 == num_stages;
+    int pipe_fds[2] = {-1, -1};
+    if (!last && openPipe(pipe_fds) == -1) {
+      perror("pipe failed");
+      break;
+    }
+    uint64_t started_us = nowUs();
+    int stdin_fd = prev_read >= 0 ? prev_read : job_stdin;
+    pid_t pid =
+        startStage(&stages[i], stdin_fd, pipe_fds[1], started->pgid);
+    // the children have their copies now
+    if (prev_read >= 0) {
+      close(prev_read);
+    }
+    if (pipe_fds[1] >= 0) {
+      close(pipe_fds[1]);
+    }
+    prev_read = pipe_fds[0];
+    if (pid >= 0) {
+      process* proc = jobs_add_process(started, pid, stages[i].argv[0], last);
+      proc->started_us = started_us;
+      watchProcess(proc);
+    }
+  }
+  if (prev_read >= 0) {
+    close(prev_read);
+  }
+
+  if (started->num_procs == 0) {
+    finishJob(started);
     return;
   }
+  if (job_control) {
+    giveTerminal(started);
+  }
+  if (ms > 0) {
+    scheduleTimeout(started, ms);
+  }
+}
+
+// a sleep in the shell: the job stays without processes until its timer
+// goes off, at the end of the sleep or at its timeout if that is sooner
+static void startSleep(job* cur, uint64_t sleep_ms, uint64_t timeout) {
+  bool times_out = timeout > 0 && timeout < sleep_ms;
+  sleepers[num_sleepers++] = (sleeper){cur, times_out};
+  scheduleTimeout(cur, times_out ? timeout : sleep_ms);
+}
+
+// finishes a sleep in the shell at its end or its timeout, or with the
+// signal that interrupted it
+static void wakeSleeper(job* cur, int signo) {
+  size_t idx = 0;
+  while (sleepers[idx].owner != cur) {
+    idx++;
+  }
+  if (signo == 0 && sleepers[idx].times_out) {
+    cur->timed_out = true;
+    signo = SIGKILL;
+  }
+  sleepers[idx] = sleepers[--num_sleepers];
+  cur->status = W_EXITCODE(0, signo);
+  struct rusage none = {0};
+  recordUsage(cur->name, cur->started_us, cur->status, cur->timed_out,
+              &none);
+  finishJob(cur);
+}
 
-  if (argc_child == 0) {
-    free(cmd_copy);
-    free(argv1);
+// runs a builtin in the shell itself, as a job without processes, so it
+// is still reported and counted in the statistics
+static void runInShell(const builtin* found,
+                       char** args,
+                       uint64_t ms,
+                       bool timed) {
+  job* cur = jobs_add(args[0], 1);
+  cur->timed = timed;
+  struct rusage before;
+  getrusage(RUSAGE_SELF, &before);
+  cur->started_us = nowUs();
+
+  int res = found->run_in_shell(args);
+  fflush(stdout);
+
+  // what the builtin used is what the shell used meanwhile
+  struct rusage used;
+  getrusage(RUSAGE_SELF, &used);
+  timersub(&used.ru_utime, &before.ru_utime, &used.ru_utime);
+  timersub(&used.ru_stime, &before.ru_stime, &used.ru_stime);
+  used.ru_maxrss = 0;
+  used.ru_nvcsw -= before.ru_nvcsw;
+  used.ru_nivcsw -= before.ru_nivcsw;
+  cur->status = W_EXITCODE(res & 0xff, 0);
+  cur->user_us = timevalUs(used.ru_utime);
+  cur->sys_us = timevalUs(used.ru_stime);
+
+  builtin_request request = builtins_take_request();
+  if (request.exit) {
+    exit_requested = true;
+    exit_status = res & 0xff;
+  }
+  if (request.sleep_ms > 0) {
+    startSleep(cur, request.sleep_ms, ms);
     return;
   }
+  recordUsage(args[0], cur->started_us, cur->status, false, &used);
+  finishJob(cur);
+}
 
-  alarm_flag = 0;
-  pid_t pid = fork();
-  if (pid < 0) {
-    perror("fork failed");
-    free(cmd_copy);
-    free(argv1);
+// ===========================================================
+// Redirections
+// ===========================================================
+typedef struct redirect_op_st {
+  const char* op;
+  int fd;
+  int flags;
+} redirect_op;
+
+// longer operators first, so "2>" and ">>" are not taken for ">"
+static const redirect_op kRedirectOps[] = {
+    {"2>", STDERR_FILENO, O_WRONLY | O_CREAT | O_TRUNC},
+    {">>", STDOUT_FILENO, O_WRONLY | O_CREAT | O_APPEND},
+    {">", STDOUT_FILENO, O_WRONLY | O_CREAT | O_TRUNC},
+    {"<", STDIN_FILENO, O_RDONLY},
+};
+#define NUM_REDIRECT_OPS (sizeof(kRedirectOps) / sizeof(kRedirectOps[0]))
+
+// takes the redirections, like `> out` or `2>err`, out of the arguments of
+// a stage and into its redirects. Returns false if one has no file
+static bool parseRedirects(stage* cur, size_t argc) {
+  cur->redirects = malloc(argc * sizeof(launch_redirect));
+  if (!cur->redirects) {
+    perror("malloc failed");
     exit(EXIT_FAILURE);
   }
+  size_t kept = 0;
+  for (size_t i = 0; cur->argv[i] != NULL; i++) {
+    const redirect_op* found = NULL;
+    for (size_t j = 0; j < NUM_REDIRECT_OPS && found == NULL; j++) {
+      const char* op = kRedirectOps[j].op;
+      if (strncmp(cur->argv[i], op, strlen(op)) == 0) {
+        found = &kRedirectOps[j];
+      }
+    }
+    if (found == NULL) {
+      cur->argv[kept++] = cur->argv[i];
+      continue;
+    }
+    // the file may follow the operator or be the next word
+    const char* path = cur->argv[i] + strlen(found->op);
+    if (*path == '\0') {
+      path = cur->argv[++i];
+    }
+    if (path == NULL) {
+      fprintf(stderr, "invalid redirection: no file after %s\n", found->op);
+      cur->argv[kept] = NULL;
+      return false;
+    }
+    launch_redirect* redirect = &cur->redirects[cur->num_redirects++];
+    redirect->fd = found->fd;
+    redirect->path = path;
+    redirect->flags = found->flags;
+  }
+  cur->argv[kept] = NULL;
+  return true;
+}
 
-  // if child process
-  if (pid == 0) {
-    struct sigaction dfl = {0};
-    dfl.sa_handler = SIG_DFL;
-    sigemptyset(&dfl.sa_mask);
-    sigaction(SIGINT, &dfl, NULL);
-
-    execve(argv1[0], argv1, envp);
-    perror("execve failed");
+// ===========================================================
+// parse and start the command as a job
+// ===========================================================
+void runCommand(char* cmd) {
+  // split the pipeline at every '|', and parse each stage
+  size_t num_stages = 1;
+  for (const char* c = cmd; *c != '\0'; c++) {
+    num_stages += *c == '|';
+  }
+  stage* stages = calloc(num_stages, sizeof(stage));
+  if (!stages) {
+    perror("calloc failed");
     exit(EXIT_FAILURE);
   }
-  // if parent process
-  if (pid > 0) {
-    // set the sig_handler
-    current_child = pid;
-    setupParentSignals();
+  bool valid = true;
+  char* segment = cmd;
+  for (size_t i = 0; i < num_stages; i++) {
+    char* bar = strchr(segment, '|');
+    if (bar != NULL) {
+      *bar = '\0';
+    }
+    int argc_stage = 0;
+    stages[i].argv = parse(segment, &argc_stage);
+    if (stages[i].argv != NULL && valid) {
+      valid = parseRedirects(&stages[i], (size_t)argc_stage);
+    }
+    if (bar != NULL) {
+      segment = bar + 1;
+    }
+  }
 
-    if (timeout > 0) {
-      alarm(timeout);
+  // a `time` prefix prints the times of the command when it finishes, and
+  // a `timeout=250ms` prefix overrides the timeout for this command
+  uint64_t cmd_timeout = timeout_ms;
+  bool timed = false;
+  char** first = stages[0].argv;
+  while (valid && stages[0].argv != NULL && stages[0].argv[0] != NULL) {
+    const char* word = stages[0].argv[0];
+    if (strcmp(word, "time") == 0) {
+      timed = true;
+    } else if (strncmp(word, "timeout=", 8) == 0) {
+      valid = parseTimeout(word + 8, &cmd_timeout);
+      if (!valid) {
+        fprintf(stderr, "invalid timeout: %s\n", word + 8);
+      }
     } else {
-      alarm(0);
+      break;
     }
+    stages[0].argv++;
+  }
 
-    int status;
-    while (1) {
-        pid_t wait_res = wait(&status);
-        if (wait_res >= 0){
-          break;
-        }
-        if (errno == EINTR){
-          continue;
+  size_t num_empty = 0;
+  size_t num_redirects = 0;
+  for (size_t i = 0; i < num_stages; i++) {
+    num_empty += stages[i].argv == NULL || stages[i].argv[0] == NULL;
+    num_redirects += stages[i].num_redirects;
+  }
+  const builtin* found = NULL;
+  if (valid && num_empty == 0 && num_stages == 1 && num_redirects == 0) {
+    found = builtins_find(stages[0].argv);
+  }
+  if (valid && num_empty > 0 && (num_stages > 1 || num_redirects > 0)) {
+    fprintf(stderr, "invalid command: missing command\n");
+  } else if (!valid || num_empty > 0) {
+    // nothing to run
+  } else if (found != NULL && found->run_in_shell != NULL) {
+    runInShell(found, stages[0].argv, cmd_timeout, timed);
+  } else {
+    startJob(stages, num_stages, cmd_timeout, timed);
+  }
+
+  // the arrays start where parse() allocated them
+  free(first);
+  for (size_t i = 0; i < num_stages; i++) {
+    if (i > 0) {
+      free(stages[i].argv);
+    }
+    free(stages[i].redirects);
+  }
+  free(stages);
+}
+
+// ===========================================================
+// Event handlers
+// ===========================================================
+static void handleSignals(void) {
+  struct signalfd_siginfo info;
+  while (read(signal_fd, &info, sizeof(info)) == sizeof(info)) {
+    if (info.ssi_signo == SIGINT) {
+      // Ctrl+C goes to the jobs, or gives a fresh prompt without any
+      if (jobs_running > 0) {
+        jobs_signal_all(SIGINT);
+        while (num_sleepers > 0) {
+          wakeSleeper(sleepers[0].owner, SIGINT);
         }
-        perror("wait failed");
-        exit(EXIT_FAILURE);
+      } else {
+        write(STDERR_FILENO, "\n", 1);
+        need_prompt = true;
+      }
+    } else if (info.ssi_signo == SIGCHLD &&
+               (!use_pidfd || num_unwatched > 0)) {
+      reapChildren();
+    }
+  }
+}
+
+static void handleEvent(const struct epoll_event* event, LineReader* reader) {
+  event_kind kind = (event_kind)(event->data.u64 >> 32);
+  pid_t pid = (pid_t)(uint32_t)event->data.u64;
+  if (kind == EVENT_INPUT) {
+    if (line_reader_fill(reader) < 0 && errno != EINTR) {
+      perror("read failed");
+      // treat it like the end of the input
+      reader->eof = true;
+    }
+    return;
+  }
+  if (kind == EVENT_SIGNAL) {
+    handleSignals();
+    return;
+  }
+  if (kind == EVENT_TIMER) {
+    handleTimer();
+    return;
+  }
+
+  reapPid(pid);
+}
+
+// ===========================================================
+// The main loop: runs commands while there is room for more
+// jobs, and otherwise waits in epoll for input, signals, jobs
+// exiting and timeouts
+// ===========================================================
+void runEventLoop(LineReader* reader) {
+  // regular files cannot be polled, but reading them never blocks
+  struct epoll_event input_event = {0};
+  input_event.events = EPOLLIN;
+  input_event.data.u64 = eventKey(EVENT_INPUT, 0);
+  int added = epoll_ctl(epoll_fd, EPOLL_CTL_ADD, reader->fd, &input_event);
+  if (added == -1 && errno != EPERM) {
+    perror("epoll_ctl failed");
+    exit(EXIT_FAILURE);
+  }
+  bool pollable = added == 0;
+  bool watching_input = pollable;
+  bool input_open = true;
+
+  while (input_open || jobs_running > 0) {
+    // 1. run the commands that are read already
+    while (input_open && (size_t)jobs_running < max_jobs &&
+           line_reader_has_line(reader)) {
+      char* cmd;
+      if (line_reader_next(reader, &cmd) < 0) {
+        input_open = false;
+        break;
+      }
+      need_prompt = true;
+      // 2. trim whitespace and run the command
+      if (trim(cmd) > 0) {
+        runCommand(cmd);
+      }
+      if (exit_requested) {
+        input_open = false;
+      }
     }
 
-    if (alarm_flag) {
-      write(STDERR_FILENO, CATCHPHRASE, strlen(CATCHPHRASE));
+    // 3. read more input only when there is room for another job
+    bool want_input = input_open && (size_t)jobs_running < max_jobs;
+    if (want_input && !pollable) {
+      if (line_reader_fill(reader) < 0) {
+        perror("read failed");
+        input_open = false;
+      }
+      continue;
+    }
+    if (want_input != watching_input) {
+      // removed rather than disabled, which would still report hangups
+      epoll_ctl(epoll_fd, want_input ? EPOLL_CTL_ADD : EPOLL_CTL_DEL,
+                reader->fd, &input_event);
+      watching_input = want_input;
+    }
+    if (want_input && interactive && need_prompt) {
+      write(STDERR_FILENO, PROMPT, strlen(PROMPT));
+      need_prompt = false;
+    }
+    if (!want_input && jobs_running == 0) {
+      continue;
     }
 
-    alarm(0);
-    current_child = 0;
-    free(cmd_copy);
-    free(argv1);
+    // 4. wait for something to happen
+    struct epoll_event events[MAX_EVENTS];
+    int num_events = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+    if (num_events < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("epoll_wait failed");
+      exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < num_events; i++) {
+      handleEvent(&events[i], reader);
+    }
+  }
+}
+
+// ===========================================================
+// Statistics dump at exit
+// ===========================================================
+// opens the file for --stats-json now, so a bad path fails before any
+// command runs. "-" is standard output
+static FILE* openStatsJson(const char* file) {
+  if (strcmp(file, "-") == 0) {
+    return stdout;
+  }
+  FILE* out = fopen(file, "we");
+  if (out == NULL) {
+    perror("fopen failed");
+    exit(EXIT_FAILURE);
+  }
+  return out;
+}
+
+static void writeStatsJson(FILE* out) {
+  stats_write_json(out);
+  if (out == stdout ? fflush(out) != 0 : fclose(out) != 0) {
+    perror("write failed");
   }
 }
 
@@ -251,32 +892,94 @@ void runCommand(char* cmd, char* envp[]) {
 // Main
 // ===========================================================
 int main(int argc, char* argv[], char* envp[]) {
-  if (argc > 2) {
+  const char* script = NULL;
+  bool report_status = false;
+  static const struct option kLongOptions[] = {
+      {"stats-json", required_argument, NULL, 'S'},
+      {NULL, 0, NULL, 0},
+  };
+  int opt;
+  while ((opt = getopt_long(argc, argv, "s:f:j:o", kLongOptions, NULL)) !=
+         -1) {
+    bool valid = true;
+    if (opt == 'S') {
+      stats_json = openStatsJson(optarg);
+    } else if (opt == 'f') {
+      script = optarg;
+    } else if (opt == 'j') {
+      char* end;
+      long jobs_long = strtol(optarg, &end, 10);
+      valid = *end == '\0' && jobs_long > 0;
+      max_jobs = (size_t)jobs_long;
+    } else if (opt == 'o') {
+      report_status = true;
+    } else {
+      valid = opt == 's' && launch_backend_parse(optarg, &backend);
+    }
+    if (!valid) {
+      fprintf(stderr,
+              "usage: %s [-s fork|spawn|vfork] [-f script] [-j jobs] [-o] "
+              "[--stats-json file] [timeout]\n",
+              argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (argc - optind > 1) {
     return EXIT_FAILURE;
   }
-  if (argc == 2) {
-    char* end;
-    long timeout_long = strtol(argv[1], &end, 10);
-    if (*end != '\0' || timeout_long < 0) {
+  if (argc - optind == 1) {
+    if (!parseTimeout(argv[optind], &timeout_ms)) {
       exit(EXIT_FAILURE);
     }
-    timeout = (int)timeout_long;
   }
 
-  const int max_line_length = 4096;
-  char cmd[max_line_length];
-  while (true) {
-    // 1. read user input
-    if (!readCommandLine(cmd, max_line_length)) {
-      break;
+  int input_fd = STDIN_FILENO;
+  if (script != NULL) {
+    input_fd = open(script, O_RDONLY | O_CLOEXEC);
+    if (input_fd < 0) {
+      perror("open failed");
+      return EXIT_FAILURE;
     }
-    // 2.trim whitespace
-    size_t len = trim(cmd);
-    if (len == 0) {
-      continue;
+  }
+  interactive = script == NULL && isatty(STDIN_FILENO);
+  // with -j the shell reads on while jobs run, so they cannot have the
+  // terminal
+  job_control = max_jobs == 1 && isatty(STDIN_FILENO) &&
+                tcgetpgrp(STDIN_FILENO) == getpgrp();
+  // a "<" redirect still replaces it, see setup_child_io()
+  if (!job_control && isatty(STDIN_FILENO)) {
+    job_stdin = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    if (job_stdin < 0) {
+      perror("open failed");
+      return EXIT_FAILURE;
     }
-    // 3. run command (do fork things)
-    runCommand(cmd, envp);
   }
-  return EXIT_SUCCESS;
-}
\ No newline at end of file
+
+  jobs_init(max_jobs, report_status);
+  env_init(envp);
+  sleepers = calloc(max_jobs, sizeof(sleeper));
+  if (!sleepers) {
+    perror("calloc failed");
+    exit(EXIT_FAILURE);
+  }
+  setupEventLoop();
+
+  LineReader reader = line_reader_new(input_fd);
+  runEventLoop(&reader);
+  if (stats_json != NULL) {
+    writeStatsJson(stats_json);
+  }
+  jobs_free();
+  line_reader_destroy(&reader);
+  if (script != NULL) {
+    close(input_fd);
+  }
+  if (job_stdin >= 0) {
+    close(job_stdin);
+  }
+  path_cache_free();
+  stats_free();
+  env_free();
+  free(sleepers);
+  return exit_status;
+}
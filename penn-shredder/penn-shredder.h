@@ -3,6 +3,7 @@
 
 #include <errno.h>
 #include <signal.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -10,30 +11,12 @@
 #include <sys/wait.h>
 #include <termios.h>
 #include <unistd.h>
+#include "line_reader.h"
 
 #define CATCHPHRASE "Bwahaha ... Tonight, I dine on turtle soup!\n"
 #define MAX_TOKENS 1024
 #define PROMPT "penn-shredder# "
 
-/*!
- * Handles the SIGALRM signal
- * This function sets the `alarm_flag` and terminates the currently
- * running child process if timeout.
- *
- * @param signo     The signal number (SIGALRM).
- */
-void handle_sigalrm(int signo);
-
-/*!
- * Handles the SIGINT signal (Ctrl+C).
- * If a child process is running, parent will deliver the signal to child.
- * Parent still running.
- * If no child process, it return a new penn-shredder# line.
- *
- * @param signo     The signal number (SIGINT).
- */
-void handle_sigint(int signo);
-
 char* my_strdup(const char* s);
 /*!
  * Trims leading and trailing whitespace from a given buffer.
@@ -54,28 +37,51 @@ static size_t trim(char* buffer);
 static char** parse(char* cmd, int* argc);
 
 /*!
- * Reads a command line from standard input.
+ * Parses a timeout: a number of seconds, which may have a fraction, with an
+ * optional "s" suffix, or a number of milliseconds with an "ms" suffix,
+ * e.g. "2", "1.5s" or "250ms".
  *
- * @param cmdBuffer    input buffer that stores command
- * @param buffer_size  The maximum size of the buffer
- * @returns true if a valid command was read, false if an error occurred or EOF
- * was reached.
+ * @param text the timeout.
+ * @param ms   set to the timeout in milliseconds, rounded up.
+ * @returns true if the timeout is valid.
  */
-bool readCommandLine(char* cmdBuffer, size_t buffer_size);
+bool parseTimeout(const char* text, uint64_t* ms);
 
 /*!
- * Sets up signal handlers for SIGALRM and SIGINT in the parent process.
+ * Blocks SIGINT and SIGCHLD, which are read from a signalfd from now on,
+ * and SIGTTOU, and creates the epoll instance of the event loop.
  */
-void setupParentSignals(void);
+void setupEventLoop(void);
 
 /*!
  * Parses and executes a given command.
- * This function forks a child process, executes the command,
- * and waits for the child process to complete.
+ * This function starts a child process for each stage of a pipeline like
+ * `sort < in | uniq > out`, all at once and connected with pipes, with the
+ * spawn backend chosen on the command line (see launch.h) or as a builtin
+ * (see builtins.h), with the environment of env.h. The children open their
+ * redirections (<, >, >> and 2>) themselves. They become one job in the
+ * job table, in a process group of their own, with a pidfd per process for
+ * the event loop to watch and the timeout of the job on the timer wheel.
+ * It does not wait. A builtin like cd that is the whole command line runs
+ * in the shell and is finished when this returns, except sleep, which is
+ * finished by its timer. A `time` prefix prints the real, user and system
+ * time of the command when it finishes.
  *
  * @param cmd   The command string to execute for child process.
- * @param envp  The environment variables
  */
-void runCommand(char* cmd, char* envp[]);
+void runCommand(char* cmd);
+
+/*!
+ * Runs the commands read from the input, at most max_jobs (-j) at once,
+ * until the input ends and every job has exited. It waits in epoll_wait
+ * for input, SIGINT and SIGCHLD from the signalfd, the pidfds of the jobs
+ * and the timerfd of their timeouts. A reaped job's rusage goes into the
+ * statistics. Without -j, it only reads the next command after the
+ * current one has exited. After the exit builtin it reads no more
+ * commands.
+ *
+ * @param reader the reader of the script or of standard input
+ */
+void runEventLoop(LineReader* reader);
 
 #endif
\ No newline at end of file
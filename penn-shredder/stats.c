@@ -0,0 +1,276 @@
+#include "stats.h"
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_TABLE_SIZE 16
+
+// the histogram buckets: values below 2^(SUB_BITS + 1) are exact, above
+// that each power of two has 2^SUB_BITS buckets. Larger values than
+// 2^MAX_BITS - 1 (25 days) count as that
+#define SUB_BITS 5
+#define SUB_COUNT (1 << SUB_BITS)
+#define MAX_BITS 41
+#define NUM_BUCKETS (2 * SUB_COUNT + (MAX_BITS - SUB_BITS - 1) * SUB_COUNT)
+
+// the statistics of one command name
+typedef struct entry_st {
+  char* name;
+  uint64_t runs;
+  uint64_t failed;
+  uint64_t timed_out;
+  uint64_t wall_total_us;
+  uint64_t wall_max_us;
+  uint64_t user_us;
+  uint64_t sys_us;
+  uint64_t max_rss_kb;
+  uint64_t rss_total_kb;  // for the mean
+  uint64_t voluntary_switches;
+  uint64_t involuntary_switches;
+  uint32_t wall_hist[NUM_BUCKETS];
+} entry;
+
+// Global Variables
+static entry** table = NULL;   // open addressing, linear probing
+static size_t table_size = 0;  // a power of two
+static size_t table_used = 0;
+
+static void* checked_calloc(size_t count, size_t size) {
+  void* res = calloc(count, size);
+  if (!res) {
+    perror("calloc failed");
+    exit(EXIT_FAILURE);
+  }
+  return res;
+}
+
+// ===========================================================
+// HDR histogram of wall times
+// ===========================================================
+static size_t bucket_of(uint64_t value) {
+  if (value < 2 * SUB_COUNT) {
+    return (size_t)value;
+  }
+  if (value >> MAX_BITS != 0) {
+    value = (1ULL << MAX_BITS) - 1;
+  }
+  // the top SUB_BITS + 1 bits of the value pick the bucket
+  int exponent = 63 - __builtin_clzll(value);
+  int shift = exponent - SUB_BITS;
+  return 2 * SUB_COUNT + (size_t)(exponent - SUB_BITS - 1) * SUB_COUNT +
+         (size_t)((value >> shift) - SUB_COUNT);
+}
+
+// the largest value that falls into a bucket
+static uint64_t bucket_top(size_t bucket) {
+  if (bucket < 2 * SUB_COUNT) {
+    return bucket;
+  }
+  size_t rest = bucket - 2 * SUB_COUNT;
+  int shift = (int)(rest / SUB_COUNT) + 1;
+  uint64_t low = (uint64_t)(SUB_COUNT + rest % SUB_COUNT) << shift;
+  return low + (1ULL << shift) - 1;
+}
+
+// the value that `percent` percent of the runs of an entry are at most
+static uint64_t percentile(const entry* cur, unsigned percent) {
+  uint64_t rank = (cur->runs * percent + 99) / 100;
+  if (rank == 0) {
+    rank = 1;
+  }
+  uint64_t seen = 0;
+  for (size_t bucket = 0; bucket < NUM_BUCKETS; bucket++) {
+    seen += cur->wall_hist[bucket];
+    if (seen >= rank) {
+      uint64_t top = bucket_top(bucket);
+      return top < cur->wall_max_us ? top : cur->wall_max_us;
+    }
+  }
+  return cur->wall_max_us;
+}
+
+// ===========================================================
+// The table of command names
+// ===========================================================
+static size_t hash_name(const char* name) {
+  // FNV-1a
+  uint64_t hash = 14695981039346656037ULL;
+  for (const char* c = name; *c != '\0'; c++) {
+    hash = (hash ^ (unsigned char)*c) * 1099511628211ULL;
+  }
+  return (size_t)hash;
+}
+
+static size_t find_slot(entry** slots, size_t size, const char* name) {
+  size_t idx = hash_name(name) & (size - 1);
+  while (slots[idx] != NULL && strcmp(slots[idx]->name, name) != 0) {
+    idx = (idx + 1) & (size - 1);
+  }
+  return idx;
+}
+
+static void grow_table(void) {
+  size_t new_size = table_size == 0 ? MIN_TABLE_SIZE : table_size * 2;
+  entry** slots = checked_calloc(new_size, sizeof(entry*));
+  for (size_t i = 0; i < table_size; i++) {
+    if (table[i] != NULL) {
+      slots[find_slot(slots, new_size, table[i]->name)] = table[i];
+    }
+  }
+  free(table);
+  table = slots;
+  table_size = new_size;
+}
+
+static entry* find_or_add(const char* name) {
+  if (2 * (table_used + 1) > table_size) {
+    grow_table();
+  }
+  size_t idx = find_slot(table, table_size, name);
+  if (table[idx] == NULL) {
+    table[idx] = checked_calloc(1, sizeof(entry));
+    table[idx]->name = strdup(name);
+    if (!table[idx]->name) {
+      perror("strdup failed");
+      exit(EXIT_FAILURE);
+    }
+    table_used++;
+  }
+  return table[idx];
+}
+
+static int compare_wall_total(const void* lhs, const void* rhs) {
+  const entry* left = *(entry* const*)lhs;
+  const entry* right = *(entry* const*)rhs;
+  if (left->wall_total_us != right->wall_total_us) {
+    return left->wall_total_us > right->wall_total_us ? -1 : 1;
+  }
+  return strcmp(left->name, right->name);
+}
+
+// the entries, the one with the most total wall time first. The caller
+// frees the array
+static entry** sorted_entries(void) {
+  entry** res = checked_calloc(table_used + 1, sizeof(entry*));
+  size_t count = 0;
+  for (size_t i = 0; i < table_size; i++) {
+    if (table[i] != NULL) {
+      res[count++] = table[i];
+    }
+  }
+  qsort(res, count, sizeof(entry*), compare_wall_total);
+  return res;
+}
+
+// ===========================================================
+// Public functions
+// ===========================================================
+void stats_record(const char* name,
+                  const command_usage* usage,
+                  bool failed,
+                  bool timed_out) {
+  entry* cur = find_or_add(name);
+  cur->runs++;
+  cur->failed += failed;
+  cur->timed_out += timed_out;
+  cur->wall_total_us += usage->wall_us;
+  if (usage->wall_us > cur->wall_max_us) {
+    cur->wall_max_us = usage->wall_us;
+  }
+  cur->wall_hist[bucket_of(usage->wall_us)]++;
+  cur->user_us += usage->user_us;
+  cur->sys_us += usage->sys_us;
+  if (usage->max_rss_kb > cur->max_rss_kb) {
+    cur->max_rss_kb = usage->max_rss_kb;
+  }
+  cur->rss_total_kb += usage->max_rss_kb;
+  cur->voluntary_switches += usage->voluntary_switches;
+  cur->involuntary_switches += usage->involuntary_switches;
+}
+
+// formats microseconds as milliseconds with three decimals
+static const char* format_ms(char* buf, size_t size, uint64_t us) {
+  snprintf(buf, size, "%" PRIu64 ".%03" PRIu64, us / 1000, us % 1000);
+  return buf;
+}
+
+void stats_print(FILE* out) {
+  fprintf(out, "%-20s %6s %6s %10s %10s %10s %10s %10s %10s %10s %8s %8s\n",
+          "command", "runs", "failed", "p50 ms", "p90 ms", "p99 ms",
+          "max ms", "user ms", "sys ms", "rss KB", "vcsw", "ivcsw");
+  entry** entries = sorted_entries();
+  for (entry** it = entries; *it != NULL; it++) {
+    const entry* cur = *it;
+    char p50[32], p90[32], p99[32], max[32], user[32], sys[32];
+    fprintf(out,
+            "%-20s %6" PRIu64 " %6" PRIu64
+            " %10s %10s %10s %10s %10s %10s %10" PRIu64 " %8" PRIu64
+            " %8" PRIu64 "\n",
+            cur->name, cur->runs, cur->failed,
+            format_ms(p50, sizeof(p50), percentile(cur, 50)),
+            format_ms(p90, sizeof(p90), percentile(cur, 90)),
+            format_ms(p99, sizeof(p99), percentile(cur, 99)),
+            format_ms(max, sizeof(max), cur->wall_max_us),
+            format_ms(user, sizeof(user), cur->user_us),
+            format_ms(sys, sizeof(sys), cur->sys_us), cur->max_rss_kb,
+            cur->voluntary_switches, cur->involuntary_switches);
+  }
+  free(entries);
+}
+
+// writes a string with the characters JSON does not allow escaped
+static void write_json_string(FILE* out, const char* str) {
+  fputc('"', out);
+  for (const unsigned char* c = (const unsigned char*)str; *c != '\0'; c++) {
+    if (*c == '"' || *c == '\\') {
+      fprintf(out, "\\%c", *c);
+    } else if (*c < 0x20) {
+      fprintf(out, "\\u%04x", *c);
+    } else {
+      fputc(*c, out);
+    }
+  }
+  fputc('"', out);
+}
+
+void stats_write_json(FILE* out) {
+  fprintf(out, "{\"commands\": [");
+  entry** entries = sorted_entries();
+  for (entry** it = entries; *it != NULL; it++) {
+    const entry* cur = *it;
+    fprintf(out, "%s\n  {\"name\": ", it == entries ? "" : ",");
+    write_json_string(out, cur->name);
+    fprintf(out,
+            ", \"runs\": %" PRIu64 ", \"failed\": %" PRIu64
+            ", \"timed_out\": %" PRIu64
+            ",\n   \"wall_us\": {\"total\": %" PRIu64 ", \"mean\": %" PRIu64
+            ", \"p50\": %" PRIu64 ", \"p90\": %" PRIu64 ", \"p99\": %" PRIu64
+            ", \"max\": %" PRIu64 "},\n",
+            cur->runs, cur->failed, cur->timed_out, cur->wall_total_us,
+            cur->wall_total_us / cur->runs, percentile(cur, 50),
+            percentile(cur, 90), percentile(cur, 99), cur->wall_max_us);
+    fprintf(out,
+            "   \"user_us\": %" PRIu64 ", \"sys_us\": %" PRIu64
+            ", \"max_rss_kb\": %" PRIu64 ", \"mean_rss_kb\": %" PRIu64
+            ",\n   \"voluntary_switches\": %" PRIu64
+            ", \"involuntary_switches\": %" PRIu64 "}",
+            cur->user_us, cur->sys_us, cur->max_rss_kb,
+            cur->rss_total_kb / cur->runs, cur->voluntary_switches,
+            cur->involuntary_switches);
+  }
+  fprintf(out, "\n]}\n");
+  free(entries);
+}
+
+void stats_free(void) {
+  for (size_t i = 0; i < table_size; i++) {
+    if (table[i] != NULL) {
+      free(table[i]->name);
+      free(table[i]);
+    }
+  }
+  free(table);
+  table = NULL;
+  table_size = 0;
+  table_used = 0;
+}
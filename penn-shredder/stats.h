@@ -0,0 +1,65 @@
+#ifndef STATS_H_
+#define STATS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*!
+ * Resource use of finished commands, aggregated per command name.
+ *
+ * Every reaped job adds its wall time and the rusage the kernel reports
+ * for it to the entry of its command name. Wall times go into an HDR
+ * style histogram: values below 64 microseconds each have a bucket, and
+ * above that every power of two is split into 32 buckets, so a percentile
+ * is within about 3% of the real value while a histogram stays under
+ * 5 KB whatever the range of the values. The other counters keep their
+ * sum and maximum.
+ *
+ * Entries are kept in an open addressing hash table keyed by the name, so
+ * recording a job costs a hash and a few additions.
+ */
+
+/* What the kernel reports about one finished command. */
+typedef struct command_usage_st {
+  uint64_t wall_us;  // from starting the command to reaping it
+  uint64_t user_us;  // user CPU time
+  uint64_t sys_us;   // system CPU time
+  uint64_t max_rss_kb;
+  uint64_t voluntary_switches;    // waits for I/O, locks, sleeps
+  uint64_t involuntary_switches;  // preemptions
+} command_usage;
+
+/*!
+ * Adds a finished command to the statistics.
+ *
+ * @param name      the command name.
+ * @param usage     its resource use.
+ * @param failed    true if it exited with a nonzero status or a signal.
+ * @param timed_out true if it was killed for its timeout.
+ * @post if memory allocation fails, the program exits.
+ */
+void stats_record(const char* name,
+                  const command_usage* usage,
+                  bool failed,
+                  bool timed_out);
+
+/*!
+ * Prints a table with a row per command name, the one with the most total
+ * wall time first.
+ *
+ * @param out where to print.
+ */
+void stats_print(FILE* out);
+
+/*!
+ * Writes the statistics as a JSON object, with the times in microseconds.
+ *
+ * @param out where to write.
+ */
+void stats_write_json(FILE* out);
+
+/* Frees the statistics. */
+void stats_free(void);
+
+#endif  // STATS_H_
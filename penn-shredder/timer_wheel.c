@@ -0,0 +1,134 @@
+#include "timer_wheel.h"
+
+#define SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+#define SHIFT(level) (TIMER_WHEEL_SLOT_BITS * (level))
+
+TimerWheel timer_wheel_new(uint64_t now) {
+  TimerWheel res = {0};
+  res.now = now;
+  return res;
+}
+
+static void link_timer(TimerWheel* self, Timer* timer, int level, size_t idx) {
+  Timer** head = &self->slots[level][idx];
+  timer->next = *head;
+  if (*head != NULL) {
+    (*head)->pprev = &timer->next;
+  }
+  *head = timer;
+  timer->pprev = head;
+  timer->slot = (unsigned)(level * TIMER_WHEEL_SLOTS + idx);
+  self->occupied[level] |= 1ULL << idx;
+}
+
+static void unlink_timer(TimerWheel* self, Timer* timer) {
+  *timer->pprev = timer->next;
+  if (timer->next != NULL) {
+    timer->next->pprev = timer->pprev;
+  }
+  int level = (int)(timer->slot / TIMER_WHEEL_SLOTS);
+  size_t idx = timer->slot % TIMER_WHEEL_SLOTS;
+  if (self->slots[level][idx] == NULL) {
+    self->occupied[level] &= ~(1ULL << idx);
+  }
+  timer->next = NULL;
+  timer->pprev = NULL;
+}
+
+// puts a timer into the lowest level whose range covers tick `when`,
+// which is at least now
+static void place(TimerWheel* self, Timer* timer, uint64_t when) {
+  uint64_t delta = when - self->now;
+  int level = 0;
+  while (level < TIMER_WHEEL_LEVELS - 1 && delta >= 1ULL << SHIFT(level + 1)) {
+    level++;
+  }
+  if (delta >= 1ULL << SHIFT(TIMER_WHEEL_LEVELS)) {
+    // out of range: the last slot of the top level, placed again from
+    // there when it cascades
+    when = self->now + ((uint64_t)SLOT_MASK << SHIFT(level));
+  }
+  link_timer(self, timer, level, (when >> SHIFT(level)) & SLOT_MASK);
+}
+
+// moves the timers of a slot down into the lower levels
+static void cascade(TimerWheel* self, int level, size_t idx) {
+  Timer* timer;
+  while ((timer = self->slots[level][idx]) != NULL) {
+    unlink_timer(self, timer);
+    place(self, timer, timer->expires > self->now ? timer->expires : self->now);
+  }
+}
+
+void timer_wheel_add(TimerWheel* self, Timer* timer, uint64_t expires) {
+  timer->expires = expires;
+  // the current tick has fired already
+  place(self, timer, expires > self->now ? expires : self->now + 1);
+  self->count++;
+}
+
+void timer_wheel_cancel(TimerWheel* self, Timer* timer) {
+  if (timer_scheduled(timer)) {
+    unlink_timer(self, timer);
+    self->count--;
+  }
+}
+
+void timer_wheel_advance(TimerWheel* self, uint64_t now, timer_fn fire) {
+  while (self->now < now) {
+    if (self->count == 0) {
+      self->now = now;
+      return;
+    }
+    if (self->occupied[0] == 0) {
+      // nothing fires before the next cascade, at a multiple of the slots
+      uint64_t next_block = (self->now | SLOT_MASK) + 1;
+      if (next_block > now) {
+        self->now = now;
+        return;
+      }
+      self->now = next_block - 1;
+    }
+    self->now++;
+
+    // higher levels first, so their timers can cascade again right away
+    for (int level = TIMER_WHEEL_LEVELS - 1; level > 0; level--) {
+      if ((self->now & ((1ULL << SHIFT(level)) - 1)) == 0) {
+        cascade(self, level, (self->now >> SHIFT(level)) & SLOT_MASK);
+      }
+    }
+
+    size_t idx = self->now & SLOT_MASK;
+    Timer* timer;
+    while ((timer = self->slots[0][idx]) != NULL) {
+      unlink_timer(self, timer);
+      self->count--;
+      fire(timer);
+    }
+  }
+}
+
+bool timer_wheel_next(const TimerWheel* self, uint64_t* when) {
+  if (self->count == 0) {
+    return false;
+  }
+  uint64_t best = UINT64_MAX;
+  for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+    uint64_t bits = self->occupied[level];
+    if (bits == 0) {
+      continue;
+    }
+    // rotate so that bit 0 is the slot after the current one. The current
+    // slot itself comes around last, a full rotation from now
+    uint64_t base = self->now >> SHIFT(level);
+    unsigned first = (unsigned)((base + 1) & SLOT_MASK);
+    uint64_t rotated = first == 0 ? bits : bits >> first | bits << (64 - first);
+    uint64_t distance = (uint64_t)__builtin_ctzll(rotated) + 1;
+    uint64_t tick = (base + distance) << SHIFT(level);
+    if (tick < best) {
+      best = tick;
+    }
+  }
+  *when = best;
+  return true;
+}
@@ -0,0 +1,93 @@
+#ifndef TIMER_WHEEL_H_
+#define TIMER_WHEEL_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*!
+ * A hierarchical timer wheel, so any number of timeouts share one OS
+ * timer.
+ *
+ * Time is counted in ticks of one millisecond. Level 0 has a slot for each
+ * of the next 64 ticks, level 1 a slot for each of the next 64 blocks of
+ * 64 ticks, and so on for four levels, about 4.6 hours. A timer goes into
+ * the lowest level whose range covers it. When time reaches the start of
+ * a higher level slot, its timers are cascaded into the lower levels, so
+ * adding and cancelling a timer is O(1) and each timer is moved at most
+ * once per level. Timers further out than the top level wait in its last
+ * slot and are placed again when it cascades.
+ *
+ * Timers are intrusive: the caller owns the Timer and keeps it at the same
+ * address while it is scheduled.
+ */
+
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_SLOT_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_SLOT_BITS)
+
+typedef struct timer_st {
+  uint64_t expires;  // the tick it fires at
+  struct timer_st* next;
+  struct timer_st** pprev;  // NULL when not scheduled
+  unsigned slot;            // level * TIMER_WHEEL_SLOTS + index
+  void* arg;                // for the caller
+} Timer;
+
+typedef struct timer_wheel_st {
+  uint64_t now;  // every tick up to and including this one has fired
+  size_t count;  // scheduled timers
+  uint64_t occupied[TIMER_WHEEL_LEVELS];  // a bit per non-empty slot
+  Timer* slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+} TimerWheel;
+
+/* Called for each timer that fires. The timer is no longer scheduled. */
+typedef void (*timer_fn)(Timer* timer);
+
+/*!
+ * Creates an empty wheel.
+ *
+ * @param now the current tick.
+ * @returns the wheel.
+ */
+TimerWheel timer_wheel_new(uint64_t now);
+
+/*!
+ * Schedules a timer. It must not be scheduled already.
+ *
+ * @param self    the wheel.
+ * @param timer   the timer.
+ * @param expires the tick to fire at. Ticks that have passed fire on the
+ *                next advance.
+ */
+void timer_wheel_add(TimerWheel* self, Timer* timer, uint64_t expires);
+
+/* Unschedules a timer, if it is scheduled. */
+void timer_wheel_cancel(TimerWheel* self, Timer* timer);
+
+/* Returns true if the timer is scheduled. */
+static inline bool timer_scheduled(const Timer* timer) {
+  return timer->pprev != NULL;
+}
+
+/*!
+ * Moves time forward, firing every timer that expires by then.
+ *
+ * @param self the wheel.
+ * @param now  the current tick. Nothing happens if it is not ahead.
+ * @param fire called for each expired timer, in order of expiry slot.
+ */
+void timer_wheel_advance(TimerWheel* self, uint64_t now, timer_fn fire);
+
+/*!
+ * Finds when the wheel next needs to advance: the earliest tick at which
+ * a timer fires or a slot holding timers cascades. Advancing then may fire
+ * nothing, but no timer fires before it.
+ *
+ * @param self the wheel.
+ * @param when set to the tick.
+ * @returns false if no timer is scheduled.
+ */
+bool timer_wheel_next(const TimerWheel* self, uint64_t* when);
+
+#endif  // TIMER_WHEEL_H_
@@ -1,7 +1,10 @@
 #include "./Vec.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "./panic.h"
+#include "./slab.h"
+#include "./vec_internal.h"
 
 Vec vec_new(size_t initial_capacity, ptr_dtor_fn ele_dtor_fn) {
   // TODO: implement me
@@ -27,9 +30,65 @@ Vec vec_new(size_t initial_capacity, ptr_dtor_fn ele_dtor_fn) {
   res.length = 0;
   res.capacity = initial_capacity;
   res.ele_dtor_fn = ele_dtor_fn;
+  res.batch_dtor_fn = NULL;
+  res.slab = NULL;
+  res.block = NULL;
   return res;
 }
 
+Vec vec_new_batch(size_t initial_capacity, ptr_batch_dtor_fn batch_dtor_fn) {
+  Vec res = vec_new(initial_capacity, NULL);
+  res.batch_dtor_fn = batch_dtor_fn;
+  return res;
+}
+
+Vec vec_new_slab(size_t initial_capacity, Slab* slab) {
+  if (slab == NULL) {
+    panic("slab is NULL");
+  }
+  Vec res = vec_new(initial_capacity, NULL);
+  res.slab = slab;
+  return res;
+}
+
+// clean up the elements in [begin, end) with whichever destructor
+// the vector was created with. The batch destructor gets the whole
+// span in one call, the per element one is only called on non-NULL
+static void vec_destroy_range(Vec* self, size_t begin, size_t end) {
+  if (begin >= end) {
+    return;
+  }
+  // snapshots may still see the elements, they are destructed later
+  if (self->block != NULL && vec_retire_range(self, begin, end)) {
+    return;
+  }
+  if (self->slab != NULL) {
+    // non-NULL elements are distinct slab objects, so if the vector holds
+    // as many as the slab has live, it holds all of them and they can go
+    // at once. Counting the NULLs is a SIMD scan, far cheaper than N frees
+    if (begin == 0 && end == self->length &&
+        slab_live(self->slab) == end - vec_count(self, NULL)) {
+      slab_reset(self->slab);
+      return;
+    }
+    for (size_t i = begin; i < end; i++) {
+      slab_free(self->slab, self->data[i]);
+    }
+    return;
+  }
+  if (self->batch_dtor_fn != NULL) {
+    self->batch_dtor_fn(self->data + begin, end - begin);
+    return;
+  }
+  if (self->ele_dtor_fn != NULL) {
+    for (size_t i = begin; i < end; i++) {
+      if (self->data[i] != NULL) {
+        self->ele_dtor_fn(self->data[i]);
+      }
+    }
+  }
+}
+
 // TODO: the rest of the vector functions
 /* Gets the specified element of the Vec
  *
@@ -70,10 +129,11 @@ void vec_set(Vec* self, size_t index, ptr_t new_ele) {
     panic("index out of bound");
   }
 
+  // a snapshot may share the buffer, copy it before writing
+  vec_unshare(self);
+
   // remember to clean up the old one
-  if (self->ele_dtor_fn != NULL && self->data[index] != NULL) {
-    self->ele_dtor_fn(self->data[index]);
-  }
+  vec_destroy_range(self, index, index + 1);
 
   self->data[index] = new_ele;
 }
@@ -94,6 +154,9 @@ void vec_push_back(Vec* self, ptr_t new_ele) {
   if (self == NULL) {
     panic("self is NULL");
   }
+
+  vec_unshare(self);
+
   if (self->capacity == 0) {
     self->capacity = 1;
     self->data = (ptr_t*)malloc(self->capacity * sizeof(ptr_t));
@@ -136,9 +199,9 @@ bool vec_pop_back(Vec* self) {
     return false;
   }
 
-  if (self->ele_dtor_fn != NULL && self->data[self->length - 1] != NULL) {
-    self->ele_dtor_fn(self->data[self->length - 1]);
-  }
+  vec_unshare(self);
+
+  vec_destroy_range(self, self->length - 1, self->length);
   // correct way
   self->length--;
   return true;
@@ -167,6 +230,8 @@ void vec_insert(Vec* self, size_t index, ptr_t new_ele) {
     panic("index out of bound");
   }
 
+  vec_unshare(self);
+
   if (self->capacity == 0) {
     self->capacity = 1;
     self->data = (ptr_t*)malloc(self->capacity * sizeof(ptr_t));
@@ -207,10 +272,9 @@ void vec_erase(Vec* self, size_t index) {
   if (index < 0 || index >= self->length) {
     panic("index out of bound");
   }
+  vec_unshare(self);
   // deconstruct the index element only
-  if (self->ele_dtor_fn != NULL && self->data[index] != NULL) {
-    self->ele_dtor_fn(self->data[index]);
-  }
+  vec_destroy_range(self, index, index + 1);
   // no need to deconstruct every element, since it's array of ptr, so just
   // shift
   for (size_t i = index; i < self->length - 1; i++) {
@@ -219,6 +283,113 @@ void vec_erase(Vec* self, size_t index) {
   self->length--;
 }
 
+/* Inserts k elements at k positions in one pass.
+ *
+ * @param self      a pointer to the vector we want to insert into.
+ * @param positions the positions, sorted in non-decreasing order.
+ * @param elems     the k elements to insert.
+ * @param k         the number of elements to insert.
+ * @pre If a position is > self->length or the positions are not sorted
+ * then this function will panic().
+ */
+void vec_insert_many(Vec* self,
+                     const size_t* positions,
+                     const ptr_t* elems,
+                     size_t k) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  if (k == 0) {
+    return;
+  }
+  if (positions == NULL || elems == NULL) {
+    panic("positions or elems is NULL");
+  }
+  for (size_t j = 0; j < k; j++) {
+    if (positions[j] > self->length) {
+      panic("index out of bound");
+    }
+    if (j > 0 && positions[j] < positions[j - 1]) {
+      panic("positions are not sorted");
+    }
+  }
+
+  vec_unshare(self);
+
+  size_t new_length = self->length + k;
+  if (new_length > self->capacity) {
+    size_t new_capacity = self->capacity * 2;
+    if (new_capacity < new_length) {
+      new_capacity = new_length;
+    }
+    vec_resize(self, new_capacity);
+  }
+
+  // merge from the back: the elements after positions[j] move up by
+  // j + 1 slots, then elems[j] goes right below them
+  size_t src_end = self->length;
+  for (size_t j = k; j > 0; j--) {
+    size_t pos = positions[j - 1];
+    memmove(&self->data[pos + j], &self->data[pos],
+            (src_end - pos) * sizeof(ptr_t));
+    self->data[pos + j - 1] = elems[j - 1];
+    src_end = pos;
+  }
+  self->length = new_length;
+}
+
+/* Erases the elements at k indices in one pass.
+ *
+ * @param self a pointer to the vector we want to erase from.
+ * @param idx  the indices of the elements to erase, strictly increasing.
+ * @param k    the number of indices.
+ * @pre If an index is >= self->length or the indices are not strictly
+ * increasing then this function will panic().
+ */
+void vec_erase_indices(Vec* self, const size_t* idx, size_t k) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  if (k == 0) {
+    return;
+  }
+  if (idx == NULL) {
+    panic("idx is NULL");
+  }
+  for (size_t j = 0; j < k; j++) {
+    if (idx[j] >= self->length) {
+      panic("index out of bound");
+    }
+    if (j > 0 && idx[j] <= idx[j - 1]) {
+      panic("indices are not sorted");
+    }
+  }
+
+  vec_unshare(self);
+
+  // compact the kept runs forward, setting the erased elements aside
+  ptr_t* erased = (ptr_t*)malloc(k * sizeof(ptr_t));
+  if (erased == NULL) {
+    panic("malloc failed");
+  }
+  size_t dst = idx[0];
+  for (size_t j = 0; j < k; j++) {
+    erased[j] = self->data[idx[j]];
+    size_t run_begin = idx[j] + 1;
+    size_t run_end = j + 1 < k ? idx[j + 1] : self->length;
+    memmove(&self->data[dst], &self->data[run_begin],
+            (run_end - run_begin) * sizeof(ptr_t));
+    dst += run_end - run_begin;
+  }
+
+  // the erased elements go to the freed tail and are destructed as one
+  // range, so a batch destructor or a slab reset covers them all at once
+  memcpy(&self->data[dst], erased, k * sizeof(ptr_t));
+  free(erased);
+  vec_destroy_range(self, dst, self->length);
+  self->length = dst;
+}
+
 /* Resizes the container to a new specified capacity.
  * Does nothing if new_capacity <= self->length
  *
@@ -235,6 +406,7 @@ void vec_resize(Vec* self, size_t new_capacity) {
     panic("self is NULL");
   }
   if (new_capacity > self->capacity) {
+    vec_unshare(self);
     ptr_t* newdata = (ptr_t*)realloc(self->data, new_capacity * sizeof(ptr_t));
     if (newdata == NULL) {
       panic("realloc failed");
@@ -257,15 +429,11 @@ void vec_clear(Vec* self) {
     panic("self is NULL");
   }
 
-  if (self->ele_dtor_fn != NULL) {
-    for (size_t i = 0; i < self->length; i++) {
-      if (self->data[i] != NULL) {
-        self->ele_dtor_fn(self->data[i]);
-      }
-    }
-  }
-
+  // the elements go first, to the newest snapshot if one can still see
+  // them, so a buffer still shared with it need not be copied
+  vec_destroy_range(self, 0, self->length);
   self->length = 0;
+  vec_unshare_empty(self);
 }
 
 /* Destruct the vector.
@@ -282,12 +450,9 @@ void vec_destroy(Vec* self) {
     panic("self is NULL");
   }
 
-  if (self->ele_dtor_fn != NULL) {
-    for (size_t i = 0; i < self->length; i++) {
-      if (self->data[i] != NULL) {
-        self->ele_dtor_fn(self->data[i]);
-      }
-    }
+  vec_destroy_range(self, 0, self->length);
+  if (self->block != NULL) {
+    vec_release_block(self);
   }
   free(self->data);
   self->data = NULL;
@@ -6,14 +6,28 @@
 
 typedef void* ptr_t;
 typedef void (*ptr_dtor_fn)(ptr_t);
+typedef void (*ptr_batch_dtor_fn)(ptr_t*, size_t);
+
+struct slab_st;
+struct vec_block_st;
 
 typedef struct vec_st {
   ptr_t* data;
   size_t length;
   size_t capacity;
   ptr_dtor_fn ele_dtor_fn;
+  ptr_batch_dtor_fn batch_dtor_fn;
+  struct slab_st* slab;  // NULL unless created with vec_new_slab()
+  struct vec_block_st* block;  // NULL unless snapshotted, see vec_snapshot()
 } Vec;
 
+/* An immutable view of a Vec at the time vec_snapshot() was called. */
+typedef struct vec_snapshot_st {
+  const ptr_t* data;
+  size_t length;
+  struct vec_block_st* block;
+} VecSnapshot;
+
 /*!
  * Creates a new empty Vec(tor) with the specified initial_capacity
  * and specified function to clean up elements in the vector.
@@ -32,6 +46,40 @@ typedef struct vec_st {
  */
 Vec vec_new(size_t initial_capacity, ptr_dtor_fn ele_dtor_fn);
 
+/*!
+ * Creates a new empty Vec(tor) whose elements are cleaned up in batches.
+ * Instead of being called once per element, the batch destructor is handed
+ * the whole span of removed elements in one call, e.g. all `length` elements
+ * on vec_clear() and vec_destroy(), or a span of 1 on vec_erase().
+ *
+ * @param initial_capacity the initial capacity of the newly created vector
+ * @param batch_dtor_fn    a function pointer to a function that takes in a
+ *                         pointer to the first removed element and the number
+ *                         of removed elements. Unlike ele_dtor_fn, the span
+ *                         may contain NULL elements, so the function must
+ *                         skip them itself. NULL can be passed in to specify
+ *                         that there is no cleanup function.
+ * @returns a newly created vector with specified capacity, 0 length, no
+ * per-element destructor and the specified batch destructor.
+ * @post if memory allocation fails, the function will panic.
+ */
+Vec vec_new_batch(size_t initial_capacity, ptr_batch_dtor_fn batch_dtor_fn);
+
+/*!
+ * Creates a new empty Vec(tor) whose elements are objects from a Slab
+ * (see slab.h). Removed elements are given back with slab_free(), and when
+ * every live object of the slab is in the vector, vec_clear() and
+ * vec_destroy() release them all with a single slab_reset() instead of one
+ * call per element. The slab is not owned by the vector and must outlive it.
+ *
+ * @param initial_capacity the initial capacity of the newly created vector
+ * @param slab             the Slab every non-NULL element was allocated from.
+ * @returns a newly created vector with specified capacity, 0 length and
+ * no element destructor other than giving elements back to the slab.
+ * @post if memory allocation fails, the function will panic.
+ */
+Vec vec_new_slab(size_t initial_capacity, struct slab_st* slab);
+
 /* Returns the current capacity of the Vec
  * Written as a function-like macro
  *
@@ -128,6 +176,42 @@ void vec_insert(Vec* self, size_t index, ptr_t new_ele);
  */
 void vec_erase(Vec* self, size_t index);
 
+/* Inserts k elements at k positions in one pass.
+ * elems[j] is inserted before the element that was at index positions[j]
+ * when the call was made, or at the end if positions[j] is the length.
+ * Elements given the same position keep their order. Unlike k calls to
+ * vec_insert, which shift the tail k times, this grows the buffer at most
+ * once and moves every element once, in O(n + k).
+ *
+ * @param self      a pointer to the vector we want to insert into.
+ * @param positions the positions, sorted in non-decreasing order.
+ * @param elems     the k elements to insert.
+ * @param k         the number of elements to insert.
+ * @pre If a position is > self->length or the positions are not sorted
+ * then this function will panic().
+ * @post If the new length is greater than the old capacity then a
+ * reallocation takes place. Capacity is doubled, or raised to the new
+ * length if that is not enough.
+ */
+void vec_insert_many(Vec* self,
+                     const size_t* positions,
+                     const ptr_t* elems,
+                     size_t k);
+
+/* Erases the elements at k indices in one pass.
+ * The remaining elements keep their order and each moves once, in O(n).
+ * The erased elements are destructed after the pass, in one call of the
+ * batch destructor or one call per element of ele_dtor_fn.
+ *
+ * @param self a pointer to the vector we want to erase from.
+ * @param idx  the indices of the elements to erase, strictly increasing.
+ * @param k    the number of indices.
+ * @pre If an index is >= self->length or the indices are not strictly
+ * increasing then this function will panic().
+ * @post The removed elements are destructed (cleaned up).
+ */
+void vec_erase_indices(Vec* self, const size_t* idx, size_t k);
+
 /* Resizes the container to a new specified capacity.
  * Does nothing if new_capacity <= self->length
  *
@@ -162,4 +246,101 @@ void vec_clear(Vec* self);
  */
 void vec_destroy(Vec* self);
 
+/* The index returned by the search functions when nothing was found. */
+#define VEC_NPOS ((size_t)-1)
+
+/* Finds the first occurrence of an element in the Vec.
+ * Elements are compared by pointer value. The search runs with the best
+ * SIMD kernel the CPU supports (see simd.h) and skips the per element
+ * bounds checks of vec_get.
+ *
+ * @param self   a pointer to the vector we want to search.
+ * @param needle the element we are looking for.
+ * @returns the index of the first element equal to needle, or VEC_NPOS if
+ * there is no such element.
+ * @pre Assumes self points to a valid vector.
+ */
+size_t vec_find(Vec* self, ptr_t needle);
+
+/* Counts the occurrences of an element in the Vec.
+ * Elements are compared by pointer value.
+ *
+ * @param self   a pointer to the vector we want to search.
+ * @param needle the element we are counting.
+ * @returns the number of elements equal to needle.
+ * @pre Assumes self points to a valid vector.
+ */
+size_t vec_count(Vec* self, ptr_t needle);
+
+/* Finds the first NULL element in the Vec.
+ *
+ * @param self a pointer to the vector we want to search.
+ * @returns the index of the first NULL element, or VEC_NPOS if
+ * there is no such element.
+ * @pre Assumes self points to a valid vector.
+ */
+size_t vec_find_if_null(Vec* self);
+
+/* Removes every NULL element from the Vec in a single pass.
+ * The remaining elements keep their relative order. Capacity of the vector
+ * is unchanged. No destructor is called since NULL elements are never
+ * destructed.
+ *
+ * @param self a pointer to the vector we want to compact.
+ * @returns the number of elements that were removed.
+ * @pre Assumes self points to a valid vector.
+ */
+size_t vec_compact_nulls(Vec* self);
+
+/* Takes an O(1) snapshot of the Vec that shares its buffer.
+ * The snapshot is reference counted and immutable. The next mutation of
+ * the vector copies the buffer first (copy on write), so readers of the
+ * snapshot never see it change, and the elements it holds are only
+ * destructed once the last snapshot holding them is released.
+ *
+ * Snapshots can be handed to other threads. Getting elements of a snapshot,
+ * retaining and releasing it take no locks, only an atomic counter. The
+ * vector itself must still be used from one thread at a time.
+ *
+ * @param self a pointer to the vector to take a snapshot of.
+ * @returns a snapshot to be released with vec_snapshot_release().
+ * @pre Assumes self points to a valid vector that is not bound to a Slab.
+ * @post if memory allocation fails, the function will panic.
+ */
+VecSnapshot vec_snapshot(Vec* self);
+
+/* Returns the length of a snapshot.
+ *
+ * @param snap, a pointer to the snapshot we want to grab the len of.
+ */
+#define vec_snapshot_len(snap) ((snap)->length)
+
+/* Gets the specified element of a snapshot.
+ *
+ * @param snap  a pointer to the snapshot who's element we want to get.
+ * @param index the index of the element to get.
+ * @returns the element at the specified index.
+ * @pre If the index is >= the length of the snapshot then this function
+ * will panic()
+ */
+ptr_t vec_snapshot_get(const VecSnapshot* snap, size_t index);
+
+/* Takes another reference to a snapshot, e.g. to hand it to another thread.
+ *
+ * @param snap a pointer to the snapshot to share.
+ * @returns the same snapshot, to be released on its own.
+ */
+VecSnapshot vec_snapshot_retain(const VecSnapshot* snap);
+
+/* Releases a snapshot, leaving it empty. Once every snapshot sharing a
+ * buffer is released the buffer is freed, along with the elements the vector
+ * removed while they were still visible through it. Elements removed after
+ * the newest snapshot was taken are destructed by the vector itself, on its
+ * next removal or snapshot once it finds no snapshot is left.
+ *
+ * @param snap a pointer to the snapshot to release. Releasing an empty
+ * snapshot does nothing.
+ */
+void vec_snapshot_release(VecSnapshot* snap);
+
 #endif  // VEC_H_
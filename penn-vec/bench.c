@@ -0,0 +1,1391 @@
+#define _GNU_SOURCE  // tdestroy
+#include <malloc.h>
+#include <pthread.h>
+#include <search.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "./Vec.h"
+#include "./extsort.h"
+#include "./flat.h"
+#include "./gap_vec.h"
+#include "./hashmap.h"
+#include "./pvec.h"
+#include "./seq.h"
+#include "./shared_vec.h"
+#include "./simd.h"
+#include "./slab.h"
+#include "./strvec.h"
+#include "./vector.h"
+#include "./vector_kernels.h"
+
+/*!
+ * Throughput benchmarks for the penn-vec containers and kernels.
+ *
+ * usage: ./bench <name> [max_elements]
+ *
+ * Each benchmark runs over sizes from 1K elements up to max_elements,
+ * growing by a factor of 10. Build with `make bench`, which compiles with
+ * optimizations on.
+ */
+
+#define MIN_ELEMENTS 1000U
+#define DEFAULT_MAX_ELEMENTS 100000000U
+
+// do at least this many element visits per measurement so that
+// small sizes are not dominated by timer overhead
+#define MIN_WORK 200000000U
+
+#define BASE_10 10
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static size_t reps_for(size_t n) {
+  size_t reps = MIN_WORK / n;
+  return reps == 0 ? 1 : reps;
+}
+
+// keeps the compiler from optimizing the measured results away
+static volatile size_t sink;
+
+static ptr_t as_ptr(uintptr_t val) {
+  return (ptr_t)val;
+}
+
+// splitmix64, a fast generator for benchmark keys
+static uint64_t next_random(uint64_t* state) {
+  uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+// ===========================================================
+// Chained hash table, the baseline for the associative
+// containers. Separate chaining with one malloc per node and
+// a power of two bucket count, grown at load factor 1.
+// ===========================================================
+typedef struct chain_node_st {
+  struct chain_node_st* next;
+  uintptr_t key;
+  uintptr_t value;
+} chain_node;
+
+typedef struct chain_table_st {
+  chain_node** buckets;
+  size_t mask;
+  size_t length;
+} chain_table;
+
+static size_t chain_bucket(const chain_table* table, uintptr_t key) {
+  return (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & table->mask;
+}
+
+static void chain_init(chain_table* table) {
+  table->mask = 15;
+  table->length = 0;
+  table->buckets = calloc(table->mask + 1, sizeof(chain_node*));
+}
+
+static void chain_grow(chain_table* table) {
+  chain_table bigger = {
+      .buckets = calloc(2 * (table->mask + 1), sizeof(chain_node*)),
+      .mask = 2 * table->mask + 1,
+      .length = table->length,
+  };
+  for (size_t b = 0; b <= table->mask; b++) {
+    chain_node* node = table->buckets[b];
+    while (node != NULL) {
+      chain_node* next = node->next;
+      size_t dst = chain_bucket(&bigger, node->key);
+      node->next = bigger.buckets[dst];
+      bigger.buckets[dst] = node;
+      node = next;
+    }
+  }
+  free(table->buckets);
+  *table = bigger;
+}
+
+static chain_node* chain_find(const chain_table* table, uintptr_t key) {
+  chain_node* node = table->buckets[chain_bucket(table, key)];
+  while (node != NULL && node->key != key) {
+    node = node->next;
+  }
+  return node;
+}
+
+static void chain_put(chain_table* table, uintptr_t key, uintptr_t value) {
+  chain_node* node = chain_find(table, key);
+  if (node != NULL) {
+    node->value = value;
+    return;
+  }
+  if (table->length > table->mask) {
+    chain_grow(table);
+  }
+  size_t b = chain_bucket(table, key);
+  node = malloc(sizeof(chain_node));
+  node->key = key;
+  node->value = value;
+  node->next = table->buckets[b];
+  table->buckets[b] = node;
+  table->length++;
+}
+
+static bool chain_erase(chain_table* table, uintptr_t key) {
+  chain_node** link = &table->buckets[chain_bucket(table, key)];
+  while (*link != NULL && (*link)->key != key) {
+    link = &(*link)->next;
+  }
+  if (*link == NULL) {
+    return false;
+  }
+  chain_node* node = *link;
+  *link = node->next;
+  free(node);
+  table->length--;
+  return true;
+}
+
+static void chain_destroy(chain_table* table) {
+  for (size_t b = 0; b <= table->mask; b++) {
+    chain_node* node = table->buckets[b];
+    while (node != NULL) {
+      chain_node* next = node->next;
+      free(node);
+      node = next;
+    }
+  }
+  free(table->buckets);
+}
+
+// ===========================================================
+// vec_find / vec_count / vec_compact_nulls
+// ===========================================================
+static size_t find_with_vec_get(Vec* vec, ptr_t needle) {
+  for (size_t i = 0; i < vec_len(vec); i++) {
+    if (vec_get(vec, i) == needle) {
+      return i;
+    }
+  }
+  return VEC_NPOS;
+}
+
+static void bench_search(size_t max_n) {
+  simd_level best = simd_detect();
+  printf("%12s %10s %14s %14s %14s\n", "elements", "kernel", "find ns/elem",
+         "count ns/elem", "compact ns/elem");
+
+  for (size_t n = MIN_ELEMENTS; n <= max_n; n *= BASE_10) {
+    Vec vec = vec_new(n, NULL);
+    for (size_t i = 0; i < n; i++) {
+      vec_push_back(&vec, as_ptr(i + 1));
+    }
+    // worst case for find, the needle is the last element
+    ptr_t needle = as_ptr(n);
+    size_t reps = reps_for(n);
+
+    double start = now_sec();
+    for (size_t r = 0; r < reps; r++) {
+      sink = find_with_vec_get(&vec, needle);
+    }
+    double elapsed = now_sec() - start;
+    printf("%12zu %10s %14.3f %14s %14s\n", n, "vec_get",
+           elapsed * 1e9 / (double)(n * reps), "-", "-");
+
+    for (int level = SIMD_SCALAR; level <= best; level++) {
+      simd_set_level((simd_level)level);
+
+      start = now_sec();
+      for (size_t r = 0; r < reps; r++) {
+        sink = vec_find(&vec, needle);
+      }
+      double find_time = now_sec() - start;
+
+      start = now_sec();
+      for (size_t r = 0; r < reps; r++) {
+        sink = vec_count(&vec, needle);
+      }
+      double count_time = now_sec() - start;
+
+      // compaction is destructive, so only time a single pass over a
+      // vector where every other element is NULL
+      Vec holes = vec_new(n, NULL);
+      for (size_t i = 0; i < n; i++) {
+        vec_push_back(&holes, (i % 2) ? NULL : as_ptr(i + 1));
+      }
+      start = now_sec();
+      sink = vec_compact_nulls(&holes);
+      double compact_time = now_sec() - start;
+      vec_destroy(&holes);
+
+      printf("%12zu %10s %14.3f %14.3f %14.3f\n", n,
+             simd_level_name((simd_level)level),
+             find_time * 1e9 / (double)(n * reps),
+             count_time * 1e9 / (double)(n * reps),
+             compact_time * 1e9 / (double)n);
+    }
+    simd_set_level(best);
+    vec_destroy(&vec);
+  }
+}
+
+// ===========================================================
+// vector(T) reductions
+// ===========================================================
+#define HIST_BINS 64
+
+// times every reduction of one element type, the same set of
+// columns is printed for each of int, float and double
+#define BENCH_REDUCE_TYPE(T, n, reps)                                     \
+  do {                                                                    \
+    vector(T) a = vector_new(T, (n), NULL);                               \
+    vector(T) b = vector_new(T, (n), NULL);                               \
+    for (size_t i = 0; i < (n); i++) {                                    \
+      vector_push(&a, (T)(i % 1000));                                     \
+      vector_push(&b, (T)(i % 7));                                        \
+    }                                                                     \
+    size_t counts[HIST_BINS];                                             \
+    double times[5];                                                      \
+    double start = now_sec();                                             \
+    for (size_t r = 0; r < (reps); r++) {                                 \
+      sink = (size_t)vector_sum(&a, T);                                   \
+    }                                                                     \
+    times[0] = now_sec() - start;                                         \
+    start = now_sec();                                                    \
+    for (size_t r = 0; r < (reps); r++) {                                 \
+      sink = (size_t)vector_min(&a, T);                                   \
+    }                                                                     \
+    times[1] = now_sec() - start;                                         \
+    start = now_sec();                                                    \
+    for (size_t r = 0; r < (reps); r++) {                                 \
+      sink = (size_t)vector_max(&a, T);                                   \
+    }                                                                     \
+    times[2] = now_sec() - start;                                         \
+    start = now_sec();                                                    \
+    for (size_t r = 0; r < (reps); r++) {                                 \
+      sink = (size_t)vector_dot(&a, &b, T);                               \
+    }                                                                     \
+    times[3] = now_sec() - start;                                         \
+    start = now_sec();                                                    \
+    for (size_t r = 0; r < (reps); r++) {                                 \
+      vector_histogram(&a, T, 0.0, 1000.0, counts, HIST_BINS);            \
+      sink = counts[0];                                                   \
+    }                                                                     \
+    times[4] = now_sec() - start;                                         \
+    printf("%12zu %10s %8s", (n), simd_level_name(simd_get_level()), #T); \
+    for (int col = 0; col < 5; col++) {                                   \
+      printf(" %9.3f", times[col] * 1e9 / (double)((n) * (reps)));        \
+    }                                                                     \
+    printf("\n");                                                         \
+    vector_free(&a);                                                      \
+    vector_free(&b);                                                      \
+  } while (0)
+
+static void bench_reduce(size_t max_n) {
+  simd_level best = simd_detect();
+  printf("ns per element\n");
+  printf("%12s %10s %8s %9s %9s %9s %9s %9s\n", "elements", "kernel", "type",
+         "sum", "min", "max", "dot", "hist");
+
+  for (size_t n = MIN_ELEMENTS; n <= max_n; n *= BASE_10) {
+    size_t reps = reps_for(n);
+    for (int level = SIMD_SCALAR; level <= best; level++) {
+      simd_set_level((simd_level)level);
+      BENCH_REDUCE_TYPE(int, n, reps);
+      BENCH_REDUCE_TYPE(float, n, reps);
+      BENCH_REDUCE_TYPE(double, n, reps);
+    }
+  }
+  simd_set_level(best);
+}
+
+#undef BENCH_REDUCE_TYPE
+
+// ===========================================================
+// FlatSet vs tsearch (red-black tree) vs chained hash table
+// ===========================================================
+#define FLAT_MAX_ELEMENTS 10000000U
+
+static int compare_uintptr(const void* a, const void* b) {
+  uintptr_t x = (uintptr_t)a;
+  uintptr_t y = (uintptr_t)b;
+  return (x > y) - (x < y);
+}
+
+static void noop_free(void* node) {
+  (void)node;
+}
+
+static void bench_flat(size_t max_n) {
+  if (max_n > FLAT_MAX_ELEMENTS) {
+    max_n = FLAT_MAX_ELEMENTS;
+  }
+  printf("ns per key, n random keys inserted then looked up at random\n");
+  printf("%12s %12s %12s %12s\n", "keys", "container", "insert", "lookup");
+
+  for (size_t n = MIN_ELEMENTS; n <= max_n; n *= BASE_10) {
+    uint64_t state = n;
+    ptr_t* keys = malloc(n * sizeof(ptr_t));
+    ptr_t* probes = malloc(n * sizeof(ptr_t));
+    for (size_t i = 0; i < n; i++) {
+      keys[i] = as_ptr(next_random(&state) | 1);
+    }
+    for (size_t i = 0; i < n; i++) {
+      probes[i] = keys[next_random(&state) % n];
+    }
+    size_t reps = reps_for(n * 20);
+
+    double insert_time = 0;
+    double lookup_time = 0;
+    for (size_t r = 0; r < reps; r++) {
+      FlatSet set = flat_set_new(0, NULL, NULL);
+      double start = now_sec();
+      flat_set_insert_many(&set, keys, n);
+      insert_time += now_sec() - start;
+      start = now_sec();
+      size_t hits = 0;
+      for (size_t i = 0; i < n; i++) {
+        hits += flat_set_contains(&set, probes[i]);
+      }
+      lookup_time += now_sec() - start;
+      sink = hits;
+      flat_set_destroy(&set);
+    }
+    printf("%12zu %12s %12.1f %12.1f\n", n, "flat_set",
+           insert_time * 1e9 / (double)(n * reps),
+           lookup_time * 1e9 / (double)(n * reps));
+
+    insert_time = 0;
+    lookup_time = 0;
+    for (size_t r = 0; r < reps; r++) {
+      void* root = NULL;
+      double start = now_sec();
+      for (size_t i = 0; i < n; i++) {
+        tsearch(keys[i], &root, compare_uintptr);
+      }
+      insert_time += now_sec() - start;
+      start = now_sec();
+      size_t hits = 0;
+      for (size_t i = 0; i < n; i++) {
+        hits += tfind(probes[i], &root, compare_uintptr) != NULL;
+      }
+      lookup_time += now_sec() - start;
+      sink = hits;
+      tdestroy(root, noop_free);
+    }
+    printf("%12zu %12s %12.1f %12.1f\n", n, "rb_tree",
+           insert_time * 1e9 / (double)(n * reps),
+           lookup_time * 1e9 / (double)(n * reps));
+
+    insert_time = 0;
+    lookup_time = 0;
+    for (size_t r = 0; r < reps; r++) {
+      chain_table table;
+      chain_init(&table);
+      double start = now_sec();
+      for (size_t i = 0; i < n; i++) {
+        chain_put(&table, (uintptr_t)keys[i], 0);
+      }
+      insert_time += now_sec() - start;
+      start = now_sec();
+      size_t hits = 0;
+      for (size_t i = 0; i < n; i++) {
+        hits += chain_find(&table, (uintptr_t)probes[i]) != NULL;
+      }
+      lookup_time += now_sec() - start;
+      sink = hits;
+      chain_destroy(&table);
+    }
+    printf("%12zu %12s %12.1f %12.1f\n", n, "chain_hash",
+           insert_time * 1e9 / (double)(n * reps),
+           lookup_time * 1e9 / (double)(n * reps));
+
+    free(keys);
+    free(probes);
+  }
+}
+
+// ===========================================================
+// hashmap(K, V) vs chained hash table
+// ===========================================================
+#define HASH_MAX_ELEMENTS 10000000U
+#define HASH_COLUMNS 4
+
+static void print_hash_row(size_t n,
+                           const char* name,
+                           const double* times,
+                           size_t reps) {
+  printf("%12zu %12s", n, name);
+  for (int col = 0; col < HASH_COLUMNS; col++) {
+    printf(" %10.1f", times[col] * 1e9 / (double)(n * reps));
+  }
+  printf("\n");
+}
+
+static void bench_hashmap(size_t max_n) {
+  if (max_n > HASH_MAX_ELEMENTS) {
+    max_n = HASH_MAX_ELEMENTS;
+  }
+  simd_level best = simd_detect();
+  printf("ns per key, n random uint64 keys\n");
+  printf("%12s %12s %10s %10s %10s %10s\n", "keys", "container", "insert",
+         "hit", "miss", "remove");
+
+  for (size_t n = MIN_ELEMENTS; n <= max_n; n *= BASE_10) {
+    uint64_t state = n;
+    uint64_t* keys = malloc(n * sizeof(uint64_t));
+    uint64_t* misses = malloc(n * sizeof(uint64_t));
+    for (size_t i = 0; i < n; i++) {
+      // odd keys are stored and even keys are looked up as misses
+      keys[i] = next_random(&state) | 1;
+      misses[i] = next_random(&state) & ~(uint64_t)1;
+    }
+    size_t reps = reps_for(n * 20);
+
+    for (int level = SIMD_SCALAR; level <= SIMD_SSE2 && level <= best;
+         level++) {
+      simd_set_level((simd_level)level);
+      double times[HASH_COLUMNS] = {0};
+      for (size_t r = 0; r < reps; r++) {
+        hashmap(uint64_t, uint64_t) map = NULL;
+        double start = now_sec();
+        for (size_t i = 0; i < n; i++) {
+          hashmap_put(&map, keys[i], i);
+        }
+        times[0] += now_sec() - start;
+        size_t hits = 0;
+        start = now_sec();
+        for (size_t i = 0; i < n; i++) {
+          hits += hashmap_find(&map, keys[(i * 7919) % n]) != HASHMAP_NPOS;
+        }
+        times[1] += now_sec() - start;
+        start = now_sec();
+        for (size_t i = 0; i < n; i++) {
+          hits += hashmap_contains(&map, misses[i]);
+        }
+        times[2] += now_sec() - start;
+        start = now_sec();
+        for (size_t i = 0; i < n; i++) {
+          hits += hashmap_remove(&map, keys[i]);
+        }
+        times[3] += now_sec() - start;
+        sink = hits;
+        hashmap_free(&map);
+      }
+      char name[32];
+      snprintf(name, sizeof(name), "hashmap/%s",
+               simd_level_name((simd_level)level));
+      print_hash_row(n, name, times, reps);
+    }
+    simd_set_level(best);
+
+    double times[HASH_COLUMNS] = {0};
+    for (size_t r = 0; r < reps; r++) {
+      chain_table table;
+      chain_init(&table);
+      double start = now_sec();
+      for (size_t i = 0; i < n; i++) {
+        chain_put(&table, keys[i], i);
+      }
+      times[0] += now_sec() - start;
+      size_t hits = 0;
+      start = now_sec();
+      for (size_t i = 0; i < n; i++) {
+        hits += chain_find(&table, keys[(i * 7919) % n]) != NULL;
+      }
+      times[1] += now_sec() - start;
+      start = now_sec();
+      for (size_t i = 0; i < n; i++) {
+        hits += chain_find(&table, misses[i]) != NULL;
+      }
+      times[2] += now_sec() - start;
+      start = now_sec();
+      for (size_t i = 0; i < n; i++) {
+        hits += chain_erase(&table, keys[i]);
+      }
+      times[3] += now_sec() - start;
+      sink = hits;
+      chain_destroy(&table);
+    }
+    print_hash_row(n, "chain_hash", times, reps);
+
+    free(keys);
+    free(misses);
+  }
+}
+
+// ===========================================================
+// StrVec vs a Vec of malloc'd strings
+// ===========================================================
+#define STRING_MAX_ELEMENTS 10000000U
+#define STRING_BUF_LEN 32
+
+static void bench_strings(size_t max_n) {
+  if (max_n > STRING_MAX_ELEMENTS) {
+    max_n = STRING_MAX_ELEMENTS;
+  }
+  printf("n short strings, ns per string, bytes per string\n");
+  printf("%12s %10s %10s %10s %10s %10s\n", "strings", "container", "append",
+         "scan", "clear", "bytes");
+
+  char buf[STRING_BUF_LEN];
+  for (size_t n = MIN_ELEMENTS; n <= max_n; n *= BASE_10) {
+    size_t reps = reps_for(n * 50);
+    double times[3] = {0};
+    size_t bytes = 0;
+    for (size_t r = 0; r < reps; r++) {
+      Vec vec = vec_new(0, free);
+      double start = now_sec();
+      for (size_t i = 0; i < n; i++) {
+        snprintf(buf, sizeof(buf), "key-%zu", i);
+        vec_push_back(&vec, strdup(buf));
+      }
+      times[0] += now_sec() - start;
+      size_t total = 0;
+      start = now_sec();
+      for (size_t i = 0; i < n; i++) {
+        total += strlen((const char*)vec_get(&vec, i));
+      }
+      times[1] += now_sec() - start;
+      sink = total;
+      bytes = vec.capacity * sizeof(ptr_t);
+      for (size_t i = 0; i < n; i++) {
+        bytes += malloc_usable_size(vec_get(&vec, i)) + sizeof(size_t);
+      }
+      start = now_sec();
+      vec_clear(&vec);
+      times[2] += now_sec() - start;
+      vec_destroy(&vec);
+    }
+    printf("%12zu %10s %10.1f %10.2f %10.2f %10.1f\n", n, "Vec",
+           times[0] * 1e9 / (double)(n * reps),
+           times[1] * 1e9 / (double)(n * reps),
+           times[2] * 1e9 / (double)(n * reps), (double)bytes / (double)n);
+
+    for (int intern = 0; intern <= 1; intern++) {
+      memset(times, 0, sizeof(times));
+      for (size_t r = 0; r < reps; r++) {
+        StrVec strs = str_vec_new(0, 0, intern);
+        double start = now_sec();
+        for (size_t i = 0; i < n; i++) {
+          int len = snprintf(buf, sizeof(buf), "key-%zu", i);
+          str_vec_append(&strs, buf, (size_t)len);
+        }
+        times[0] += now_sec() - start;
+        size_t total = 0;
+        start = now_sec();
+        for (size_t i = 0; i < n; i++) {
+          total += str_vec_get(&strs, i).len;
+        }
+        times[1] += now_sec() - start;
+        sink = total;
+        bytes = strs.bytes_capacity + (strs.capacity + 1) * sizeof(size_t) +
+                (strs.index ? (strs.index_mask + 1) * sizeof(uint64_t) : 0);
+        start = now_sec();
+        str_vec_clear(&strs);
+        times[2] += now_sec() - start;
+        str_vec_destroy(&strs);
+      }
+      printf("%12zu %10s %10.1f %10.2f %10.2f %10.1f\n", n,
+             intern ? "interned" : "StrVec",
+             times[0] * 1e9 / (double)(n * reps),
+             times[1] * 1e9 / (double)(n * reps),
+             times[2] * 1e9 / (double)(n * reps), (double)bytes / (double)n);
+    }
+  }
+}
+
+// ===========================================================
+// Slab allocation
+// ===========================================================
+#define SLAB_MAX_ELEMENTS 10000000U
+
+// the size of a small struct element, like a 3D point of doubles
+#define SLAB_OBJECT_SIZE 24
+
+static void print_slab_row(size_t n,
+                           const char* allocator,
+                           const double times[3],
+                           size_t reps) {
+  printf("%12zu %10s %10.2f %10.2f %10.2f\n", n, allocator,
+         times[0] * 1e9 / (double)(n * reps),
+         times[1] * 1e9 / (double)(n * reps),
+         times[2] * 1e9 / (double)(n * reps));
+}
+
+static void bench_slab(size_t max_n) {
+  if (max_n > SLAB_MAX_ELEMENTS) {
+    max_n = SLAB_MAX_ELEMENTS;
+  }
+  printf("n %d byte objects, ns per object\n", SLAB_OBJECT_SIZE);
+  printf("%12s %10s %10s %10s %10s\n", "objects", "allocator", "alloc",
+         "free", "vec clear");
+
+  for (size_t n = MIN_ELEMENTS; n <= max_n; n *= BASE_10) {
+    size_t reps = reps_for(n * 20);
+    Vec objs = vec_new(n, NULL);
+    double times[3] = {0};
+
+    // malloc and free, freeing each object on its own and
+    // through the element destructor of a Vec
+    for (size_t r = 0; r < reps; r++) {
+      double start = now_sec();
+      for (size_t i = 0; i < n; i++) {
+        vec_push_back(&objs, malloc(SLAB_OBJECT_SIZE));
+      }
+      times[0] += now_sec() - start;
+      start = now_sec();
+      for (size_t i = 0; i < n; i++) {
+        free(objs.data[i]);
+      }
+      times[1] += now_sec() - start;
+      vec_clear(&objs);
+
+      Vec vec = vec_new(n, free);
+      for (size_t i = 0; i < n; i++) {
+        vec_push_back(&vec, malloc(SLAB_OBJECT_SIZE));
+      }
+      start = now_sec();
+      vec_clear(&vec);
+      times[2] += now_sec() - start;
+      vec_destroy(&vec);
+    }
+    print_slab_row(n, "malloc", times, reps);
+
+    // the same with a slab, where the Vec is released with one reset
+    memset(times, 0, sizeof(times));
+    Slab slab = slab_new(SLAB_OBJECT_SIZE);
+    for (size_t r = 0; r < reps; r++) {
+      double start = now_sec();
+      for (size_t i = 0; i < n; i++) {
+        vec_push_back(&objs, slab_alloc(&slab));
+      }
+      times[0] += now_sec() - start;
+      start = now_sec();
+      for (size_t i = 0; i < n; i++) {
+        slab_free(&slab, objs.data[i]);
+      }
+      times[1] += now_sec() - start;
+      vec_clear(&objs);
+
+      Vec vec = vec_new_slab(n, &slab);
+      for (size_t i = 0; i < n; i++) {
+        vec_push_back(&vec, slab_alloc(&slab));
+      }
+      start = now_sec();
+      vec_clear(&vec);
+      times[2] += now_sec() - start;
+      vec_destroy(&vec);
+    }
+    slab_destroy(&slab);
+    print_slab_row(n, "slab", times, reps);
+    vec_destroy(&objs);
+  }
+}
+
+// ===========================================================
+// Snapshots
+// ===========================================================
+#define SNAPSHOT_MAX_ELEMENTS 100000U
+#define SNAPSHOT_MAX_READERS 8
+#define SNAPSHOT_SECONDS 0.25
+#define SNAPSHOT_LOOKUPS 8
+
+// the writer updates the table this often
+#define SNAPSHOT_WRITE_PERIOD_NS 20000
+
+typedef struct snapshot_bench_st {
+  bool cow;
+  size_t n;
+  atomic_bool stop;
+
+  // copy on write: the writer hands each reader its newest snapshot
+  _Atomic(VecSnapshot*) slots[SNAPSHOT_MAX_READERS];
+
+  // mutex plus copy: readers copy the table out under the lock
+  pthread_mutex_t lock;
+  Vec table;
+} snapshot_bench;
+
+typedef struct snapshot_reader_st {
+  snapshot_bench* bench;
+  size_t id;
+  size_t iterations;
+} snapshot_reader;
+
+static void* snapshot_reader_main(void* arg) {
+  snapshot_reader* reader = (snapshot_reader*)arg;
+  snapshot_bench* bench = reader->bench;
+  ptr_t* copy = (ptr_t*)malloc(bench->n * sizeof(ptr_t));
+  VecSnapshot mine = {NULL, 0, NULL};
+  uint64_t rng = reader->id + 1;
+  size_t total = 0;
+  size_t iterations = 0;
+
+  // each iteration refreshes the reader's view and looks a few entries up
+  while (!atomic_load_explicit(&bench->stop, memory_order_relaxed)) {
+    const ptr_t* view = NULL;
+    if (bench->cow) {
+      VecSnapshot* fresh = atomic_exchange(&bench->slots[reader->id], NULL);
+      if (fresh != NULL) {
+        vec_snapshot_release(&mine);
+        mine = *fresh;
+        free(fresh);
+      }
+      view = mine.data;
+    } else {
+      pthread_mutex_lock(&bench->lock);
+      memcpy(copy, bench->table.data, bench->n * sizeof(ptr_t));
+      pthread_mutex_unlock(&bench->lock);
+      view = copy;
+    }
+    if (view != NULL) {
+      for (size_t i = 0; i < SNAPSHOT_LOOKUPS; i++) {
+        total += (uintptr_t)view[next_random(&rng) % bench->n];
+      }
+    }
+    iterations++;
+  }
+  vec_snapshot_release(&mine);
+  free(copy);
+  sink = total;
+  reader->iterations = iterations;
+  return NULL;
+}
+
+// hands every reader a reference to snap, dropping the ones not picked up
+static void snapshot_publish(snapshot_bench* bench,
+                             size_t readers,
+                             const VecSnapshot* snap) {
+  for (size_t r = 0; r < readers; r++) {
+    VecSnapshot* mine = (VecSnapshot*)malloc(sizeof(VecSnapshot));
+    *mine = vec_snapshot_retain(snap);
+    VecSnapshot* old = atomic_exchange(&bench->slots[r], mine);
+    if (old != NULL) {
+      vec_snapshot_release(old);
+      free(old);
+    }
+  }
+}
+
+static void run_snapshot_bench(size_t n, size_t readers, bool cow) {
+  snapshot_bench bench = {.cow = cow, .n = n};
+  atomic_init(&bench.stop, false);
+  for (size_t r = 0; r < SNAPSHOT_MAX_READERS; r++) {
+    atomic_init(&bench.slots[r], NULL);
+  }
+  pthread_mutex_init(&bench.lock, NULL);
+  bench.table = vec_new(n, NULL);
+  for (size_t i = 0; i < n; i++) {
+    vec_push_back(&bench.table, as_ptr(i));
+  }
+  if (cow) {
+    VecSnapshot snap = vec_snapshot(&bench.table);
+    snapshot_publish(&bench, readers, &snap);
+    vec_snapshot_release(&snap);
+  }
+
+  pthread_t threads[SNAPSHOT_MAX_READERS];
+  snapshot_reader args[SNAPSHOT_MAX_READERS];
+  for (size_t r = 0; r < readers; r++) {
+    args[r] = (snapshot_reader){&bench, r, 0};
+    pthread_create(&threads[r], NULL, snapshot_reader_main, &args[r]);
+  }
+
+  // the writer changes one entry per period and publishes the new table
+  uint64_t rng = 0;
+  size_t writes = 0;
+  double write_time = 0;
+  double start = now_sec();
+  double elapsed = 0;
+  struct timespec period = {0, SNAPSHOT_WRITE_PERIOD_NS};
+  while (elapsed < SNAPSHOT_SECONDS) {
+    double write_start = now_sec();
+    size_t index = next_random(&rng) % n;
+    if (cow) {
+      vec_set(&bench.table, index, as_ptr(writes));
+      VecSnapshot snap = vec_snapshot(&bench.table);
+      snapshot_publish(&bench, readers, &snap);
+      vec_snapshot_release(&snap);
+    } else {
+      pthread_mutex_lock(&bench.lock);
+      vec_set(&bench.table, index, as_ptr(writes));
+      pthread_mutex_unlock(&bench.lock);
+    }
+    writes++;
+    double now = now_sec();
+    write_time += now - write_start;
+    elapsed = now - start;
+    nanosleep(&period, NULL);
+  }
+  atomic_store(&bench.stop, true);
+
+  size_t iterations = 0;
+  for (size_t r = 0; r < readers; r++) {
+    pthread_join(threads[r], NULL);
+    iterations += args[r].iterations;
+  }
+  elapsed = now_sec() - start;
+  for (size_t r = 0; r < readers; r++) {
+    VecSnapshot* old = atomic_exchange(&bench.slots[r], NULL);
+    if (old != NULL) {
+      vec_snapshot_release(old);
+      free(old);
+    }
+  }
+  vec_destroy(&bench.table);
+  pthread_mutex_destroy(&bench.lock);
+
+  printf("%12zu %8zu %10s %12.2f %12.0f %12.2f\n", n, readers,
+         cow ? "snapshot" : "mutex", (double)iterations / elapsed / 1e6,
+         (double)writes / elapsed, write_time * 1e6 / (double)writes);
+}
+
+static void bench_snapshot(size_t max_n) {
+  if (max_n > SNAPSHOT_MAX_ELEMENTS) {
+    max_n = SNAPSHOT_MAX_ELEMENTS;
+  }
+  printf("1 writer updating an n entry table every %d us, N readers each\n"
+         "refreshing their view then doing %d lookups per iteration\n",
+         SNAPSHOT_WRITE_PERIOD_NS / 1000, SNAPSHOT_LOOKUPS);
+  printf("%12s %8s %10s %12s %12s %12s\n", "table", "readers", "mode",
+         "M iters/s", "writes/s", "us/write");
+  for (size_t n = MIN_ELEMENTS; n <= max_n; n *= BASE_10) {
+    for (size_t readers = 1; readers <= SNAPSHOT_MAX_READERS; readers *= 2) {
+      run_snapshot_bench(n, readers, false);
+      run_snapshot_bench(n, readers, true);
+    }
+  }
+}
+
+// ===========================================================
+// Epoch protected reads
+// ===========================================================
+typedef struct epoch_writer_st {
+  SharedVec* vec;
+  atomic_bool stop;
+  size_t pushes;
+} epoch_writer;
+
+// keeps growing the vector from scratch so that buffers get retired
+static void* epoch_writer_main(void* arg) {
+  epoch_writer* writer = (epoch_writer*)arg;
+  size_t pushes = 0;
+  while (!atomic_load_explicit(&writer->stop, memory_order_relaxed)) {
+    shared_vec_push_back(writer->vec, as_ptr(pushes));
+    pushes++;
+  }
+  writer->pushes = pushes;
+  return NULL;
+}
+
+static void bench_epoch(size_t max_n) {
+  printf("ns per element scanned, ns per enter/exit pair\n");
+  printf("%12s %10s %10s %12s %12s\n", "elements", "Vec", "SharedVec",
+         "+ writer", "enter/exit");
+  EpochDomain* domain = epoch_domain_new();
+  EpochReader reader = epoch_register(domain);
+
+  for (size_t n = MIN_ELEMENTS; n <= max_n; n *= BASE_10) {
+    size_t reps = reps_for(n);
+    Vec vec = vec_new(n, NULL);
+    SharedVec* shared = shared_vec_new(domain, n, NULL);
+    for (size_t i = 0; i < n; i++) {
+      vec_push_back(&vec, as_ptr(i));
+      shared_vec_push_back(shared, as_ptr(i));
+    }
+
+    size_t total = 0;
+    double start = now_sec();
+    for (size_t r = 0; r < reps; r++) {
+      for (size_t i = 0; i < vec_len(&vec); i++) {
+        total += (uintptr_t)vec.data[i];
+      }
+    }
+    double vec_time = now_sec() - start;
+
+    // one read section per scan
+    double times[2] = {0};
+    for (int with_writer = 0; with_writer <= 1; with_writer++) {
+      SharedVec* scanned = shared;
+      epoch_writer writer = {shared_vec_new(domain, 1, NULL), false, 0};
+      pthread_t thread;
+      if (with_writer) {
+        // the writer grows a vector readers are scanning
+        scanned = writer.vec;
+        for (size_t i = 0; i < n; i++) {
+          shared_vec_push_back(scanned, as_ptr(i));
+        }
+        pthread_create(&thread, NULL, epoch_writer_main, &writer);
+      }
+      size_t scanned_elements = 0;
+      start = now_sec();
+      for (size_t r = 0; r < reps; r++) {
+        epoch_enter(&reader);
+        SharedVecView view = shared_vec_view(scanned);
+        for (size_t i = 0; i < n; i++) {
+          total += (uintptr_t)shared_vec_view_get(&view, i);
+        }
+        scanned_elements += n;
+        epoch_exit(&reader);
+      }
+      times[with_writer] = (now_sec() - start) / (double)scanned_elements;
+      if (with_writer) {
+        atomic_store(&writer.stop, true);
+        pthread_join(thread, NULL);
+      }
+      shared_vec_free(writer.vec);
+    }
+
+    size_t pairs = MIN_WORK / BASE_10;
+    start = now_sec();
+    for (size_t i = 0; i < pairs; i++) {
+      epoch_enter(&reader);
+      epoch_exit(&reader);
+    }
+    double pair_time = now_sec() - start;
+    sink = total;
+
+    printf("%12zu %10.3f %10.3f %12.3f %12.2f\n", n,
+           vec_time * 1e9 / (double)(n * reps), times[0] * 1e9,
+           times[1] * 1e9, pair_time * 1e9 / (double)pairs);
+    vec_destroy(&vec);
+    shared_vec_free(shared);
+  }
+  epoch_synchronize(domain);
+  epoch_unregister(&reader);
+  epoch_domain_free(domain);
+}
+
+// ===========================================================
+// Persistent vectors
+// ===========================================================
+#define PVEC_MAX_ELEMENTS 10000000U
+#define PVEC_VERSIONS 1000U
+
+static size_t heap_in_use(void) {
+  return mallinfo2().uordblks;
+}
+
+static void bench_pvec(size_t max_n) {
+  if (max_n > PVEC_MAX_ELEMENTS) {
+    max_n = PVEC_MAX_ELEMENTS;
+  }
+  printf("ns per operation, bytes per version after one set\n");
+  printf("%12s %10s %10s %10s %10s %10s %12s %12s\n", "elements",
+         "Vec get", "get", "push", "set", "concat", "B/version",
+         "B/Vec copy");
+
+  for (size_t n = MIN_ELEMENTS; n <= max_n; n *= BASE_10) {
+    Vec vec = vec_new(n, NULL);
+    for (size_t i = 0; i < n; i++) {
+      vec_push_back(&vec, as_ptr(i));
+    }
+    uint64_t state = n;
+    size_t lookups = MIN_WORK / BASE_10;
+    size_t total = 0;
+
+    double start = now_sec();
+    for (size_t i = 0; i < lookups; i++) {
+      total += (uintptr_t)vec_get(&vec, next_random(&state) % n);
+    }
+    double vec_get_time = now_sec() - start;
+
+    // each push makes a new version from the previous one
+    start = now_sec();
+    PVec pvec = pvec_new();
+    for (size_t i = 0; i < n; i++) {
+      PVec next = pvec_push(&pvec, as_ptr(i));
+      pvec_release(&pvec);
+      pvec = next;
+    }
+    double push_time = now_sec() - start;
+
+    start = now_sec();
+    for (size_t i = 0; i < lookups; i++) {
+      total += (uintptr_t)pvec_get(&pvec, next_random(&state) % n);
+    }
+    double get_time = now_sec() - start;
+
+    // keep every version alive to measure what each one costs
+    PVec* versions = (PVec*)malloc(PVEC_VERSIONS * sizeof(PVec));
+    size_t heap_before = heap_in_use();
+    start = now_sec();
+    versions[0] = pvec_set(&pvec, 0, as_ptr(0));
+    for (size_t v = 1; v < PVEC_VERSIONS; v++) {
+      versions[v] =
+          pvec_set(&versions[v - 1], next_random(&state) % n, as_ptr(v));
+    }
+    double set_time = now_sec() - start;
+    size_t version_bytes = (heap_in_use() - heap_before) / PVEC_VERSIONS;
+    for (size_t v = 0; v < PVEC_VERSIONS; v++) {
+      pvec_release(&versions[v]);
+    }
+    free(versions);
+
+    // joining two halves, the second one aligned to a leaf
+    size_t half = n / 2 & ~(size_t)(PVEC_WIDTH - 1);
+    PVec left = pvec_slice(&pvec, 0, half);
+    PVec right = pvec_slice(&pvec, half, n);
+    size_t concats = reps_for(n) / 2 + 1;
+    start = now_sec();
+    for (size_t r = 0; r < concats; r++) {
+      PVec joined = pvec_concat(&left, &right);
+      total += pvec_len(&joined);
+      pvec_release(&joined);
+    }
+    double concat_time = now_sec() - start;
+    pvec_release(&left);
+    pvec_release(&right);
+    sink = total;
+
+    printf("%12zu %10.2f %10.2f %10.2f %10.2f %10.0f %12zu %12zu\n", n,
+           vec_get_time * 1e9 / (double)lookups,
+           get_time * 1e9 / (double)lookups, push_time * 1e9 / (double)n,
+           set_time * 1e9 / PVEC_VERSIONS,
+           concat_time * 1e9 / (double)concats, version_bytes,
+           n * sizeof(ptr_t));
+    pvec_release(&pvec);
+    vec_destroy(&vec);
+  }
+}
+
+// ===========================================================
+// B+tree sequences
+// ===========================================================
+#define SEQ_MAX_ELEMENTS 50000000U
+#define SEQ_INSERTS 100000U
+
+static void bench_seq(size_t max_n) {
+  if (max_n > SEQ_MAX_ELEMENTS) {
+    max_n = SEQ_MAX_ELEMENTS;
+  }
+  printf("ns per random insert + erase pair, random get, element scanned\n");
+  printf("%12s %12s %12s %10s %10s %10s %10s\n", "elements", "Vec edit",
+         "Seq edit", "Vec get", "Seq get", "Vec scan", "Seq scan");
+
+  for (size_t n = MIN_ELEMENTS; n <= max_n; n *= BASE_10) {
+    Vec vec = vec_new(n + 1, NULL);
+    Seq seq = seq_new(NULL);
+    for (size_t i = 0; i < n; i++) {
+      vec_push_back(&vec, as_ptr(i));
+      seq_push_back(&seq, as_ptr(i));
+    }
+    uint64_t state = n;
+    size_t total = 0;
+
+    // every insert is undone by an erase so the length stays at n.
+    // Vec moves half the array for each, so it gets fewer rounds
+    size_t vec_edits = MIN_WORK / BASE_10 / n + 1;
+    double start = now_sec();
+    for (size_t i = 0; i < vec_edits; i++) {
+      size_t index = next_random(&state) % n;
+      vec_insert(&vec, index, as_ptr(i));
+      vec_erase(&vec, next_random(&state) % n);
+    }
+    double vec_edit = (now_sec() - start) / (double)vec_edits;
+
+    start = now_sec();
+    for (size_t i = 0; i < SEQ_INSERTS; i++) {
+      seq_insert(&seq, next_random(&state) % n, as_ptr(i));
+      seq_erase(&seq, next_random(&state) % n);
+    }
+    double seq_edit = (now_sec() - start) / SEQ_INSERTS;
+
+    size_t lookups = MIN_WORK / BASE_10;
+    double get_times[2];
+    start = now_sec();
+    for (size_t i = 0; i < lookups; i++) {
+      total += (uintptr_t)vec_get(&vec, next_random(&state) % n);
+    }
+    get_times[0] = (now_sec() - start) / (double)lookups;
+    start = now_sec();
+    for (size_t i = 0; i < lookups; i++) {
+      total += (uintptr_t)seq_get(&seq, next_random(&state) % n);
+    }
+    get_times[1] = (now_sec() - start) / (double)lookups;
+
+    size_t reps = reps_for(n);
+    double scan_times[2];
+    start = now_sec();
+    for (size_t r = 0; r < reps; r++) {
+      for (size_t i = 0; i < vec_len(&vec); i++) {
+        total += (uintptr_t)vec.data[i];
+      }
+    }
+    scan_times[0] = (now_sec() - start) / (double)(n * reps);
+    start = now_sec();
+    for (size_t r = 0; r < reps; r++) {
+      SeqIter it = seq_iter(&seq, 0);
+      ptr_t ele;
+      while (seq_iter_next(&it, &ele)) {
+        total += (uintptr_t)ele;
+      }
+    }
+    scan_times[1] = (now_sec() - start) / (double)(n * reps);
+    sink = total;
+
+    printf("%12zu %12.1f %12.1f %10.2f %10.2f %10.3f %10.3f\n", n,
+           vec_edit * 1e9, seq_edit * 1e9, get_times[0] * 1e9,
+           get_times[1] * 1e9, scan_times[0] * 1e9, scan_times[1] * 1e9);
+    vec_destroy(&vec);
+    seq_destroy(&seq);
+  }
+}
+
+// ===========================================================
+// Gap buffers
+// ===========================================================
+#define GAP_INSERTS 1000000U
+// the cursor moves up to this many elements between inserts
+#define GAP_WALK 8
+
+// one step of a random walk over [0, length]
+static size_t walk_cursor(size_t cursor, size_t length, uint64_t* state) {
+  uint64_t step = next_random(state) % (2 * GAP_WALK + 1);
+  if (step < GAP_WALK && cursor < GAP_WALK - step) {
+    return 0;
+  }
+  cursor = cursor + step - GAP_WALK;
+  return cursor > length ? length : cursor;
+}
+
+static void bench_gap(size_t max_n) {
+  printf("ns per insert at a random walk cursor, ns per random get\n");
+  printf("%12s %12s %12s %10s %10s\n", "elements", "Vec insert",
+         "GapVec ins", "Vec get", "GapVec get");
+
+  for (size_t n = MIN_ELEMENTS; n <= max_n; n *= BASE_10) {
+    Vec vec = vec_new(n, NULL);
+    GapVec gap = gap_vec_new(n, NULL);
+    for (size_t i = 0; i < n; i++) {
+      vec_push_back(&vec, as_ptr(i));
+      gap_vec_push_back(&gap, as_ptr(i));
+    }
+
+    // both start typing in the middle. Vec shifts the tail on every
+    // insert, so it gets fewer of them
+    size_t vec_inserts = MIN_WORK / BASE_10 / n + 1;
+    uint64_t state = n;
+    size_t cursor = n / 2;
+    double start = now_sec();
+    for (size_t i = 0; i < vec_inserts; i++) {
+      cursor = walk_cursor(cursor, vec_len(&vec), &state);
+      vec_insert(&vec, cursor, as_ptr(i));
+    }
+    double vec_insert_time = (now_sec() - start) / (double)vec_inserts;
+
+    state = n;
+    cursor = n / 2;
+    start = now_sec();
+    for (size_t i = 0; i < GAP_INSERTS; i++) {
+      cursor = walk_cursor(cursor, gap_vec_len(&gap), &state);
+      gap_vec_insert(&gap, cursor, as_ptr(i));
+    }
+    double gap_insert_time = (now_sec() - start) / GAP_INSERTS;
+
+    size_t lookups = MIN_WORK / BASE_10;
+    size_t total = 0;
+    start = now_sec();
+    for (size_t i = 0; i < lookups; i++) {
+      total += (uintptr_t)vec_get(&vec, next_random(&state) % n);
+    }
+    double vec_get_time = (now_sec() - start) / (double)lookups;
+    start = now_sec();
+    for (size_t i = 0; i < lookups; i++) {
+      total += (uintptr_t)gap_vec_get(&gap, next_random(&state) % n);
+    }
+    double gap_get_time = (now_sec() - start) / (double)lookups;
+    sink = total;
+
+    printf("%12zu %12.1f %12.1f %10.2f %10.2f\n", n, vec_insert_time * 1e9,
+           gap_insert_time * 1e9, vec_get_time * 1e9, gap_get_time * 1e9);
+    vec_destroy(&vec);
+    gap_vec_destroy(&gap);
+  }
+}
+
+// ===========================================================
+// Batched insert and erase
+// ===========================================================
+#define MANY_MAX_ELEMENTS 1000000U
+// one element in this many is inserted, then erased
+#define MANY_STRIDE 100
+
+static int compare_size(const void* a, const void* b) {
+  size_t x = *(const size_t*)a;
+  size_t y = *(const size_t*)b;
+  return (x > y) - (x < y);
+}
+
+static void bench_many(size_t max_n) {
+  if (max_n > MANY_MAX_ELEMENTS) {
+    max_n = MANY_MAX_ELEMENTS;
+  }
+  printf("ms to insert then erase n / %d elements at sorted positions\n",
+         MANY_STRIDE);
+  printf("%12s %12s %12s %12s %12s\n", "elements", "vec_insert",
+         "insert_many", "vec_erase", "erase_idx");
+
+  for (size_t n = MIN_ELEMENTS; n <= max_n; n *= BASE_10) {
+    size_t k = n / MANY_STRIDE;
+    size_t* positions = (size_t*)malloc(k * sizeof(size_t));
+    ptr_t* elems = (ptr_t*)malloc(k * sizeof(ptr_t));
+    uint64_t state = n;
+    for (size_t j = 0; j < k; j++) {
+      positions[j] = next_random(&state) % (n + 1);
+      elems[j] = as_ptr(j);
+    }
+    qsort(positions, k, sizeof(size_t), compare_size);
+    // after inserting, element j sits at positions[j] + j
+    size_t* inserted = (size_t*)malloc(k * sizeof(size_t));
+    for (size_t j = 0; j < k; j++) {
+      inserted[j] = positions[j] + j;
+    }
+
+    double times[4];
+    for (int batched = 0; batched <= 1; batched++) {
+      Vec vec = vec_new(n, NULL);
+      for (size_t i = 0; i < n; i++) {
+        vec_push_back(&vec, as_ptr(i));
+      }
+      double start = now_sec();
+      if (batched) {
+        vec_insert_many(&vec, positions, elems, k);
+      } else {
+        for (size_t j = k; j > 0; j--) {
+          vec_insert(&vec, positions[j - 1], elems[j - 1]);
+        }
+      }
+      times[batched] = now_sec() - start;
+      start = now_sec();
+      if (batched) {
+        vec_erase_indices(&vec, inserted, k);
+      } else {
+        for (size_t j = k; j > 0; j--) {
+          vec_erase(&vec, inserted[j - 1]);
+        }
+      }
+      times[2 + batched] = now_sec() - start;
+      vec_destroy(&vec);
+    }
+
+    printf("%12zu %12.3f %12.3f %12.3f %12.3f\n", n, times[0] * 1e3,
+           times[1] * 1e3, times[2] * 1e3, times[3] * 1e3);
+    free(positions);
+    free(elems);
+    free(inserted);
+  }
+}
+
+// ===========================================================
+// External sort
+// ===========================================================
+#define EXTSORT_MAX_ELEMENTS 10000000U
+
+static void sink_keys(const ptr_t* keys, size_t n, void* arg) {
+  (void)arg;
+  sink += (size_t)keys[n - 1];
+}
+
+static void bench_extsort(size_t max_n) {
+  static const size_t kBudgets[] = {64 << 10, 1 << 20, 16 << 20};
+  if (max_n > EXTSORT_MAX_ELEMENTS) {
+    max_n = EXTSORT_MAX_ELEMENTS;
+  }
+  printf("MB/s of random 8 byte keys sorted, by memory budget\n");
+  printf("%12s %12s %12s %12s %12s\n", "elements", "runs@64K", "64K", "1M",
+         "16M");
+
+  for (size_t n = MIN_ELEMENTS; n <= max_n; n *= BASE_10) {
+    ptr_t* keys = (ptr_t*)malloc(n * sizeof(ptr_t));
+    uint64_t state = n;
+    for (size_t i = 0; i < n; i++) {
+      keys[i] = as_ptr(next_random(&state));
+    }
+
+    size_t runs = 0;
+    double mb_per_sec[3];
+    for (size_t b = 0; b < 3; b++) {
+      ExtSort* sort = ext_sort_new(kBudgets[b], NULL, NULL);
+      double start = now_sec();
+      ext_sort_push(sort, keys, n);
+      if (b == 0) {
+        runs = ext_sort_runs(sort);
+      }
+      ext_sort_finish(sort, sink_keys, NULL);
+      double elapsed = now_sec() - start;
+      mb_per_sec[b] = (double)(n * sizeof(ptr_t)) / elapsed / 1e6;
+      ext_sort_free(sort);
+    }
+
+    printf("%12zu %12zu %12.1f %12.1f %12.1f\n", n, runs, mb_per_sec[0],
+           mb_per_sec[1], mb_per_sec[2]);
+    free(keys);
+  }
+}
+
+// ===========================================================
+// Main
+// ===========================================================
+typedef struct benchmark_st {
+  const char* name;
+  void (*run)(size_t max_n);
+} benchmark;
+
+static const benchmark kBenchmarks[] = {
+    {"search", bench_search},
+    {"reduce", bench_reduce},
+    {"flat", bench_flat},
+    {"hashmap", bench_hashmap},
+    {"strings", bench_strings},
+    {"slab", bench_slab},
+    {"snapshot", bench_snapshot},
+    {"epoch", bench_epoch},
+    {"pvec", bench_pvec},
+    {"seq", bench_seq},
+    {"gap", bench_gap},
+    {"many", bench_many},
+    {"extsort", bench_extsort},
+};
+
+#define NUM_BENCHMARKS (sizeof(kBenchmarks) / sizeof(kBenchmarks[0]))
+
+int main(int argc, char* argv[]) {
+  size_t max_n = DEFAULT_MAX_ELEMENTS;
+  if (argc == 3) {
+    char* end = NULL;
+    max_n = (size_t)strtoull(argv[2], &end, BASE_10);
+    if (*end != '\0' || max_n < MIN_ELEMENTS) {
+      fprintf(stderr, "max_elements must be an integer >= %u\n",
+              MIN_ELEMENTS);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (argc == 2 || argc == 3) {
+    for (size_t i = 0; i < NUM_BENCHMARKS; i++) {
+      if (strcmp(argv[1], kBenchmarks[i].name) == 0) {
+        kBenchmarks[i].run(max_n);
+        return EXIT_SUCCESS;
+      }
+    }
+  }
+
+  fprintf(stderr, "usage: %s <benchmark> [max_elements]\nbenchmarks:",
+          argv[0]);
+  for (size_t i = 0; i < NUM_BENCHMARKS; i++) {
+    fprintf(stderr, " %s", kBenchmarks[i].name);
+  }
+  fprintf(stderr, "\n");
+  return EXIT_FAILURE;
+}
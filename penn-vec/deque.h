@@ -0,0 +1,321 @@
+#ifndef DEQUE_H_
+#define DEQUE_H_
+
+/*!
+ * A typed double ended queue, using the same layout as vector.h.
+ *
+ * deque(T) is a T* pointing to a heap allocated ring buffer, with a
+ * deque_info_st header stored right before it. The elements are stored
+ * from `head` onward, wrapping around at the end of the buffer, so that
+ * pushing and popping at either end is O(1) and nothing is ever shifted.
+ * The capacity is always a power of two so wrapping around is a mask.
+ * A null pointer is treated as a 0 length, 0 capacity deque.
+ *
+ * deque(int) dq = deque_new(int, 4, NULL);
+ * deque_push_back(&dq, 1);
+ * deque_push_back(&dq, 2);
+ * deque_push_front(&dq, 0);
+ *
+ *             +---+
+ *          dq | | |
+ *             +-+-+
+ *               |
+ *               V    // pointer to heap
+ * +------------+---+---+---+---+
+ * | head = 3   |   |   |   |   |
+ * | len = 3    | 1 | 2 | ? | 0 |
+ * | cap = 4    |   |   |   |   |
+ * | dtor= NULL |   |   |   |   |
+ * +------------+---+---+---+---+
+ *
+ * Because of the wrap around, dq[i] is not the i-th element of the deque,
+ * use deque_get(&dq, i) instead.
+ *
+ * Elements are cleaned up with the destroy_fn given at creation, which is
+ * passed a pointer to the element, exactly like vector(T).
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>  // malloc, realloc, free
+#include <string.h>  // memcpy
+#include "./panic.h"
+#include "./vector.h"  // destroy_fn
+
+typedef struct deque_info_st {
+  size_t head;
+  size_t len;
+  size_t capacity;
+  destroy_fn ele_dtor;
+} deque_info;
+
+#define deque(T) T*
+
+// Synopsis:
+//  deque_info* get_deque_header(deque(T)* dq);
+//
+// Given a pointer to a deque, returns a pointer to that deque's metadata,
+// or NULL if the deque was never allocated.
+#define get_deque_header(dq)                                     \
+  ({                                                             \
+    typeof(dq) __impl_gdh_dq = (dq);                             \
+    if (__impl_gdh_dq == NULL) {                                 \
+      panic("NULL arg to get_deque_header\n");                   \
+    }                                                            \
+    *__impl_gdh_dq ? ((deque_info*)(*__impl_gdh_dq)) - 1 : NULL; \
+  })
+
+// Synopsis:
+//   size_t deque_round_capacity(size_t n);
+//
+// Returns the smallest power of two that is >= n, or 0 if n is 0.
+#define deque_round_capacity(n)                   \
+  ({                                              \
+    size_t __impl_drc_n = (n);                    \
+    size_t __impl_drc_cap = __impl_drc_n ? 1 : 0; \
+    while (__impl_drc_cap < __impl_drc_n) {       \
+      __impl_drc_cap *= 2;                        \
+    }                                             \
+    __impl_drc_cap;                               \
+  })
+
+// Synopsis:
+//   deque(T) deque_new(T, size_t initial_capacity,
+//                      destroy_fn element_destroy_fn);
+//
+// Description:
+// Allocates a new empty deque of T. The capacity is rounded up to a
+// power of two. panic()'s if the allocation fails.
+//
+// example:
+// deque(int) dq = deque_new(int, 10, NULL);  // capacity 16
+#define deque_new(T, init_capacity, dtor)                                    \
+  ({                                                                         \
+    size_t __impl_dn_cap = deque_round_capacity(init_capacity);              \
+    deque_info* __impl_dn_info =                                             \
+        (deque_info*)malloc(sizeof(deque_info) + __impl_dn_cap * sizeof(T)); \
+    if (__impl_dn_info == NULL) {                                            \
+      panic("malloc failed in deque_new\n");                                 \
+    }                                                                        \
+    __impl_dn_info->head = 0;                                                \
+    __impl_dn_info->len = 0;                                                 \
+    __impl_dn_info->capacity = __impl_dn_cap;                                \
+    __impl_dn_info->ele_dtor = (destroy_fn)(dtor);                           \
+    (T*)(__impl_dn_info + 1);                                                \
+  })
+
+// Synopsis:
+//   size_t deque_len(deque(T)* self);
+//   size_t deque_capacity(deque(T)* self);
+//
+// Returns the number of elements in the deque / the number of elements
+// it can hold before it has to grow.
+#define deque_len(self)                                       \
+  ({                                                          \
+    deque_info* __impl_dl_info = get_deque_header(self);      \
+    __impl_dl_info == NULL ? (size_t)0 : __impl_dl_info->len; \
+  })
+
+#define deque_capacity(self)                                       \
+  ({                                                               \
+    deque_info* __impl_dc_info = get_deque_header(self);           \
+    __impl_dc_info == NULL ? (size_t)0 : __impl_dc_info->capacity; \
+  })
+
+// Synopsis:
+//   void deque_reserve(deque(T)* self, size_t n);
+//
+// Description:
+// Grows the deque so it can hold at least n elements, rounded up to a
+// power of two. If the elements wrap around the end of the old buffer,
+// the wrapped part is moved after the old end, so every element moves
+// at most once. Pointers to elements are invalidated if the deque grows.
+#define deque_reserve(self, n)                                            \
+  ({                                                                      \
+    typeof(self) __impl_dr_self = (self);                                 \
+    size_t __impl_dr_n = (n);                                             \
+    deque_info* __impl_dr_info = get_deque_header(__impl_dr_self);        \
+    size_t __impl_dr_old = __impl_dr_info ? __impl_dr_info->capacity : 0; \
+    if (__impl_dr_info == NULL || __impl_dr_n > __impl_dr_old) {          \
+      size_t __impl_dr_cap = deque_round_capacity(__impl_dr_n);           \
+      size_t __impl_dr_size = sizeof(**__impl_dr_self);                   \
+      deque_info* __impl_dr_new = (deque_info*)realloc(                   \
+          __impl_dr_info,                                                 \
+          sizeof(deque_info) + __impl_dr_cap * __impl_dr_size);           \
+      if (__impl_dr_new == NULL) {                                        \
+        panic("realloc failed in deque_reserve\n");                       \
+      }                                                                   \
+      if (__impl_dr_info == NULL) {                                       \
+        __impl_dr_new->head = 0;                                          \
+        __impl_dr_new->len = 0;                                           \
+        __impl_dr_new->ele_dtor = NULL;                                   \
+      }                                                                   \
+      /* move the part that wrapped around to right after the old end */  \
+      size_t __impl_dr_end = __impl_dr_new->head + __impl_dr_new->len;    \
+      if (__impl_dr_end > __impl_dr_old) {                                \
+        char* __impl_dr_data = (char*)(__impl_dr_new + 1);                \
+        memcpy(__impl_dr_data + __impl_dr_old * __impl_dr_size,           \
+               __impl_dr_data,                                            \
+               (__impl_dr_end - __impl_dr_old) * __impl_dr_size);         \
+      }                                                                   \
+      __impl_dr_new->capacity = __impl_dr_cap;                            \
+      *__impl_dr_self = (typeof(*__impl_dr_self))(__impl_dr_new + 1);     \
+    }                                                                     \
+    ((void)0);                                                            \
+  })
+
+// Synopsis:
+//   T* deque_at(deque(T)* self, size_t index);
+//
+// Description:
+// Returns a pointer to the element at the specified position, where 0 is
+// the front of the deque. panic()'s if the index is out of bound.
+#define deque_at(self, index)                                               \
+  ({                                                                        \
+    typeof(self) __impl_da_self = (self);                                   \
+    size_t __impl_da_index = (index);                                       \
+    deque_info* __impl_da_info = get_deque_header(__impl_da_self);          \
+    if (__impl_da_info == NULL || __impl_da_index >= __impl_da_info->len) { \
+      panic("index out of bound in deque_at\n");                            \
+    }                                                                       \
+    &(*__impl_da_self)[(__impl_da_info->head + __impl_da_index) &           \
+                       (__impl_da_info->capacity - 1)];                     \
+  })
+
+// Synopsis:
+//   T deque_get(deque(T)* self, size_t index);
+//   T deque_front(deque(T)* self);
+//   T deque_back(deque(T)* self);
+//
+// Returns the element at the specified position, the first element or
+// the last element. panic()'s if the index is out of bound.
+#define deque_get(self, index) (*deque_at(self, index))
+#define deque_front(self) (*deque_at(self, 0))
+#define deque_back(self) (*deque_at(self, deque_len(self) - 1))
+
+// Synopsis:
+//   void deque_set(deque(T)* self, size_t index, T new_element);
+//
+// Description:
+// Destroys the element at the specified position and replaces it.
+// panic()'s if the index is out of bound.
+#define deque_set(self, index, ...)                                            \
+  ({                                                                           \
+    typeof(self) __impl_ds_self = (self);                                      \
+    typeof(*__impl_ds_self) __impl_ds_ele = deque_at(__impl_ds_self, (index)); \
+    deque_info* __impl_ds_info = get_deque_header(__impl_ds_self);             \
+    if (__impl_ds_info->ele_dtor != NULL) {                                    \
+      __impl_ds_info->ele_dtor(__impl_ds_ele);                                 \
+    }                                                                          \
+    *__impl_ds_ele = (__VA_ARGS__);                                            \
+    ((void)0);                                                                 \
+  })
+
+// Synopsis:
+//   void deque_push_back(deque(T)* self, T new_element);
+//   void deque_push_front(deque(T)* self, T new_element);
+//
+// Description:
+// Adds the element after the last / before the first element, doubling
+// the capacity first if the deque is full. panic()'s if that fails.
+//
+// example:
+// deque(int) dq = NULL;
+// deque_push_back(&dq, 3);
+// deque_push_front(&dq, 2);  // dq is now {2, 3}
+#define deque_push_back(self, ...)                                       \
+  ({                                                                     \
+    typeof(self) __impl_dpb_self = (self);                               \
+    size_t __impl_dpb_len = deque_len(__impl_dpb_self);                  \
+    if (__impl_dpb_len == deque_capacity(__impl_dpb_self)) {             \
+      deque_reserve(__impl_dpb_self, __impl_dpb_len + 1);                \
+    }                                                                    \
+    deque_info* __impl_dpb_info = get_deque_header(__impl_dpb_self);     \
+    (*__impl_dpb_self)[(__impl_dpb_info->head + __impl_dpb_len) &        \
+                       (__impl_dpb_info->capacity - 1)] = (__VA_ARGS__); \
+    __impl_dpb_info->len++;                                              \
+    ((void)0);                                                           \
+  })
+
+#define deque_push_front(self, ...)                                    \
+  ({                                                                   \
+    typeof(self) __impl_dpf_self = (self);                             \
+    size_t __impl_dpf_len = deque_len(__impl_dpf_self);                \
+    if (__impl_dpf_len == deque_capacity(__impl_dpf_self)) {           \
+      deque_reserve(__impl_dpf_self, __impl_dpf_len + 1);              \
+    }                                                                  \
+    deque_info* __impl_dpf_info = get_deque_header(__impl_dpf_self);   \
+    __impl_dpf_info->head =                                            \
+        (__impl_dpf_info->head - 1) & (__impl_dpf_info->capacity - 1); \
+    (*__impl_dpf_self)[__impl_dpf_info->head] = (__VA_ARGS__);         \
+    __impl_dpf_info->len++;                                            \
+    ((void)0);                                                         \
+  })
+
+// Synopsis:
+//   bool deque_pop_back(deque(T)* self);
+//   bool deque_pop_front(deque(T)* self);
+//
+// Description:
+// Removes and destroys the last / first element of the deque.
+// Use deque_back() / deque_front() first to look at it.
+//
+// returns:
+// - false if the deque was empty, true otherwise
+#define deque_pop_back(self)                                           \
+  ({                                                                   \
+    typeof(self) __impl_dpob_self = (self);                            \
+    deque_info* __impl_dpob_info = get_deque_header(__impl_dpob_self); \
+    bool __impl_dpob_res = false;                                      \
+    if (__impl_dpob_info != NULL && __impl_dpob_info->len > 0) {       \
+      __impl_dpob_info->len--;                                         \
+      if (__impl_dpob_info->ele_dtor != NULL) {                        \
+        __impl_dpob_info->ele_dtor(&(*__impl_dpob_self)[(              \
+            __impl_dpob_info->head + __impl_dpob_info->len) &          \
+            (__impl_dpob_info->capacity - 1)]);                        \
+      }                                                                \
+      __impl_dpob_res = true;                                          \
+    }                                                                  \
+    __impl_dpob_res;                                                   \
+  })
+
+#define deque_pop_front(self)                                              \
+  ({                                                                       \
+    typeof(self) __impl_dpof_self = (self);                                \
+    deque_info* __impl_dpof_info = get_deque_header(__impl_dpof_self);     \
+    bool __impl_dpof_res = false;                                          \
+    if (__impl_dpof_info != NULL && __impl_dpof_info->len > 0) {           \
+      if (__impl_dpof_info->ele_dtor != NULL) {                            \
+        __impl_dpof_info->ele_dtor(                                        \
+            &(*__impl_dpof_self)[__impl_dpof_info->head]);                 \
+      }                                                                    \
+      __impl_dpof_info->head =                                             \
+          (__impl_dpof_info->head + 1) & (__impl_dpof_info->capacity - 1); \
+      __impl_dpof_info->len--;                                             \
+      __impl_dpof_res = true;                                              \
+    }                                                                      \
+    __impl_dpof_res;                                                       \
+  })
+
+// Synopsis:
+//   void deque_free(deque(T)* self);
+//
+// Description:
+// Destroys every element, frees the storage and sets *self to NULL.
+#define deque_free(self)                                                   \
+  ({                                                                       \
+    typeof(self) __impl_df_self = (self);                                  \
+    deque_info* __impl_df_info = get_deque_header(__impl_df_self);         \
+    if (__impl_df_info != NULL) {                                          \
+      if (__impl_df_info->ele_dtor != NULL) {                              \
+        for (size_t __impl_df_i = 0; __impl_df_i < __impl_df_info->len;    \
+             __impl_df_i++) {                                              \
+          __impl_df_info->ele_dtor(deque_at(__impl_df_self, __impl_df_i)); \
+        }                                                                  \
+      }                                                                    \
+      free(__impl_df_info);                                                \
+      *__impl_df_self = NULL;                                              \
+    }                                                                      \
+    ((void)0);                                                             \
+  })
+
+#endif  // DEQUE_H_
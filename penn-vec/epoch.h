@@ -0,0 +1,115 @@
+#ifndef EPOCH_H_
+#define EPOCH_H_
+
+#include <stddef.h>
+
+/*!
+ * Epoch-based reclamation (EBR) for data that lock-free readers may still
+ * be looking at when a writer replaces it.
+ *
+ * Readers wrap every access in epoch_enter() / epoch_exit(), which only
+ * announce the global epoch the reader is in. A writer that unlinks an
+ * object (e.g. the old buffer of a vector that grew) hands it to
+ * epoch_retire() instead of freeing it. The domain advances the global
+ * epoch once every active reader has announced the current one, and an
+ * object retired in epoch e is freed once the global epoch reaches e + 2:
+ * by then every reader that could have seen it has exited.
+ *
+ * Entering is a load of the global epoch and one seq_cst exchange that
+ * announces it. The exchange is the one read-modify-write on the read
+ * side, and its full fence is what the protocol needs: the announcement
+ * must be visible before the section reads anything. Exiting is a single
+ * release store. Readers take no locks. Retiring, registering and
+ * advancing take a mutex on the write side.
+ *
+ * A reader that stays inside an epoch forever blocks all reclamation, so
+ * read sections should be short.
+ */
+
+#define EPOCH_MAX_READERS 64
+
+typedef struct epoch_domain_st EpochDomain;
+
+// a reader thread's handle, one per thread and domain
+typedef struct epoch_reader_st {
+  EpochDomain* domain;
+  size_t slot;
+} EpochReader;
+
+typedef void (*epoch_reclaim_fn)(void*);
+
+/*!
+ * Creates a new domain in epoch 0 with no readers.
+ *
+ * @returns a newly created domain to be freed with epoch_domain_free().
+ * @post if memory allocation fails, the function will panic.
+ */
+EpochDomain* epoch_domain_new(void);
+
+/*!
+ * Reclaims every retired object and frees the domain.
+ *
+ * @param domain the domain to free.
+ * @pre no reader may be inside an epoch of the domain.
+ */
+void epoch_domain_free(EpochDomain* domain);
+
+/*!
+ * Registers the calling thread as a reader.
+ *
+ * @param domain the domain to read under.
+ * @returns a handle for epoch_enter() and epoch_exit().
+ * @post panics if EPOCH_MAX_READERS readers are already registered.
+ */
+EpochReader epoch_register(EpochDomain* domain);
+
+/*!
+ * Gives the reader's slot back to the domain.
+ *
+ * @param reader a registered reader that is not inside an epoch.
+ */
+void epoch_unregister(EpochReader* reader);
+
+/*!
+ * Starts a read section. Objects retired after this call are not freed
+ * before the matching epoch_exit().
+ *
+ * @param reader the handle of the calling thread.
+ */
+void epoch_enter(EpochReader* reader);
+
+/*!
+ * Ends a read section. Pointers read inside it must not be used anymore.
+ *
+ * @param reader the handle of the calling thread.
+ */
+void epoch_exit(EpochReader* reader);
+
+/*!
+ * Frees an object with `reclaim` once no reader can see it anymore. The
+ * caller must already have unlinked it, so that readers entering from now
+ * on can not reach it.
+ *
+ * @param domain  the domain the readers of the object are registered with.
+ * @param ptr     the object to free.
+ * @param reclaim the function freeing it, called on the writer side.
+ * @post if memory allocation fails, the function will panic.
+ */
+void epoch_retire(EpochDomain* domain, void* ptr, epoch_reclaim_fn reclaim);
+
+/*!
+ * Waits for every reader to leave the epochs it was in and frees everything
+ * retired so far. Spins while readers are inside a read section.
+ *
+ * @param domain the domain to synchronize.
+ */
+void epoch_synchronize(EpochDomain* domain);
+
+/*!
+ * Returns the number of retired objects not freed yet.
+ *
+ * @param domain the domain to look at.
+ */
+size_t epoch_pending(EpochDomain* domain);
+
+#endif  // EPOCH_H_
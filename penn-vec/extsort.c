@@ -0,0 +1,404 @@
+#include "./extsort.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "./panic.h"
+#include "./ptr_sort.h"
+
+// The budget is split in two halves of `capacity` keys: the chunk Vec
+// collecting keys and the scratch space for sorting it. While merging,
+// both halves are carved into the run buffers and the output buffer.
+
+#define KEYS_PER_BLOCK (EXT_SORT_BLOCK / sizeof(ptr_t))
+
+typedef struct run_st {
+  int fd;
+  size_t length;  // in keys
+} run;
+
+struct ext_sort_st {
+  Vec chunk;       // keys collected for the next run
+  ptr_t* scratch;  // capacity keys
+  size_t capacity;
+  ptr_cmp_fn cmp;
+  char* temp_dir;
+  Vec runs;  // of run*, in the order they were spilled
+};
+
+static inline int compare(ptr_cmp_fn cmp, ptr_t a, ptr_t b) {
+  if (cmp == NULL) {
+    uintptr_t x = (uintptr_t)a;
+    uintptr_t y = (uintptr_t)b;
+    return (x > y) - (x < y);
+  }
+  return cmp(a, b);
+}
+
+static void sort_chunk(ExtSort* self) {
+  ptr_sort_entries(self->chunk.data, self->chunk.length, 1, self->cmp,
+                   self->scratch);
+}
+
+// ===========================================================
+// Run files
+// ===========================================================
+static void run_free(ptr_t ptr) {
+  run* r = (run*)ptr;
+  close(r->fd);
+  free(r);
+}
+
+static run* run_new(ExtSort* self) {
+  size_t len = strlen(self->temp_dir) + sizeof("/extsort-XXXXXX");
+  char* path = (char*)malloc(len);
+  if (path == NULL) {
+    panic("malloc failed");
+  }
+  snprintf(path, len, "%s/extsort-XXXXXX", self->temp_dir);
+  int fd = mkstemp(path);
+  if (fd < 0) {
+    panic("mkstemp failed");
+  }
+  // the file lives on through the descriptor only
+  unlink(path);
+  free(path);
+
+  run* r = (run*)malloc(sizeof(run));
+  if (r == NULL) {
+    panic("malloc failed");
+  }
+  r->fd = fd;
+  r->length = 0;
+  return r;
+}
+
+static void write_all(int fd, const void* buf, size_t bytes) {
+  const char* pos = (const char*)buf;
+  while (bytes > 0) {
+    ssize_t written = write(fd, pos, bytes);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      panic("write failed");
+    }
+    pos += written;
+    bytes -= (size_t)written;
+  }
+}
+
+static void read_all(int fd, void* buf, size_t bytes, off_t offset) {
+  char* pos = (char*)buf;
+  while (bytes > 0) {
+    ssize_t got = pread(fd, pos, bytes, offset);
+    if (got < 0 && errno == EINTR) {
+      continue;
+    }
+    if (got <= 0) {
+      panic("read failed");
+    }
+    pos += got;
+    offset += got;
+    bytes -= (size_t)got;
+  }
+}
+
+// an ext_sort_emit_fn appending to a run
+static void emit_to_run(const ptr_t* keys, size_t n, void* arg) {
+  run* r = (run*)arg;
+  write_all(r->fd, keys, n * sizeof(ptr_t));
+  r->length += n;
+}
+
+// an ext_sort_emit_fn writing to a file descriptor
+static void emit_to_fd(const ptr_t* keys, size_t n, void* arg) {
+  write_all(*(int*)arg, keys, n * sizeof(ptr_t));
+}
+
+// sorts the chunk and writes it out as a run, in one write
+static void spill(ExtSort* self) {
+  sort_chunk(self);
+  run* r = run_new(self);
+  emit_to_run(self->chunk.data, self->chunk.length, r);
+  posix_fadvise(r->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+  vec_push_back(&self->runs, r);
+  self->chunk.length = 0;
+}
+
+// ===========================================================
+// Merging
+// ===========================================================
+typedef struct reader_st {
+  run* src;
+  ptr_t* buf;
+  size_t buf_keys;
+  size_t pos;
+  size_t len;
+  size_t next;  // the index in the run of the key after the buffer
+} reader;
+
+static bool reader_fill(reader* r) {
+  size_t left = r->src->length - r->next;
+  if (left == 0) {
+    return false;
+  }
+  size_t n = left < r->buf_keys ? left : r->buf_keys;
+  read_all(r->src->fd, r->buf, n * sizeof(ptr_t),
+           (off_t)(r->next * sizeof(ptr_t)));
+  r->next += n;
+  r->pos = 0;
+  r->len = n;
+
+  // read ahead: have the kernel fetch the next block while we merge
+  left -= n;
+  if (left > 0) {
+    size_t ahead = left < r->buf_keys ? left : r->buf_keys;
+    posix_fadvise(r->src->fd, (off_t)(r->next * sizeof(ptr_t)),
+                  (off_t)(ahead * sizeof(ptr_t)), POSIX_FADV_WILLNEED);
+  }
+  return true;
+}
+
+static inline bool reader_done(const reader* r) {
+  return r->pos == r->len;
+}
+
+// true if reader a's key goes out before reader b's. Ties go to the
+// earlier run, which keeps the merge stable
+static inline bool beats(const reader* readers,
+                         size_t a,
+                         size_t b,
+                         ptr_cmp_fn cmp) {
+  if (reader_done(&readers[a])) {
+    return false;
+  }
+  if (reader_done(&readers[b])) {
+    return true;
+  }
+  int c = compare(cmp, readers[a].buf[readers[a].pos],
+                  readers[b].buf[readers[b].pos]);
+  return c < 0 || (c == 0 && a < b);
+}
+
+// the i-th buffer of buf_keys keys while merging. The first ones are
+// carved from the chunk, the rest from the scratch space
+static ptr_t* buffer_at(ExtSort* self, size_t i, size_t buf_keys) {
+  size_t per_half = self->capacity / buf_keys;
+  return i < per_half ? &self->chunk.data[i * buf_keys]
+                      : &self->scratch[(i - per_half) * buf_keys];
+}
+
+// merges runs [first, first + k) with a loser tree. losers[t] is the
+// loser of the match at node t and losers[0] the overall winner. The
+// leaves, one per run, are the implicit nodes k to 2k - 1, so the
+// parent of run i is node (k + i) / 2
+static void merge_runs(ExtSort* self,
+                       size_t first,
+                       size_t k,
+                       ext_sort_emit_fn emit,
+                       void* arg) {
+  size_t halves = (k + 2) / 2;  // buffers per half, rounded up
+  size_t buf_keys = self->capacity / halves;
+
+  reader* readers = (reader*)malloc(k * sizeof(reader));
+  size_t* losers = (size_t*)malloc(k * sizeof(size_t));
+  size_t* winners = (size_t*)malloc(2 * k * sizeof(size_t));
+  if (readers == NULL || losers == NULL || winners == NULL) {
+    panic("malloc failed");
+  }
+  for (size_t i = 0; i < k; i++) {
+    reader* r = &readers[i];
+    r->src = (run*)self->runs.data[first + i];
+    r->buf = buffer_at(self, i, buf_keys);
+    r->buf_keys = buf_keys;
+    r->pos = 0;
+    r->len = 0;
+    r->next = 0;
+    reader_fill(r);
+  }
+  ptr_t* out = buffer_at(self, k, buf_keys);
+  size_t out_len = 0;
+
+  // play the first round of matches bottom up
+  for (size_t i = 0; i < k; i++) {
+    winners[k + i] = i;
+  }
+  for (size_t t = k - 1; t > 0; t--) {
+    size_t a = winners[2 * t];
+    size_t b = winners[2 * t + 1];
+    bool a_wins = beats(readers, a, b, self->cmp);
+    winners[t] = a_wins ? a : b;
+    losers[t] = a_wins ? b : a;
+  }
+  losers[0] = k == 1 ? 0 : winners[1];
+  free(winners);
+
+  while (!reader_done(&readers[losers[0]])) {
+    size_t w = losers[0];
+    reader* r = &readers[w];
+    out[out_len++] = r->buf[r->pos++];
+    if (out_len == buf_keys) {
+      emit(out, out_len, arg);
+      out_len = 0;
+    }
+    if (reader_done(r)) {
+      reader_fill(r);
+    }
+    // replay the matches on the path from w's leaf to the root
+    for (size_t t = (w + k) / 2; t > 0; t /= 2) {
+      if (beats(readers, losers[t], w, self->cmp)) {
+        size_t tmp = losers[t];
+        losers[t] = w;
+        w = tmp;
+      }
+    }
+    losers[0] = w;
+  }
+  if (out_len > 0) {
+    emit(out, out_len, arg);
+  }
+  free(losers);
+  free(readers);
+}
+
+// ===========================================================
+// Public functions
+// ===========================================================
+ExtSort* ext_sort_new(size_t memory_budget,
+                      ptr_cmp_fn cmp,
+                      const char* temp_dir) {
+  if (memory_budget < EXT_SORT_MIN_BUDGET) {
+    panic("memory budget is too small");
+  }
+  if (temp_dir == NULL) {
+    temp_dir = getenv("TMPDIR");
+  }
+  if (temp_dir == NULL || *temp_dir == '\0') {
+    temp_dir = "/tmp";
+  }
+
+  ExtSort* res = (ExtSort*)malloc(sizeof(ExtSort));
+  if (res == NULL) {
+    panic("malloc failed");
+  }
+  res->capacity = memory_budget / 2 / sizeof(ptr_t);
+  res->chunk = vec_new(res->capacity, NULL);
+  res->scratch = (ptr_t*)malloc(res->capacity * sizeof(ptr_t));
+  res->temp_dir = strdup(temp_dir);
+  if (res->scratch == NULL || res->temp_dir == NULL) {
+    panic("malloc failed");
+  }
+  res->cmp = cmp;
+  res->runs = vec_new(0, run_free);
+  return res;
+}
+
+void ext_sort_push(ExtSort* self, const ptr_t* keys, size_t n) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  while (n > 0) {
+    size_t room = self->capacity - self->chunk.length;
+    size_t take = n < room ? n : room;
+    memcpy(&self->chunk.data[self->chunk.length], keys, take * sizeof(ptr_t));
+    self->chunk.length += take;
+    keys += take;
+    n -= take;
+    if (self->chunk.length == self->capacity) {
+      spill(self);
+    }
+  }
+}
+
+void ext_sort_push_vec(ExtSort* self, const Vec* vec) {
+  if (vec == NULL) {
+    panic("vec is NULL");
+  }
+  ext_sort_push(self, vec->data, vec->length);
+}
+
+size_t ext_sort_runs(const ExtSort* self) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  return vec_len(&self->runs);
+}
+
+void ext_sort_finish(ExtSort* self, ext_sort_emit_fn emit, void* arg) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  if (emit == NULL) {
+    panic("emit is NULL");
+  }
+  if (vec_is_empty(&self->runs)) {
+    // it all fit in memory
+    sort_chunk(self);
+    if (self->chunk.length > 0) {
+      emit(self->chunk.data, self->chunk.length, arg);
+    }
+    self->chunk.length = 0;
+    return;
+  }
+  if (self->chunk.length > 0) {
+    spill(self);
+  }
+
+  // with more runs than buffers, merge neighbouring groups into longer
+  // runs until one merge can take them all
+  size_t fan_in = 2 * (self->capacity / KEYS_PER_BLOCK) - 1;
+  while (vec_len(&self->runs) > fan_in) {
+    Vec merged = vec_new(vec_len(&self->runs) / fan_in + 1, run_free);
+    for (size_t first = 0; first < vec_len(&self->runs); first += fan_in) {
+      size_t k = vec_len(&self->runs) - first;
+      k = k < fan_in ? k : fan_in;
+      run* out = self->runs.data[first];
+      if (k > 1) {
+        out = run_new(self);
+        merge_runs(self, first, k, emit_to_run, out);
+        for (size_t i = first; i < first + k; i++) {
+          run_free(self->runs.data[i]);
+        }
+      }
+      for (size_t i = first; i < first + k; i++) {
+        self->runs.data[i] = NULL;
+      }
+      vec_push_back(&merged, out);
+    }
+    vec_destroy(&self->runs);
+    self->runs = merged;
+  }
+
+  merge_runs(self, 0, vec_len(&self->runs), emit, arg);
+  vec_clear(&self->runs);
+}
+
+void ext_sort_finish_file(ExtSort* self, const char* path) {
+  if (path == NULL) {
+    panic("path is NULL");
+  }
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    panic("open failed");
+  }
+  ext_sort_finish(self, emit_to_fd, &fd);
+  if (close(fd) != 0) {
+    panic("close failed");
+  }
+}
+
+void ext_sort_free(ExtSort* self) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  vec_destroy(&self->runs);
+  vec_destroy(&self->chunk);
+  free(self->scratch);
+  free(self->temp_dir);
+  free(self);
+}
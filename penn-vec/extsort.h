@@ -0,0 +1,105 @@
+#ifndef EXTSORT_H_
+#define EXTSORT_H_
+
+#include <stddef.h>
+#include "./Vec.h"
+#include "./flat.h"  // ptr_cmp_fn
+
+/*!
+ * An external merge sort, for more keys than fit in memory.
+ *
+ * Keys are pushed into an ExtSort, which collects them in a Vec. When the
+ * Vec fills its share of the memory budget it is sorted and spilled to a
+ * temp file as one sorted "run", with one large sequential write. Finishing
+ * the sort merges the runs:
+ *
+ * - Each run is read through a buffer of its own, refilled with one large
+ *   pread. After every refill the kernel is asked to start reading the next
+ *   block (POSIX_FADV_WILLNEED), so the disk works while the merge runs.
+ * - A loser tree picks the smallest key of k runs with log2(k) compares.
+ * - If there are more runs than buffers fit in the budget, groups of
+ *   neighbouring runs are merged into longer runs first, in extra passes.
+ *
+ * If no run was spilled the keys are sorted in memory and nothing touches
+ * the disk. The sort is stable: keys that compare equal come out in the
+ * order they were pushed.
+ *
+ * Keys are written to disk as their bits, so they must be values packed into
+ * a ptr_t (integers, or indices into something that stays in memory), not
+ * pointers to memory the ExtSort does not own. Temp files are unlinked as
+ * soon as they are created, so they never outlive the process.
+ *
+ * I/O errors panic, like failed allocations elsewhere in penn-vec.
+ */
+
+// run buffers are at least a block. The smallest budget allowed has room
+// for three of them and the output buffer
+#define EXT_SORT_BLOCK 4096U
+#define EXT_SORT_MIN_BUDGET (4 * EXT_SORT_BLOCK)
+
+typedef struct ext_sort_st ExtSort;
+
+/* Receives the sorted keys, a buffer at a time, in order.
+ *
+ * @param keys the next keys.
+ * @param n    the number of keys.
+ * @param arg  the argument given to ext_sort_finish().
+ */
+typedef void (*ext_sort_emit_fn)(const ptr_t* keys, size_t n, void* arg);
+
+/*!
+ * Creates a new external sort.
+ *
+ * @param memory_budget the bytes the sort may use for keys and buffers, at
+ *                      least EXT_SORT_MIN_BUDGET. Half of it holds keys
+ *                      while they are collected, the other half is scratch
+ *                      space for sorting them.
+ * @param cmp           the key comparator, or NULL to compare keys by
+ *                      their value as a uintptr_t (which is the fastest).
+ * @param temp_dir      the directory for the runs, or NULL for $TMPDIR,
+ *                      or /tmp if that is not set.
+ * @returns a newly created ExtSort.
+ * @post if memory allocation fails, the function will panic.
+ */
+ExtSort* ext_sort_new(size_t memory_budget,
+                      ptr_cmp_fn cmp,
+                      const char* temp_dir);
+
+/*!
+ * Adds keys to the sort, spilling a run whenever memory fills up.
+ *
+ * @param self the sort.
+ * @param keys the keys to add.
+ * @param n    the number of keys.
+ */
+void ext_sort_push(ExtSort* self, const ptr_t* keys, size_t n);
+
+/* Adds every element of a Vec to the sort. The Vec is left unchanged. */
+void ext_sort_push_vec(ExtSort* self, const Vec* vec);
+
+/* Returns the number of runs spilled to disk so far. */
+size_t ext_sort_runs(const ExtSort* self);
+
+/*!
+ * Merges everything pushed so far and hands the keys to a callback in
+ * sorted order. Afterwards the sort is empty and can be reused.
+ *
+ * @param self the sort.
+ * @param emit the function receiving the sorted keys.
+ * @param arg  passed to emit.
+ */
+void ext_sort_finish(ExtSort* self, ext_sort_emit_fn emit, void* arg);
+
+/*!
+ * Merges everything pushed so far into a file, as an array of raw keys.
+ * Afterwards the sort is empty and can be reused.
+ *
+ * @param self the sort.
+ * @param path the file to create or truncate.
+ */
+void ext_sort_finish_file(ExtSort* self, const char* path);
+
+/* Frees the sort and closes its temp files. */
+void ext_sort_free(ExtSort* self);
+
+#endif  // EXTSORT_H_
@@ -0,0 +1,347 @@
+#include "./flat.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "./panic.h"
+#include "./ptr_sort.h"
+
+// ===========================================================
+// Comparison and branchless search
+// ===========================================================
+static inline int compare(ptr_cmp_fn cmp, ptr_t a, ptr_t b) {
+  if (cmp == NULL) {
+    uintptr_t x = (uintptr_t)a;
+    uintptr_t y = (uintptr_t)b;
+    return (x > y) - (x < y);
+  }
+  return cmp(a, b);
+}
+
+// The answer always stays in [base, base + n]. Each step halves n and
+// moves base with a conditional move instead of a branch, so there is
+// nothing for the branch predictor to get wrong. Both candidates for
+// the next probe are prefetched while the current compare runs.
+static size_t lower_bound_uintptr(const ptr_t* data, size_t n, ptr_t key) {
+  if (n == 0) {
+    return 0;
+  }
+  const uintptr_t* base = (const uintptr_t*)data;
+  uintptr_t target = (uintptr_t)key;
+  while (n > 1) {
+    size_t half = n / 2;
+    __builtin_prefetch(base + half / 2);
+    __builtin_prefetch(base + half + half / 2);
+    base = (base[half] < target) ? base + half : base;
+    n -= half;
+  }
+  return (size_t)(base - (const uintptr_t*)data) + (*base < target);
+}
+
+static size_t lower_bound_cmp(const ptr_t* data,
+                              size_t n,
+                              ptr_t key,
+                              ptr_cmp_fn cmp) {
+  if (n == 0) {
+    return 0;
+  }
+  const ptr_t* base = data;
+  while (n > 1) {
+    size_t half = n / 2;
+    __builtin_prefetch(base + half / 2);
+    __builtin_prefetch(base + half + half / 2);
+    base = (cmp(base[half], key) < 0) ? base + half : base;
+    n -= half;
+  }
+  return (size_t)(base - data) + (cmp(*base, key) < 0);
+}
+
+static inline size_t lower_bound(const ptr_t* data,
+                                 size_t n,
+                                 ptr_t key,
+                                 ptr_cmp_fn cmp) {
+  if (cmp == NULL) {
+    return lower_bound_uintptr(data, n, key);
+  }
+  return lower_bound_cmp(data, n, key, cmp);
+}
+
+// sorts entries of `stride` pointers by the first pointer of each. A set
+// sorts bare keys (stride 1), a map sorts interleaved key/value pairs
+static void sort_entries(ptr_t* data, size_t n, size_t stride, ptr_cmp_fn cmp) {
+  if (n < 2) {
+    return;
+  }
+  ptr_t* scratch = (ptr_t*)malloc(n * stride * sizeof(ptr_t));
+  if (scratch == NULL) {
+    panic("malloc failed");
+  }
+  ptr_sort_entries(data, n, stride, cmp, scratch);
+  free(scratch);
+}
+
+// ===========================================================
+// Shared implementation. `values` is NULL for a set.
+// ===========================================================
+static void destroy_ele(Vec* vec, ptr_t ele) {
+  if (vec->ele_dtor_fn != NULL && ele != NULL) {
+    vec->ele_dtor_fn(ele);
+  }
+}
+
+static bool found_at(Vec* keys, size_t pos, ptr_t key, ptr_cmp_fn cmp) {
+  return pos < keys->length && compare(cmp, keys->data[pos], key) == 0;
+}
+
+static bool insert_one(Vec* keys,
+                       Vec* values,
+                       ptr_cmp_fn cmp,
+                       ptr_t key,
+                       ptr_t value) {
+  size_t pos = lower_bound(keys->data, keys->length, key, cmp);
+  if (found_at(keys, pos, key, cmp)) {
+    destroy_ele(keys, key);
+    if (values != NULL) {
+      vec_set(values, pos, value);
+    }
+    return false;
+  }
+  vec_insert(keys, pos, key);
+  if (values != NULL) {
+    vec_insert(values, pos, value);
+  }
+  return true;
+}
+
+static bool erase_one(Vec* keys, Vec* values, ptr_cmp_fn cmp, ptr_t key) {
+  size_t pos = lower_bound(keys->data, keys->length, key, cmp);
+  if (!found_at(keys, pos, key, cmp)) {
+    return false;
+  }
+  vec_erase(keys, pos);
+  if (values != NULL) {
+    vec_erase(values, pos);
+  }
+  return true;
+}
+
+// `staged` holds m entries (a key, followed by a value for maps) in input
+// order. They are sorted, collapsed to one entry per key (the last one
+// wins), the entries whose key is already present update it in place, and
+// the rest are merged in from the back in a single pass.
+static size_t insert_many(Vec* keys,
+                          Vec* values,
+                          ptr_cmp_fn cmp,
+                          ptr_t* staged,
+                          size_t m) {
+  size_t stride = values == NULL ? 1 : 2;
+  sort_entries(staged, m, stride, cmp);
+
+  // the sort is stable, so of equal keys the last one given comes last
+  size_t unique = 0;
+  for (size_t i = 0; i < m; i++) {
+    ptr_t* entry = &staged[i * stride];
+    if (i + 1 < m && compare(cmp, entry[0], entry[stride]) == 0) {
+      destroy_ele(keys, entry[0]);
+      if (values != NULL) {
+        destroy_ele(values, entry[1]);
+      }
+      continue;
+    }
+    memmove(&staged[unique++ * stride], entry, stride * sizeof(ptr_t));
+  }
+
+  // staged keys are sorted, so each search can start where the last ended
+  size_t n = keys->length;
+  size_t fresh = 0;
+  size_t pos = 0;
+  for (size_t i = 0; i < unique; i++) {
+    ptr_t* entry = &staged[i * stride];
+    pos += lower_bound(keys->data + pos, n - pos, entry[0], cmp);
+    if (found_at(keys, pos, entry[0], cmp)) {
+      destroy_ele(keys, entry[0]);
+      if (values != NULL) {
+        vec_set(values, pos, entry[1]);
+      }
+      continue;
+    }
+    memmove(&staged[fresh++ * stride], entry, stride * sizeof(ptr_t));
+  }
+  if (fresh == 0) {
+    return 0;
+  }
+
+  // one grow, then merge from the back so nothing is overwritten
+  // before it has been moved
+  if (keys->capacity < n + fresh) {
+    vec_resize(keys, n + fresh);
+  }
+  if (values != NULL && values->capacity < n + fresh) {
+    vec_resize(values, n + fresh);
+  }
+  size_t i = n;
+  size_t j = fresh;
+  size_t w = n + fresh;
+  while (j > 0) {
+    w--;
+    if (i > 0 &&
+        compare(cmp, keys->data[i - 1], staged[(j - 1) * stride]) > 0) {
+      i--;
+      keys->data[w] = keys->data[i];
+      if (values != NULL) {
+        values->data[w] = values->data[i];
+      }
+    } else {
+      j--;
+      keys->data[w] = staged[j * stride];
+      if (values != NULL) {
+        values->data[w] = staged[j * stride + 1];
+      }
+    }
+  }
+  keys->length = n + fresh;
+  if (values != NULL) {
+    values->length = n + fresh;
+  }
+  return fresh;
+}
+
+// ===========================================================
+// FlatSet
+// ===========================================================
+FlatSet flat_set_new(size_t initial_capacity,
+                     ptr_cmp_fn cmp,
+                     ptr_dtor_fn key_dtor_fn) {
+  FlatSet res;
+  res.keys = vec_new(initial_capacity, key_dtor_fn);
+  res.cmp = cmp;
+  return res;
+}
+
+size_t flat_set_lower_bound(FlatSet* self, ptr_t key) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  return lower_bound(self->keys.data, self->keys.length, key, self->cmp);
+}
+
+bool flat_set_contains(FlatSet* self, ptr_t key) {
+  return found_at(&self->keys, flat_set_lower_bound(self, key), key,
+                  self->cmp);
+}
+
+bool flat_set_insert(FlatSet* self, ptr_t key) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  return insert_one(&self->keys, NULL, self->cmp, key, NULL);
+}
+
+size_t flat_set_insert_many(FlatSet* self, const ptr_t* keys, size_t n) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  if (n == 0) {
+    return 0;
+  }
+  ptr_t* staged = (ptr_t*)malloc(n * sizeof(ptr_t));
+  if (staged == NULL) {
+    panic("malloc failed");
+  }
+  memcpy(staged, keys, n * sizeof(ptr_t));
+  size_t inserted = insert_many(&self->keys, NULL, self->cmp, staged, n);
+  free(staged);
+  return inserted;
+}
+
+bool flat_set_erase(FlatSet* self, ptr_t key) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  return erase_one(&self->keys, NULL, self->cmp, key);
+}
+
+void flat_set_destroy(FlatSet* self) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  vec_destroy(&self->keys);
+}
+
+// ===========================================================
+// FlatMap
+// ===========================================================
+FlatMap flat_map_new(size_t initial_capacity,
+                     ptr_cmp_fn cmp,
+                     ptr_dtor_fn key_dtor_fn,
+                     ptr_dtor_fn value_dtor_fn) {
+  FlatMap res;
+  res.keys = vec_new(initial_capacity, key_dtor_fn);
+  res.values = vec_new(initial_capacity, value_dtor_fn);
+  res.cmp = cmp;
+  return res;
+}
+
+size_t flat_map_lower_bound(FlatMap* self, ptr_t key) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  return lower_bound(self->keys.data, self->keys.length, key, self->cmp);
+}
+
+bool flat_map_get(FlatMap* self, ptr_t key, ptr_t* value) {
+  size_t pos = flat_map_lower_bound(self, key);
+  if (!found_at(&self->keys, pos, key, self->cmp)) {
+    return false;
+  }
+  if (value != NULL) {
+    *value = self->values.data[pos];
+  }
+  return true;
+}
+
+bool flat_map_put(FlatMap* self, ptr_t key, ptr_t value) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  return insert_one(&self->keys, &self->values, self->cmp, key, value);
+}
+
+size_t flat_map_put_many(FlatMap* self,
+                         const ptr_t* keys,
+                         const ptr_t* values,
+                         size_t n) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  if (n == 0) {
+    return 0;
+  }
+  // interleave the pairs so that sorting moves values with their keys
+  ptr_t* staged = (ptr_t*)malloc(2 * n * sizeof(ptr_t));
+  if (staged == NULL) {
+    panic("malloc failed");
+  }
+  for (size_t i = 0; i < n; i++) {
+    staged[2 * i] = keys[i];
+    staged[2 * i + 1] = values[i];
+  }
+  size_t inserted =
+      insert_many(&self->keys, &self->values, self->cmp, staged, n);
+  free(staged);
+  return inserted;
+}
+
+bool flat_map_erase(FlatMap* self, ptr_t key) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  return erase_one(&self->keys, &self->values, self->cmp, key);
+}
+
+void flat_map_destroy(FlatMap* self) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  vec_destroy(&self->keys);
+  vec_destroy(&self->values);
+}
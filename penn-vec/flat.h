@@ -0,0 +1,210 @@
+#ifndef FLAT_H_
+#define FLAT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "./Vec.h"
+
+/*!
+ * Sorted associative containers layered on Vec.
+ *
+ * A FlatSet keeps its keys sorted and unique in a single Vec, a FlatMap
+ * keeps a sorted Vec of keys next to a Vec of values at the same indices.
+ * Keeping the keys in their own contiguous array makes lookups a binary
+ * search over one cache friendly array, instead of chasing node pointers
+ * like a tree or chained hash table.
+ *
+ * The binary search is branchless: each step picks the half to continue
+ * with a conditional move, and the two possible next probes are prefetched.
+ *
+ * Inserting a single key is O(n) since the tail has to shift. To insert many
+ * keys use the _insert_many / _put_many functions instead, which sort the
+ * new keys and merge them into the container in one O(n + m) pass.
+ *
+ * Keys are ordered by a ptr_cmp_fn, or by their value as a uintptr_t
+ * when the comparator is NULL (which is also the fastest).
+ *
+ * The containers own the keys (and values) they hold: they are cleaned up
+ * with the destructors given at creation when erased, replaced or destroyed,
+ * just like elements of a Vec. A key that is passed in but not stored because
+ * an equal key is already present is cleaned up right away.
+ */
+
+// returns < 0, 0 or > 0 if a is less than, equal to or greater than b
+typedef int (*ptr_cmp_fn)(ptr_t, ptr_t);
+
+typedef struct flat_set_st {
+  Vec keys;
+  ptr_cmp_fn cmp;
+} FlatSet;
+
+typedef struct flat_map_st {
+  Vec keys;
+  Vec values;
+  ptr_cmp_fn cmp;
+} FlatMap;
+
+/*!
+ * Creates a new empty FlatSet.
+ *
+ * @param initial_capacity the initial capacity of the key array.
+ * @param cmp              the key comparator, or NULL to compare keys by
+ *                         their value as a uintptr_t.
+ * @param key_dtor_fn      the function used to clean up keys, can be NULL.
+ * @returns a newly created set.
+ * @post if memory allocation fails, the function will panic.
+ */
+FlatSet flat_set_new(size_t initial_capacity,
+                     ptr_cmp_fn cmp,
+                     ptr_dtor_fn key_dtor_fn);
+
+/* Returns the number of keys in a FlatSet or FlatMap. */
+#define flat_len(flat) ((flat)->keys.length)
+
+/* Returns the key at the specified position of a FlatSet or FlatMap.
+ * Keys are in sorted order. panic()'s if index is out of bound.
+ */
+#define flat_key_at(flat, index) (vec_get(&(flat)->keys, (index)))
+
+/*!
+ * Finds the position of the first key that is not less than `key`.
+ *
+ * @param self a pointer to the set to search.
+ * @param key  the key we are looking for.
+ * @returns an index in [0, flat_len(self)].
+ */
+size_t flat_set_lower_bound(FlatSet* self, ptr_t key);
+
+/*!
+ * Checks if a key is in the set.
+ *
+ * @param self a pointer to the set to search.
+ * @param key  the key we are looking for.
+ * @returns true iff an equal key is in the set.
+ */
+bool flat_set_contains(FlatSet* self, ptr_t key);
+
+/*!
+ * Inserts a single key into the set. O(n) because of the shift.
+ *
+ * @param self a pointer to the set to insert into.
+ * @param key  the key to insert.
+ * @returns true iff the key was inserted. If an equal key was already in
+ * the set, the passed in key is cleaned up and false is returned.
+ */
+bool flat_set_insert(FlatSet* self, ptr_t key);
+
+/*!
+ * Inserts many keys at once in O(n + m log m).
+ * The new keys are copied aside and sorted, then merged with the existing
+ * keys from the back so that every existing key moves at most once.
+ *
+ * @param self a pointer to the set to insert into.
+ * @param keys the keys to insert, in any order. May contain duplicates.
+ * @param n    the number of keys.
+ * @returns the number of keys that were inserted. Keys that were already
+ * present (or repeated in `keys`) are cleaned up.
+ */
+size_t flat_set_insert_many(FlatSet* self, const ptr_t* keys, size_t n);
+
+/*!
+ * Removes and cleans up a key from the set.
+ *
+ * @param self a pointer to the set to erase from.
+ * @param key  a key equal to the one to remove. It is not cleaned up.
+ * @returns true iff a key was removed.
+ */
+bool flat_set_erase(FlatSet* self, ptr_t key);
+
+/*!
+ * Destroys the set, cleaning up every key.
+ *
+ * @param self a pointer to the set to destroy.
+ */
+void flat_set_destroy(FlatSet* self);
+
+/*!
+ * Creates a new empty FlatMap.
+ *
+ * @param initial_capacity the initial capacity of the key and value arrays.
+ * @param cmp              the key comparator, or NULL to compare keys by
+ *                         their value as a uintptr_t.
+ * @param key_dtor_fn      the function used to clean up keys, can be NULL.
+ * @param value_dtor_fn    the function used to clean up values, can be NULL.
+ * @returns a newly created map.
+ * @post if memory allocation fails, the function will panic.
+ */
+FlatMap flat_map_new(size_t initial_capacity,
+                     ptr_cmp_fn cmp,
+                     ptr_dtor_fn key_dtor_fn,
+                     ptr_dtor_fn value_dtor_fn);
+
+/* Returns the value at the specified position of a FlatMap,
+ * the value of the key flat_key_at(map, index).
+ */
+#define flat_value_at(map, index) (vec_get(&(map)->values, (index)))
+
+/*!
+ * Finds the position of the first key that is not less than `key`.
+ *
+ * @param self a pointer to the map to search.
+ * @param key  the key we are looking for.
+ * @returns an index in [0, flat_len(self)].
+ */
+size_t flat_map_lower_bound(FlatMap* self, ptr_t key);
+
+/*!
+ * Looks up the value of a key.
+ *
+ * @param self  a pointer to the map to search.
+ * @param key   the key we are looking for.
+ * @param value where to store the value if the key is found, can be NULL.
+ * @returns true iff the key was found.
+ */
+bool flat_map_get(FlatMap* self, ptr_t key, ptr_t* value);
+
+/*!
+ * Sets the value of a key, inserting the key if it is not in the map yet.
+ * If the key was present, its old value is cleaned up and the passed in
+ * key is cleaned up (the stored key is kept).
+ *
+ * @param self  a pointer to the map to modify.
+ * @param key   the key to set.
+ * @param value the new value of the key.
+ * @returns true iff the key was newly inserted.
+ */
+bool flat_map_put(FlatMap* self, ptr_t key, ptr_t value);
+
+/*!
+ * Sets the values of many keys at once in O(n + m log m), as if
+ * flat_map_put() was called for every pair in order: if a key repeats,
+ * the last value wins.
+ *
+ * @param self   a pointer to the map to modify.
+ * @param keys   the keys to set, in any order.
+ * @param values the values of the keys, values[i] belongs to keys[i].
+ * @param n      the number of pairs.
+ * @returns the number of keys that were newly inserted.
+ */
+size_t flat_map_put_many(FlatMap* self,
+                         const ptr_t* keys,
+                         const ptr_t* values,
+                         size_t n);
+
+/*!
+ * Removes and cleans up a key and its value from the map.
+ *
+ * @param self a pointer to the map to erase from.
+ * @param key  a key equal to the one to remove. It is not cleaned up.
+ * @returns true iff a key was removed.
+ */
+bool flat_map_erase(FlatMap* self, ptr_t key);
+
+/*!
+ * Destroys the map, cleaning up every key and value.
+ *
+ * @param self a pointer to the map to destroy.
+ */
+void flat_map_destroy(FlatMap* self);
+
+#endif  // FLAT_H_
@@ -0,0 +1,170 @@
+#include "./gap_vec.h"
+#include <stdlib.h>
+#include <string.h>
+#include "./panic.h"
+
+// elements in [0, gap_start) and [gap_end, capacity) are live
+
+GapVec gap_vec_new(size_t initial_capacity, ptr_dtor_fn ele_dtor_fn) {
+  GapVec res = {NULL, initial_capacity, 0, initial_capacity, ele_dtor_fn};
+  if (initial_capacity > 0) {
+    res.data = (ptr_t*)malloc(initial_capacity * sizeof(ptr_t));
+    if (res.data == NULL) {
+      panic("malloc failed");
+    }
+  }
+  return res;
+}
+
+// the slot in data of element `index`
+static inline size_t gap_vec_slot(const GapVec* self, size_t index) {
+  return index < self->gap_start ? index
+                                 : index + (self->gap_end - self->gap_start);
+}
+
+static void gap_vec_destroy_ele(GapVec* self, ptr_t ele) {
+  if (ele != NULL && self->ele_dtor_fn != NULL) {
+    self->ele_dtor_fn(ele);
+  }
+}
+
+// doubles the buffer, the gap takes all of the new space
+static void gap_vec_grow(GapVec* self) {
+  size_t new_capacity = self->capacity == 0 ? 1 : self->capacity * 2;
+  ptr_t* data = (ptr_t*)realloc(self->data, new_capacity * sizeof(ptr_t));
+  if (data == NULL) {
+    panic("realloc failed");
+  }
+  size_t after = self->capacity - self->gap_end;
+  memmove(&data[new_capacity - after], &data[self->gap_end],
+          after * sizeof(ptr_t));
+  self->data = data;
+  self->gap_end = new_capacity - after;
+  self->capacity = new_capacity;
+}
+
+ptr_t gap_vec_get(GapVec* self, size_t index) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  if (index >= gap_vec_len(self)) {
+    panic("index out of bound");
+  }
+  return self->data[gap_vec_slot(self, index)];
+}
+
+void gap_vec_set(GapVec* self, size_t index, ptr_t new_ele) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  if (index >= gap_vec_len(self)) {
+    panic("index out of bound");
+  }
+  size_t slot = gap_vec_slot(self, index);
+  ptr_t old = self->data[slot];
+  self->data[slot] = new_ele;
+  gap_vec_destroy_ele(self, old);
+}
+
+void gap_vec_move_to(GapVec* self, size_t index) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  if (index > gap_vec_len(self)) {
+    panic("index out of bound");
+  }
+  size_t gap = self->gap_end - self->gap_start;
+  if (index < self->gap_start) {
+    // the elements in [index, gap_start) move to the end of the gap
+    size_t moved = self->gap_start - index;
+    memmove(&self->data[self->gap_end - moved], &self->data[index],
+            moved * sizeof(ptr_t));
+  } else if (index > self->gap_start) {
+    // the ones after the gap up to the index move to its start
+    size_t moved = index - self->gap_start;
+    memmove(&self->data[self->gap_start], &self->data[self->gap_end],
+            moved * sizeof(ptr_t));
+  }
+  self->gap_start = index;
+  self->gap_end = index + gap;
+}
+
+void gap_vec_insert(GapVec* self, size_t index, ptr_t new_ele) {
+  gap_vec_move_to(self, index);
+  if (self->gap_start == self->gap_end) {
+    gap_vec_grow(self);
+  }
+  self->data[self->gap_start++] = new_ele;
+}
+
+void gap_vec_erase(GapVec* self, size_t index) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  if (index >= gap_vec_len(self)) {
+    panic("index out of bound");
+  }
+  gap_vec_move_to(self, index);
+  ptr_t old = self->data[self->gap_end++];
+  gap_vec_destroy_ele(self, old);
+}
+
+void gap_vec_push_back(GapVec* self, ptr_t new_ele) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  gap_vec_insert(self, gap_vec_len(self), new_ele);
+}
+
+bool gap_vec_pop_back(GapVec* self) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  size_t length = gap_vec_len(self);
+  if (length == 0) {
+    return false;
+  }
+  gap_vec_erase(self, length - 1);
+  return true;
+}
+
+void gap_vec_clear(GapVec* self) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  for (size_t i = 0; i < self->gap_start; i++) {
+    gap_vec_destroy_ele(self, self->data[i]);
+  }
+  for (size_t i = self->gap_end; i < self->capacity; i++) {
+    gap_vec_destroy_ele(self, self->data[i]);
+  }
+  self->gap_start = 0;
+  self->gap_end = self->capacity;
+}
+
+void gap_vec_destroy(GapVec* self) {
+  gap_vec_clear(self);
+  free(self->data);
+  self->data = NULL;
+  self->capacity = 0;
+  self->gap_start = 0;
+  self->gap_end = 0;
+}
+
+Vec gap_vec_to_vec(GapVec* self) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  size_t length = gap_vec_len(self);
+  Vec res = vec_new(length, NULL);
+  size_t after = self->capacity - self->gap_end;
+  if (self->gap_start > 0) {
+    memcpy(res.data, self->data, self->gap_start * sizeof(ptr_t));
+  }
+  if (after > 0) {
+    memcpy(&res.data[self->gap_start], &self->data[self->gap_end],
+           after * sizeof(ptr_t));
+  }
+  res.length = length;
+  return res;
+}
@@ -0,0 +1,139 @@
+#ifndef GAP_VEC_H_
+#define GAP_VEC_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "./Vec.h"
+
+/*!
+ * A gap buffer: a vector whose free space sits at the last place it was
+ * edited instead of at the end.
+ *
+ *   [ a b c d | . . . . . . | e f g ]
+ *             ^gap_start    ^gap_end
+ *
+ * vec_insert() shifts every element after the index, so typing into the
+ * middle of a 10M element buffer moves 80MB per keystroke. A GapVec moves
+ * the gap to the index first, with one memmove of the elements between the
+ * old and the new position, and then inserts by filling the gap. Edits near
+ * each other, like a cursor moving through text, only move a few elements.
+ *
+ * Indexing skips over the gap, so gap_vec_get is one compare more than
+ * vec_get. When the gap is used up the buffer doubles, and the elements
+ * after the gap move to the end of the new buffer.
+ *
+ * The functions mirror those of Vec.h. Elements are owned the same way:
+ * removed elements are cleaned up with the destructor from gap_vec_new().
+ */
+
+typedef struct gap_vec_st {
+  ptr_t* data;
+  size_t capacity;
+  size_t gap_start;  // the index of the cursor, where the gap begins
+  size_t gap_end;    // one past the end of the gap in data
+  ptr_dtor_fn ele_dtor_fn;
+} GapVec;
+
+/*!
+ * Creates a new empty GapVec.
+ *
+ * @param initial_capacity the initial capacity, which is also the first gap.
+ * @param ele_dtor_fn      the function used to clean up removed elements,
+ *                         or NULL if there is nothing to clean up.
+ * @returns a newly created gap buffer.
+ * @post if memory allocation fails, the function will panic.
+ */
+GapVec gap_vec_new(size_t initial_capacity, ptr_dtor_fn ele_dtor_fn);
+
+/* Returns the number of elements in the GapVec */
+#define gap_vec_len(self) \
+  ((self)->capacity - ((self)->gap_end - (self)->gap_start))
+
+/* Returns the index the gap is at */
+#define gap_vec_cursor(self) ((self)->gap_start)
+
+/* Gets the specified element.
+ *
+ * @param self  a pointer to the gap buffer.
+ * @param index the index of the element to get.
+ * @returns the element at the specified index.
+ * @pre If the index is >= the length then this function will panic()
+ */
+ptr_t gap_vec_get(GapVec* self, size_t index);
+
+/* Sets the specified element, cleaning up the old one.
+ *
+ * @param self    a pointer to the gap buffer.
+ * @param index   the index of the element to set.
+ * @param new_ele the new value of the element.
+ * @pre If the index is >= the length then this function will panic()
+ */
+void gap_vec_set(GapVec* self, size_t index, ptr_t new_ele);
+
+/* Moves the gap to an index, shifting the elements in between.
+ *
+ * @param self  a pointer to the gap buffer.
+ * @param index the new cursor, at most the length.
+ * @pre If the index is > the length then this function will panic()
+ */
+void gap_vec_move_to(GapVec* self, size_t index);
+
+/* Inserts an element at an index, moving the gap there first. Elements at
+ * the index and after it are shifted up one position, and the cursor ends
+ * up after the new element.
+ *
+ * @param self    a pointer to the gap buffer.
+ * @param index   the index to insert at, at most the length.
+ * @param new_ele the value we want to insert.
+ * @pre If the index is > the length then this function will panic()
+ * @post if memory allocation fails, the function will panic.
+ */
+void gap_vec_insert(GapVec* self, size_t index, ptr_t new_ele);
+
+/* Erases the element at an index, moving the gap there first.
+ *
+ * @param self  a pointer to the gap buffer.
+ * @param index the index of the element to erase.
+ * @pre If the index is >= the length then this function will panic()
+ */
+void gap_vec_erase(GapVec* self, size_t index);
+
+/* Appends an element, moving the gap to the end.
+ *
+ * @param self    a pointer to the gap buffer.
+ * @param new_ele the value we want to add to the end.
+ * @post if memory allocation fails, the function will panic.
+ */
+void gap_vec_push_back(GapVec* self, ptr_t new_ele);
+
+/* Removes and destroys the last element.
+ *
+ * @param self a pointer to the gap buffer.
+ * @returns true iff an element was removed.
+ */
+bool gap_vec_pop_back(GapVec* self);
+
+/* Erases all elements, keeping the capacity.
+ *
+ * @param self a pointer to the gap buffer.
+ * @post The removed elements are destructed (cleaned up).
+ */
+void gap_vec_clear(GapVec* self);
+
+/* Destructs the gap buffer and frees its storage.
+ *
+ * @param self a pointer to the gap buffer.
+ * @post The removed elements are destructed (cleaned up).
+ */
+void gap_vec_destroy(GapVec* self);
+
+/*!
+ * Copies the elements, in order and without the gap, into a new Vec with
+ * no destructor.
+ *
+ * @param self the gap buffer to copy.
+ * @returns a newly created vector.
+ */
+Vec gap_vec_to_vec(GapVec* self);
+
+#endif  // GAP_VEC_H_
@@ -0,0 +1,473 @@
+#include "./hashmap.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "./panic.h"
+#include "./simd.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define HASHMAP_X86 1
+#endif
+
+// entries are stored right after the header, keep them max aligned
+static_assert(sizeof(hashmap_info) % _Alignof(max_align_t) == 0,
+              "hashmap_info must keep the entries aligned");
+
+// ===========================================================
+// Control bytes
+//
+// A full slot stores the low 7 bits of the hash of its key (H2), so the
+// high bit tells apart full slots from EMPTY and DELETED ones. The first
+// GROUP_WIDTH control bytes are mirrored after the last slot, so a group
+// can be loaded from any slot without wrapping around.
+// ===========================================================
+#define GROUP_WIDTH 16
+#define CTRL_EMPTY ((uint8_t)0x80)
+#define CTRL_DELETED ((uint8_t)0xFE)
+#define MAX_ENTRIES UINT32_MAX
+
+static inline uint8_t h2_of(uint64_t hash) {
+  return (uint8_t)(hash & 0x7F);
+}
+
+static inline size_t h1_of(uint64_t hash) {
+  return (size_t)(hash >> 7);
+}
+
+static inline size_t num_slots(const hashmap_info* info) {
+  return info->mask + 1;
+}
+
+// the largest number of entries that a table with `slots` slots takes
+// before it has to grow, keeping the load factor at most 7/8
+static inline size_t capacity_for(size_t slots) {
+  return slots - slots / 8;
+}
+
+static inline void set_ctrl(hashmap_info* info, size_t slot, uint8_t value) {
+  info->ctrl[slot] = value;
+  info->ctrl[((slot - GROUP_WIDTH) & info->mask) + GROUP_WIDTH] = value;
+}
+
+static inline uint8_t* entry_at(hashmap_info* info, size_t pos) {
+  return (uint8_t*)(info + 1) + pos * info->entry_size;
+}
+
+static inline hashmap_info* header_of(const void* entries) {
+  return ((hashmap_info*)entries) - 1;
+}
+
+// ===========================================================
+// Hashing and key comparison, both on the raw key bytes
+// ===========================================================
+
+// the splitmix64 finalizer, every input bit affects every output bit
+static inline uint64_t mix(uint64_t x) {
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+static inline uint64_t hash_key(const void* key, size_t size) {
+  const uint8_t* bytes = (const uint8_t*)key;
+  uint64_t hash = 0x9E3779B97F4A7C15ULL ^ size;
+  // integer and pointer keys take a single round
+  if (size == sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, bytes, sizeof(word));
+    return mix(hash ^ word);
+  }
+  while (size >= sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, bytes, sizeof(word));
+    hash = mix(hash ^ word);
+    bytes += sizeof(word);
+    size -= sizeof(word);
+  }
+  if (size > 0) {
+    uint64_t word = 0;
+    memcpy(&word, bytes, size);
+    hash = mix(hash ^ word);
+  }
+  return hash;
+}
+
+static inline bool keys_equal(const void* a, const void* b, size_t size) {
+  // the common key sizes get a single compare instead of a memcmp call
+  switch (size) {
+    case sizeof(uint32_t): {
+      uint32_t x;
+      uint32_t y;
+      memcpy(&x, a, sizeof(x));
+      memcpy(&y, b, sizeof(y));
+      return x == y;
+    }
+    case sizeof(uint64_t): {
+      uint64_t x;
+      uint64_t y;
+      memcpy(&x, a, sizeof(x));
+      memcpy(&y, b, sizeof(y));
+      return x == y;
+    }
+    default:
+      return memcmp(a, b, size) == 0;
+  }
+}
+
+// ===========================================================
+// Group matching. Each function returns a bit mask with bit i set
+// if control byte i of the group starting at `ctrl` matches.
+// ===========================================================
+static inline uint32_t match_h2_scalar(const uint8_t* ctrl, uint8_t h2) {
+  uint32_t bits = 0;
+  for (int i = 0; i < GROUP_WIDTH; i++) {
+    bits |= (uint32_t)(ctrl[i] == h2) << i;
+  }
+  return bits;
+}
+
+static inline uint32_t match_empty_scalar(const uint8_t* ctrl) {
+  return match_h2_scalar(ctrl, CTRL_EMPTY);
+}
+
+// EMPTY and DELETED are the only control bytes with the high bit set
+static inline uint32_t match_free_scalar(const uint8_t* ctrl) {
+  uint32_t bits = 0;
+  for (int i = 0; i < GROUP_WIDTH; i++) {
+    bits |= (uint32_t)(ctrl[i] >> 7) << i;
+  }
+  return bits;
+}
+
+#ifdef HASHMAP_X86
+__attribute__((target("sse2"))) static inline uint32_t match_h2_sse2(
+    const uint8_t* ctrl,
+    uint8_t h2) {
+  __m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+  __m128i eq = _mm_cmpeq_epi8(group, _mm_set1_epi8((char)h2));
+  return (uint32_t)_mm_movemask_epi8(eq);
+}
+
+__attribute__((target("sse2"))) static inline uint32_t match_empty_sse2(
+    const uint8_t* ctrl) {
+  return match_h2_sse2(ctrl, CTRL_EMPTY);
+}
+
+__attribute__((target("sse2"))) static inline uint32_t match_free_sse2(
+    const uint8_t* ctrl) {
+  __m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+  return (uint32_t)_mm_movemask_epi8(group);
+}
+#endif  // HASHMAP_X86
+
+// ===========================================================
+// Probing
+//
+// The probe sequence visits groups at triangular offsets from the
+// home slot h1 & mask, which reaches every group of a power of two
+// sized table. A key is absent once a group with an EMPTY slot is
+// seen, and the load factor guarantees that such a group exists.
+//
+// find_slot returns the slot holding the key, or HASHMAP_NPOS.
+// find_free returns the first EMPTY or DELETED slot for the hash.
+// ===========================================================
+#define DEFINE_PROBES(SFX, TARGET)                                          \
+  TARGET static size_t find_slot_##SFX(hashmap_info* info, const void* key, \
+                                       uint64_t hash) {                     \
+    size_t pos = h1_of(hash) & info->mask;                                  \
+    uint8_t h2 = h2_of(hash);                                               \
+    for (size_t stride = GROUP_WIDTH;; stride += GROUP_WIDTH) {             \
+      const uint8_t* group = info->ctrl + pos;                              \
+      for (uint32_t bits = match_h2_##SFX(group, h2); bits != 0;            \
+           bits &= bits - 1) {                                              \
+        size_t slot = (pos + (size_t)__builtin_ctz(bits)) & info->mask;     \
+        if (keys_equal(entry_at(info, info->slots[slot]), key,              \
+                       info->key_size)) {                                   \
+          return slot;                                                      \
+        }                                                                   \
+      }                                                                     \
+      if (match_empty_##SFX(group) != 0) {                                  \
+        return HASHMAP_NPOS;                                                \
+      }                                                                     \
+      pos = (pos + stride) & info->mask;                                    \
+    }                                                                       \
+  }                                                                         \
+                                                                            \
+  TARGET static size_t find_free_##SFX(hashmap_info* info, uint64_t hash) { \
+    size_t pos = h1_of(hash) & info->mask;                                  \
+    for (size_t stride = GROUP_WIDTH;; stride += GROUP_WIDTH) {             \
+      uint32_t bits = match_free_##SFX(info->ctrl + pos);                   \
+      if (bits != 0) {                                                      \
+        return (pos + (size_t)__builtin_ctz(bits)) & info->mask;            \
+      }                                                                     \
+      pos = (pos + stride) & info->mask;                                    \
+    }                                                                       \
+  }                                                                         \
+                                                                            \
+  TARGET static uint32_t match_empty_at_##SFX(hashmap_info* info,           \
+                                              size_t slot) {                \
+    return match_empty_##SFX(info->ctrl + slot);                            \
+  }
+
+DEFINE_PROBES(scalar, )
+#ifdef HASHMAP_X86
+DEFINE_PROBES(sse2, __attribute__((target("sse2"))))
+#endif
+
+#undef DEFINE_PROBES
+
+typedef struct probe_kernels_st {
+  size_t (*find_slot)(hashmap_info*, const void*, uint64_t);
+  size_t (*find_free)(hashmap_info*, uint64_t);
+  uint32_t (*match_empty_at)(hashmap_info*, size_t);
+} probe_kernels;
+
+#define SCALAR_PROBES \
+  {find_slot_scalar, find_free_scalar, match_empty_at_scalar}
+#define SSE2_PROBES {find_slot_sse2, find_free_sse2, match_empty_at_sse2}
+
+// groups are 16 control bytes wide by design, so the wider instruction
+// sets have nothing to add over SSE2
+#ifdef HASHMAP_X86
+static const probe_kernels kKernels[SIMD_LEVEL_COUNT] = {
+    [SIMD_SCALAR] = SCALAR_PROBES, [SIMD_SSE2] = SSE2_PROBES,
+    [SIMD_SSE42] = SSE2_PROBES,    [SIMD_AVX2] = SSE2_PROBES,
+    [SIMD_AVX512] = SSE2_PROBES,
+};
+#else
+static const probe_kernels kKernels[SIMD_LEVEL_COUNT] = {
+    [SIMD_SCALAR] = SCALAR_PROBES, [SIMD_SSE2] = SCALAR_PROBES,
+    [SIMD_SSE42] = SCALAR_PROBES,  [SIMD_AVX2] = SCALAR_PROBES,
+    [SIMD_AVX512] = SCALAR_PROBES,
+};
+#endif
+
+#undef SCALAR_PROBES
+#undef SSE2_PROBES
+
+static inline const probe_kernels* kernels(void) {
+  return &kKernels[simd_get_level()];
+}
+
+// ===========================================================
+// Table management
+// ===========================================================
+
+// allocates an all EMPTY index of `slots` slots into info
+static void alloc_index(hashmap_info* info, size_t slots) {
+  // the slot table follows the control bytes, rounded up to keep it aligned
+  size_t ctrl_bytes = (slots + GROUP_WIDTH + sizeof(uint32_t) - 1) &
+                      ~(sizeof(uint32_t) - 1);
+  uint8_t* block = (uint8_t*)malloc(ctrl_bytes + slots * sizeof(uint32_t));
+  if (block == NULL) {
+    panic("malloc failed in hashmap\n");
+  }
+  memset(block, CTRL_EMPTY, slots + GROUP_WIDTH);
+  info->ctrl = block;
+  info->slots = (uint32_t*)(block + ctrl_bytes);
+  info->mask = slots - 1;
+  info->growth_left = capacity_for(slots) - info->len;
+}
+
+static size_t slots_for(size_t capacity) {
+  size_t slots = GROUP_WIDTH;
+  while (capacity_for(slots) < capacity) {
+    slots *= 2;
+  }
+  return slots;
+}
+
+// rebuilds the index with `slots` slots, moving the entries to a bigger
+// allocation if the capacity grows. Returns the (possibly moved) header.
+static hashmap_info* rehash(hashmap_info* info, size_t slots) {
+  size_t capacity = capacity_for(slots);
+  if (capacity > MAX_ENTRIES) {
+    panic("too many entries in hashmap\n");
+  }
+  if (capacity > info->capacity) {
+    hashmap_info* moved = (hashmap_info*)realloc(
+        info, sizeof(hashmap_info) + capacity * info->entry_size);
+    if (moved == NULL) {
+      panic("realloc failed in hashmap\n");
+    }
+    info = moved;
+    info->capacity = capacity;
+  }
+
+  free(info->ctrl);
+  alloc_index(info, slots);
+  const probe_kernels* probes = kernels();
+  for (size_t pos = 0; pos < info->len; pos++) {
+    uint64_t hash = hash_key(entry_at(info, pos), info->key_size);
+    size_t slot = probes->find_free(info, hash);
+    set_ctrl(info, slot, h2_of(hash));
+    info->slots[slot] = (uint32_t)pos;
+  }
+  return info;
+}
+
+static void destroy_values(hashmap_info* info) {
+  if (info->value_dtor == NULL) {
+    return;
+  }
+  for (size_t pos = 0; pos < info->len; pos++) {
+    info->value_dtor(entry_at(info, pos) + info->value_offset);
+  }
+}
+
+// ===========================================================
+// Public functions
+// ===========================================================
+void* hm_new(size_t capacity,
+             size_t key_size,
+             size_t value_offset,
+             size_t entry_size,
+             destroy_fn value_dtor) {
+  size_t slots = slots_for(capacity);
+  capacity = capacity_for(slots);
+  if (capacity > MAX_ENTRIES) {
+    panic("too many entries in hashmap\n");
+  }
+  hashmap_info* info =
+      (hashmap_info*)malloc(sizeof(hashmap_info) + capacity * entry_size);
+  if (info == NULL) {
+    panic("malloc failed in hashmap\n");
+  }
+  info->key_size = key_size;
+  info->value_offset = value_offset;
+  info->entry_size = entry_size;
+  info->len = 0;
+  info->capacity = capacity;
+  info->value_dtor = value_dtor;
+  alloc_index(info, slots);
+  return info + 1;
+}
+
+size_t hm_find(const void* entries, const void* key) {
+  if (entries == NULL) {
+    return HASHMAP_NPOS;
+  }
+  hashmap_info* info = header_of(entries);
+  size_t slot =
+      kernels()->find_slot(info, key, hash_key(key, info->key_size));
+  return slot == HASHMAP_NPOS ? HASHMAP_NPOS : info->slots[slot];
+}
+
+size_t hm_insert(void** entries, const void* key, bool* inserted) {
+  if (entries == NULL || *entries == NULL) {
+    panic("NULL arg to hm_insert\n");
+  }
+  hashmap_info* info = header_of(*entries);
+  const probe_kernels* probes = kernels();
+  uint64_t hash = hash_key(key, info->key_size);
+
+  size_t slot = probes->find_slot(info, key, hash);
+  if (slot != HASHMAP_NPOS) {
+    *inserted = false;
+    return info->slots[slot];
+  }
+
+  slot = probes->find_free(info, hash);
+  if (info->growth_left == 0 && info->ctrl[slot] == CTRL_EMPTY) {
+    // out of EMPTY slots. If most of them were used up by DELETED ones,
+    // rebuilding the index at the same size is enough.
+    size_t slots = num_slots(info);
+    if (info->len >= info->capacity / 2) {
+      slots *= 2;
+    }
+    info = rehash(info, slots);
+    *entries = info + 1;
+    slot = probes->find_free(info, hash);
+  }
+
+  if (info->ctrl[slot] == CTRL_EMPTY) {
+    info->growth_left--;
+  }
+  size_t pos = info->len++;
+  set_ctrl(info, slot, h2_of(hash));
+  info->slots[slot] = (uint32_t)pos;
+  memcpy(entry_at(info, pos), key, info->key_size);
+  *inserted = true;
+  return pos;
+}
+
+bool hm_remove(void* entries, const void* key) {
+  if (entries == NULL) {
+    return false;
+  }
+  hashmap_info* info = header_of(entries);
+  const probe_kernels* probes = kernels();
+  size_t slot = probes->find_slot(info, key, hash_key(key, info->key_size));
+  if (slot == HASHMAP_NPOS) {
+    return false;
+  }
+
+  size_t pos = info->slots[slot];
+  uint8_t* entry = entry_at(info, pos);
+  if (info->value_dtor != NULL) {
+    info->value_dtor(entry + info->value_offset);
+  }
+
+  // If no group containing the slot was ever full, no probe sequence
+  // went past it, so it can go back to EMPTY instead of DELETED.
+  size_t before = (slot - GROUP_WIDTH) & info->mask;
+  uint32_t empty_after = probes->match_empty_at(info, slot);
+  uint32_t empty_before = probes->match_empty_at(info, before);
+  bool never_full = empty_before != 0 && empty_after != 0 &&
+                    (size_t)__builtin_ctz(empty_after) +
+                            (size_t)(__builtin_clz(empty_before) - 16) <
+                        GROUP_WIDTH;
+  set_ctrl(info, slot, never_full ? CTRL_EMPTY : CTRL_DELETED);
+  info->growth_left += never_full;
+
+  // keep the entries dense by moving the last one into the hole
+  size_t last = info->len - 1;
+  if (pos != last) {
+    uint8_t* moved = entry_at(info, last);
+    size_t moved_slot = probes->find_slot(
+        info, moved, hash_key(moved, info->key_size));
+    info->slots[moved_slot] = (uint32_t)pos;
+    memcpy(entry, moved, info->entry_size);
+  }
+  info->len--;
+  return true;
+}
+
+void hm_reserve(void** entries, size_t n) {
+  if (entries == NULL || *entries == NULL) {
+    panic("NULL arg to hm_reserve\n");
+  }
+  hashmap_info* info = header_of(*entries);
+  if (n <= info->capacity) {
+    return;
+  }
+  info = rehash(info, slots_for(n));
+  *entries = info + 1;
+}
+
+void hm_clear(void* entries) {
+  if (entries == NULL) {
+    return;
+  }
+  hashmap_info* info = header_of(entries);
+  destroy_values(info);
+  info->len = 0;
+  memset(info->ctrl, CTRL_EMPTY, num_slots(info) + GROUP_WIDTH);
+  info->growth_left = capacity_for(num_slots(info));
+}
+
+void hm_free(void** entries) {
+  if (entries == NULL) {
+    panic("NULL arg to hm_free\n");
+  }
+  if (*entries == NULL) {
+    return;
+  }
+  hashmap_info* info = header_of(*entries);
+  destroy_values(info);
+  free(info->ctrl);
+  free(info);
+  *entries = NULL;
+}
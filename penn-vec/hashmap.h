@@ -0,0 +1,304 @@
+#ifndef HASHMAP_H_
+#define HASHMAP_H_
+
+/*!
+ * A typed hash map built with the same trick as vector.h.
+ *
+ * A hashmap(K, V) is a pointer to a heap allocated array of entries, each
+ * entry being a struct with a `key` and a `value` field. The entries are
+ * kept dense, in insertion order (until something is removed), so they can
+ * be iterated and indexed directly with square brackets. A null pointer is
+ * treated as an empty map.
+ *
+ * The metadata lives in a hashmap_info_st stored right before the entries,
+ * just like vector_info. It also points to a separate index: an open
+ * addressing Swiss table that maps each key to the position of its entry.
+ * For every slot the index keeps a one byte "control" value, either
+ * EMPTY, DELETED, or 7 bits of the hash of the key stored there. A lookup
+ * compares the control bytes of 16 slots at once (with SSE2 when
+ * available, see simd.h) and only looks at the entries whose 7 bits match,
+ * so there is no pointer chasing like in a chained hash table.
+ *
+ * If we did something like:
+ *
+ * hashmap(int, double) map = NULL;
+ * hashmap_put(&map, 7, 0.5);
+ * hashmap_put(&map, 3, 1.5);
+ *
+ * We would get the following stored in memory:
+ *
+ *             +---+
+ *         map | | |
+ *             +-+-+
+ *               |
+ *               V    // pointer to heap
+ * +------------+---------+---------+---+
+ * | len = 2    | key = 7 | key = 3 |   |
+ * | cap = 14   | val=0.5 | val=1.5 | ? | ...
+ * | index ---+ |         |         |   |
+ * +----------|-+---------+---------+---+
+ *            V
+ *   +-----------------------------+
+ *   | control bytes, 16 per group |  (slot -> entry position)
+ *   +-----------------------------+
+ *
+ * int main() {
+ *   hashmap(int, double) map = NULL;
+ *   hashmap_put(&map, 7, 0.5);
+ *
+ *   if (hashmap_contains(&map, 7)) {
+ *     printf("%f\n", hashmap_get(&map, 7));
+ *   }
+ *   for (size_t i = 0; i < hashmap_len(&map); i++) {
+ *     printf("%d -> %f\n", map[i].key, map[i].value);
+ *   }
+ *   hashmap_free(&map);
+ * }
+ *
+ * Keys are hashed and compared by their bytes, so K should be a type
+ * without padding, like an integer or a pointer. A char* key is compared
+ * by address, not by the string it points to.
+ *
+ * Every spelling of hashmap(K, V) is a new struct type, so use a typedef
+ * when a map has to be passed around:
+ *
+ * typedef hashmap(int, double) int_to_double;
+ *
+ * Values are cleaned up with a destroy_fn, following the same conventions
+ * as vector.h: it is passed a pointer to the value when the value is
+ * replaced, removed or the map is freed. Keys are never destroyed.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>  // offsetof
+#include <stdint.h>
+#include "./panic.h"
+#include "./vector.h"  // destroy_fn
+
+typedef struct hashmap_info_st {
+  uint8_t* ctrl;       // control bytes, mirrored for the first group
+  uint32_t* slots;     // entry position of each full slot
+  size_t mask;         // number of slots - 1
+  size_t growth_left;  // insertions into EMPTY slots before a rehash
+  size_t key_size;
+  size_t value_offset;
+  size_t entry_size;
+  size_t len;
+  size_t capacity;  // entries that fit before the map grows
+  destroy_fn value_dtor;
+} hashmap_info;
+
+#define HASHMAP_NPOS ((size_t)-1)
+
+#define hashmap(K, V) \
+  struct {            \
+    K key;            \
+    V value;          \
+  }*
+
+// Synopsis:
+//   void* hm_new(size_t capacity, size_t key_size, size_t value_offset,
+//                size_t entry_size, destroy_fn value_dtor);
+//   size_t hm_find(const void* entries, const void* key);
+//   size_t hm_insert(void** entries, const void* key, bool* inserted);
+//   bool hm_remove(void* entries, const void* key);
+//   void hm_reserve(void** entries, size_t n);
+//   void hm_clear(void* entries);
+//   void hm_free(void** entries);
+//
+// The untyped implementation behind the hashmap_ macros, working on the
+// pointer to the entries. Use the macros instead.
+//
+// hm_insert returns the position of the entry with the given key, adding
+// an entry with that key (and an uninitialized value) if there was none.
+void* hm_new(size_t capacity,
+             size_t key_size,
+             size_t value_offset,
+             size_t entry_size,
+             destroy_fn value_dtor);
+size_t hm_find(const void* entries, const void* key);
+size_t hm_insert(void** entries, const void* key, bool* inserted);
+bool hm_remove(void* entries, const void* key);
+void hm_reserve(void** entries, size_t n);
+void hm_clear(void* entries);
+void hm_free(void** entries);
+
+// Synopsis:
+//  hashmap_info* get_hashmap_header(hashmap(K, V)* map);
+//
+// Given a pointer to a map, returns a pointer to that map's metadata,
+// or NULL if the map is empty and was never allocated.
+#define get_hashmap_header(map)                                      \
+  ({                                                                 \
+    typeof(map) __impl_ghh_map = (map);                              \
+    if (__impl_ghh_map == NULL) {                                    \
+      panic("NULL arg to get_hashmap_header\n");                     \
+    }                                                                \
+    *__impl_ghh_map ? ((hashmap_info*)(*__impl_ghh_map)) - 1 : NULL; \
+  })
+
+// Synopsis:
+//   void hashmap_init(hashmap(K, V)* self, size_t init_capacity,
+//                     destroy_fn value_destroy_fn);
+//
+// Description:
+// Allocates a new empty map into *self, with room for init_capacity
+// entries before a rehash and the given value destructor (can be NULL).
+// A map that is never initialized (NULL) also works, it has no destructor.
+// *self must be NULL or a map that has already been freed.
+//
+// example:
+// hashmap(int, char*) map;
+// hashmap_init(&map, 100, free_string);
+#define hashmap_init(self, init_capacity, dtor)          \
+  ({                                                     \
+    typeof(self) __impl_hi_self = (self);                \
+    *__impl_hi_self = (typeof(*__impl_hi_self))hm_new(   \
+        (init_capacity), sizeof((*__impl_hi_self)->key), \
+        offsetof(typeof(**__impl_hi_self), value),       \
+        sizeof(**__impl_hi_self), (destroy_fn)(dtor));   \
+    ((void)0);                                           \
+  })
+
+// Synopsis:
+//   size_t hashmap_len(hashmap(K, V)* self);
+//   size_t hashmap_capacity(hashmap(K, V)* self);
+//
+// Returns the number of entries in the map, and the number of entries
+// that fit before the map has to grow.
+#define hashmap_len(self)                                     \
+  ({                                                          \
+    hashmap_info* __impl_hl_info = get_hashmap_header(self);  \
+    __impl_hl_info == NULL ? (size_t)0 : __impl_hl_info->len; \
+  })
+
+#define hashmap_capacity(self)                                     \
+  ({                                                               \
+    hashmap_info* __impl_hc_info = get_hashmap_header(self);       \
+    __impl_hc_info == NULL ? (size_t)0 : __impl_hc_info->capacity; \
+  })
+
+// Synopsis:
+//   size_t hashmap_find(hashmap(K, V)* self, K key);
+//
+// Description:
+// Returns the position of the entry with the given key, so that
+// (*self)[pos].key == key, or HASHMAP_NPOS if the key is not in the map.
+// Positions stay valid until the next put or remove.
+//
+// example:
+// size_t pos = hashmap_find(&map, 7);
+// if (pos != HASHMAP_NPOS) {
+//   map[pos].value += 1.0;
+// }
+#define hashmap_find(self, ...)                                   \
+  ({                                                              \
+    typeof(self) __impl_hf_self = (self);                         \
+    typeof((*__impl_hf_self)->key) __impl_hf_key = (__VA_ARGS__); \
+    hm_find(*__impl_hf_self, &__impl_hf_key);                     \
+  })
+
+// Synopsis:
+//   bool hashmap_contains(hashmap(K, V)* self, K key);
+//
+// Returns true iff the key is in the map.
+#define hashmap_contains(self, ...) \
+  (hashmap_find(self, __VA_ARGS__) != HASHMAP_NPOS)
+
+// Synopsis:
+//   V hashmap_get(hashmap(K, V)* self, K key);
+//
+// Description:
+// Returns the value stored for the key.
+// panic()'s if the key is not in the map.
+#define hashmap_get(self, ...)                                        \
+  ({                                                                  \
+    typeof(self) __impl_hg_self = (self);                             \
+    size_t __impl_hg_pos = hashmap_find(__impl_hg_self, __VA_ARGS__); \
+    if (__impl_hg_pos == HASHMAP_NPOS) {                              \
+      panic("key not found in hashmap_get\n");                        \
+    }                                                                 \
+    (*__impl_hg_self)[__impl_hg_pos].value;                           \
+  })
+
+// Synopsis:
+//   bool hashmap_put(hashmap(K, V)* self, K key, V value);
+//
+// Description:
+// Sets the value of the key, adding an entry at the end of the map if the
+// key was not in it. If the key was already present, its old value is
+// destroyed with the value destructor first.
+// If the map has to grow the entries are reallocated, so pointers to them
+// are invalidated. panic()'s if allocation fails.
+//
+// returns:
+// - true iff a new entry was added
+//
+// example:
+// hashmap(int, double) map = NULL;
+// hashmap_put(&map, 7, 0.5);
+#define hashmap_put(self, new_key, new_value)                              \
+  ({                                                                       \
+    typeof(self) __impl_hp_self = (self);                                  \
+    typeof((*__impl_hp_self)->key) __impl_hp_key = (new_key);              \
+    if (*__impl_hp_self == NULL) {                                         \
+      hashmap_init(__impl_hp_self, 0, NULL);                               \
+    }                                                                      \
+    bool __impl_hp_new = false;                                            \
+    size_t __impl_hp_pos =                                                 \
+        hm_insert((void**)__impl_hp_self, &__impl_hp_key, &__impl_hp_new); \
+    hashmap_info* __impl_hp_info = get_hashmap_header(__impl_hp_self);     \
+    if (!__impl_hp_new && __impl_hp_info->value_dtor != NULL) {            \
+      __impl_hp_info->value_dtor(&(*__impl_hp_self)[__impl_hp_pos].value); \
+    }                                                                      \
+    (*__impl_hp_self)[__impl_hp_pos].value = (new_value);                  \
+    __impl_hp_new;                                                         \
+  })
+
+// Synopsis:
+//   bool hashmap_remove(hashmap(K, V)* self, K key);
+//
+// Description:
+// Removes the entry with the given key, destroying its value.
+// To keep the entries dense, the last entry is moved into the position
+// of the removed one.
+//
+// returns:
+// - true iff the key was in the map
+#define hashmap_remove(self, ...)                                   \
+  ({                                                                \
+    typeof(self) __impl_hrm_self = (self);                          \
+    typeof((*__impl_hrm_self)->key) __impl_hrm_key = (__VA_ARGS__); \
+    hm_remove(*__impl_hrm_self, &__impl_hrm_key);                   \
+  })
+
+// Synopsis:
+//   void hashmap_reserve(hashmap(K, V)* self, size_t n);
+//
+// Description:
+// Makes sure that n entries fit in the map without a rehash.
+// If n is <= the current capacity, nothing is done.
+#define hashmap_reserve(self, n)                       \
+  ({                                                   \
+    typeof(self) __impl_hr_self = (self);              \
+    size_t __impl_hr_n = (n);                          \
+    if (*__impl_hr_self == NULL) {                     \
+      hashmap_init(__impl_hr_self, __impl_hr_n, NULL); \
+    } else {                                           \
+      hm_reserve((void**)__impl_hr_self, __impl_hr_n); \
+    }                                                  \
+    ((void)0);                                         \
+  })
+
+// Synopsis:
+//   void hashmap_clear(hashmap(K, V)* self);
+//   void hashmap_free(hashmap(K, V)* self);
+//
+// Description:
+// hashmap_clear destroys every value and empties the map, keeping its
+// storage. hashmap_free destroys every value, frees the storage and sets
+// *self to NULL.
+#define hashmap_clear(self) hm_clear(*(self))
+#define hashmap_free(self) hm_free((void**)(self))
+
+#endif  // HASHMAP_H_
@@ -0,0 +1,326 @@
+#ifndef HEAP_H_
+#define HEAP_H_
+
+/*!
+ * Binary heap (priority queue) generators for vector(T).
+ *
+ * A heap is just a vector(T) whose elements are kept in heap order, so it
+ * has the same header-before-data layout, vector_len() and vector_free()
+ * work on it, and an existing vector can be turned into a heap in place.
+ *
+ * Since the ordering has to be known at compile time to be inlined, the
+ * heap operations are generated per element type and ordering:
+ *
+ * static bool int_less(int a, int b) { return a < b; }
+ * DECLARE_HEAP(min_heap, int, int_less)
+ *
+ * generates static inline functions min_heap_push(), min_heap_pop(),
+ * min_heap_top() and min_heap_heapify() that all take a vector(int)*.
+ * `less` can be a function or a function-like macro: less(a, b) must be
+ * true iff a has to come out of the heap before b. The element that comes
+ * out first is at index 0.
+ *
+ * vector(int) heap = NULL;
+ * min_heap_push(&heap, 3);
+ * min_heap_push(&heap, 1);
+ * int smallest;
+ * min_heap_pop(&heap, &smallest);  // smallest == 1
+ * vector_free(&heap);
+ *
+ * DECLARE_INDEXED_HEAP generates a variant that hands out a handle for
+ * every pushed element, so that its priority can later be changed (the
+ * "decrease key" of Dijkstra or Prim) or the element removed.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "./panic.h"
+#include "./vector.h"
+
+// Synopsis:
+//   DECLARE_HEAP(name, T, less)
+//
+//   void name_push(vector(T)* self, T element);
+//   T name_top(vector(T)* self);
+//   bool name_pop(vector(T)* self, T* out);
+//   void name_heapify(vector(T)* self);
+//
+// name_push adds an element in O(log n).
+// name_top returns the first element without removing it, panic()'s if
+//   the heap is empty.
+// name_pop removes the first element in O(log n). If out is not NULL the
+//   element is stored there and the caller owns it, otherwise it is
+//   destroyed with the vector's element destructor. Returns false if the
+//   heap was empty.
+// name_heapify puts the elements of any vector(T) in heap order in O(n).
+#define DECLARE_HEAP(name, T, less)                                        \
+  static inline void name##_sift_up(T* data, size_t index) {               \
+    T moving = data[index];                                                \
+    while (index > 0) {                                                    \
+      size_t parent = (index - 1) / 2;                                     \
+      if (!less(moving, data[parent])) {                                   \
+        break;                                                             \
+      }                                                                    \
+      data[index] = data[parent];                                          \
+      index = parent;                                                      \
+    }                                                                      \
+    data[index] = moving;                                                  \
+  }                                                                        \
+                                                                           \
+  static inline void name##_sift_down(T* data, size_t index, size_t len) { \
+    T moving = data[index];                                                \
+    for (;;) {                                                             \
+      size_t child = 2 * index + 1;                                        \
+      if (child >= len) {                                                  \
+        break;                                                             \
+      }                                                                    \
+      if (child + 1 < len && less(data[child + 1], data[child])) {         \
+        child++;                                                           \
+      }                                                                    \
+      if (!less(data[child], moving)) {                                    \
+        break;                                                             \
+      }                                                                    \
+      data[index] = data[child];                                           \
+      index = child;                                                       \
+    }                                                                      \
+    data[index] = moving;                                                  \
+  }                                                                        \
+                                                                           \
+  static inline void name##_push(vector(T) * self, T element) {            \
+    vector_push(self, element);                                            \
+    name##_sift_up(*self, vector_len(self) - 1);                           \
+  }                                                                        \
+                                                                           \
+  static inline T name##_top(vector(T) * self) {                           \
+    if (vector_len(self) == 0) {                                           \
+      panic("empty heap in " #name "_top\n");                              \
+    }                                                                      \
+    return (*self)[0];                                                     \
+  }                                                                        \
+                                                                           \
+  static inline bool name##_pop(vector(T) * self, T * out) {               \
+    size_t len = vector_len(self);                                         \
+    if (len == 0) {                                                        \
+      return false;                                                        \
+    }                                                                      \
+    vector_info* info = get_vector_header(self);                           \
+    if (out != NULL) {                                                     \
+      *out = (*self)[0];                                                   \
+    } else if (info->ele_dtor != NULL) {                                   \
+      info->ele_dtor(&(*self)[0]);                                         \
+    }                                                                      \
+    info->len = --len;                                                     \
+    if (len > 0) {                                                         \
+      (*self)[0] = (*self)[len];                                           \
+      name##_sift_down(*self, 0, len);                                     \
+    }                                                                      \
+    return true;                                                           \
+  }                                                                        \
+                                                                           \
+  static inline void name##_heapify(vector(T) * self) {                    \
+    size_t len = vector_len(self);                                         \
+    for (size_t i = len / 2; i-- > 0;) {                                   \
+      name##_sift_down(*self, i, len);                                     \
+    }                                                                      \
+  }
+
+// handle value of a popped or removed element in an indexed heap
+#define HEAP_NO_POS ((size_t)-1)
+
+// Synopsis:
+//   DECLARE_INDEXED_HEAP(name, T, less)
+//
+//   typedef struct { ... } name;
+//   name name_new(destroy_fn element_destroy_fn);
+//   size_t name_push(name* self, T element);
+//   T name_top(name* self);
+//   size_t name_top_handle(name* self);
+//   bool name_pop(name* self, T* out);
+//   bool name_contains(name* self, size_t handle);
+//   T name_get(name* self, size_t handle);
+//   void name_update(name* self, size_t handle, T element);
+//   void name_remove(name* self, size_t handle);
+//   size_t name_len(name* self);
+//   void name_free(name* self);
+//
+// A heap that keeps track of where each element is. name_push returns a
+// handle for the element that stays valid until the element is popped or
+// removed, after which the handle may be given out again.
+//
+// name_update replaces (and destroys) the element of a handle and moves it
+// up or down to its new place in O(log n), which covers decrease key as
+// well as increase key. name_remove destroys the element of a handle and
+// takes it out of the heap in O(log n). Both panic() on a stale handle.
+// The other functions behave like the DECLARE_HEAP ones.
+#define DECLARE_INDEXED_HEAP(name, T, less)                                \
+  typedef struct name##_st {                                               \
+    vector(T) items;         /* heap ordered elements */                   \
+    vector(size_t) handles;  /* handles[i] is the handle of items[i] */    \
+    vector(size_t) pos;      /* pos[h] is the index of handle h */         \
+    vector(size_t) free_handles;                                           \
+  } name;                                                                  \
+                                                                           \
+  static inline name name##_new(destroy_fn dtor) {                         \
+    name res;                                                              \
+    res.items = vector_new(T, 0, dtor);                                    \
+    res.handles = NULL;                                                    \
+    res.pos = NULL;                                                        \
+    res.free_handles = NULL;                                               \
+    return res;                                                            \
+  }                                                                        \
+                                                                           \
+  static inline void name##_place(name* self, size_t index, T element,     \
+                                  size_t handle) {                         \
+    self->items[index] = element;                                          \
+    self->handles[index] = handle;                                         \
+    self->pos[handle] = index;                                             \
+  }                                                                        \
+                                                                           \
+  static inline void name##_sift_up(name* self, size_t index) {            \
+    T moving = self->items[index];                                         \
+    size_t handle = self->handles[index];                                  \
+    while (index > 0) {                                                    \
+      size_t parent = (index - 1) / 2;                                     \
+      if (!less(moving, self->items[parent])) {                            \
+        break;                                                             \
+      }                                                                    \
+      name##_place(self, index, self->items[parent],                       \
+                   self->handles[parent]);                                 \
+      index = parent;                                                      \
+    }                                                                      \
+    name##_place(self, index, moving, handle);                             \
+  }                                                                        \
+                                                                           \
+  static inline void name##_sift_down(name* self, size_t index) {          \
+    size_t len = vector_len(&self->items);                                 \
+    T moving = self->items[index];                                         \
+    size_t handle = self->handles[index];                                  \
+    for (;;) {                                                             \
+      size_t child = 2 * index + 1;                                        \
+      if (child >= len) {                                                  \
+        break;                                                             \
+      }                                                                    \
+      if (child + 1 < len &&                                               \
+          less(self->items[child + 1], self->items[child])) {              \
+        child++;                                                           \
+      }                                                                    \
+      if (!less(self->items[child], moving)) {                             \
+        break;                                                             \
+      }                                                                    \
+      name##_place(self, index, self->items[child], self->handles[child]); \
+      index = child;                                                       \
+    }                                                                      \
+    name##_place(self, index, moving, handle);                             \
+  }                                                                        \
+                                                                           \
+  static inline size_t name##_len(name* self) {                            \
+    return vector_len(&self->items);                                       \
+  }                                                                        \
+                                                                           \
+  static inline size_t name##_push(name* self, T element) {                \
+    size_t handle = vector_len(&self->pos);                                \
+    if (vector_len(&self->free_handles) > 0) {                             \
+      handle = vector_get(&self->free_handles,                             \
+                          vector_len(&self->free_handles) - 1);            \
+      vector_pop(&self->free_handles);                                     \
+    } else {                                                               \
+      vector_push(&self->pos, HEAP_NO_POS);                                \
+    }                                                                      \
+    vector_push(&self->items, element);                                    \
+    vector_push(&self->handles, handle);                                   \
+    name##_sift_up(self, vector_len(&self->items) - 1);                    \
+    return handle;                                                         \
+  }                                                                        \
+                                                                           \
+  static inline bool name##_contains(name* self, size_t handle) {          \
+    return handle < vector_len(&self->pos) &&                              \
+           self->pos[handle] != HEAP_NO_POS;                               \
+  }                                                                        \
+                                                                           \
+  static inline size_t name##_index_of(name* self, size_t handle) {        \
+    if (!name##_contains(self, handle)) {                                  \
+      panic("stale handle in " #name "\n");                                \
+    }                                                                      \
+    return self->pos[handle];                                              \
+  }                                                                        \
+                                                                           \
+  static inline T name##_top(name* self) {                                 \
+    if (name##_len(self) == 0) {                                           \
+      panic("empty heap in " #name "_top\n");                              \
+    }                                                                      \
+    return self->items[0];                                                 \
+  }                                                                        \
+                                                                           \
+  static inline size_t name##_top_handle(name* self) {                     \
+    if (name##_len(self) == 0) {                                           \
+      panic("empty heap in " #name "_top_handle\n");                       \
+    }                                                                      \
+    return self->handles[0];                                               \
+  }                                                                        \
+                                                                           \
+  static inline T name##_get(name* self, size_t handle) {                  \
+    return self->items[name##_index_of(self, handle)];                     \
+  }                                                                        \
+                                                                           \
+  /* takes out the element at index, storing it in out or destroying it */ \
+  static inline void name##_take(name* self, size_t index, T* out) {       \
+    vector_info* info = get_vector_header(&self->items);                   \
+    size_t handle = self->handles[index];                                  \
+    if (out != NULL) {                                                     \
+      *out = self->items[index];                                           \
+    } else if (info->ele_dtor != NULL) {                                   \
+      info->ele_dtor(&self->items[index]);                                 \
+    }                                                                      \
+    self->pos[handle] = HEAP_NO_POS;                                       \
+    vector_push(&self->free_handles, handle);                              \
+                                                                           \
+    size_t last = --info->len;                                             \
+    get_vector_header(&self->handles)->len--;                              \
+    if (index == last) {                                                   \
+      return;                                                              \
+    }                                                                      \
+    /* the last element may belong above or below the hole */              \
+    name##_place(self, index, self->items[last], self->handles[last]);     \
+    if (index > 0 &&                                                       \
+        less(self->items[index], self->items[(index - 1) / 2])) {          \
+      name##_sift_up(self, index);                                         \
+    } else {                                                               \
+      name##_sift_down(self, index);                                       \
+    }                                                                      \
+  }                                                                        \
+                                                                           \
+  static inline bool name##_pop(name* self, T* out) {                      \
+    if (name##_len(self) == 0) {                                           \
+      return false;                                                        \
+    }                                                                      \
+    name##_take(self, 0, out);                                             \
+    return true;                                                           \
+  }                                                                        \
+                                                                           \
+  static inline void name##_remove(name* self, size_t handle) {            \
+    name##_take(self, name##_index_of(self, handle), NULL);                \
+  }                                                                        \
+                                                                           \
+  static inline void name##_update(name* self, size_t handle, T element) { \
+    size_t index = name##_index_of(self, handle);                          \
+    vector_info* info = get_vector_header(&self->items);                   \
+    if (info->ele_dtor != NULL) {                                          \
+      info->ele_dtor(&self->items[index]);                                 \
+    }                                                                      \
+    self->items[index] = element;                                          \
+    if (index > 0 &&                                                       \
+        less(element, self->items[(index - 1) / 2])) {                     \
+      name##_sift_up(self, index);                                         \
+    } else {                                                               \
+      name##_sift_down(self, index);                                       \
+    }                                                                      \
+  }                                                                        \
+                                                                           \
+  static inline void name##_free(name* self) {                             \
+    vector_free(&self->items);                                             \
+    vector_free(&self->handles);                                           \
+    vector_free(&self->pos);                                               \
+    vector_free(&self->free_handles);                                      \
+  }
+
+#endif  // HEAP_H_
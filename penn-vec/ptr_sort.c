@@ -0,0 +1,97 @@
+#include "./ptr_sort.h"
+#include <stdint.h>
+#include <string.h>
+
+// entries are sorted in slices of this many first
+#define INSERTION_SORT_ENTRIES 32
+
+static inline int compare(ptr_cmp_fn cmp, ptr_t a, ptr_t b) {
+  if (cmp == NULL) {
+    uintptr_t x = (uintptr_t)a;
+    uintptr_t y = (uintptr_t)b;
+    return (x > y) - (x < y);
+  }
+  return cmp(a, b);
+}
+
+// the helpers are inlined into sort() with a constant stride, so the
+// copies of an entry compile to plain moves
+
+static inline void insertion_sort(ptr_t* data,
+                                  size_t n,
+                                  size_t stride,
+                                  ptr_cmp_fn cmp) {
+  for (size_t i = 1; i < n; i++) {
+    ptr_t entry[PTR_SORT_MAX_STRIDE];
+    memcpy(entry, &data[i * stride], stride * sizeof(ptr_t));
+    size_t j = i;
+    while (j > 0 && compare(cmp, entry[0], data[(j - 1) * stride]) < 0) {
+      memcpy(&data[j * stride], &data[(j - 1) * stride],
+             stride * sizeof(ptr_t));
+      j--;
+    }
+    memcpy(&data[j * stride], entry, stride * sizeof(ptr_t));
+  }
+}
+
+static inline void merge_runs(const ptr_t* src,
+                              ptr_t* dst,
+                              size_t lo,
+                              size_t mid,
+                              size_t hi,
+                              size_t stride,
+                              ptr_cmp_fn cmp) {
+  size_t i = lo;
+  size_t j = mid;
+  size_t k = lo;
+  size_t bytes = stride * sizeof(ptr_t);
+  while (i < mid && j < hi) {
+    // take from the right run only when strictly less to stay stable
+    bool right = compare(cmp, src[j * stride], src[i * stride]) < 0;
+    size_t take = right ? j++ : i++;
+    memcpy(&dst[k++ * stride], &src[take * stride], bytes);
+  }
+  memcpy(&dst[k * stride], &src[i * stride], (mid - i) * bytes);
+  k += mid - i;
+  memcpy(&dst[k * stride], &src[j * stride], (hi - j) * bytes);
+}
+
+static inline void sort(ptr_t* data,
+                        size_t n,
+                        size_t stride,
+                        ptr_cmp_fn cmp,
+                        ptr_t* scratch) {
+  for (size_t lo = 0; lo < n; lo += INSERTION_SORT_ENTRIES) {
+    size_t len =
+        n - lo < INSERTION_SORT_ENTRIES ? n - lo : INSERTION_SORT_ENTRIES;
+    insertion_sort(&data[lo * stride], len, stride, cmp);
+  }
+
+  ptr_t* src = data;
+  ptr_t* dst = scratch;
+  for (size_t width = INSERTION_SORT_ENTRIES; width < n; width *= 2) {
+    for (size_t lo = 0; lo < n; lo += 2 * width) {
+      size_t mid = lo + width < n ? lo + width : n;
+      size_t hi = lo + 2 * width < n ? lo + 2 * width : n;
+      merge_runs(src, dst, lo, mid, hi, stride, cmp);
+    }
+    ptr_t* tmp = src;
+    src = dst;
+    dst = tmp;
+  }
+  if (src != data) {
+    memcpy(data, src, n * stride * sizeof(ptr_t));
+  }
+}
+
+void ptr_sort_entries(ptr_t* data,
+                      size_t n,
+                      size_t stride,
+                      ptr_cmp_fn cmp,
+                      ptr_t* scratch) {
+  if (stride == 1) {
+    sort(data, n, 1, cmp, scratch);
+  } else {
+    sort(data, n, PTR_SORT_MAX_STRIDE, cmp, scratch);
+  }
+}
@@ -0,0 +1,32 @@
+#ifndef PTR_SORT_H_
+#define PTR_SORT_H_
+
+#include <stddef.h>
+#include "./Vec.h"
+#include "./flat.h"  // ptr_cmp_fn
+
+// The stable sort shared by FlatSet/FlatMap and ExtSort. Not part of the
+// public API.
+
+// the most pointers in one entry: a key and its value
+#define PTR_SORT_MAX_STRIDE 2
+
+/*!
+ * Sorts n "entries" of `stride` pointers each, ordered by the first
+ * pointer of the entry. Short slices are insertion sorted first, then
+ * merged bottom-up between data and scratch. Equal entries keep their
+ * order.
+ *
+ * @param data    the entries, sorted in place.
+ * @param n       the number of entries.
+ * @param stride  the pointers per entry, at most PTR_SORT_MAX_STRIDE.
+ * @param cmp     the comparison, or NULL to compare the pointer values.
+ * @param scratch room for n * stride pointers.
+ */
+void ptr_sort_entries(ptr_t* data,
+                      size_t n,
+                      size_t stride,
+                      ptr_cmp_fn cmp,
+                      ptr_t* scratch);
+
+#endif  // PTR_SORT_H_
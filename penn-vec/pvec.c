@@ -0,0 +1,326 @@
+#include "./pvec.h"
+#include <stdlib.h>
+#include <string.h>
+#include "./panic.h"
+
+// ===========================================================
+// Nodes
+//
+// A node is a leaf holding elements or an internal node holding
+// children, told apart by the level it sits at. Its reference count
+// is the number of parents and version handles pointing at it.
+//
+// All updates go through an in-place path that first makes every
+// node it writes to "editable": a node referenced once can only be
+// reached through the version being updated, so it is changed in
+// place, any other node is copied first. The public functions
+// retain the input version before updating it, which makes every
+// node on the path shared and thus copied, so the input never
+// changes. Building a fresh version (pvec_from_vec, pvec_concat)
+// updates nodes nobody else sees, and so runs in place.
+//
+// Positions are indices into the trie, element i of a version is at
+// position offset + i. Positions [0, tail_offset) are in the trie,
+// the rest in the tail, which always starts at a multiple of 32.
+// After a slice the trie may still hold nodes past tail_offset;
+// nothing reads them, and updates overwrite them.
+// ===========================================================
+#define PVEC_MASK (PVEC_WIDTH - 1)
+
+typedef struct pvec_node_st {
+  uint32_t refs;
+  void* slots[PVEC_WIDTH];  // elements in a leaf, children otherwise
+} pvec_node;
+
+static pvec_node* node_alloc(void) {
+  pvec_node* node = (pvec_node*)malloc(sizeof(pvec_node));
+  if (node == NULL) {
+    panic("malloc failed");
+  }
+  node->refs = 1;
+  return node;
+}
+
+static pvec_node* node_new(void) {
+  pvec_node* node = node_alloc();
+  memset(node->slots, 0, sizeof(node->slots));
+  return node;
+}
+
+static inline pvec_node* node_retain(pvec_node* node) {
+  if (node != NULL) {
+    node->refs++;
+  }
+  return node;
+}
+
+// `shift` is the level of the node, 0 for leaves
+static void node_release(pvec_node* node, size_t shift) {
+  if (node == NULL || --node->refs > 0) {
+    return;
+  }
+  if (shift > 0) {
+    for (size_t i = 0; i < PVEC_WIDTH; i++) {
+      node_release((pvec_node*)node->slots[i], shift - PVEC_BITS);
+    }
+  }
+  free(node);
+}
+
+// makes *slot a node only this version refers to, copying it if shared
+static pvec_node* node_editable(pvec_node** slot, size_t shift) {
+  pvec_node* node = *slot;
+  if (node->refs == 1) {
+    return node;
+  }
+  pvec_node* copy = node_alloc();
+  memcpy(copy->slots, node->slots, sizeof(node->slots));
+  if (shift > 0) {
+    for (size_t i = 0; i < PVEC_WIDTH; i++) {
+      node_retain((pvec_node*)copy->slots[i]);
+    }
+  }
+  node->refs--;
+  *slot = copy;
+  return copy;
+}
+
+// ===========================================================
+// Positions
+// ===========================================================
+static inline size_t end_position(const PVec* self) {
+  return self->offset + self->length;
+}
+
+static inline size_t tail_offset(size_t end) {
+  return end == 0 ? 0 : ((end - 1) >> PVEC_BITS) << PVEC_BITS;
+}
+
+// the leaf holding `position`, which must be below the tail offset
+static pvec_node* leaf_for(const PVec* self, size_t position) {
+  pvec_node* node = self->root;
+  for (size_t level = self->shift; level > 0; level -= PVEC_BITS) {
+    node = (pvec_node*)node->slots[(position >> level) & PVEC_MASK];
+  }
+  return node;
+}
+
+// ===========================================================
+// In-place updates
+// ===========================================================
+
+// moves the full tail into the trie, leaving no tail
+static void push_tail(PVec* self) {
+  size_t position = end_position(self) - PVEC_WIDTH;
+  if (self->root == NULL) {
+    self->root = node_new();
+    self->shift = PVEC_BITS;
+  } else if ((position >> PVEC_BITS) >= ((size_t)1 << self->shift)) {
+    // the trie is full, grow a level on top
+    pvec_node* root = node_new();
+    root->slots[0] = self->root;
+    self->root = root;
+    self->shift += PVEC_BITS;
+  }
+
+  pvec_node* node = node_editable(&self->root, self->shift);
+  for (size_t level = self->shift; level > PVEC_BITS; level -= PVEC_BITS) {
+    pvec_node** child =
+        (pvec_node**)&node->slots[(position >> level) & PVEC_MASK];
+    if (*child == NULL) {
+      *child = node_new();
+    }
+    node = node_editable(child, level - PVEC_BITS);
+  }
+  pvec_node** leaf =
+      (pvec_node**)&node->slots[(position >> PVEC_BITS) & PVEC_MASK];
+  node_release(*leaf, 0);  // left over from before a slice
+  *leaf = self->tail;
+  self->tail = NULL;
+}
+
+static void push_in_place(PVec* self, ptr_t new_ele) {
+  size_t end = end_position(self);
+  if (self->tail != NULL && (end & PVEC_MASK) == 0) {
+    push_tail(self);
+  }
+  if (self->tail == NULL) {
+    self->tail = node_new();
+  }
+  node_editable(&self->tail, 0)->slots[end & PVEC_MASK] = new_ele;
+  self->length++;
+}
+
+// appends a full leaf, `leaf` must hold 32 elements and the version must
+// end at a multiple of 32
+static void push_leaf_in_place(PVec* self, pvec_node* leaf) {
+  if (self->tail != NULL) {
+    push_tail(self);
+  }
+  self->tail = node_retain(leaf);
+  self->length += PVEC_WIDTH;
+}
+
+static void set_in_place(PVec* self, size_t index, ptr_t new_ele) {
+  size_t position = self->offset + index;
+  if (position >= tail_offset(end_position(self))) {
+    node_editable(&self->tail, 0)->slots[position & PVEC_MASK] = new_ele;
+    return;
+  }
+  pvec_node* node = node_editable(&self->root, self->shift);
+  for (size_t level = self->shift; level > 0; level -= PVEC_BITS) {
+    pvec_node** child =
+        (pvec_node**)&node->slots[(position >> level) & PVEC_MASK];
+    node = node_editable(child, level - PVEC_BITS);
+  }
+  node->slots[position & PVEC_MASK] = new_ele;
+}
+
+// ===========================================================
+// Public functions
+// ===========================================================
+PVec pvec_new(void) {
+  PVec res = {NULL, NULL, 0, 0, PVEC_BITS};
+  return res;
+}
+
+PVec pvec_retain(const PVec* self) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  PVec res = *self;
+  node_retain(res.root);
+  node_retain(res.tail);
+  return res;
+}
+
+void pvec_release(PVec* self) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  node_release(self->root, self->shift);
+  node_release(self->tail, 0);
+  *self = pvec_new();
+}
+
+ptr_t pvec_get(const PVec* self, size_t index) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  if (index >= self->length) {
+    panic("index out of bound");
+  }
+  size_t position = self->offset + index;
+  if (position >= tail_offset(end_position(self))) {
+    return self->tail->slots[position & PVEC_MASK];
+  }
+  return leaf_for(self, position)->slots[position & PVEC_MASK];
+}
+
+PVec pvec_push(const PVec* self, ptr_t new_ele) {
+  PVec res = pvec_retain(self);
+  push_in_place(&res, new_ele);
+  return res;
+}
+
+PVec pvec_set(const PVec* self, size_t index, ptr_t new_ele) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  if (index >= self->length) {
+    panic("index out of bound");
+  }
+  PVec res = pvec_retain(self);
+  set_in_place(&res, index, new_ele);
+  return res;
+}
+
+PVec pvec_slice(const PVec* self, size_t begin, size_t end) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  if (begin > end || end > self->length) {
+    panic("slice out of bound");
+  }
+  if (begin == end) {
+    return pvec_new();
+  }
+
+  PVec res = pvec_retain(self);
+  size_t old_tail_offset = tail_offset(end_position(self));
+  res.offset += begin;
+  res.length = end - begin;
+  size_t new_tail_offset = tail_offset(end_position(&res));
+  if (new_tail_offset < old_tail_offset) {
+    // the new last element is in the trie, its leaf becomes the tail
+    node_release(res.tail, 0);
+    res.tail = node_retain(leaf_for(&res, new_tail_offset));
+  }
+  if (new_tail_offset == 0 && res.root != NULL) {
+    node_release(res.root, res.shift);
+    res.root = NULL;
+    res.shift = PVEC_BITS;
+  }
+  return res;
+}
+
+PVec pvec_concat(const PVec* left, const PVec* right) {
+  if (left == NULL || right == NULL) {
+    panic("left or right is NULL");
+  }
+  if (left->length == 0) {
+    return pvec_retain(right);
+  }
+  PVec res = pvec_retain(left);
+
+  size_t index = 0;
+  if ((end_position(left) & PVEC_MASK) == 0 &&
+      (right->offset & PVEC_MASK) == 0) {
+    // whole leaves of right line up with ours, share them
+    size_t right_tail_offset = tail_offset(end_position(right));
+    for (size_t position = right->offset; position < right_tail_offset;
+         position += PVEC_WIDTH) {
+      push_leaf_in_place(&res, leaf_for(right, position));
+      index += PVEC_WIDTH;
+    }
+  }
+  for (; index < right->length; index++) {
+    push_in_place(&res, pvec_get(right, index));
+  }
+  return res;
+}
+
+PVec pvec_from_vec(const Vec* vec) {
+  if (vec == NULL) {
+    panic("vec is NULL");
+  }
+  PVec res = pvec_new();
+  for (size_t i = 0; i < vec->length; i++) {
+    push_in_place(&res, vec->data[i]);
+  }
+  return res;
+}
+
+Vec pvec_to_vec(const PVec* self) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  Vec res = vec_new(self->length, NULL);
+  size_t end = end_position(self);
+  size_t trie_end = tail_offset(end);
+
+  // a leaf at a time
+  size_t position = self->offset;
+  while (position < end) {
+    const pvec_node* leaf =
+        position >= trie_end ? self->tail : leaf_for(self, position);
+    size_t leaf_end = (position | PVEC_MASK) + 1;
+    if (leaf_end > end) {
+      leaf_end = end;
+    }
+    for (; position < leaf_end; position++) {
+      res.data[res.length++] = leaf->slots[position & PVEC_MASK];
+    }
+  }
+  return res;
+}
@@ -0,0 +1,142 @@
+#ifndef PVEC_H_
+#define PVEC_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "./Vec.h"
+
+/*!
+ * A persistent (immutable) vector: every update returns a new version and
+ * leaves the old one untouched, sharing most of its memory with it.
+ *
+ * Elements live in a trie of 32-way nodes, plus a "tail" leaf holding the
+ * last 1 to 32 elements so that pushes rarely touch the trie:
+ *
+ *            root
+ *         /   |   \
+ *      leaf  leaf  leaf ...  tail
+ *
+ * An update copies the nodes on the path to the element it changes,
+ * O(log32 n) nodes, and points the copies at the untouched subtrees. Nodes
+ * are reference counted, a version is a handle to a root and a tail.
+ *
+ * - pvec_get is O(log32 n), at most 4 hops for 1M elements.
+ * - pvec_push and pvec_set copy one path, O(log32 n).
+ * - pvec_slice is O(log32 n). It keeps the whole trie alive and shifts the
+ *   first index by an offset, so slicing off a prefix frees no memory.
+ * - pvec_concat shares the leaves of the right vector when both ends are
+ *   aligned to 32 elements, O(m / 32 log32 n) for m elements on the right.
+ *   Otherwise it pushes the elements of the right vector one at a time.
+ *
+ * The vector does not own its elements: the same element is shared by many
+ * versions, so no destructor is ever called on it. Versions are not thread
+ * safe, a version and those derived from it must be used from one thread at
+ * a time.
+ *
+ * Every version returned by a function must be released with
+ * pvec_release(), including the ones given to other functions as input.
+ */
+
+#define PVEC_BITS 5
+#define PVEC_WIDTH (1U << PVEC_BITS)
+
+struct pvec_node_st;
+
+typedef struct pvec_st {
+  struct pvec_node_st* root;  // positions [0, tail offset), may be NULL
+  struct pvec_node_st* tail;  // the leaf with the last positions, or NULL
+  size_t offset;  // trie position of element 0, see pvec_slice()
+  size_t length;
+  size_t shift;  // PVEC_BITS * (height of the root above the leaves)
+} PVec;
+
+/*!
+ * Creates an empty version. Allocates nothing.
+ *
+ * @returns an empty persistent vector.
+ */
+PVec pvec_new(void);
+
+/* Returns the number of elements in a version. */
+#define pvec_len(self) ((self)->length)
+
+/*!
+ * Takes another handle to the same version.
+ *
+ * @param self the version to share.
+ * @returns the same version, to be released on its own.
+ */
+PVec pvec_retain(const PVec* self);
+
+/*!
+ * Releases a version, freeing the nodes no other version shares.
+ *
+ * @param self the version to release, left empty.
+ */
+void pvec_release(PVec* self);
+
+/*!
+ * Gets an element.
+ *
+ * @param self  the version to read.
+ * @param index the index of the element.
+ * @returns the element. panic()'s if the index is >= the length.
+ */
+ptr_t pvec_get(const PVec* self, size_t index);
+
+/*!
+ * Returns a new version with an element appended.
+ *
+ * @param self    the version to append to, unchanged.
+ * @param new_ele the element to append.
+ * @returns the new version.
+ * @post if memory allocation fails, the function will panic.
+ */
+PVec pvec_push(const PVec* self, ptr_t new_ele);
+
+/*!
+ * Returns a new version with an element replaced.
+ *
+ * @param self    the version to update, unchanged.
+ * @param index   the index of the element to replace.
+ * @param new_ele the new element.
+ * @returns the new version. panic()'s if the index is >= the length.
+ */
+PVec pvec_set(const PVec* self, size_t index, ptr_t new_ele);
+
+/*!
+ * Returns the elements in [begin, end) as a new version.
+ *
+ * @param self  the version to slice, unchanged.
+ * @param begin the index of the first element to keep.
+ * @param end   one past the index of the last element to keep.
+ * @returns the new version. panic()'s unless begin <= end <= length.
+ */
+PVec pvec_slice(const PVec* self, size_t begin, size_t end);
+
+/*!
+ * Returns the elements of left followed by those of right as a new version.
+ *
+ * @param left  the first version, unchanged.
+ * @param right the second version, unchanged.
+ * @returns the new version.
+ */
+PVec pvec_concat(const PVec* left, const PVec* right);
+
+/*!
+ * Creates a version holding the elements of a Vec, in O(n).
+ *
+ * @param vec the vector to copy the elements of.
+ * @returns the new version.
+ */
+PVec pvec_from_vec(const Vec* vec);
+
+/*!
+ * Copies the elements of a version into a new Vec with no destructor.
+ *
+ * @param self the version to copy.
+ * @returns a newly created vector.
+ */
+Vec pvec_to_vec(const PVec* self);
+
+#endif  // PVEC_H_
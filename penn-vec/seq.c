@@ -0,0 +1,467 @@
+#include "./seq.h"
+#include <stdlib.h>
+#include <string.h>
+#include "./panic.h"
+
+// A node under these sizes is merged with or refilled from a sibling.
+// Only the root may stay below them: every other internal node is made
+// by splitting a full one in half, so it always has a sibling to
+// rebalance with.
+#define SEQ_LEAF_MIN (SEQ_LEAF_CAP / 4)
+#define SEQ_FANOUT_MIN (SEQ_FANOUT / 4)
+
+typedef struct seq_leaf_st {
+  struct seq_leaf_st* next;
+  size_t length;
+  ptr_t data[SEQ_LEAF_CAP];
+} seq_leaf;
+
+typedef struct seq_branch_st {
+  size_t count;
+  size_t sizes[SEQ_FANOUT];  // the number of elements under each child
+  void* children[SEQ_FANOUT];
+} seq_branch;
+
+static void* node_alloc(size_t size) {
+  void* node = malloc(size);
+  if (node == NULL) {
+    panic("malloc failed");
+  }
+  return node;
+}
+
+static seq_leaf* leaf_new(void) {
+  seq_leaf* leaf = (seq_leaf*)node_alloc(sizeof(seq_leaf));
+  leaf->next = NULL;
+  leaf->length = 0;
+  return leaf;
+}
+
+static seq_branch* branch_new(void) {
+  seq_branch* branch = (seq_branch*)node_alloc(sizeof(seq_branch));
+  branch->count = 0;
+  return branch;
+}
+
+static size_t branch_total(const seq_branch* branch) {
+  size_t total = 0;
+  for (size_t i = 0; i < branch->count; i++) {
+    total += branch->sizes[i];
+  }
+  return total;
+}
+
+// the leaf holding element *index, which is made relative to the leaf
+static seq_leaf* find_leaf(const Seq* self, size_t* index) {
+  void* node = self->root;
+  for (size_t height = self->height; height > 0; height--) {
+    seq_branch* branch = (seq_branch*)node;
+    size_t i = 0;
+    while (*index >= branch->sizes[i]) {
+      *index -= branch->sizes[i];
+      i++;
+    }
+    node = branch->children[i];
+  }
+  return (seq_leaf*)node;
+}
+
+// ===========================================================
+// Insert
+//
+// The insert functions return the new right sibling when the node
+// they inserted into was full and had to split, and set *right_size
+// to the number of elements under it. They return NULL otherwise.
+// ===========================================================
+static void* leaf_insert(seq_leaf* leaf,
+                         size_t index,
+                         ptr_t new_ele,
+                         size_t* right_size) {
+  if (leaf->length < SEQ_LEAF_CAP) {
+    memmove(&leaf->data[index + 1], &leaf->data[index],
+            (leaf->length - index) * sizeof(ptr_t));
+    leaf->data[index] = new_ele;
+    leaf->length++;
+    return NULL;
+  }
+
+  // appending to the last leaf starts a new one, so that pushing builds
+  // full leaves. Anywhere else the leaf splits in half
+  size_t keep = SEQ_LEAF_CAP / 2;
+  if (leaf->next == NULL && index == SEQ_LEAF_CAP) {
+    keep = SEQ_LEAF_CAP;
+  }
+  seq_leaf* right = leaf_new();
+  right->length = SEQ_LEAF_CAP - keep;
+  memcpy(right->data, &leaf->data[keep], right->length * sizeof(ptr_t));
+  leaf->length = keep;
+  right->next = leaf->next;
+  leaf->next = right;
+
+  if (index < keep) {
+    leaf_insert(leaf, index, new_ele, right_size);
+  } else {
+    leaf_insert(right, index - keep, new_ele, right_size);
+  }
+  *right_size = right->length;
+  return right;
+}
+
+// puts a child at position `pos` of a branch
+static void* branch_add_child(seq_branch* branch,
+                              size_t pos,
+                              void* child,
+                              size_t size,
+                              size_t* right_size) {
+  if (branch->count < SEQ_FANOUT) {
+    size_t moved = branch->count - pos;
+    memmove(&branch->sizes[pos + 1], &branch->sizes[pos],
+            moved * sizeof(size_t));
+    memmove(&branch->children[pos + 1], &branch->children[pos],
+            moved * sizeof(void*));
+    branch->sizes[pos] = size;
+    branch->children[pos] = child;
+    branch->count++;
+    return NULL;
+  }
+
+  size_t keep = SEQ_FANOUT / 2;
+  seq_branch* right = branch_new();
+  right->count = SEQ_FANOUT - keep;
+  memcpy(right->sizes, &branch->sizes[keep], right->count * sizeof(size_t));
+  memcpy(right->children, &branch->children[keep],
+         right->count * sizeof(void*));
+  branch->count = keep;
+
+  if (pos <= keep) {
+    branch_add_child(branch, pos, child, size, right_size);
+  } else {
+    branch_add_child(right, pos - keep, child, size, right_size);
+  }
+  *right_size = branch_total(right);
+  return right;
+}
+
+static void* node_insert(void* node,
+                         size_t height,
+                         size_t index,
+                         ptr_t new_ele,
+                         size_t* right_size) {
+  if (height == 0) {
+    return leaf_insert((seq_leaf*)node, index, new_ele, right_size);
+  }
+  seq_branch* branch = (seq_branch*)node;
+  // an index at the end of a child appends to it
+  size_t i = 0;
+  while (i + 1 < branch->count && index > branch->sizes[i]) {
+    index -= branch->sizes[i];
+    i++;
+  }
+  size_t split_size = 0;
+  void* split =
+      node_insert(branch->children[i], height - 1, index, new_ele, &split_size);
+  branch->sizes[i]++;
+  if (split == NULL) {
+    return NULL;
+  }
+  branch->sizes[i] -= split_size;
+  return branch_add_child(branch, i + 1, split, split_size, right_size);
+}
+
+// ===========================================================
+// Erase
+// ===========================================================
+
+// evens out two neighbouring leaves, or moves everything into `left`
+// if it all fits. Returns true if `right` was emptied and freed
+static bool rebalance_leaves(seq_leaf* left, seq_leaf* right) {
+  size_t total = left->length + right->length;
+  if (total <= SEQ_LEAF_CAP) {
+    memcpy(&left->data[left->length], right->data,
+           right->length * sizeof(ptr_t));
+    left->length = total;
+    left->next = right->next;
+    free(right);
+    return true;
+  }
+  size_t half = total / 2;
+  if (left->length < half) {
+    size_t moved = half - left->length;
+    memcpy(&left->data[left->length], right->data, moved * sizeof(ptr_t));
+    memmove(right->data, &right->data[moved],
+            (right->length - moved) * sizeof(ptr_t));
+    right->length -= moved;
+  } else {
+    size_t moved = left->length - half;
+    memmove(&right->data[moved], right->data, right->length * sizeof(ptr_t));
+    memcpy(right->data, &left->data[half], moved * sizeof(ptr_t));
+    right->length += moved;
+  }
+  left->length = half;
+  return false;
+}
+
+// the same for two neighbouring branches
+static bool rebalance_branches(seq_branch* left, seq_branch* right) {
+  size_t total = left->count + right->count;
+  if (total <= SEQ_FANOUT) {
+    memcpy(&left->sizes[left->count], right->sizes,
+           right->count * sizeof(size_t));
+    memcpy(&left->children[left->count], right->children,
+           right->count * sizeof(void*));
+    left->count = total;
+    free(right);
+    return true;
+  }
+  size_t half = total / 2;
+  if (left->count < half) {
+    size_t moved = half - left->count;
+    memcpy(&left->sizes[left->count], right->sizes, moved * sizeof(size_t));
+    memcpy(&left->children[left->count], right->children,
+           moved * sizeof(void*));
+    memmove(right->sizes, &right->sizes[moved],
+            (right->count - moved) * sizeof(size_t));
+    memmove(right->children, &right->children[moved],
+            (right->count - moved) * sizeof(void*));
+    right->count -= moved;
+  } else {
+    size_t moved = left->count - half;
+    memmove(&right->sizes[moved], right->sizes, right->count * sizeof(size_t));
+    memmove(&right->children[moved], right->children,
+            right->count * sizeof(void*));
+    memcpy(right->sizes, &left->sizes[half], moved * sizeof(size_t));
+    memcpy(right->children, &left->children[half], moved * sizeof(void*));
+    right->count += moved;
+  }
+  left->count = half;
+  return false;
+}
+
+// fixes up child i of a branch after it fell under the minimum size
+static void rebalance_child(seq_branch* branch, size_t i, size_t height) {
+  size_t l = i + 1 < branch->count ? i : i - 1;
+  size_t r = l + 1;
+  void* left = branch->children[l];
+  void* right = branch->children[r];
+
+  bool merged = height == 0
+                    ? rebalance_leaves((seq_leaf*)left, (seq_leaf*)right)
+                    : rebalance_branches((seq_branch*)left, (seq_branch*)right);
+  if (merged) {
+    branch->sizes[l] += branch->sizes[r];
+    size_t moved = branch->count - r - 1;
+    memmove(&branch->sizes[r], &branch->sizes[r + 1], moved * sizeof(size_t));
+    memmove(&branch->children[r], &branch->children[r + 1],
+            moved * sizeof(void*));
+    branch->count--;
+    return;
+  }
+  if (height == 0) {
+    branch->sizes[l] = ((seq_leaf*)left)->length;
+    branch->sizes[r] = ((seq_leaf*)right)->length;
+  } else {
+    branch->sizes[l] = branch_total((seq_branch*)left);
+    branch->sizes[r] = branch_total((seq_branch*)right);
+  }
+}
+
+// removes element `index` from the subtree and returns it
+static ptr_t node_erase(void* node, size_t height, size_t index) {
+  if (height == 0) {
+    seq_leaf* leaf = (seq_leaf*)node;
+    ptr_t ele = leaf->data[index];
+    memmove(&leaf->data[index], &leaf->data[index + 1],
+            (leaf->length - index - 1) * sizeof(ptr_t));
+    leaf->length--;
+    return ele;
+  }
+
+  seq_branch* branch = (seq_branch*)node;
+  size_t i = 0;
+  while (index >= branch->sizes[i]) {
+    index -= branch->sizes[i];
+    i++;
+  }
+  void* child = branch->children[i];
+  ptr_t ele = node_erase(child, height - 1, index);
+  branch->sizes[i]--;
+
+  bool small = height == 1 ? ((seq_leaf*)child)->length < SEQ_LEAF_MIN
+                           : ((seq_branch*)child)->count < SEQ_FANOUT_MIN;
+  if (small && branch->count > 1) {
+    rebalance_child(branch, i, height - 1);
+  }
+  return ele;
+}
+
+static void node_free(void* node, size_t height, ptr_dtor_fn ele_dtor_fn) {
+  if (height == 0) {
+    seq_leaf* leaf = (seq_leaf*)node;
+    if (ele_dtor_fn != NULL) {
+      for (size_t i = 0; i < leaf->length; i++) {
+        if (leaf->data[i] != NULL) {
+          ele_dtor_fn(leaf->data[i]);
+        }
+      }
+    }
+    free(leaf);
+    return;
+  }
+  seq_branch* branch = (seq_branch*)node;
+  for (size_t i = 0; i < branch->count; i++) {
+    node_free(branch->children[i], height - 1, ele_dtor_fn);
+  }
+  free(branch);
+}
+
+// ===========================================================
+// Public functions
+// ===========================================================
+Seq seq_new(ptr_dtor_fn ele_dtor_fn) {
+  Seq res = {NULL, 0, 0, ele_dtor_fn};
+  return res;
+}
+
+ptr_t seq_get(Seq* self, size_t index) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  if (index >= self->length) {
+    panic("index out of bound");
+  }
+  seq_leaf* leaf = find_leaf(self, &index);
+  return leaf->data[index];
+}
+
+void seq_set(Seq* self, size_t index, ptr_t new_ele) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  if (index >= self->length) {
+    panic("index out of bound");
+  }
+  seq_leaf* leaf = find_leaf(self, &index);
+  ptr_t old = leaf->data[index];
+  leaf->data[index] = new_ele;
+  if (old != NULL && self->ele_dtor_fn != NULL) {
+    self->ele_dtor_fn(old);
+  }
+}
+
+void seq_push_back(Seq* self, ptr_t new_ele) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  seq_insert(self, self->length, new_ele);
+}
+
+bool seq_pop_back(Seq* self) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  if (self->length == 0) {
+    return false;
+  }
+  seq_erase(self, self->length - 1);
+  return true;
+}
+
+void seq_insert(Seq* self, size_t index, ptr_t new_ele) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  if (index > self->length) {
+    panic("index out of bound");
+  }
+  if (self->root == NULL) {
+    self->root = leaf_new();
+    self->height = 0;
+  }
+
+  size_t right_size = 0;
+  void* split =
+      node_insert(self->root, self->height, index, new_ele, &right_size);
+  self->length++;
+  if (split != NULL) {
+    // the root split, grow a level on top
+    seq_branch* root = branch_new();
+    root->count = 2;
+    root->sizes[0] = self->length - right_size;
+    root->sizes[1] = right_size;
+    root->children[0] = self->root;
+    root->children[1] = split;
+    self->root = root;
+    self->height++;
+  }
+}
+
+void seq_erase(Seq* self, size_t index) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  if (index >= self->length) {
+    panic("index out of bound");
+  }
+  ptr_t ele = node_erase(self->root, self->height, index);
+  self->length--;
+  while (self->height > 0 && ((seq_branch*)self->root)->count == 1) {
+    seq_branch* root = (seq_branch*)self->root;
+    self->root = root->children[0];
+    self->height--;
+    free(root);
+  }
+  if (ele != NULL && self->ele_dtor_fn != NULL) {
+    self->ele_dtor_fn(ele);
+  }
+}
+
+void seq_clear(Seq* self) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  if (self->root != NULL) {
+    node_free(self->root, self->height, self->ele_dtor_fn);
+  }
+  self->root = NULL;
+  self->height = 0;
+  self->length = 0;
+}
+
+void seq_destroy(Seq* self) {
+  seq_clear(self);
+}
+
+SeqIter seq_iter(Seq* self, size_t index) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  if (index > self->length) {
+    panic("index out of bound");
+  }
+  SeqIter res = {NULL, NULL, NULL};
+  if (index < self->length) {
+    res.leaf = find_leaf(self, &index);
+    res.pos = &res.leaf->data[index];
+    res.end = &res.leaf->data[res.leaf->length];
+  }
+  return res;
+}
+
+bool seq_iter_advance(SeqIter* iter) {
+  if (iter == NULL) {
+    panic("iter is NULL");
+  }
+  if (iter->leaf == NULL || iter->leaf->next == NULL) {
+    return false;
+  }
+  iter->leaf = iter->leaf->next;
+  // leaves are scattered after edits, start fetching the one after
+  if (iter->leaf->next != NULL) {
+    for (size_t line = 0; line < sizeof(seq_leaf); line += 64) {
+      __builtin_prefetch((const char*)iter->leaf->next + line);
+    }
+  }
+  iter->pos = iter->leaf->data;
+  iter->end = &iter->leaf->data[iter->leaf->length];
+  return iter->pos != iter->end;
+}
@@ -0,0 +1,176 @@
+#ifndef SEQ_H_
+#define SEQ_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "./Vec.h"
+
+/*!
+ * An indexed sequence for very large vectors that are edited in the middle.
+ *
+ * vec_insert() and vec_erase() shift the whole tail of the array, which is
+ * hundreds of MB for a middle insert into 50M elements. A Seq stores its
+ * elements in leaf arrays of SEQ_LEAF_CAP elements (eight cache lines),
+ * hung under a B+tree whose internal nodes record how many elements each
+ * subtree holds. An index is found by walking down the counts, and an
+ * insert or erase only shifts elements inside one leaf, splitting, merging
+ * or rebalancing leaves and nodes on the way back up:
+ *
+ * - seq_get, seq_set, seq_insert and seq_erase are O(log n).
+ * - seq_push_back fills leaves completely, so a Seq built by pushing uses
+ *   about as much memory as a Vec of the same length.
+ * - Leaves are linked, and a SeqIter walks them a leaf at a time: the loop
+ *   is over plain arrays, with one call per leaf to reach the next one.
+ *
+ * The functions mirror those of Vec.h, with vec_ replaced by seq_, and the
+ * elements are owned the same way: removed elements are cleaned up with
+ * the destructor given to seq_new().
+ */
+
+// elements per leaf, leaves are kept at least a quarter full
+#define SEQ_LEAF_CAP 64
+// children per internal node
+#define SEQ_FANOUT 32
+
+struct seq_leaf_st;
+
+typedef struct seq_st {
+  void* root;  // a leaf if height is 0, an internal node otherwise
+  size_t height;
+  size_t length;
+  ptr_dtor_fn ele_dtor_fn;
+} Seq;
+
+/* Walks a Seq from a given index, see seq_iter(). */
+typedef struct seq_iter_st {
+  ptr_t* pos;
+  ptr_t* end;  // the end of the current leaf
+  struct seq_leaf_st* leaf;
+} SeqIter;
+
+/*!
+ * Creates a new empty Seq. Allocates nothing until the first insert.
+ *
+ * @param ele_dtor_fn the function used to clean up removed elements, or
+ *                    NULL if there is nothing to clean up.
+ * @returns a newly created sequence.
+ */
+Seq seq_new(ptr_dtor_fn ele_dtor_fn);
+
+/* Returns the current length of the Seq
+ *
+ * @param seq, a pointer to the sequence we want to grab the len of.
+ */
+#define seq_len(seq) ((seq)->length)
+
+/* Checks if the Seq is empty
+ *
+ * @param seq, a pointer to the sequence we want to check emptiness of.
+ */
+#define seq_is_empty(seq) ((seq)->length == 0)
+
+/* Gets the specified element of the Seq in O(log n)
+ *
+ * @param self  a pointer to the sequence who's element we want to get.
+ * @param index the index of the element to get.
+ * @returns the element at the specified index.
+ * @pre If the index is >= self->length then this function will panic()
+ */
+ptr_t seq_get(Seq* self, size_t index);
+
+/* Sets the specified element of the Seq, cleaning up the old one
+ *
+ * @param self    a pointer to the sequence who's element we want to set.
+ * @param index   the index of the element to set.
+ * @param new_ele the value we want to set the element at that index to
+ * @pre If the index is >= self->length then this function will panic()
+ */
+void seq_set(Seq* self, size_t index, ptr_t new_ele);
+
+/* Appends the given element to the end of the Seq
+ *
+ * @param self    a pointer to the sequence we are pushing onto
+ * @param new_ele the value we want to add to the end of the container
+ * @post if memory allocation fails, the function will panic.
+ */
+void seq_push_back(Seq* self, ptr_t new_ele);
+
+/* Removes and destroys the last element of the Seq
+ *
+ * @param self a pointer to the sequence we are popping.
+ * @returns true iff an element was removed.
+ */
+bool seq_pop_back(Seq* self);
+
+/* Inserts an element at the specified location in O(log n)
+ *
+ * @param self    a pointer to the sequence we want to insert into.
+ * @param index   the index of the element we want to insert at. Elements at
+ *                this index and after it are shifted up one position. If
+ *                index is equal to the length, then we insert at the end.
+ * @param new_ele the value we want to insert
+ * @pre If the index is > self->length then this function will panic().
+ * @post if memory allocation fails, the function will panic.
+ */
+void seq_insert(Seq* self, size_t index, ptr_t new_ele);
+
+/* Erases an element at the specified location in O(log n)
+ *
+ * @param self  a pointer to the sequence we want to erase from.
+ * @param index the index of the element we want to erase. Elements after
+ *              this index are shifted down one position.
+ * @pre If the index is >= self->length then this function will panic().
+ */
+void seq_erase(Seq* self, size_t index);
+
+/* Erases all elements and frees every node. The Seq can be reused.
+ *
+ * @param self a pointer to the sequence we want to clear.
+ * @post The removed elements are destructed (cleaned up).
+ */
+void seq_clear(Seq* self);
+
+/* Destruct the sequence, same as seq_clear().
+ *
+ * @param self a pointer to the sequence we want to destruct.
+ * @post The removed elements are destructed (cleaned up).
+ */
+void seq_destroy(Seq* self);
+
+/*!
+ * Starts an iteration at an index:
+ *
+ *   SeqIter it = seq_iter(&seq, 0);
+ *   ptr_t ele;
+ *   while (seq_iter_next(&it, &ele)) {
+ *     use(ele);
+ *   }
+ *
+ * Inserting into or erasing from the Seq invalidates its iterators.
+ *
+ * @param self  the sequence to walk.
+ * @param index the index of the first element returned, <= the length.
+ * @returns an iterator positioned before that element.
+ */
+SeqIter seq_iter(Seq* self, size_t index);
+
+/* Moves an iterator to the next leaf, returns false at the end. Called by
+ * seq_iter_next().
+ */
+bool seq_iter_advance(SeqIter* iter);
+
+/* Gets the next element of an iteration.
+ *
+ * @param iter the iterator.
+ * @param ele  where to store the element.
+ * @returns false, leaving ele alone, if there are no elements left.
+ */
+static inline bool seq_iter_next(SeqIter* iter, ptr_t* ele) {
+  if (iter->pos == iter->end && !seq_iter_advance(iter)) {
+    return false;
+  }
+  *ele = *iter->pos++;
+  return true;
+}
+
+#endif  // SEQ_H_
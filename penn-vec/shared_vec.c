@@ -0,0 +1,157 @@
+#include "./shared_vec.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include "./panic.h"
+
+// Buffers only ever grow, and a writer publishes a new buffer before
+// the length that needs it. Readers load the length first, so the
+// buffer they load next always holds at least that many elements.
+//
+// Element slots are accessed with the __atomic builtins because they
+// are plain ptr_t's, read through SharedVecView in the header.
+
+typedef struct shared_buf_st {
+  size_t capacity;
+  ptr_t data[];
+} shared_buf;
+
+struct shared_vec_st {
+  _Atomic(shared_buf*) buf;
+  atomic_size_t length;
+  ptr_dtor_fn ele_dtor_fn;
+  EpochDomain* domain;
+  pthread_mutex_t lock;  // serializes writers
+};
+
+static shared_buf* buf_new(size_t capacity) {
+  shared_buf* buf =
+      (shared_buf*)malloc(sizeof(shared_buf) + capacity * sizeof(ptr_t));
+  if (buf == NULL) {
+    panic("malloc failed");
+  }
+  buf->capacity = capacity;
+  return buf;
+}
+
+// hands a removed element to the domain, to be destructed once no
+// reader can see it
+static void retire_element(SharedVec* self, ptr_t ele) {
+  if (ele != NULL && self->ele_dtor_fn != NULL) {
+    epoch_retire(self->domain, ele, self->ele_dtor_fn);
+  }
+}
+
+SharedVec* shared_vec_new(EpochDomain* domain,
+                          size_t initial_capacity,
+                          ptr_dtor_fn ele_dtor_fn) {
+  if (domain == NULL) {
+    panic("domain is NULL");
+  }
+  SharedVec* res = (SharedVec*)malloc(sizeof(SharedVec));
+  if (res == NULL) {
+    panic("malloc failed");
+  }
+  atomic_init(&res->buf, buf_new(initial_capacity));
+  atomic_init(&res->length, 0);
+  res->ele_dtor_fn = ele_dtor_fn;
+  res->domain = domain;
+  pthread_mutex_init(&res->lock, NULL);
+  return res;
+}
+
+void shared_vec_free(SharedVec* self) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  shared_buf* buf = atomic_load(&self->buf);
+  size_t length = atomic_load(&self->length);
+  if (self->ele_dtor_fn != NULL) {
+    for (size_t i = 0; i < length; i++) {
+      if (buf->data[i] != NULL) {
+        self->ele_dtor_fn(buf->data[i]);
+      }
+    }
+  }
+  free(buf);
+  pthread_mutex_destroy(&self->lock);
+  free(self);
+}
+
+size_t shared_vec_len(SharedVec* self) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  return atomic_load_explicit(&self->length, memory_order_acquire);
+}
+
+void shared_vec_push_back(SharedVec* self, ptr_t new_ele) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  pthread_mutex_lock(&self->lock);
+  shared_buf* buf = atomic_load_explicit(&self->buf, memory_order_relaxed);
+  size_t length = atomic_load_explicit(&self->length, memory_order_relaxed);
+
+  if (length == buf->capacity) {
+    shared_buf* bigger = buf_new(buf->capacity == 0 ? 1 : buf->capacity * 2);
+    for (size_t i = 0; i < length; i++) {
+      bigger->data[i] = __atomic_load_n(&buf->data[i], __ATOMIC_RELAXED);
+    }
+    atomic_store_explicit(&self->buf, bigger, memory_order_release);
+    epoch_retire(self->domain, buf, free);
+    buf = bigger;
+  }
+
+  // a reader that loaded the length before a pop may still read the slot
+  __atomic_store_n(&buf->data[length], new_ele, __ATOMIC_RELEASE);
+  // release publishes the element, and the buffer before it
+  atomic_store_explicit(&self->length, length + 1, memory_order_release);
+  pthread_mutex_unlock(&self->lock);
+}
+
+void shared_vec_set(SharedVec* self, size_t index, ptr_t new_ele) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  pthread_mutex_lock(&self->lock);
+  if (index >= atomic_load_explicit(&self->length, memory_order_relaxed)) {
+    pthread_mutex_unlock(&self->lock);
+    panic("index out of bound");
+  }
+  shared_buf* buf = atomic_load_explicit(&self->buf, memory_order_relaxed);
+  ptr_t old =
+      __atomic_exchange_n(&buf->data[index], new_ele, __ATOMIC_RELEASE);
+  retire_element(self, old);
+  pthread_mutex_unlock(&self->lock);
+}
+
+bool shared_vec_pop_back(SharedVec* self) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  pthread_mutex_lock(&self->lock);
+  size_t length = atomic_load_explicit(&self->length, memory_order_relaxed);
+  if (length == 0) {
+    pthread_mutex_unlock(&self->lock);
+    return false;
+  }
+  shared_buf* buf = atomic_load_explicit(&self->buf, memory_order_relaxed);
+  ptr_t old = __atomic_load_n(&buf->data[length - 1], __ATOMIC_RELAXED);
+  atomic_store_explicit(&self->length, length - 1, memory_order_release);
+  retire_element(self, old);
+  pthread_mutex_unlock(&self->lock);
+  return true;
+}
+
+SharedVecView shared_vec_view(SharedVec* self) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  // the length first, see the comment at the top
+  size_t length = atomic_load_explicit(&self->length, memory_order_acquire);
+  shared_buf* buf = atomic_load_explicit(&self->buf, memory_order_acquire);
+  SharedVecView view = {buf->data, length};
+  return view;
+}
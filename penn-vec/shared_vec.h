@@ -0,0 +1,117 @@
+#ifndef SHARED_VEC_H_
+#define SHARED_VEC_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "./Vec.h"
+#include "./epoch.h"
+
+/*!
+ * A growable vector that readers on other threads can iterate while writers
+ * push to it, without locks on the read side.
+ *
+ * Iterating a plain Vec while another thread calls vec_push_back() is a use
+ * after free waiting to happen: the push may realloc the buffer the reader
+ * is walking. A SharedVec never reallocs in place. When it runs out of room
+ * the writer copies the elements into a new buffer, publishes it with an
+ * atomic store and retires the old one through an EpochDomain (see epoch.h),
+ * which frees it once every reader that could still be using it is done.
+ *
+ * Readers take a view inside a read section:
+ *
+ *   epoch_enter(&reader);
+ *   SharedVecView view = shared_vec_view(vec);
+ *   for (size_t i = 0; i < view.length; i++) {
+ *     use(shared_vec_view_get(&view, i));
+ *   }
+ *   epoch_exit(&reader);
+ *
+ * A view holds the elements that were in the vector when it was taken, or
+ * newer values of them if they were set since. Elements removed or replaced
+ * by a writer are also retired, so they stay valid until the read section
+ * ends.
+ *
+ * Writers are serialized by a mutex inside the SharedVec.
+ */
+
+typedef struct shared_vec_st SharedVec;
+
+typedef struct shared_vec_view_st {
+  ptr_t* data;
+  size_t length;
+} SharedVecView;
+
+/*!
+ * Creates a new empty SharedVec.
+ *
+ * @param domain           the domain readers of the vector register with.
+ *                         It must outlive the vector.
+ * @param initial_capacity the initial capacity of the vector.
+ * @param ele_dtor_fn      the function cleaning up removed elements, or NULL.
+ * @returns a newly created SharedVec.
+ * @post if memory allocation fails, the function will panic.
+ */
+SharedVec* shared_vec_new(EpochDomain* domain,
+                          size_t initial_capacity,
+                          ptr_dtor_fn ele_dtor_fn);
+
+/*!
+ * Destroys the vector, its elements and its buffer right away.
+ *
+ * @param self the vector to free.
+ * @pre no reader may still be using the vector.
+ */
+void shared_vec_free(SharedVec* self);
+
+/* Returns the number of elements in the vector.
+ *
+ * @param self the vector.
+ */
+size_t shared_vec_len(SharedVec* self);
+
+/* Appends an element. If the vector is full, the elements are copied to a
+ * buffer twice as large and the old buffer is retired.
+ *
+ * @param self    the vector to push onto.
+ * @param new_ele the element to append.
+ * @post if memory allocation fails, the function will panic.
+ */
+void shared_vec_push_back(SharedVec* self, ptr_t new_ele);
+
+/* Replaces an element, retiring the old one.
+ *
+ * @param self    the vector.
+ * @param index   the index of the element to replace.
+ * @param new_ele the new element.
+ * @pre if the index is >= the length this function will panic().
+ */
+void shared_vec_set(SharedVec* self, size_t index, ptr_t new_ele);
+
+/* Removes the last element, retiring it.
+ *
+ * @param self the vector.
+ * @returns true iff an element was removed.
+ */
+bool shared_vec_pop_back(SharedVec* self);
+
+/* Takes a view of the vector. Must be called inside a read section, and
+ * the view must not be used after the section ends.
+ *
+ * @param self the vector to read.
+ * @returns the current buffer and length.
+ */
+SharedVecView shared_vec_view(SharedVec* self);
+
+/* Gets an element of a view.
+ *
+ * @param view  the view taken in the current read section.
+ * @param index the index of the element, < view->length.
+ */
+static inline ptr_t shared_vec_view_get(const SharedVecView* view,
+                                        size_t index) {
+  // writers may store to the slot concurrently, see shared_vec_set(),
+  // acquire pairs with their release so the element itself is visible
+  return __atomic_load_n(&view->data[index], __ATOMIC_ACQUIRE);
+}
+
+#endif  // SHARED_VEC_H_
@@ -0,0 +1,71 @@
+#include "./simd.h"
+#include <stdlib.h>
+#include <string.h>
+
+// the level everything is dispatched to, -1 until first use
+static int selected_level = -1;
+
+static const char* const kLevelNames[SIMD_LEVEL_COUNT] = {
+    "scalar", "sse2", "sse4.2", "avx2", "avx512",
+};
+
+simd_level simd_detect(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  // the avx512 kernels use the F, BW and VL subsets
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+      __builtin_cpu_supports("avx512vl")) {
+    return SIMD_AVX512;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return SIMD_AVX2;
+  }
+  if (__builtin_cpu_supports("sse4.2")) {
+    return SIMD_SSE42;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return SIMD_SSE2;
+  }
+#endif
+  return SIMD_SCALAR;
+}
+
+simd_level simd_get_level(void) {
+  if (selected_level < 0) {
+    simd_level level = simd_detect();
+
+    // allow forcing a lower level without recompiling
+    const char* env = getenv("PENN_VEC_SIMD");
+    if (env != NULL) {
+      for (int i = 0; i < SIMD_LEVEL_COUNT; i++) {
+        if (strcmp(env, kLevelNames[i]) == 0 && i < (int)level) {
+          level = (simd_level)i;
+        }
+      }
+    }
+    selected_level = (int)level;
+  }
+  return (simd_level)selected_level;
+}
+
+// pick the level once at startup so that the kernels never race on
+// the first call when used from several threads
+__attribute__((constructor)) static void simd_init(void) {
+  (void)simd_get_level();
+}
+
+simd_level simd_set_level(simd_level level) {
+  simd_level best = simd_detect();
+  if (level > best) {
+    level = best;
+  }
+  selected_level = (int)level;
+  return level;
+}
+
+const char* simd_level_name(simd_level level) {
+  if (level < SIMD_SCALAR || level >= SIMD_LEVEL_COUNT) {
+    return "unknown";
+  }
+  return kLevelNames[level];
+}
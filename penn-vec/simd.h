@@ -0,0 +1,65 @@
+#ifndef SIMD_H_
+#define SIMD_H_
+
+#include <stdbool.h>
+
+/*!
+ * Runtime selection of SIMD kernels.
+ *
+ * The kernel libraries (vec_search.c, vector_kernels.c, ...) compile one
+ * variant of each kernel per instruction set with
+ * __attribute__((target(...))) so that the rest of the build does not need
+ * -mavx2 and friends. On the first call the best level the CPU (and OS)
+ * supports is detected with cpuid, and every kernel call is dispatched through
+ * a per-level table indexed with simd_get_level().
+ *
+ * Levels are ordered, a CPU that supports a level supports every level below
+ * it. A kernel library that has no variant for some level uses the variant
+ * of the next lower level instead.
+ */
+
+typedef enum simd_level_en {
+  SIMD_SCALAR = 0,
+  SIMD_SSE2,
+  SIMD_SSE42,
+  SIMD_AVX2,
+  SIMD_AVX512,
+  SIMD_LEVEL_COUNT,
+} simd_level;
+
+/*!
+ * Detects the best level supported by the CPU we are running on.
+ * Always returns SIMD_SCALAR on non x86 builds.
+ *
+ * @returns the best supported simd_level
+ */
+simd_level simd_detect(void);
+
+/*!
+ * Returns the level that kernels are currently dispatched to.
+ * This is simd_detect() unless changed with simd_set_level() or the
+ * PENN_VEC_SIMD environment variable (one of the simd_level_name() names).
+ *
+ * @returns the selected simd_level
+ */
+simd_level simd_get_level(void);
+
+/*!
+ * Forces kernels to be dispatched to the specified level. Mostly useful for
+ * testing and benchmarking the lower level kernels against each other.
+ *
+ * @param level the level we want to use.
+ * @returns the level that was actually selected, which is `level` clamped to
+ * what simd_detect() says the CPU supports.
+ */
+simd_level simd_set_level(simd_level level);
+
+/*!
+ * Returns a human readable name for the level, e.g. "avx2"
+ *
+ * @param level the level we want the name of
+ * @returns a statically allocated string. "unknown" for invalid levels.
+ */
+const char* simd_level_name(simd_level level);
+
+#endif  // SIMD_H_
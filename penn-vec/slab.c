@@ -0,0 +1,130 @@
+#include "./slab.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include "./panic.h"
+
+// pages are big enough for at least this many objects
+#define SLAB_MIN_OBJECTS 8
+
+// every page starts with this header, objects follow at an aligned offset
+typedef struct slab_page_st {
+  struct slab_page_st* next;
+} slab_page;
+
+#define PAGE_HEADER_SIZE \
+  ((sizeof(slab_page) + SLAB_ALIGN - 1) / SLAB_ALIGN * SLAB_ALIGN)
+
+static inline size_t round_up(size_t size, size_t align) {
+  return (size + align - 1) / align * align;
+}
+
+static inline char* page_objects(slab_page* page) {
+  return (char*)page + PAGE_HEADER_SIZE;
+}
+
+// points the bump allocator at the objects of `page`
+static void bump_into(Slab* self, slab_page* page) {
+  self->current = page;
+  self->bump = page_objects(page);
+  self->bump_end = (char*)page + self->page_size;
+}
+
+// moves the bump pointer to the next page, reusing a page kept by
+// slab_reset() if there is one, allocating a new one otherwise
+static void next_page(Slab* self) {
+  slab_page* page = self->current == NULL ? self->pages : self->current->next;
+  if (page == NULL) {
+    // malloc already aligns to SLAB_ALIGN, and asking for page alignment
+    // makes glibc split off and track a fragment per page
+    page = (slab_page*)malloc(self->page_size);
+    if (page == NULL) {
+      panic("malloc failed");
+    }
+    page->next = NULL;
+    if (self->current == NULL) {
+      self->pages = page;
+    } else {
+      self->current->next = page;
+    }
+    self->page_count++;
+  }
+  bump_into(self, page);
+}
+
+Slab slab_new(size_t object_size) {
+  if (object_size == 0) {
+    panic("object size should be positive");
+  }
+  Slab res = {0};
+  // a freed object holds the free list link
+  if (object_size < sizeof(void*)) {
+    object_size = sizeof(void*);
+  }
+  res.object_size = round_up(object_size, SLAB_ALIGN);
+  res.page_size =
+      round_up(PAGE_HEADER_SIZE + SLAB_MIN_OBJECTS * res.object_size,
+               SLAB_PAGE_SIZE);
+  return res;
+}
+
+void* slab_alloc(Slab* self) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  void* obj = self->free_list;
+  if (obj != NULL) {
+    self->free_list = *(void**)obj;
+  } else {
+    if ((size_t)(self->bump_end - self->bump) < self->object_size) {
+      next_page(self);
+    }
+    obj = self->bump;
+    self->bump += self->object_size;
+  }
+  self->live++;
+  return obj;
+}
+
+void slab_free(Slab* self, void* obj) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  if (obj == NULL) {
+    return;
+  }
+  *(void**)obj = self->free_list;
+  self->free_list = obj;
+  self->live--;
+}
+
+void slab_reset(Slab* self) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  // the bump pointer starts over from the first page, the next pages
+  // are picked up again by next_page() as it runs out
+  self->free_list = NULL;
+  self->live = 0;
+  if (self->pages != NULL) {
+    bump_into(self, self->pages);
+  }
+}
+
+void slab_destroy(Slab* self) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  slab_page* page = self->pages;
+  while (page != NULL) {
+    slab_page* next = page->next;
+    free(page);
+    page = next;
+  }
+  self->pages = NULL;
+  self->current = NULL;
+  self->bump = NULL;
+  self->bump_end = NULL;
+  self->free_list = NULL;
+  self->live = 0;
+  self->page_count = 0;
+}
@@ -0,0 +1,85 @@
+#ifndef SLAB_H_
+#define SLAB_H_
+
+#include <stddef.h>
+
+/*!
+ * A pool of fixed-size objects carved out of page-sized slabs.
+ *
+ * Elements of a Vec are usually small malloc'd structs that are freed one
+ * by one. A Slab hands out objects of a single size instead: it grabs
+ * memory a page at a time, carves objects off the current page with a bump
+ * pointer, and keeps the objects given back by slab_free() on an intrusive
+ * free list so the next slab_alloc() reuses them. Both are O(1) and touch
+ * no allocator lock or bookkeeping.
+ *
+ * The main win is slab_reset(), which releases every object at once in O(1)
+ * by forgetting the free list and rewinding the bump pointer to the first
+ * page. The pages are kept for the next round of allocations. A Vec created
+ * with vec_new_slab() uses it to clear itself without N calls to free().
+ *
+ * Objects are aligned to SLAB_ALIGN bytes.
+ */
+
+#define SLAB_ALIGN 16
+#define SLAB_PAGE_SIZE 4096
+
+struct slab_page_st;
+
+typedef struct slab_st {
+  size_t object_size;            // rounded up to SLAB_ALIGN
+  size_t page_size;              // a multiple of SLAB_PAGE_SIZE
+  struct slab_page_st* pages;    // every page, in allocation order
+  struct slab_page_st* current;  // the page the bump pointer is in
+  char* bump;
+  char* bump_end;
+  void* free_list;
+  size_t live;  // objects handed out and not yet given back
+  size_t page_count;
+} Slab;
+
+/*!
+ * Creates a new empty Slab. No memory is allocated until the first object.
+ *
+ * @param object_size the size in bytes of every object, > 0.
+ * @returns a newly created Slab.
+ */
+Slab slab_new(size_t object_size);
+
+/* Returns the number of objects handed out and not given back. */
+#define slab_live(self) ((self)->live)
+
+/*!
+ * Allocates one object. The contents of the object are unspecified.
+ *
+ * @param self a pointer to the Slab to allocate from.
+ * @returns a pointer to object_size bytes aligned to SLAB_ALIGN.
+ * @post if a new page is needed and allocating it fails, the function will
+ * panic.
+ */
+void* slab_alloc(Slab* self);
+
+/*!
+ * Gives an object back to the Slab so that it can be handed out again.
+ *
+ * @param self a pointer to the Slab the object came from.
+ * @param obj  the object to free. NULL is ignored.
+ */
+void slab_free(Slab* self, void* obj);
+
+/*!
+ * Frees every object of the Slab in O(1), keeping its pages.
+ * Every pointer handed out before is invalidated.
+ *
+ * @param self a pointer to the Slab to reset.
+ */
+void slab_reset(Slab* self);
+
+/*!
+ * Frees all pages of the Slab, leaving it empty but usable.
+ *
+ * @param self a pointer to the Slab to destroy.
+ */
+void slab_destroy(Slab* self);
+
+#endif  // SLAB_H_
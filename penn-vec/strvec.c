@@ -0,0 +1,268 @@
+#include "./strvec.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "./panic.h"
+
+// ===========================================================
+// Intern index
+//
+// An open addressing table, probed linearly. Each slot holds the
+// index of a string in its low 32 bits and 32 bits of the string's
+// hash in its high 32 bits, which pick the home slot and let most
+// probes skip comparing the bytes. There are at least
+// INDEX_SLOTS_PER_STRING slots per string, so probes always reach
+// an EMPTY slot. str_vec_clear() empties every slot.
+// ===========================================================
+#define INDEX_EMPTY UINT64_MAX
+#define NO_STRING UINT32_MAX
+#define INDEX_MIN_SLOTS 16
+#define INDEX_SLOTS_PER_STRING 2
+
+// the splitmix64 finalizer
+static inline uint64_t mix(uint64_t x) {
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+static uint32_t hash_bytes(const char* str, size_t len) {
+  uint64_t hash = 0x9E3779B97F4A7C15ULL ^ len;
+  while (len >= sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, str, sizeof(word));
+    hash = mix(hash ^ word);
+    str += sizeof(word);
+    len -= sizeof(word);
+  }
+  if (len > 0) {
+    uint64_t word = 0;
+    memcpy(&word, str, len);
+    hash = mix(hash ^ word);
+  }
+  return (uint32_t)(hash >> 32);
+}
+
+static inline uint64_t make_entry(uint32_t hash, size_t id) {
+  return ((uint64_t)hash << 32) | (uint64_t)id;
+}
+
+static inline uint32_t entry_hash(uint64_t entry) {
+  return (uint32_t)(entry >> 32);
+}
+
+static inline uint32_t entry_id(uint64_t entry) {
+  return (uint32_t)entry;
+}
+
+static inline size_t string_len(const StrVec* self, size_t index) {
+  return self->offsets[index + 1] - self->offsets[index] - 1;
+}
+
+static inline bool string_equals(const StrVec* self,
+                                 size_t index,
+                                 const char* str,
+                                 size_t len) {
+  return string_len(self, index) == len &&
+         memcmp(self->bytes + self->offsets[index], str, len) == 0;
+}
+
+// returns the slot naming an equal string, or the EMPTY slot ending
+// the probe sequence if there is none
+static size_t index_probe(const StrVec* self,
+                          const char* str,
+                          size_t len,
+                          uint32_t hash) {
+  size_t slot = (size_t)hash & self->index_mask;
+  for (;;) {
+    uint64_t entry = self->index[slot];
+    if (entry == INDEX_EMPTY ||
+        (entry_hash(entry) == hash &&
+         string_equals(self, entry_id(entry), str, len))) {
+      return slot;
+    }
+    slot = (slot + 1) & self->index_mask;
+  }
+}
+
+// rebuilds the index with `slots` slots, keeping every entry
+static void index_rebuild(StrVec* self, size_t slots) {
+  uint64_t* old = self->index;
+  size_t old_slots = old == NULL ? 0 : self->index_mask + 1;
+
+  self->index = (uint64_t*)malloc(slots * sizeof(uint64_t));
+  if (self->index == NULL) {
+    panic("malloc failed");
+  }
+  memset(self->index, 0xFF, slots * sizeof(uint64_t));
+  self->index_mask = slots - 1;
+
+  // entries are distinct strings, so no comparisons are needed
+  for (size_t i = 0; i < old_slots; i++) {
+    if (old[i] != INDEX_EMPTY) {
+      size_t slot = (size_t)entry_hash(old[i]) & self->index_mask;
+      while (self->index[slot] != INDEX_EMPTY) {
+        slot = (slot + 1) & self->index_mask;
+      }
+      self->index[slot] = old[i];
+    }
+  }
+  free(old);
+}
+
+static size_t index_slots_for(size_t capacity) {
+  size_t slots = INDEX_MIN_SLOTS;
+  while (slots < INDEX_SLOTS_PER_STRING * capacity) {
+    slots *= 2;
+  }
+  return slots;
+}
+
+// ===========================================================
+// Growth
+// ===========================================================
+static void reserve_bytes(StrVec* self, size_t needed) {
+  if (needed <= self->bytes_capacity) {
+    return;
+  }
+  size_t capacity = self->bytes_capacity == 0 ? 1 : self->bytes_capacity;
+  while (capacity < needed) {
+    capacity *= 2;
+  }
+  char* bytes = (char*)realloc(self->bytes, capacity);
+  if (bytes == NULL) {
+    panic("realloc failed");
+  }
+  self->bytes = bytes;
+  self->bytes_capacity = capacity;
+}
+
+static void reserve_strings(StrVec* self, size_t needed) {
+  if (needed <= self->capacity) {
+    return;
+  }
+  size_t capacity = self->capacity == 0 ? 1 : self->capacity * 2;
+  if (capacity < needed) {
+    capacity = needed;
+  }
+  size_t* offsets =
+      (size_t*)realloc(self->offsets, (capacity + 1) * sizeof(size_t));
+  if (offsets == NULL) {
+    panic("realloc failed");
+  }
+  self->offsets = offsets;
+  self->capacity = capacity;
+}
+
+// ===========================================================
+// Public functions
+// ===========================================================
+StrVec str_vec_new(size_t initial_capacity,
+                   size_t initial_bytes,
+                   bool intern) {
+  StrVec res = {0};
+  res.offsets = (size_t*)malloc((initial_capacity + 1) * sizeof(size_t));
+  if (res.offsets == NULL) {
+    panic("malloc failed");
+  }
+  res.offsets[0] = 0;
+  res.capacity = initial_capacity;
+  reserve_bytes(&res, initial_bytes);
+  if (intern) {
+    index_rebuild(&res, index_slots_for(initial_capacity));
+  }
+  return res;
+}
+
+size_t str_vec_append(StrVec* self, const char* str, size_t len) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+
+  size_t slot = 0;
+  uint32_t hash = 0;
+  if (self->index != NULL) {
+    if (self->length >= NO_STRING - 1) {
+      panic("too many strings to intern");
+    }
+    size_t slots = self->index_mask + 1;
+    if (INDEX_SLOTS_PER_STRING * (self->length + 1) > slots) {
+      index_rebuild(self, 2 * slots);
+    }
+    hash = hash_bytes(str, len);
+    slot = index_probe(self, str, len, hash);
+    if (self->index[slot] != INDEX_EMPTY) {
+      return entry_id(self->index[slot]);
+    }
+  }
+
+  size_t start = self->bytes_len;
+  reserve_bytes(self, start + len + 1);
+  reserve_strings(self, self->length + 1);
+  memcpy(self->bytes + start, str, len);
+  self->bytes[start + len] = '\0';
+  self->bytes_len = start + len + 1;
+
+  size_t index = self->length++;
+  self->offsets[self->length] = self->bytes_len;
+  if (self->index != NULL) {
+    self->index[slot] = make_entry(hash, index);
+  }
+  return index;
+}
+
+StrView str_vec_get(StrVec* self, size_t index) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  if (index >= self->length) {
+    panic("index out of bound");
+  }
+  StrView res = {self->bytes + self->offsets[index], string_len(self, index)};
+  return res;
+}
+
+size_t str_vec_find(StrVec* self, const char* str, size_t len) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  if (self->index != NULL) {
+    size_t slot = index_probe(self, str, len, hash_bytes(str, len));
+    uint64_t entry = self->index[slot];
+    return entry != INDEX_EMPTY ? entry_id(entry) : VEC_NPOS;
+  }
+  for (size_t i = 0; i < self->length; i++) {
+    if (string_equals(self, i, str, len)) {
+      return i;
+    }
+  }
+  return VEC_NPOS;
+}
+
+void str_vec_clear(StrVec* self) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  if (self->index != NULL) {
+    memset(self->index, 0xFF, (self->index_mask + 1) * sizeof(uint64_t));
+  }
+  self->length = 0;
+  self->bytes_len = 0;
+}
+
+void str_vec_destroy(StrVec* self) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  free(self->bytes);
+  free(self->offsets);
+  free(self->index);
+  self->bytes = NULL;
+  self->offsets = NULL;
+  self->index = NULL;
+  self->bytes_len = 0;
+  self->bytes_capacity = 0;
+  self->length = 0;
+  self->capacity = 0;
+  self->index_mask = 0;
+}
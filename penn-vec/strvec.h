@@ -0,0 +1,115 @@
+#ifndef STRVEC_H_
+#define STRVEC_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "./Vec.h"  // VEC_NPOS
+
+/*!
+ * A vector of strings that keeps all of their bytes in one arena.
+ *
+ * A Vec of strings usually holds one malloc'd string per element and
+ * frees them one by one. A StrVec instead appends the bytes of every
+ * string (plus a terminating '\0') to a single growable byte array, and
+ * records where each string starts in an offsets array:
+ *
+ *  bytes:   "cat\0dog\0horse\0"
+ *  offsets: {0, 4, 8, 14}      // offsets[i + 1] is where string i ends
+ *
+ * Getting a string is O(1), scanning the strings walks one contiguous
+ * array, there is no per string allocation overhead, and clearing the
+ * whole vector is O(1).
+ *
+ * A StrVec can optionally intern its strings: appending a string that is
+ * already present returns the index of the existing copy instead of
+ * storing it again. Duplicates are found through a hash index on the side.
+ *
+ * The StrVec owns copies of the strings, so nothing has to be freed by the
+ * caller. Pointers returned by str_vec_get() are invalidated by the next
+ * append, since the arena may move when it grows.
+ */
+
+typedef struct str_view_st {
+  const char* ptr;  // '\0' terminated
+  size_t len;       // not counting the '\0'
+} StrView;
+
+typedef struct str_vec_st {
+  char* bytes;
+  size_t bytes_len;
+  size_t bytes_capacity;
+  size_t* offsets;  // length + 1 entries
+  size_t length;
+  size_t capacity;
+  uint64_t* index;  // NULL unless interning, see strvec.c
+  size_t index_mask;
+} StrVec;
+
+/*!
+ * Creates a new empty StrVec.
+ *
+ * @param initial_capacity the number of strings to make room for.
+ * @param initial_bytes    the number of bytes to make room for in the arena,
+ *                         including one terminator per string.
+ * @param intern           true to store each distinct string only once.
+ * @returns a newly created StrVec.
+ * @post if memory allocation fails, the function will panic.
+ */
+StrVec str_vec_new(size_t initial_capacity, size_t initial_bytes, bool intern);
+
+/* Returns the number of strings in the StrVec. */
+#define str_vec_len(self) ((self)->length)
+
+/* Returns the number of bytes used in the arena, terminators included. */
+#define str_vec_bytes(self) ((self)->bytes_len)
+
+/*!
+ * Appends a copy of a string.
+ *
+ * @param self a pointer to the StrVec to append to.
+ * @param str  the bytes of the string, need not be '\0' terminated.
+ * @param len  the number of bytes in str.
+ * @returns the index of the string. When interning and an equal string is
+ * already present, nothing is appended and its index is returned.
+ * @post if a resize is needed and it fails, the function will panic().
+ * Pointers previously returned by str_vec_get() are invalidated.
+ */
+size_t str_vec_append(StrVec* self, const char* str, size_t len);
+
+/*!
+ * Gets the string at the specified index.
+ *
+ * @param self  a pointer to the StrVec.
+ * @param index the index of the string.
+ * @returns a view of the string, valid until the next append, clear or
+ * destroy. panic()'s if the index is >= the length.
+ */
+StrView str_vec_get(StrVec* self, size_t index);
+
+/*!
+ * Finds a string. O(1) on average when interning, a linear scan otherwise.
+ *
+ * @param self a pointer to the StrVec to search.
+ * @param str  the bytes of the string we are looking for.
+ * @param len  the number of bytes in str.
+ * @returns the index of the first equal string, or VEC_NPOS if there is none.
+ */
+size_t str_vec_find(StrVec* self, const char* str, size_t len);
+
+/*!
+ * Removes every string, keeping the allocated storage. O(1), except that
+ * an intern index is emptied too.
+ *
+ * @param self a pointer to the StrVec to clear.
+ */
+void str_vec_clear(StrVec* self);
+
+/*!
+ * Frees the StrVec's storage, leaving it as a 0 capacity StrVec.
+ *
+ * @param self a pointer to the StrVec to destroy.
+ */
+void str_vec_destroy(StrVec* self);
+
+#endif  // STRVEC_H_
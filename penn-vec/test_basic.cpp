@@ -1,5 +1,7 @@
 #include "catch.hpp"
+#include <stdint.h>
 #include <stdlib.h>
+#include <algorithm>
 
 extern "C" {
   #include "./Vec.h"
@@ -450,3 +452,199 @@ TEST_CASE("Stress Test with Large Capacity and Operations", "[stress]") {
   vec_destroy(&v);
   //done...
 }
+
+// --- Batch Destructor ---
+static int batch_calls = 0;
+
+void count_constants_batch(ptr_t* elems, size_t n) {
+  batch_calls += 1;
+  for (size_t i = 0; i < n; i++) {
+    if (elems[i] != nullptr) {
+      count_constants(elems[i]);
+    }
+  }
+}
+
+TEST_CASE("Batch Destructor on Clear and Destroy", "[batch-dtor]") {
+  counter = 0;
+  invocations = 0;
+  batch_calls = 0;
+
+  Vec v = vec_new_batch(5, count_constants_batch);
+  REQUIRE(v.ele_dtor_fn == nullptr);
+  REQUIRE(v.batch_dtor_fn == count_constants_batch);
+  for (uintptr_t i = 0; i < 100; ++i) {
+    vec_push_back(&v, kOne);
+  }
+  vec_push_back(&v, nullptr);
+
+  vec_clear(&v);
+  REQUIRE(v.length == 0);
+  REQUIRE(counter == 100);
+  REQUIRE(invocations == 100);
+  REQUIRE(batch_calls == 1);
+
+  vec_push_back(&v, kTwo);
+  vec_push_back(&v, kThree);
+  vec_destroy(&v);
+  REQUIRE(counter == 105);
+  REQUIRE(invocations == 102);
+  REQUIRE(batch_calls == 2);
+  REQUIRE(v.data == nullptr);
+}
+
+TEST_CASE("Batch Destructor on Single Removals", "[batch-dtor]") {
+  counter = 0;
+  invocations = 0;
+  batch_calls = 0;
+
+  Vec v = vec_new_batch(5, count_constants_batch);
+  vec_push_back(&v, kOne);
+  vec_push_back(&v, kTwo);
+  vec_push_back(&v, kThree);
+
+  vec_erase(&v, 0);
+  REQUIRE(counter == 1);
+  REQUIRE(batch_calls == 1);
+
+  vec_set(&v, 0, kFour);
+  REQUIRE(counter == 3);
+  REQUIRE(batch_calls == 2);
+
+  REQUIRE(vec_pop_back(&v));
+  REQUIRE(counter == 6);
+  REQUIRE(batch_calls == 3);
+
+  vec_destroy(&v);
+  REQUIRE(counter == 10);
+  REQUIRE(invocations == 4);
+  REQUIRE(batch_calls == 4);
+}
+
+TEST_CASE("Batch Destructor not called on empty Vec", "[batch-dtor]") {
+  batch_calls = 0;
+  Vec v = vec_new_batch(0, count_constants_batch);
+  vec_clear(&v);
+  vec_destroy(&v);
+  REQUIRE(batch_calls == 0);
+}
+
+// --- Batched insert and erase ---
+static ptr_t as_ptr(uintptr_t val) {
+  return reinterpret_cast<ptr_t>(val);
+}
+
+TEST_CASE("Insert Many Elements", "[insert-erase-many]") {
+  Vec v = vec_new(4, nullptr);
+  for (uintptr_t i = 0; i < 4; i++) {
+    vec_push_back(&v, as_ptr(i * 10));
+  }
+  // [0, 10, 20, 30] with 1 and 2 before 0, 15 before 20 and 40, 41 at
+  // the end
+  const size_t positions[] = {0, 0, 2, 4, 4};
+  const ptr_t elems[] = {as_ptr(1), as_ptr(2), as_ptr(15), as_ptr(40),
+                         as_ptr(41)};
+  vec_insert_many(&v, positions, elems, 5);
+  const uintptr_t expected[] = {1, 2, 0, 10, 15, 20, 30, 40, 41};
+  REQUIRE(vec_len(&v) == 9);
+  REQUIRE(vec_capacity(&v) == 9);
+  for (size_t i = 0; i < 9; i++) {
+    REQUIRE(vec_get(&v, i) == as_ptr(expected[i]));
+  }
+
+  vec_insert_many(&v, nullptr, nullptr, 0);
+  REQUIRE(vec_len(&v) == 9);
+  vec_destroy(&v);
+
+  // into an empty vector without capacity
+  Vec empty = vec_new(0, nullptr);
+  const size_t zeros[] = {0, 0, 0};
+  vec_insert_many(&empty, zeros, elems, 3);
+  REQUIRE(vec_len(&empty) == 3);
+  REQUIRE(vec_get(&empty, 2) == as_ptr(15));
+  vec_destroy(&empty);
+}
+
+TEST_CASE("Erase Many Indices", "[insert-erase-many]") {
+  counter = 0;
+  invocations = 0;
+  Vec v = vec_new(10, count_constants);
+  for (uintptr_t i = 1; i <= 10; i++) {
+    vec_push_back(&v, as_ptr(i));
+  }
+  const size_t idx[] = {0, 3, 4, 9};
+  vec_erase_indices(&v, idx, 4);
+  const uintptr_t expected[] = {2, 3, 6, 7, 8, 9};
+  REQUIRE(vec_len(&v) == 6);
+  for (size_t i = 0; i < 6; i++) {
+    REQUIRE(vec_get(&v, i) == as_ptr(expected[i]));
+  }
+  REQUIRE(invocations == 4);
+  REQUIRE(counter == 1 + 4 + 5 + 10);
+
+  const size_t all[] = {0, 1, 2, 3, 4, 5};
+  vec_erase_indices(&v, all, 6);
+  REQUIRE(vec_is_empty(&v));
+  REQUIRE(invocations == 10);
+  REQUIRE(counter == 55);
+  vec_destroy(&v);
+
+  // one call of the batch destructor for all of them
+  batch_calls = 0;
+  counter = 0;
+  Vec b = vec_new_batch(8, count_constants_batch);
+  for (uintptr_t i = 1; i <= 8; i++) {
+    vec_push_back(&b, as_ptr(i));
+  }
+  const size_t odd[] = {1, 3, 5, 7};
+  vec_erase_indices(&b, odd, 4);
+  REQUIRE(batch_calls == 1);
+  REQUIRE(counter == 2 + 4 + 6 + 8);
+  REQUIRE(vec_len(&b) == 4);
+  REQUIRE(vec_get(&b, 3) == as_ptr(7));
+  vec_destroy(&b);
+}
+
+TEST_CASE("Insert and Erase Many match single calls", "[insert-erase-many]") {
+  uint64_t state = 5;
+  auto next = [&state]() {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return state >> 33;
+  };
+  Vec batched = vec_new(0, nullptr);
+  Vec single = vec_new(0, nullptr);
+  for (int round = 0; round < 50; round++) {
+    size_t k = next() % 40;
+    size_t positions[40];
+    ptr_t elems[40];
+    for (size_t j = 0; j < k; j++) {
+      positions[j] = next() % (vec_len(&single) + 1);
+      elems[j] = as_ptr(round * 100 + j);
+    }
+    std::sort(positions, positions + k);
+    vec_insert_many(&batched, positions, elems, k);
+    // single inserts from the back keep the earlier positions valid
+    for (size_t j = k; j > 0; j--) {
+      vec_insert(&single, positions[j - 1], elems[j - 1]);
+    }
+
+    size_t idx[40];
+    size_t erased = 0;
+    for (size_t i = 0; i < vec_len(&single) && erased < 40; i++) {
+      if (next() % 4 == 0) {
+        idx[erased++] = i;
+      }
+    }
+    vec_erase_indices(&batched, idx, erased);
+    for (size_t j = erased; j > 0; j--) {
+      vec_erase(&single, idx[j - 1]);
+    }
+
+    REQUIRE(vec_len(&batched) == vec_len(&single));
+    for (size_t i = 0; i < vec_len(&single); i++) {
+      REQUIRE(vec_get(&batched, i) == vec_get(&single, i));
+    }
+  }
+  vec_destroy(&batched);
+  vec_destroy(&single);
+}
@@ -0,0 +1,136 @@
+#include "catch.hpp"
+#include <stdint.h>
+#include <stdlib.h>
+#include <deque>
+
+extern "C" {
+  #include "./deque.h"
+}
+
+using namespace std;
+
+static uintptr_t counter = 0;
+static int invocations = 0;
+
+static void count_constants(void* input) {
+  counter += *reinterpret_cast<uintptr_t*>(input);
+  invocations += 1;
+}
+
+TEST_CASE("deque push and pop at both ends", "[deque]") {
+  deque(int) dq = nullptr;
+  REQUIRE(deque_len(&dq) == 0);
+  REQUIRE(deque_capacity(&dq) == 0);
+  REQUIRE_FALSE(deque_pop_front(&dq));
+  REQUIRE_FALSE(deque_pop_back(&dq));
+
+  deque_push_back(&dq, 1);
+  deque_push_back(&dq, 2);
+  deque_push_front(&dq, 0);
+  deque_push_front(&dq, -1);
+
+  REQUIRE(deque_len(&dq) == 4);
+  REQUIRE(deque_capacity(&dq) == 4);
+  for (int i = 0; i < 4; i++) {
+    REQUIRE(deque_get(&dq, i) == i - 1);
+  }
+  REQUIRE(deque_front(&dq) == -1);
+  REQUIRE(deque_back(&dq) == 2);
+
+  REQUIRE(deque_pop_front(&dq));
+  REQUIRE(deque_pop_back(&dq));
+  REQUIRE(deque_front(&dq) == 0);
+  REQUIRE(deque_back(&dq) == 1);
+
+  deque_set(&dq, 1, 10);
+  REQUIRE(deque_get(&dq, 1) == 10);
+  *deque_at(&dq, 0) = 5;
+  REQUIRE(deque_front(&dq) == 5);
+
+  deque_free(&dq);
+  REQUIRE(dq == nullptr);
+}
+
+TEST_CASE("deque keeps its order when it grows while wrapped", "[deque]") {
+  deque(int) dq = deque_new(int, 3, nullptr);
+  REQUIRE(deque_capacity(&dq) == 4);
+
+  // head ends up in the middle of the buffer
+  deque_push_back(&dq, 2);
+  deque_push_back(&dq, 3);
+  deque_push_front(&dq, 1);
+  deque_push_front(&dq, 0);
+  deque_push_back(&dq, 4);
+
+  REQUIRE(deque_capacity(&dq) == 8);
+  for (int i = 0; i < 5; i++) {
+    REQUIRE(deque_get(&dq, i) == i);
+  }
+
+  deque_reserve(&dq, 100);
+  REQUIRE(deque_capacity(&dq) == 128);
+  for (int i = 0; i < 5; i++) {
+    REQUIRE(deque_get(&dq, i) == i);
+  }
+  deque_free(&dq);
+}
+
+TEST_CASE("deque destroys elements", "[deque]") {
+  counter = 0;
+  invocations = 0;
+
+  deque(uintptr_t) dq = deque_new(uintptr_t, 0, count_constants);
+  for (uintptr_t i = 1; i <= 6; i++) {
+    deque_push_back(&dq, i);
+  }
+  deque_pop_front(&dq);
+  deque_pop_back(&dq);
+  REQUIRE(invocations == 2);
+  REQUIRE(counter == 7);
+
+  deque_set(&dq, 0, 100);
+  REQUIRE(counter == 9);
+
+  // 100 + 3 + 4 + 5
+  deque_free(&dq);
+  REQUIRE(invocations == 7);
+  REQUIRE(counter == 121);
+}
+
+TEST_CASE("deque matches std::deque", "[deque]") {
+  deque(int) dq = nullptr;
+  std::deque<int> expected;
+  srand(31);
+
+  for (int op = 0; op < 10000; op++) {
+    int value = rand();
+    switch (rand() % 4) {
+      case 0:
+        deque_push_back(&dq, value);
+        expected.push_back(value);
+        break;
+      case 1:
+        deque_push_front(&dq, value);
+        expected.push_front(value);
+        break;
+      case 2:
+        REQUIRE(deque_pop_back(&dq) == !expected.empty());
+        if (!expected.empty()) {
+          expected.pop_back();
+        }
+        break;
+      default:
+        REQUIRE(deque_pop_front(&dq) == !expected.empty());
+        if (!expected.empty()) {
+          expected.pop_front();
+        }
+        break;
+    }
+    REQUIRE(deque_len(&dq) == expected.size());
+  }
+
+  for (size_t i = 0; i < expected.size(); i++) {
+    REQUIRE(deque_get(&dq, i) == expected[i]);
+  }
+  deque_free(&dq);
+}
@@ -0,0 +1,184 @@
+#include "catch.hpp"
+#include <stdint.h>
+#include <stdlib.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+extern "C" {
+  #include "./epoch.h"
+  #include "./shared_vec.h"
+}
+
+using namespace std;
+
+static std::atomic<int> reclaimed{0};
+
+static void count_free(void* ptr) {
+  free(ptr);
+  reclaimed++;
+}
+
+static ptr_t new_int(size_t value) {
+  size_t* ptr = static_cast<size_t*>(malloc(sizeof(size_t)));
+  *ptr = value;
+  return ptr;
+}
+
+static size_t int_at(const SharedVecView* view, size_t index) {
+  return *static_cast<size_t*>(shared_vec_view_get(view, index));
+}
+
+TEST_CASE("Retired objects wait for readers", "[epoch]") {
+  reclaimed = 0;
+  EpochDomain* domain = epoch_domain_new();
+  EpochReader reader = epoch_register(domain);
+
+  // nobody is reading, retiring advances right away
+  epoch_retire(domain, malloc(8), count_free);
+  epoch_synchronize(domain);
+  REQUIRE(reclaimed == 1);
+  REQUIRE(epoch_pending(domain) == 0);
+
+  epoch_enter(&reader);
+  for (int i = 0; i < 10; i++) {
+    epoch_retire(domain, malloc(8), count_free);
+  }
+  REQUIRE(reclaimed == 1);
+  REQUIRE(epoch_pending(domain) == 10);
+  epoch_exit(&reader);
+
+  epoch_synchronize(domain);
+  REQUIRE(reclaimed == 11);
+  epoch_retire(domain, nullptr, count_free);
+  REQUIRE(epoch_pending(domain) == 0);
+
+  // retired objects left over are freed with the domain
+  epoch_enter(&reader);
+  epoch_retire(domain, malloc(8), count_free);
+  epoch_exit(&reader);
+  epoch_unregister(&reader);
+  REQUIRE(reader.domain == nullptr);
+  epoch_domain_free(domain);
+  REQUIRE(reclaimed == 12);
+}
+
+TEST_CASE("Reader slots are given back", "[epoch]") {
+  EpochDomain* domain = epoch_domain_new();
+  std::vector<EpochReader> readers;
+  for (int i = 0; i < EPOCH_MAX_READERS; i++) {
+    readers.push_back(epoch_register(domain));
+  }
+  epoch_unregister(&readers[5]);
+  EpochReader again = epoch_register(domain);
+  REQUIRE(again.slot == 5);
+  readers[5] = again;
+  for (auto& reader : readers) {
+    epoch_unregister(&reader);
+  }
+  epoch_domain_free(domain);
+}
+
+TEST_CASE("SharedVec basic operations", "[epoch]") {
+  reclaimed = 0;
+  EpochDomain* domain = epoch_domain_new();
+  EpochReader reader = epoch_register(domain);
+  SharedVec* vec = shared_vec_new(domain, 0, count_free);
+
+  for (size_t i = 0; i < 100; i++) {
+    shared_vec_push_back(vec, new_int(i));
+  }
+  REQUIRE(shared_vec_len(vec) == 100);
+
+  epoch_enter(&reader);
+  SharedVecView view = shared_vec_view(vec);
+  REQUIRE(view.length == 100);
+
+  // the view keeps working while the vector grows and changes
+  for (size_t i = 100; i < 1000; i++) {
+    shared_vec_push_back(vec, new_int(i));
+  }
+  shared_vec_set(vec, 0, new_int(1000));
+  REQUIRE(shared_vec_pop_back(vec));
+  for (size_t i = 1; i < 100; i++) {
+    REQUIRE(int_at(&view, i) == i);
+  }
+  REQUIRE(reclaimed == 0);
+  epoch_exit(&reader);
+
+  epoch_synchronize(domain);
+  REQUIRE(reclaimed == 2);
+
+  epoch_enter(&reader);
+  view = shared_vec_view(vec);
+  REQUIRE(view.length == 999);
+  REQUIRE(int_at(&view, 0) == 1000);
+  REQUIRE(int_at(&view, 998) == 998);
+  epoch_exit(&reader);
+
+  while (shared_vec_pop_back(vec)) {
+  }
+  REQUIRE(shared_vec_len(vec) == 0);
+  epoch_synchronize(domain);
+  REQUIRE(reclaimed == 1001);
+
+  shared_vec_push_back(vec, new_int(7));
+  shared_vec_free(vec);
+  REQUIRE(reclaimed == 1002);
+  epoch_unregister(&reader);
+  epoch_domain_free(domain);
+}
+
+// Readers walk the vector while a writer grows it, overwrites and pops
+// elements. Every element holds its own index, so a reader that sees
+// anything else read freed or uninitialized memory. Run this under
+// ThreadSanitizer with `make tsan`.
+TEST_CASE("SharedVec readers during growth", "[epoch]") {
+  reclaimed = 0;
+  constexpr int kReaders = 4;
+  constexpr size_t kPushes = 50000;
+
+  EpochDomain* domain = epoch_domain_new();
+  SharedVec* vec = shared_vec_new(domain, 1, count_free);
+  std::atomic<bool> done{false};
+  std::atomic<size_t> bad{0};
+
+  std::vector<std::thread> readers;
+  for (int r = 0; r < kReaders; r++) {
+    readers.emplace_back([&] {
+      EpochReader reader = epoch_register(domain);
+      do {
+        epoch_enter(&reader);
+        SharedVecView view = shared_vec_view(vec);
+        for (size_t i = 0; i < view.length; i += 1 + view.length / 64) {
+          bad += int_at(&view, i) != i;
+        }
+        epoch_exit(&reader);
+      } while (!done.load());
+      epoch_unregister(&reader);
+    });
+  }
+
+  size_t created = 0;
+  for (size_t i = 0; i < kPushes; i++) {
+    size_t len = shared_vec_len(vec);
+    if (i % 7 == 3 && len > 0) {
+      shared_vec_set(vec, i % len, new_int(i % len));
+      created++;
+    } else if (i % 11 == 5 && len > 0) {
+      shared_vec_pop_back(vec);
+    } else {
+      shared_vec_push_back(vec, new_int(len));
+      created++;
+    }
+  }
+  done = true;
+  for (auto& reader : readers) {
+    reader.join();
+  }
+
+  REQUIRE(bad == 0);
+  shared_vec_free(vec);
+  epoch_domain_free(domain);
+  REQUIRE(reclaimed == static_cast<int>(created));
+}
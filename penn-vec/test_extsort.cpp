@@ -0,0 +1,135 @@
+#include "catch.hpp"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+
+extern "C" {
+  #include "./extsort.h"
+}
+
+using namespace std;
+
+static ptr_t as_ptr(uintptr_t val) {
+  return reinterpret_cast<ptr_t>(val);
+}
+
+static void collect(const ptr_t* keys, size_t n, void* arg) {
+  auto* out = static_cast<std::vector<uintptr_t>*>(arg);
+  for (size_t i = 0; i < n; i++) {
+    out->push_back(reinterpret_cast<uintptr_t>(keys[i]));
+  }
+}
+
+static std::vector<uintptr_t> random_keys(size_t n, uint64_t seed) {
+  std::vector<uintptr_t> keys;
+  for (size_t i = 0; i < n; i++) {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    keys.push_back(seed >> 20);
+  }
+  return keys;
+}
+
+static void push_all(ExtSort* sort, const std::vector<uintptr_t>& keys) {
+  // in uneven batches, so runs end in the middle of a push
+  size_t i = 0;
+  while (i < keys.size()) {
+    size_t n = std::min<size_t>(777, keys.size() - i);
+    ext_sort_push(sort, reinterpret_cast<const ptr_t*>(&keys[i]), n);
+    i += n;
+  }
+}
+
+TEST_CASE("ExtSort in memory", "[extsort]") {
+  ExtSort* sort = ext_sort_new(1 << 20, NULL, NULL);
+  std::vector<uintptr_t> out;
+  ext_sort_finish(sort, collect, &out);
+  REQUIRE(out.empty());
+
+  std::vector<uintptr_t> keys = random_keys(10000, 1);
+  push_all(sort, keys);
+  REQUIRE(ext_sort_runs(sort) == 0);
+  ext_sort_finish(sort, collect, &out);
+  std::sort(keys.begin(), keys.end());
+  REQUIRE(out == keys);
+  ext_sort_free(sort);
+}
+
+TEST_CASE("ExtSort with a small budget spills many runs", "[extsort]") {
+  // 1024 keys per run, and only three runs merge at once, so this takes
+  // several merge passes
+  ExtSort* sort = ext_sort_new(EXT_SORT_MIN_BUDGET, NULL, NULL);
+  for (size_t n : {1024, 1025, 3 * 1024, 50000, 200000}) {
+    std::vector<uintptr_t> keys = random_keys(n, n);
+    push_all(sort, keys);
+    REQUIRE(ext_sort_runs(sort) == n / 1024);
+
+    std::vector<uintptr_t> out;
+    ext_sort_finish(sort, collect, &out);
+    REQUIRE(ext_sort_runs(sort) == 0);
+    std::sort(keys.begin(), keys.end());
+    REQUIRE(out.size() == keys.size());
+    REQUIRE(out == keys);
+  }
+  ext_sort_free(sort);
+}
+
+// orders keys by their upper 32 bits only
+static int compare_upper(ptr_t a, ptr_t b) {
+  uintptr_t x = reinterpret_cast<uintptr_t>(a) >> 32;
+  uintptr_t y = reinterpret_cast<uintptr_t>(b) >> 32;
+  return (x > y) - (x < y);
+}
+
+TEST_CASE("ExtSort with a comparator is stable", "[extsort]") {
+  ExtSort* sort = ext_sort_new(64 * 1024, compare_upper, NULL);
+  Vec vec = vec_new(0, NULL);
+  constexpr size_t kKeys = 100000;
+  uint64_t state = 3;
+  for (uintptr_t seq = 0; seq < kKeys; seq++) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    // few distinct keys, the order of pushes is in the lower bits
+    vec_push_back(&vec, as_ptr(((state >> 33) % 50) << 32 | seq));
+  }
+  ext_sort_push_vec(sort, &vec);
+  REQUIRE(ext_sort_runs(sort) > 1);
+
+  std::vector<uintptr_t> out;
+  ext_sort_finish(sort, collect, &out);
+  REQUIRE(out.size() == kKeys);
+  for (size_t i = 1; i < out.size(); i++) {
+    REQUIRE((out[i - 1] >> 32) <= (out[i] >> 32));
+    if ((out[i - 1] >> 32) == (out[i] >> 32)) {
+      REQUIRE((out[i - 1] & 0xFFFFFFFF) < (out[i] & 0xFFFFFFFF));
+    }
+  }
+  vec_destroy(&vec);
+  ext_sort_free(sort);
+}
+
+TEST_CASE("ExtSort to a file", "[extsort]") {
+  ExtSort* sort = ext_sort_new(EXT_SORT_MIN_BUDGET, NULL, "/tmp");
+  std::vector<uintptr_t> keys = random_keys(20000, 9);
+  push_all(sort, keys);
+
+  char path[] = "/tmp/test_extsort-XXXXXX";
+  int fd = mkstemp(path);
+  REQUIRE(fd >= 0);
+  close(fd);
+  ext_sort_finish_file(sort, path);
+
+  FILE* file = fopen(path, "rb");
+  REQUIRE(file != nullptr);
+  std::vector<uintptr_t> out(keys.size() + 1);
+  REQUIRE(fread(out.data(), sizeof(uintptr_t), out.size(), file) ==
+          keys.size());
+  out.pop_back();
+  fclose(file);
+  unlink(path);
+
+  std::sort(keys.begin(), keys.end());
+  REQUIRE(out == keys);
+  ext_sort_free(sort);
+}
@@ -0,0 +1,190 @@
+#include "catch.hpp"
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <set>
+
+extern "C" {
+  #include "./Vec.h"
+  #include "./flat.h"
+}
+
+using namespace std;
+
+static ptr_t as_ptr(uintptr_t val) {
+  return reinterpret_cast<ptr_t>(val);
+}
+
+static uintptr_t as_int(ptr_t ptr) {
+  return reinterpret_cast<uintptr_t>(ptr);
+}
+
+static uintptr_t counter = 0;
+static int invocations = 0;
+
+static void count_constants(ptr_t input) {
+  counter += reinterpret_cast<uintptr_t>(input);
+  invocations += 1;
+}
+
+static int compare_strings(ptr_t a, ptr_t b) {
+  return strcmp(static_cast<char*>(a), static_cast<char*>(b));
+}
+
+TEST_CASE("FlatSet insert, contains and erase", "[flat]") {
+  FlatSet set = flat_set_new(0, nullptr, nullptr);
+  REQUIRE(flat_len(&set) == 0);
+  REQUIRE_FALSE(flat_set_contains(&set, as_ptr(3)));
+
+  REQUIRE(flat_set_insert(&set, as_ptr(5)));
+  REQUIRE(flat_set_insert(&set, as_ptr(1)));
+  REQUIRE(flat_set_insert(&set, as_ptr(3)));
+  REQUIRE_FALSE(flat_set_insert(&set, as_ptr(3)));
+
+  REQUIRE(flat_len(&set) == 3);
+  REQUIRE(flat_key_at(&set, 0) == as_ptr(1));
+  REQUIRE(flat_key_at(&set, 1) == as_ptr(3));
+  REQUIRE(flat_key_at(&set, 2) == as_ptr(5));
+  REQUIRE(flat_set_lower_bound(&set, as_ptr(4)) == 2);
+  REQUIRE(flat_set_lower_bound(&set, as_ptr(9)) == 3);
+
+  REQUIRE(flat_set_erase(&set, as_ptr(3)));
+  REQUIRE_FALSE(flat_set_erase(&set, as_ptr(3)));
+  REQUIRE_FALSE(flat_set_contains(&set, as_ptr(3)));
+  REQUIRE(flat_set_contains(&set, as_ptr(5)));
+  flat_set_destroy(&set);
+}
+
+TEST_CASE("FlatSet insert_many merges and cleans up duplicates", "[flat]") {
+  counter = 0;
+  invocations = 0;
+
+  FlatSet set = flat_set_new(2, nullptr, count_constants);
+  flat_set_insert(&set, as_ptr(10));
+  flat_set_insert(&set, as_ptr(30));
+
+  ptr_t batch[] = {as_ptr(40), as_ptr(20), as_ptr(30), as_ptr(5),
+                   as_ptr(20), as_ptr(50)};
+  REQUIRE(flat_set_insert_many(&set, batch, 6) == 4);
+
+  // one 20 from the batch, and the 30 that was already present
+  REQUIRE(invocations == 2);
+  REQUIRE(counter == 50);
+
+  uintptr_t expected[] = {5, 10, 20, 30, 40, 50};
+  REQUIRE(flat_len(&set) == 6);
+  for (size_t i = 0; i < 6; i++) {
+    REQUIRE(as_int(flat_key_at(&set, i)) == expected[i]);
+  }
+
+  REQUIRE(flat_set_insert_many(&set, batch, 0) == 0);
+  flat_set_destroy(&set);
+  REQUIRE(invocations == 8);
+}
+
+TEST_CASE("FlatSet matches std::set", "[flat]") {
+  FlatSet set = flat_set_new(0, nullptr, nullptr);
+  std::set<uintptr_t> expected;
+  srand(29);
+
+  for (int round = 0; round < 20; round++) {
+    ptr_t batch[100];
+    size_t n = static_cast<size_t>(rand() % 100);
+    for (size_t i = 0; i < n; i++) {
+      uintptr_t key = static_cast<uintptr_t>(rand() % 1000);
+      batch[i] = as_ptr(key);
+      expected.insert(key);
+    }
+    flat_set_insert_many(&set, batch, n);
+
+    uintptr_t single = static_cast<uintptr_t>(rand() % 1000);
+    REQUIRE(flat_set_insert(&set, as_ptr(single)) ==
+            expected.insert(single).second);
+    uintptr_t gone = static_cast<uintptr_t>(rand() % 1000);
+    REQUIRE(flat_set_erase(&set, as_ptr(gone)) == (expected.erase(gone) == 1));
+
+    REQUIRE(flat_len(&set) == expected.size());
+    size_t i = 0;
+    for (uintptr_t key : expected) {
+      REQUIRE(as_int(flat_key_at(&set, i++)) == key);
+    }
+    for (uintptr_t key = 0; key < 1000; key += 7) {
+      REQUIRE(flat_set_contains(&set, as_ptr(key)) == (expected.count(key) == 1));
+    }
+  }
+  flat_set_destroy(&set);
+}
+
+TEST_CASE("FlatMap put, get and erase", "[flat]") {
+  counter = 0;
+  invocations = 0;
+
+  FlatMap map = flat_map_new(0, nullptr, nullptr, count_constants);
+  ptr_t value = nullptr;
+  REQUIRE_FALSE(flat_map_get(&map, as_ptr(1), &value));
+
+  REQUIRE(flat_map_put(&map, as_ptr(2), as_ptr(20)));
+  REQUIRE(flat_map_put(&map, as_ptr(1), as_ptr(10)));
+  REQUIRE_FALSE(flat_map_put(&map, as_ptr(2), as_ptr(200)));
+  REQUIRE(invocations == 1);  // the old value of 2
+  REQUIRE(counter == 20);
+
+  REQUIRE(flat_map_get(&map, as_ptr(2), &value));
+  REQUIRE(value == as_ptr(200));
+  REQUIRE(flat_map_get(&map, as_ptr(1), nullptr));
+  REQUIRE(flat_value_at(&map, 0) == as_ptr(10));
+
+  REQUIRE(flat_map_erase(&map, as_ptr(1)));
+  REQUIRE_FALSE(flat_map_get(&map, as_ptr(1), &value));
+  REQUIRE(counter == 30);
+
+  flat_map_destroy(&map);
+  REQUIRE(counter == 230);
+  REQUIRE(invocations == 3);
+}
+
+TEST_CASE("FlatMap put_many keeps the last value", "[flat]") {
+  FlatMap map = flat_map_new(0, nullptr, nullptr, nullptr);
+  flat_map_put(&map, as_ptr(3), as_ptr(300));
+
+  ptr_t keys[] = {as_ptr(5), as_ptr(3), as_ptr(1), as_ptr(5), as_ptr(3)};
+  ptr_t values[] = {as_ptr(50), as_ptr(31), as_ptr(10), as_ptr(51),
+                    as_ptr(32)};
+  REQUIRE(flat_map_put_many(&map, keys, values, 5) == 2);
+
+  REQUIRE(flat_len(&map) == 3);
+  ptr_t value = nullptr;
+  REQUIRE(flat_map_get(&map, as_ptr(1), &value));
+  REQUIRE(value == as_ptr(10));
+  REQUIRE(flat_map_get(&map, as_ptr(3), &value));
+  REQUIRE(value == as_ptr(32));
+  REQUIRE(flat_map_get(&map, as_ptr(5), &value));
+  REQUIRE(value == as_ptr(51));
+  flat_map_destroy(&map);
+}
+
+TEST_CASE("FlatMap with string keys", "[flat]") {
+  FlatMap map = flat_map_new(4, compare_strings, free, nullptr);
+  std::map<std::string, uintptr_t> expected;
+  const char* words[] = {"pear", "apple", "fig", "kiwi", "apple", "date"};
+
+  for (uintptr_t i = 0; i < 6; i++) {
+    flat_map_put(&map, strdup(words[i]), as_ptr(i));
+    expected[words[i]] = i;
+  }
+
+  REQUIRE(flat_len(&map) == expected.size());
+  size_t i = 0;
+  for (auto& [word, index] : expected) {
+    REQUIRE(strcmp(static_cast<char*>(flat_key_at(&map, i)), word.c_str()) == 0);
+    REQUIRE(as_int(flat_value_at(&map, i)) == index);
+    i++;
+  }
+
+  char lookup[] = "kiwi";
+  REQUIRE(flat_map_get(&map, lookup, nullptr));
+  REQUIRE(flat_map_erase(&map, lookup));
+  REQUIRE_FALSE(flat_map_get(&map, lookup, nullptr));
+  flat_map_destroy(&map);
+}
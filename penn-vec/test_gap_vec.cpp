@@ -0,0 +1,133 @@
+#include "catch.hpp"
+#include <stdint.h>
+#include <stdlib.h>
+#include <vector>
+
+extern "C" {
+  #include "./gap_vec.h"
+}
+
+using namespace std;
+
+static ptr_t as_ptr(uintptr_t val) {
+  return reinterpret_cast<ptr_t>(val);
+}
+
+static int destroyed = 0;
+
+static void count_free(ptr_t ptr) {
+  free(ptr);
+  destroyed++;
+}
+
+static void require_equal(GapVec* gap, const std::vector<uintptr_t>& model) {
+  REQUIRE(gap_vec_len(gap) == model.size());
+  for (size_t i = 0; i < model.size(); i++) {
+    REQUIRE(gap_vec_get(gap, i) == as_ptr(model[i]));
+  }
+  Vec vec = gap_vec_to_vec(gap);
+  REQUIRE(vec_len(&vec) == model.size());
+  for (size_t i = 0; i < model.size(); i++) {
+    REQUIRE(vec_get(&vec, i) == as_ptr(model[i]));
+  }
+  vec_destroy(&vec);
+}
+
+TEST_CASE("GapVec basic operations", "[gap]") {
+  GapVec gap = gap_vec_new(0, NULL);
+  REQUIRE(gap_vec_len(&gap) == 0);
+  REQUIRE_FALSE(gap_vec_pop_back(&gap));
+
+  std::vector<uintptr_t> model;
+  for (uintptr_t i = 0; i < 100; i++) {
+    gap_vec_push_back(&gap, as_ptr(i));
+    model.push_back(i);
+  }
+  require_equal(&gap, model);
+  REQUIRE(gap_vec_cursor(&gap) == 100);
+
+  // typing at a cursor in the middle
+  for (uintptr_t i = 0; i < 10; i++) {
+    gap_vec_insert(&gap, 50 + i, as_ptr(1000 + i));
+    model.insert(model.begin() + 50 + i, 1000 + i);
+  }
+  REQUIRE(gap_vec_cursor(&gap) == 60);
+  require_equal(&gap, model);
+
+  // backspacing, then jumping to the front
+  gap_vec_erase(&gap, 59);
+  gap_vec_erase(&gap, 58);
+  model.erase(model.begin() + 58, model.begin() + 60);
+  gap_vec_insert(&gap, 0, as_ptr(7));
+  model.insert(model.begin(), 7);
+  gap_vec_set(&gap, 99, as_ptr(8));
+  model[99] = 8;
+  require_equal(&gap, model);
+
+  gap_vec_move_to(&gap, gap_vec_len(&gap));
+  require_equal(&gap, model);
+  gap_vec_move_to(&gap, 0);
+  require_equal(&gap, model);
+
+  // popping with the gap at the front
+  REQUIRE(gap_vec_pop_back(&gap));
+  model.pop_back();
+  require_equal(&gap, model);
+
+  gap_vec_clear(&gap);
+  REQUIRE(gap_vec_len(&gap) == 0);
+  gap_vec_push_back(&gap, as_ptr(1));
+  REQUIRE(gap_vec_get(&gap, 0) == as_ptr(1));
+  gap_vec_destroy(&gap);
+  REQUIRE(gap.data == nullptr);
+}
+
+TEST_CASE("GapVec random walk matches a vector", "[gap]") {
+  GapVec gap = gap_vec_new(4, NULL);
+  std::vector<uintptr_t> model;
+  uint64_t state = 99;
+  auto next = [&state]() {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return state >> 33;
+  };
+
+  size_t cursor = 0;
+  for (uintptr_t round = 0; round < 20000; round++) {
+    uint64_t op = next() % 10;
+    if (op == 0) {
+      // jump somewhere else
+      cursor = next() % (model.size() + 1);
+    } else if (op <= 2 && cursor > 0) {
+      cursor--;
+      gap_vec_erase(&gap, cursor);
+      model.erase(model.begin() + cursor);
+    } else {
+      gap_vec_insert(&gap, cursor, as_ptr(round));
+      model.insert(model.begin() + cursor, round);
+      cursor++;
+    }
+    if (round % 2000 == 0) {
+      require_equal(&gap, model);
+    }
+  }
+  require_equal(&gap, model);
+  gap_vec_destroy(&gap);
+}
+
+TEST_CASE("GapVec cleans up removed elements", "[gap]") {
+  destroyed = 0;
+  GapVec gap = gap_vec_new(2, count_free);
+  for (int i = 0; i < 100; i++) {
+    gap_vec_insert(&gap, gap_vec_len(&gap) / 2, malloc(8));
+  }
+  gap_vec_set(&gap, 10, malloc(8));
+  gap_vec_set(&gap, 11, nullptr);
+  REQUIRE(destroyed == 2);
+  gap_vec_erase(&gap, 11);
+  gap_vec_erase(&gap, 0);
+  REQUIRE(gap_vec_pop_back(&gap));
+  REQUIRE(destroyed == 4);
+  gap_vec_move_to(&gap, 40);
+  gap_vec_destroy(&gap);
+  REQUIRE(destroyed == 101);
+}
@@ -0,0 +1,176 @@
+#include "catch.hpp"
+#include <stdint.h>
+#include <stdlib.h>
+#include <unordered_map>
+
+extern "C" {
+  #include "./hashmap.h"
+  #include "./simd.h"
+}
+
+using namespace std;
+
+static uintptr_t counter = 0;
+static int invocations = 0;
+
+static void count_values(void* value) {
+  counter += *static_cast<uintptr_t*>(value);
+  invocations += 1;
+}
+
+static void free_string(void* value) {
+  free(*static_cast<char**>(value));
+}
+
+// 12 bytes and no padding, to exercise keys that are not a word
+struct point {
+  int32_t x;
+  int32_t y;
+  int32_t z;
+};
+
+TEST_CASE("hashmap put, get and contains", "[hashmap]") {
+  hashmap(int, double) map = nullptr;
+  REQUIRE(hashmap_len(&map) == 0);
+  REQUIRE(hashmap_capacity(&map) == 0);
+  REQUIRE(hashmap_find(&map, 7) == HASHMAP_NPOS);
+  REQUIRE_FALSE(hashmap_remove(&map, 7));
+
+  REQUIRE(hashmap_put(&map, 7, 0.5));
+  REQUIRE(hashmap_put(&map, 3, 1.5));
+  REQUIRE_FALSE(hashmap_put(&map, 7, 2.5));
+
+  REQUIRE(hashmap_len(&map) == 2);
+  REQUIRE(hashmap_capacity(&map) >= 2);
+  REQUIRE(hashmap_contains(&map, 3));
+  REQUIRE_FALSE(hashmap_contains(&map, 4));
+  REQUIRE(hashmap_get(&map, 7) == 2.5);
+
+  // entries are dense and in insertion order
+  REQUIRE(map[0].key == 7);
+  REQUIRE(map[1].key == 3);
+  REQUIRE(map[1].value == 1.5);
+  REQUIRE(hashmap_find(&map, 3) == 1);
+
+  hashmap_free(&map);
+  REQUIRE(map == nullptr);
+}
+
+TEST_CASE("hashmap destroys values", "[hashmap]") {
+  counter = 0;
+  invocations = 0;
+
+  hashmap(int, uintptr_t) map;
+  hashmap_init(&map, 4, count_values);
+  hashmap_put(&map, 1, 10);
+  hashmap_put(&map, 2, 20);
+  hashmap_put(&map, 3, 30);
+
+  // replacing a value destroys the old one
+  hashmap_put(&map, 2, 200);
+  REQUIRE(invocations == 1);
+  REQUIRE(counter == 20);
+
+  // removing moves the last entry into the hole
+  REQUIRE(hashmap_remove(&map, 1));
+  REQUIRE(invocations == 2);
+  REQUIRE(counter == 30);
+  REQUIRE(hashmap_len(&map) == 2);
+  REQUIRE(map[0].key == 3);
+  REQUIRE(map[0].value == 30);
+  REQUIRE(hashmap_get(&map, 3) == 30);
+  REQUIRE(hashmap_get(&map, 2) == 200);
+
+  hashmap_clear(&map);
+  REQUIRE(hashmap_len(&map) == 0);
+  REQUIRE(counter == 260);
+  REQUIRE_FALSE(hashmap_contains(&map, 2));
+
+  hashmap_put(&map, 5, 5);
+  hashmap_free(&map);
+  REQUIRE(counter == 265);
+  REQUIRE(invocations == 5);
+}
+
+TEST_CASE("hashmap with string values and struct keys", "[hashmap]") {
+  hashmap(point, char*) map;
+  hashmap_init(&map, 0, free_string);
+
+  for (int32_t i = 0; i < 100; i++) {
+    point p = {i, -i, i * i};
+    REQUIRE(hashmap_put(&map, p, strdup("value")));
+  }
+  point p = {4, -4, 16};
+  REQUIRE(strcmp(hashmap_get(&map, p), "value") == 0);
+  REQUIRE(hashmap_put(&map, p, strdup("other")) == false);
+  REQUIRE(strcmp(hashmap_get(&map, p), "other") == 0);
+
+  point q = {4, 4, 16};
+  REQUIRE_FALSE(hashmap_contains(&map, q));
+  REQUIRE(hashmap_remove(&map, p));
+  REQUIRE(hashmap_len(&map) == 99);
+  hashmap_free(&map);
+}
+
+TEST_CASE("hashmap reserve keeps the entries", "[hashmap]") {
+  hashmap(uint64_t, uint64_t) map = nullptr;
+  hashmap_reserve(&map, 10);
+  size_t cap = hashmap_capacity(&map);
+  REQUIRE(cap >= 10);
+
+  for (uint64_t i = 0; i < cap; i++) {
+    hashmap_put(&map, i, i * 3);
+  }
+  REQUIRE(hashmap_capacity(&map) == cap);
+
+  hashmap_reserve(&map, 1000);
+  REQUIRE(hashmap_capacity(&map) >= 1000);
+  for (uint64_t i = 0; i < cap; i++) {
+    REQUIRE(hashmap_get(&map, i) == i * 3);
+  }
+  hashmap_reserve(&map, 5);
+  REQUIRE(hashmap_capacity(&map) >= 1000);
+  hashmap_free(&map);
+}
+
+TEST_CASE("hashmap matches std::unordered_map", "[hashmap]") {
+  simd_level best = simd_detect();
+  for (int level = SIMD_SCALAR; level <= best; level++) {
+    simd_set_level(static_cast<simd_level>(level));
+    srand(30);
+
+    hashmap(uint32_t, uint32_t) map = nullptr;
+    unordered_map<uint32_t, uint32_t> expected;
+
+    // a small key range gives plenty of overwrites and removes, which
+    // leaves DELETED slots behind and forces rehashes in place
+    for (int op = 0; op < 20000; op++) {
+      uint32_t key = static_cast<uint32_t>(rand() % 3000);
+      uint32_t value = static_cast<uint32_t>(rand());
+      switch (rand() % 3) {
+        case 0:
+        case 1:
+          REQUIRE(hashmap_put(&map, key, value) ==
+                  expected.insert_or_assign(key, value).second);
+          break;
+        default:
+          REQUIRE(hashmap_remove(&map, key) == (expected.erase(key) == 1));
+          break;
+      }
+    }
+
+    REQUIRE(hashmap_len(&map) == expected.size());
+    for (size_t i = 0; i < hashmap_len(&map); i++) {
+      REQUIRE(expected.at(map[i].key) == map[i].value);
+    }
+    for (uint32_t key = 0; key < 3000; key++) {
+      size_t pos = hashmap_find(&map, key);
+      REQUIRE((pos != HASHMAP_NPOS) == (expected.count(key) == 1));
+      if (pos != HASHMAP_NPOS) {
+        REQUIRE(map[pos].key == key);
+      }
+    }
+    hashmap_free(&map);
+  }
+  simd_set_level(best);
+}
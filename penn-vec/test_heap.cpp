@@ -0,0 +1,197 @@
+#include "catch.hpp"
+#include <stdint.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <map>
+#include <queue>
+#include <vector>
+
+extern "C" {
+  #include "./heap.h"
+}
+
+using namespace std;
+
+struct task {
+  int priority;
+  int id;
+};
+
+static bool int_less(int a, int b) {
+  return a < b;
+}
+
+#define TASK_LESS(a, b) ((a).priority < (b).priority)
+
+DECLARE_HEAP(min_heap, int, int_less)
+DECLARE_HEAP(task_heap, task, TASK_LESS)
+DECLARE_INDEXED_HEAP(index_heap, int, int_less)
+
+static uintptr_t counter = 0;
+static int invocations = 0;
+
+static void count_ints(void* input) {
+  counter += static_cast<uintptr_t>(*reinterpret_cast<int*>(input));
+  invocations += 1;
+}
+
+TEST_CASE("heap pops in order", "[heap]") {
+  vector(int) heap = nullptr;
+  int out = 0;
+  REQUIRE_FALSE(min_heap_pop(&heap, &out));
+
+  int values[] = {5, 3, 8, 1, 9, 2, 7, 3};
+  for (int v : values) {
+    min_heap_push(&heap, v);
+  }
+  REQUIRE(vector_len(&heap) == 8);
+  REQUIRE(min_heap_top(&heap) == 1);
+
+  std::sort(std::begin(values), std::end(values));
+  for (int v : values) {
+    REQUIRE(min_heap_pop(&heap, &out));
+    REQUIRE(out == v);
+  }
+  REQUIRE(vector_len(&heap) == 0);
+  vector_free(&heap);
+}
+
+TEST_CASE("heap of structs with a macro ordering", "[heap]") {
+  vector(task) heap = vector_new(task, 4, nullptr);
+  task_heap_push(&heap, task{3, 0});
+  task_heap_push(&heap, task{1, 1});
+  task_heap_push(&heap, task{2, 2});
+
+  task out = {0, -1};
+  REQUIRE(task_heap_pop(&heap, &out));
+  REQUIRE(out.id == 1);
+  REQUIRE(task_heap_top(&heap).id == 2);
+  vector_free(&heap);
+}
+
+TEST_CASE("heap pop without out destroys the element", "[heap]") {
+  counter = 0;
+  invocations = 0;
+  vector(int) heap = vector_new(int, 0, count_ints);
+  min_heap_push(&heap, 4);
+  min_heap_push(&heap, 2);
+  min_heap_push(&heap, 6);
+
+  int out = 0;
+  REQUIRE(min_heap_pop(&heap, &out));
+  REQUIRE(out == 2);
+  REQUIRE(invocations == 0);
+
+  REQUIRE(min_heap_pop(&heap, nullptr));
+  REQUIRE(invocations == 1);
+  REQUIRE(counter == 4);
+  vector_free(&heap);
+  REQUIRE(counter == 10);
+}
+
+TEST_CASE("heapify an existing vector", "[heap]") {
+  srand(31);
+  for (size_t n = 0; n < 200; n += 7) {
+    vector(int) vec = nullptr;
+    std::priority_queue<int, std::vector<int>, std::greater<int>> expected;
+    for (size_t i = 0; i < n; i++) {
+      int v = rand() % 100;
+      vector_push(&vec, v);
+      expected.push(v);
+    }
+    min_heap_heapify(&vec);
+
+    for (size_t i = 1; i < n; i++) {
+      REQUIRE(vec[(i - 1) / 2] <= vec[i]);
+    }
+    int out = 0;
+    while (!expected.empty()) {
+      REQUIRE(min_heap_pop(&vec, &out));
+      REQUIRE(out == expected.top());
+      expected.pop();
+    }
+    vector_free(&vec);
+  }
+}
+
+TEST_CASE("indexed heap updates and removes by handle", "[heap]") {
+  index_heap heap = index_heap_new(nullptr);
+  size_t a = index_heap_push(&heap, 50);
+  size_t b = index_heap_push(&heap, 40);
+  size_t c = index_heap_push(&heap, 30);
+  REQUIRE(index_heap_top_handle(&heap) == c);
+
+  // decrease key
+  index_heap_update(&heap, a, 10);
+  REQUIRE(index_heap_top_handle(&heap) == a);
+  REQUIRE(index_heap_get(&heap, a) == 10);
+
+  // increase key
+  index_heap_update(&heap, a, 60);
+  REQUIRE(index_heap_top_handle(&heap) == c);
+
+  index_heap_remove(&heap, c);
+  REQUIRE_FALSE(index_heap_contains(&heap, c));
+  REQUIRE(index_heap_len(&heap) == 2);
+
+  int out = 0;
+  REQUIRE(index_heap_pop(&heap, &out));
+  REQUIRE(out == 40);
+  REQUIRE_FALSE(index_heap_contains(&heap, b));
+  REQUIRE(index_heap_contains(&heap, a));
+
+  // handles of removed elements are given out again
+  size_t d = index_heap_push(&heap, 5);
+  REQUIRE((d == b || d == c));
+  REQUIRE(index_heap_top(&heap) == 5);
+  index_heap_free(&heap);
+}
+
+TEST_CASE("indexed heap matches a std::map of handles", "[heap]") {
+  counter = 0;
+  invocations = 0;
+  index_heap heap = index_heap_new(count_ints);
+  std::map<size_t, int> live;  // handle -> value
+  srand(31);
+
+  uintptr_t destroyed = 0;
+  for (int op = 0; op < 5000; op++) {
+    int value = rand() % 1000;
+    int choice = rand() % 4;
+    if (choice == 0 || live.empty()) {
+      size_t h = index_heap_push(&heap, value);
+      REQUIRE(live.count(h) == 0);
+      live[h] = value;
+    } else {
+      auto it = live.begin();
+      std::advance(it, rand() % live.size());
+      if (choice == 1) {
+        destroyed += static_cast<uintptr_t>(it->second);
+        index_heap_update(&heap, it->first, value);
+        it->second = value;
+      } else if (choice == 2) {
+        destroyed += static_cast<uintptr_t>(it->second);
+        index_heap_remove(&heap, it->first);
+        live.erase(it);
+      } else {
+        int smallest = INT32_MAX;
+        for (auto& [h, v] : live) {
+          smallest = std::min(smallest, v);
+        }
+        size_t top = index_heap_top_handle(&heap);
+        REQUIRE(live.at(top) == smallest);
+        int out = 0;
+        REQUIRE(index_heap_pop(&heap, &out));
+        REQUIRE(out == smallest);
+        live.erase(top);
+      }
+    }
+    REQUIRE(index_heap_len(&heap) == live.size());
+  }
+  REQUIRE(counter == destroyed);
+
+  for (auto& [h, v] : live) {
+    REQUIRE(index_heap_get(&heap, h) == v);
+  }
+  index_heap_free(&heap);
+}
@@ -0,0 +1,165 @@
+#include "catch.hpp"
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+
+extern "C" {
+  #include "./vector.h"
+  #include "./vector_kernels.h"
+  #include "./simd.h"
+}
+
+using namespace std;
+
+#define MAX_LEN 100
+#define MAX_OFFSET 4
+#define NBINS 7
+
+// small values so that the float sums are exact enough to compare
+static int random_int() {
+  return rand() % 2001 - 1000;
+}
+
+static float random_float() {
+  return static_cast<float>(rand() % 2001 - 1000) / 64.0f;
+}
+
+static double random_double() {
+  return static_cast<double>(rand() % 2001 - 1000) / 64.0;
+}
+
+// the histogram range, chosen so that some values fall outside of it
+static const double kLo = -700.0;
+static const double kHi = 700.0;
+
+// the bin formula documented in vector_kernels.h
+static void add_to_bin(double x, double lo, double hi, size_t* counts) {
+  if (x >= lo && x < hi) {
+    size_t bin = static_cast<size_t>((x - lo) * (NBINS / (hi - lo)));
+    counts[bin < NBINS ? bin : NBINS - 1]++;
+  }
+}
+
+// --- vector(T) wrappers ---
+TEST_CASE("Reductions over vector(T)", "[kernels macro]") {
+  vector(int) v = vector_new(int, 4, NULL);
+  REQUIRE(vector_sum(&v, int) == 0);
+  REQUIRE(vector_min(&v, int) == INT_MAX);
+  REQUIRE(vector_max(&v, int) == INT_MIN);
+
+  vector_push(&v, 3);
+  vector_push(&v, -7);
+  vector_push(&v, 10);
+  REQUIRE(vector_sum(&v, int) == 6);
+  REQUIRE(vector_min(&v, int) == -7);
+  REQUIRE(vector_max(&v, int) == 10);
+  REQUIRE(vector_dot(&v, &v, int) == 158);
+
+  size_t counts[4];
+  vector_histogram(&v, int, -8.0, 8.0, counts, 4);
+  REQUIRE(counts[0] == 1);  // -7
+  REQUIRE(counts[1] == 0);
+  REQUIRE(counts[2] == 1);  // 3
+  REQUIRE(counts[3] == 0);  // 10 is out of range
+  vector_free(&v);
+
+  vector(double) d = vector_new(double, 0, NULL);
+  REQUIRE(vector_min(&d, double) == INFINITY);
+  vector_push(&d, 0.5);
+  vector_push(&d, 1.5);
+  REQUIRE(vector_sum(&d, double) == 2.0);
+  REQUIRE(vector_max(&d, double) == 1.5);
+  vector_free(&d);
+}
+
+// checks every kernel level the machine supports against plain loops,
+// starting at several offsets so that the unaligned heads are covered
+TEST_CASE("SIMD reductions match scalar", "[kernels macro]") {
+  simd_level original = simd_get_level();
+  simd_level best = simd_detect();
+
+  int ints_a[MAX_LEN + MAX_OFFSET];
+  int ints_b[MAX_LEN + MAX_OFFSET];
+  float floats_a[MAX_LEN + MAX_OFFSET];
+  float floats_b[MAX_LEN + MAX_OFFSET];
+  double doubles_a[MAX_LEN + MAX_OFFSET];
+  double doubles_b[MAX_LEN + MAX_OFFSET];
+  srand(5480);
+  for (size_t i = 0; i < MAX_LEN + MAX_OFFSET; i++) {
+    ints_a[i] = random_int();
+    ints_b[i] = random_int();
+    floats_a[i] = random_float();
+    floats_b[i] = random_float();
+    doubles_a[i] = random_double();
+    doubles_b[i] = random_double();
+  }
+
+  for (int level = SIMD_SCALAR; level <= best; level++) {
+    REQUIRE(simd_set_level(static_cast<simd_level>(level)) == level);
+
+    for (size_t off = 0; off < MAX_OFFSET; off++) {
+      for (size_t n = 0; n <= MAX_LEN; n++) {
+        const int* ia = ints_a + off;
+        const int* ib = ints_b + off;
+        const float* fa = floats_a + off;
+        const float* fb = floats_b + off;
+        const double* da = doubles_a + off;
+        const double* db = doubles_b + off;
+
+        int64_t isum = 0;
+        int64_t idot = 0;
+        int imin = INT_MAX;
+        int imax = INT_MIN;
+        double fsum = 0;
+        double fdot = 0;
+        float fmin = INFINITY;
+        float fmax = -INFINITY;
+        double dsum = 0;
+        double ddot = 0;
+        double dmin = INFINITY;
+        double dmax = -INFINITY;
+        for (size_t i = 0; i < n; i++) {
+          isum += ia[i];
+          idot += static_cast<int64_t>(ia[i]) * ib[i];
+          imin = ia[i] < imin ? ia[i] : imin;
+          imax = ia[i] > imax ? ia[i] : imax;
+          fsum += fa[i];
+          fdot += static_cast<double>(fa[i]) * fb[i];
+          fmin = fa[i] < fmin ? fa[i] : fmin;
+          fmax = fa[i] > fmax ? fa[i] : fmax;
+          dsum += da[i];
+          ddot += da[i] * db[i];
+          dmin = da[i] < dmin ? da[i] : dmin;
+          dmax = da[i] > dmax ? da[i] : dmax;
+        }
+
+        REQUIRE(vk_sum_int(ia, n) == isum);
+        REQUIRE(vk_dot_int(ia, ib, n) == idot);
+        REQUIRE(vk_min_int(ia, n) == imin);
+        REQUIRE(vk_max_int(ia, n) == imax);
+        REQUIRE(vk_sum_float(fa, n) == Catch::Approx(fsum).margin(1e-3));
+        REQUIRE(vk_dot_float(fa, fb, n) == Catch::Approx(fdot).margin(1e-1));
+        REQUIRE(vk_min_float(fa, n) == fmin);
+        REQUIRE(vk_max_float(fa, n) == fmax);
+        REQUIRE(vk_sum_double(da, n) == Catch::Approx(dsum).margin(1e-9));
+        REQUIRE(vk_dot_double(da, db, n) == Catch::Approx(ddot).margin(1e-9));
+        REQUIRE(vk_min_double(da, n) == dmin);
+        REQUIRE(vk_max_double(da, n) == dmax);
+
+        size_t expected[3][NBINS] = {};
+        size_t actual[3][NBINS];
+        for (size_t i = 0; i < n; i++) {
+          add_to_bin(ia[i], kLo, kHi, expected[0]);
+          add_to_bin(fa[i], kLo / 64, kHi / 64, expected[1]);
+          add_to_bin(da[i], kLo / 64, kHi / 64, expected[2]);
+        }
+        vk_histogram_int(ia, n, kLo, kHi, actual[0], NBINS);
+        vk_histogram_float(fa, n, kLo / 64, kHi / 64, actual[1], NBINS);
+        vk_histogram_double(da, n, kLo / 64, kHi / 64, actual[2], NBINS);
+        REQUIRE(memcmp(actual, expected, sizeof(expected)) == 0);
+      }
+    }
+  }
+
+  simd_set_level(original);
+}
@@ -0,0 +1,226 @@
+#include "catch.hpp"
+#include <stdint.h>
+#include <stdlib.h>
+#include <vector>
+
+extern "C" {
+  #include "./Vec.h"
+  #include "./pvec.h"
+}
+
+using namespace std;
+
+static ptr_t as_ptr(uintptr_t val) {
+  return reinterpret_cast<ptr_t>(val);
+}
+
+static void require_equal(const PVec* pvec,
+                          const std::vector<uintptr_t>& model) {
+  REQUIRE(pvec_len(pvec) == model.size());
+  for (size_t i = 0; i < model.size(); i++) {
+    REQUIRE(pvec_get(pvec, i) == as_ptr(model[i]));
+  }
+}
+
+static PVec pvec_of(size_t length, uintptr_t first) {
+  PVec res = pvec_new();
+  for (size_t i = 0; i < length; i++) {
+    PVec next = pvec_push(&res, as_ptr(first + i));
+    pvec_release(&res);
+    res = next;
+  }
+  return res;
+}
+
+static std::vector<uintptr_t> model_of(size_t length, uintptr_t first) {
+  std::vector<uintptr_t> res;
+  for (size_t i = 0; i < length; i++) {
+    res.push_back(first + i);
+  }
+  return res;
+}
+
+TEST_CASE("PVec push keeps every version", "[pvec]") {
+  // past 32 * 32 + 32 elements the trie grows a third level
+  constexpr size_t kLength = 40000;
+  std::vector<PVec> versions;
+  versions.push_back(pvec_new());
+  for (size_t i = 0; i < kLength; i++) {
+    versions.push_back(pvec_push(&versions.back(), as_ptr(i)));
+  }
+  for (size_t v = 0; v < versions.size(); v += 997) {
+    require_equal(&versions[v], model_of(v, 0));
+  }
+  require_equal(&versions.back(), model_of(kLength, 0));
+
+  // releasing versions out of order leaves the others intact
+  for (size_t v = 1; v < versions.size(); v += 2) {
+    pvec_release(&versions[v]);
+    REQUIRE(pvec_len(&versions[v]) == 0);
+  }
+  require_equal(&versions[kLength], model_of(kLength, 0));
+  require_equal(&versions[1000], model_of(1000, 0));
+  for (auto& version : versions) {
+    pvec_release(&version);
+  }
+}
+
+TEST_CASE("PVec set copies only the changed path", "[pvec]") {
+  constexpr size_t kLength = 5000;
+  PVec base = pvec_of(kLength, 0);
+  std::vector<uintptr_t> model = model_of(kLength, 0);
+
+  std::vector<PVec> versions;
+  std::vector<std::vector<uintptr_t>> models;
+  uint64_t state = 7;
+  PVec current = pvec_retain(&base);
+  for (int v = 0; v < 200; v++) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    size_t index = (state >> 33) % kLength;
+    PVec next = pvec_set(&current, index, as_ptr(100000 + v));
+    model[index] = 100000 + v;
+    versions.push_back(next);
+    models.push_back(model);
+    pvec_release(&current);
+    current = pvec_retain(&next);
+  }
+  pvec_release(&current);
+
+  require_equal(&base, model_of(kLength, 0));
+  for (size_t v = 0; v < versions.size(); v += 17) {
+    require_equal(&versions[v], models[v]);
+  }
+
+  // setting in the tail
+  PVec tail = pvec_set(&base, kLength - 1, as_ptr(42));
+  REQUIRE(pvec_get(&tail, kLength - 1) == as_ptr(42));
+  REQUIRE(pvec_get(&base, kLength - 1) == as_ptr(kLength - 1));
+
+  pvec_release(&tail);
+  pvec_release(&base);
+  for (auto& version : versions) {
+    pvec_release(&version);
+  }
+}
+
+TEST_CASE("PVec slice", "[pvec]") {
+  constexpr size_t kLength = 3000;
+  PVec base = pvec_of(kLength, 0);
+  std::vector<uintptr_t> model = model_of(kLength, 0);
+
+  const size_t bounds[][2] = {{0, kLength},  {0, 0},      {5, 5},
+                              {0, 1},        {0, 32},     {0, 33},
+                              {31, 1025},    {1000, 1024}, {100, 2999},
+                              {2990, 3000},  {1024, 2048}};
+  for (const auto& bound : bounds) {
+    PVec slice = pvec_slice(&base, bound[0], bound[1]);
+    std::vector<uintptr_t> expected(model.begin() + bound[0],
+                                    model.begin() + bound[1]);
+    require_equal(&slice, expected);
+
+    // a slice grows and changes like any other version
+    PVec pushed = pvec_retain(&slice);
+    for (uintptr_t i = 0; i < 100; i++) {
+      PVec next = pvec_push(&pushed, as_ptr(50000 + i));
+      pvec_release(&pushed);
+      pushed = next;
+      expected.push_back(50000 + i);
+    }
+    PVec set = pvec_set(&pushed, 0, as_ptr(7));
+    require_equal(&pushed, expected);
+    expected[0] = 7;
+    require_equal(&set, expected);
+
+    pvec_release(&set);
+    pvec_release(&pushed);
+    pvec_release(&slice);
+  }
+  require_equal(&base, model);
+
+  // slices of slices
+  PVec outer = pvec_slice(&base, 100, 2900);
+  PVec inner = pvec_slice(&outer, 50, 60);
+  require_equal(&inner, model_of(10, 150));
+  pvec_release(&outer);
+  require_equal(&inner, model_of(10, 150));
+  pvec_release(&inner);
+  pvec_release(&base);
+}
+
+TEST_CASE("PVec concat", "[pvec]") {
+  const size_t lengths[] = {0, 1, 31, 32, 64, 100, 1024, 1056, 2000};
+  for (size_t left_len : lengths) {
+    for (size_t right_len : lengths) {
+      PVec left = pvec_of(left_len, 0);
+      PVec right = pvec_of(right_len, 10000);
+      PVec joined = pvec_concat(&left, &right);
+
+      std::vector<uintptr_t> expected = model_of(left_len, 0);
+      for (size_t i = 0; i < right_len; i++) {
+        expected.push_back(10000 + i);
+      }
+      require_equal(&joined, expected);
+      require_equal(&left, model_of(left_len, 0));
+      require_equal(&right, model_of(right_len, 10000));
+
+      // changing the result leaves the shared leaves alone
+      if (!expected.empty()) {
+        PVec set = pvec_set(&joined, expected.size() - 1, as_ptr(1));
+        require_equal(&right, model_of(right_len, 10000));
+        pvec_release(&set);
+      }
+      pvec_release(&left);
+      pvec_release(&right);
+      pvec_release(&joined);
+    }
+  }
+
+  // sliced operands, aligned and not
+  PVec base = pvec_of(4096, 0);
+  PVec head = pvec_slice(&base, 0, 1024);
+  PVec aligned = pvec_slice(&base, 2048, 3000);
+  PVec unaligned = pvec_slice(&base, 2050, 3000);
+  PVec joined = pvec_concat(&head, &aligned);
+  std::vector<uintptr_t> expected = model_of(1024, 0);
+  for (uintptr_t i = 2048; i < 3000; i++) {
+    expected.push_back(i);
+  }
+  require_equal(&joined, expected);
+  pvec_release(&joined);
+
+  joined = pvec_concat(&head, &unaligned);
+  expected.erase(expected.begin() + 1024, expected.begin() + 1026);
+  require_equal(&joined, expected);
+  pvec_release(&joined);
+
+  pvec_release(&head);
+  pvec_release(&aligned);
+  pvec_release(&unaligned);
+  pvec_release(&base);
+}
+
+TEST_CASE("PVec conversion to and from Vec", "[pvec]") {
+  for (size_t length : {0, 1, 32, 33, 1025, 5000}) {
+    Vec vec = vec_new(0, NULL);
+    for (uintptr_t i = 0; i < length; i++) {
+      vec_push_back(&vec, as_ptr(i * 3));
+    }
+    PVec pvec = pvec_from_vec(&vec);
+    REQUIRE(pvec_len(&pvec) == length);
+    for (size_t i = 0; i < length; i++) {
+      REQUIRE(pvec_get(&pvec, i) == vec_get(&vec, i));
+    }
+
+    PVec slice = pvec_slice(&pvec, length / 3, length);
+    Vec back = pvec_to_vec(&slice);
+    REQUIRE(vec_len(&back) == length - length / 3);
+    for (size_t i = 0; i < vec_len(&back); i++) {
+      REQUIRE(vec_get(&back, i) == vec_get(&vec, length / 3 + i));
+    }
+
+    vec_destroy(&back);
+    pvec_release(&slice);
+    pvec_release(&pvec);
+    vec_destroy(&vec);
+  }
+}
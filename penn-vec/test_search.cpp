@@ -0,0 +1,119 @@
+#include "catch.hpp"
+#include <stdlib.h>
+
+extern "C" {
+  #include "./Vec.h"
+  #include "./simd.h"
+}
+
+using namespace std;
+
+static ptr_t kOne   = reinterpret_cast<ptr_t>((static_cast<uintptr_t>(1U)));
+static ptr_t kTwo   = reinterpret_cast<ptr_t>((static_cast<uintptr_t>(2U)));
+static ptr_t kThree = reinterpret_cast<ptr_t>((static_cast<uintptr_t>(3U)));
+
+static ptr_t as_ptr(uintptr_t val) {
+  return reinterpret_cast<ptr_t>(val);
+}
+
+// fills a vector with values 1..4 and NULL,
+// the same sequence every time for the same seed
+static Vec random_vec(size_t len, unsigned seed) {
+  Vec v = vec_new(len, nullptr);
+  srand(seed);
+  for (size_t i = 0; i < len; i++) {
+    vec_push_back(&v, as_ptr(static_cast<uintptr_t>(rand() % 5)));
+  }
+  return v;
+}
+
+TEST_CASE("Find and Count", "[search]") {
+  Vec v = vec_new(5, nullptr);
+  REQUIRE(vec_find(&v, kOne) == VEC_NPOS);
+  REQUIRE(vec_count(&v, kOne) == 0);
+  REQUIRE(vec_find_if_null(&v) == VEC_NPOS);
+
+  vec_push_back(&v, kOne);
+  vec_push_back(&v, kTwo);
+  vec_push_back(&v, kOne);
+
+  REQUIRE(vec_find(&v, kOne) == 0);
+  REQUIRE(vec_find(&v, kTwo) == 1);
+  REQUIRE(vec_find(&v, kThree) == VEC_NPOS);
+  REQUIRE(vec_count(&v, kOne) == 2);
+  REQUIRE(vec_count(&v, kThree) == 0);
+  REQUIRE(vec_find_if_null(&v) == VEC_NPOS);
+
+  vec_push_back(&v, nullptr);
+  REQUIRE(vec_find_if_null(&v) == 3);
+  vec_destroy(&v);
+}
+
+TEST_CASE("Compact Nulls", "[search]") {
+  Vec v = vec_new(0, nullptr);
+  REQUIRE(vec_compact_nulls(&v) == 0);
+
+  vec_push_back(&v, nullptr);
+  vec_push_back(&v, kOne);
+  vec_push_back(&v, nullptr);
+  vec_push_back(&v, nullptr);
+  vec_push_back(&v, kTwo);
+  vec_push_back(&v, kThree);
+  size_t capacity = v.capacity;
+
+  REQUIRE(vec_compact_nulls(&v) == 3);
+  REQUIRE(v.length == 3);
+  REQUIRE(v.capacity == capacity);
+  REQUIRE(vec_get(&v, 0) == kOne);
+  REQUIRE(vec_get(&v, 1) == kTwo);
+  REQUIRE(vec_get(&v, 2) == kThree);
+
+  REQUIRE(vec_compact_nulls(&v) == 0);
+  REQUIRE(v.length == 3);
+  vec_destroy(&v);
+}
+
+// every kernel level the machine supports must agree with the
+// scalar kernels on every length, so that the heads and tails are covered
+TEST_CASE("SIMD kernels match scalar", "[search]") {
+  simd_level original = simd_get_level();
+  simd_level best = simd_detect();
+
+  for (int level = SIMD_SCALAR; level <= best; level++) {
+    REQUIRE(simd_set_level(static_cast<simd_level>(level)) == level);
+
+    for (size_t len = 0; len < 70; len++) {
+      Vec v = random_vec(len, static_cast<unsigned>(len));
+
+      for (uintptr_t needle = 0; needle < 6; needle++) {
+        size_t expected_find = VEC_NPOS;
+        size_t expected_count = 0;
+        for (size_t i = 0; i < len; i++) {
+          if (v.data[i] == as_ptr(needle)) {
+            expected_find = expected_find == VEC_NPOS ? i : expected_find;
+            expected_count++;
+          }
+        }
+        REQUIRE(vec_find(&v, as_ptr(needle)) == expected_find);
+        REQUIRE(vec_count(&v, as_ptr(needle)) == expected_count);
+      }
+
+      Vec expected = vec_new(len, nullptr);
+      for (size_t i = 0; i < len; i++) {
+        if (v.data[i] != nullptr) {
+          vec_push_back(&expected, v.data[i]);
+        }
+      }
+      REQUIRE(vec_compact_nulls(&v) == len - expected.length);
+      REQUIRE(v.length == expected.length);
+      for (size_t i = 0; i < expected.length; i++) {
+        REQUIRE(vec_get(&v, i) == vec_get(&expected, i));
+      }
+
+      vec_destroy(&expected);
+      vec_destroy(&v);
+    }
+  }
+
+  simd_set_level(original);
+}
@@ -0,0 +1,154 @@
+#include "catch.hpp"
+#include <stdint.h>
+#include <stdlib.h>
+#include <vector>
+
+extern "C" {
+  #include "./seq.h"
+}
+
+using namespace std;
+
+static ptr_t as_ptr(uintptr_t val) {
+  return reinterpret_cast<ptr_t>(val);
+}
+
+static int destroyed = 0;
+
+static void count_free(ptr_t ptr) {
+  free(ptr);
+  destroyed++;
+}
+
+static void require_equal(Seq* seq, const std::vector<uintptr_t>& model) {
+  REQUIRE(seq_len(seq) == model.size());
+  SeqIter it = seq_iter(seq, 0);
+  ptr_t ele;
+  size_t i = 0;
+  while (seq_iter_next(&it, &ele)) {
+    REQUIRE(i < model.size());
+    REQUIRE(ele == as_ptr(model[i]));
+    i++;
+  }
+  REQUIRE(i == model.size());
+}
+
+TEST_CASE("Seq basic operations", "[seq]") {
+  Seq seq = seq_new(NULL);
+  REQUIRE(seq_is_empty(&seq));
+  REQUIRE_FALSE(seq_pop_back(&seq));
+  SeqIter it = seq_iter(&seq, 0);
+  ptr_t ele = nullptr;
+  REQUIRE_FALSE(seq_iter_next(&it, &ele));
+
+  std::vector<uintptr_t> model;
+  for (uintptr_t i = 0; i < 10000; i++) {
+    seq_push_back(&seq, as_ptr(i));
+    model.push_back(i);
+  }
+  require_equal(&seq, model);
+  for (size_t i = 0; i < model.size(); i += 7) {
+    REQUIRE(seq_get(&seq, i) == as_ptr(i));
+  }
+
+  seq_insert(&seq, 0, as_ptr(42));
+  seq_insert(&seq, 5000, as_ptr(43));
+  seq_insert(&seq, seq_len(&seq), as_ptr(44));
+  model.insert(model.begin(), 42);
+  model.insert(model.begin() + 5000, 43);
+  model.push_back(44);
+  seq_set(&seq, 1, as_ptr(45));
+  model[1] = 45;
+  require_equal(&seq, model);
+
+  seq_erase(&seq, 5000);
+  seq_erase(&seq, 0);
+  model.erase(model.begin() + 5000);
+  model.erase(model.begin());
+  REQUIRE(seq_pop_back(&seq));
+  model.pop_back();
+  require_equal(&seq, model);
+
+  // iterating from the middle
+  it = seq_iter(&seq, 9990);
+  for (size_t i = 9990; i < model.size(); i++) {
+    REQUIRE(seq_iter_next(&it, &ele));
+    REQUIRE(ele == as_ptr(model[i]));
+  }
+  REQUIRE_FALSE(seq_iter_next(&it, &ele));
+  it = seq_iter(&seq, seq_len(&seq));
+  REQUIRE_FALSE(seq_iter_next(&it, &ele));
+
+  while (seq_pop_back(&seq)) {
+  }
+  REQUIRE(seq_len(&seq) == 0);
+  seq_push_back(&seq, as_ptr(1));
+  REQUIRE(seq_get(&seq, 0) == as_ptr(1));
+  seq_destroy(&seq);
+  REQUIRE(seq.root == nullptr);
+}
+
+TEST_CASE("Seq random edits match a vector", "[seq]") {
+  Seq seq = seq_new(NULL);
+  std::vector<uintptr_t> model;
+  uint64_t state = 12345;
+  auto next = [&state]() {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return state >> 33;
+  };
+
+  // grow through several levels with inserts all over, then shrink back
+  // down with erases, checking along the way
+  for (int round = 0; round < 200000; round++) {
+    bool grow = round < 120000 ? next() % 4 != 0 : next() % 4 == 0;
+    if (grow || model.empty()) {
+      size_t index = next() % (model.size() + 1);
+      seq_insert(&seq, index, as_ptr(round));
+      model.insert(model.begin() + index, round);
+    } else {
+      size_t index = next() % model.size();
+      seq_erase(&seq, index);
+      model.erase(model.begin() + index);
+    }
+    if (round % 20000 == 0) {
+      require_equal(&seq, model);
+    }
+  }
+  require_equal(&seq, model);
+  for (size_t i = 0; i < model.size(); i += 13) {
+    REQUIRE(seq_get(&seq, i) == as_ptr(model[i]));
+  }
+
+  while (!model.empty()) {
+    size_t index = next() % model.size();
+    seq_erase(&seq, index);
+    model.erase(model.begin() + index);
+  }
+  REQUIRE(seq_len(&seq) == 0);
+  REQUIRE(seq.height == 0);
+  seq_destroy(&seq);
+}
+
+TEST_CASE("Seq cleans up removed elements", "[seq]") {
+  destroyed = 0;
+  Seq seq = seq_new(count_free);
+  for (int i = 0; i < 5000; i++) {
+    seq_insert(&seq, seq_len(&seq) / 2, malloc(8));
+  }
+  seq_set(&seq, 100, malloc(8));
+  REQUIRE(destroyed == 1);
+  seq_set(&seq, 101, nullptr);
+  REQUIRE(destroyed == 2);
+  seq_erase(&seq, 101);
+  REQUIRE(destroyed == 2);
+  seq_erase(&seq, 0);
+  REQUIRE(seq_pop_back(&seq));
+  REQUIRE(destroyed == 4);
+
+  seq_clear(&seq);
+  REQUIRE(destroyed == 5001);
+  REQUIRE(seq_is_empty(&seq));
+  seq_push_back(&seq, malloc(8));
+  seq_destroy(&seq);
+  REQUIRE(destroyed == 5002);
+}
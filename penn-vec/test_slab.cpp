@@ -0,0 +1,157 @@
+#include "catch.hpp"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <set>
+#include <vector>
+
+extern "C" {
+  #include "./Vec.h"
+  #include "./slab.h"
+}
+
+using namespace std;
+
+struct point {
+  int x;
+  int y;
+};
+
+static point* new_point(Slab* slab, int x, int y) {
+  point* p = static_cast<point*>(slab_alloc(slab));
+  p->x = x;
+  p->y = y;
+  return p;
+}
+
+TEST_CASE("Slab hands out distinct aligned objects", "[slab]") {
+  Slab slab = slab_new(24);
+  REQUIRE(slab.object_size == 32);
+  REQUIRE(slab.page_size % SLAB_PAGE_SIZE == 0);
+  REQUIRE(slab.page_count == 0);
+
+  std::set<void*> seen;
+  for (int i = 0; i < 1000; i++) {
+    void* obj = slab_alloc(&slab);
+    REQUIRE(reinterpret_cast<uintptr_t>(obj) % SLAB_ALIGN == 0);
+    REQUIRE(seen.insert(obj).second);
+    memset(obj, 0xAB, 24);
+  }
+  REQUIRE(slab_live(&slab) == 1000);
+  REQUIRE(slab.page_count > 1);
+
+  slab_destroy(&slab);
+  REQUIRE(slab.page_count == 0);
+  REQUIRE(slab_live(&slab) == 0);
+}
+
+TEST_CASE("Slab reuses freed objects", "[slab]") {
+  Slab slab = slab_new(1);
+  void* a = slab_alloc(&slab);
+  void* b = slab_alloc(&slab);
+  slab_free(&slab, a);
+  slab_free(&slab, nullptr);
+  REQUIRE(slab_live(&slab) == 1);
+
+  REQUIRE(slab_alloc(&slab) == a);
+  slab_free(&slab, b);
+  slab_free(&slab, a);
+  REQUIRE(slab_alloc(&slab) == a);
+  REQUIRE(slab_alloc(&slab) == b);
+  slab_destroy(&slab);
+}
+
+TEST_CASE("Slab reset keeps its pages", "[slab]") {
+  Slab slab = slab_new(sizeof(point));
+  std::vector<void*> first;
+  for (int i = 0; i < 2000; i++) {
+    first.push_back(slab_alloc(&slab));
+  }
+  size_t pages = slab.page_count;
+
+  for (int round = 0; round < 10; round++) {
+    slab_reset(&slab);
+    REQUIRE(slab_live(&slab) == 0);
+    // the same objects come back in the same order
+    for (int i = 0; i < 2000; i++) {
+      REQUIRE(slab_alloc(&slab) == first[static_cast<size_t>(i)]);
+    }
+    REQUIRE(slab.page_count == pages);
+  }
+
+  // going past the old pages allocates new ones
+  slab_alloc(&slab);
+  slab_reset(&slab);
+  for (int i = 0; i < 3000; i++) {
+    slab_alloc(&slab);
+  }
+  REQUIRE(slab.page_count > pages);
+  slab_destroy(&slab);
+}
+
+TEST_CASE("Slab objects bigger than a page", "[slab]") {
+  Slab slab = slab_new(3 * SLAB_PAGE_SIZE);
+  void* a = slab_alloc(&slab);
+  void* b = slab_alloc(&slab);
+  memset(a, 1, 3 * SLAB_PAGE_SIZE);
+  memset(b, 2, 3 * SLAB_PAGE_SIZE);
+  REQUIRE(static_cast<unsigned char*>(a)[3 * SLAB_PAGE_SIZE - 1] == 1);
+  slab_destroy(&slab);
+}
+
+TEST_CASE("Vec bound to a slab", "[slab]") {
+  Slab slab = slab_new(sizeof(point));
+  Vec vec = vec_new_slab(0, &slab);
+
+  for (int i = 0; i < 100; i++) {
+    vec_push_back(&vec, new_point(&slab, i, -i));
+  }
+  REQUIRE(slab_live(&slab) == 100);
+  REQUIRE(static_cast<point*>(vec_get(&vec, 42))->y == -42);
+
+  // single removals give the element back
+  vec_erase(&vec, 0);
+  vec_pop_back(&vec);
+  vec_set(&vec, 0, new_point(&slab, 7, 7));
+  REQUIRE(slab_live(&slab) == 98);
+  REQUIRE(vec_len(&vec) == 98);
+
+  // NULL elements are fine
+  vec_push_back(&vec, nullptr);
+  size_t pages = slab.page_count;
+  vec_clear(&vec);
+  REQUIRE(slab_live(&slab) == 0);
+  REQUIRE(vec_len(&vec) == 0);
+
+  // refilling reuses the pages
+  for (int i = 0; i < 100; i++) {
+    vec_push_back(&vec, new_point(&slab, i, i));
+  }
+  REQUIRE(slab.page_count == pages);
+  vec_destroy(&vec);
+  REQUIRE(slab_live(&slab) == 0);
+  slab_destroy(&slab);
+}
+
+TEST_CASE("Vec clear leaves other slab objects alone", "[slab]") {
+  Slab slab = slab_new(sizeof(point));
+  Vec vec = vec_new_slab(4, &slab);
+  point* outside = new_point(&slab, 1, 2);
+
+  for (int i = 0; i < 10; i++) {
+    vec_push_back(&vec, new_point(&slab, i, i));
+  }
+  // a NULL must not be mistaken for the object outside the vector
+  vec_push_back(&vec, nullptr);
+  vec_clear(&vec);
+  REQUIRE(slab_live(&slab) == 1);
+
+  // the freed objects are reused, the outside one is not handed out again
+  for (int i = 0; i < 10; i++) {
+    REQUIRE(new_point(&slab, 0, 0) != outside);
+  }
+  REQUIRE(outside->x == 1);
+  REQUIRE(outside->y == 2);
+  vec_destroy(&vec);
+  slab_destroy(&slab);
+}
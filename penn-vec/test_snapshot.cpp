@@ -0,0 +1,266 @@
+#include "catch.hpp"
+#include <stdint.h>
+#include <stdlib.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+extern "C" {
+  #include "./Vec.h"
+}
+
+using namespace std;
+
+static std::atomic<int> destroyed{0};
+
+static void count_free(void* ptr) {
+  free(ptr);
+  destroyed++;
+}
+
+static ptr_t as_ptr(uintptr_t val) {
+  return reinterpret_cast<ptr_t>(val);
+}
+
+static ptr_t new_int(int value) {
+  int* ptr = static_cast<int*>(malloc(sizeof(int)));
+  *ptr = value;
+  return ptr;
+}
+
+static int int_at(const VecSnapshot* snap, size_t index) {
+  return *static_cast<int*>(vec_snapshot_get(snap, index));
+}
+
+TEST_CASE("Snapshots share the buffer until a mutation", "[snapshot]") {
+  Vec vec = vec_new(4, nullptr);
+  for (uintptr_t i = 0; i < 4; i++) {
+    vec_push_back(&vec, as_ptr(i));
+  }
+
+  VecSnapshot a = vec_snapshot(&vec);
+  VecSnapshot b = vec_snapshot(&vec);
+  REQUIRE(a.data == vec.data);
+  REQUIRE(b.block == a.block);
+  REQUIRE(vec_snapshot_len(&a) == 4);
+
+  // reading does not copy
+  REQUIRE(vec_get(&vec, 2) == as_ptr(2));
+  REQUIRE(a.data == vec.data);
+
+  vec_set(&vec, 0, as_ptr(10));
+  REQUIRE(a.data != vec.data);
+  REQUIRE(vec_snapshot_get(&a, 0) == as_ptr(0));
+  REQUIRE(vec_get(&vec, 0) == as_ptr(10));
+
+  VecSnapshot c = vec_snapshot(&vec);
+  REQUIRE(c.block != a.block);
+  vec_push_back(&vec, as_ptr(4));
+  vec_erase(&vec, 1);
+  vec_insert(&vec, 0, as_ptr(7));
+  vec_pop_back(&vec);
+  vec_resize(&vec, 100);
+
+  REQUIRE(vec_snapshot_len(&c) == 4);
+  for (uintptr_t i = 0; i < 4; i++) {
+    REQUIRE(vec_snapshot_get(&c, i) == (i == 0 ? as_ptr(10) : as_ptr(i)));
+    REQUIRE(vec_snapshot_get(&a, i) == as_ptr(i));
+  }
+  REQUIRE(vec_len(&vec) == 4);
+  REQUIRE(vec_get(&vec, 0) == as_ptr(7));
+
+  vec_snapshot_release(&b);
+  REQUIRE(b.block == nullptr);
+  REQUIRE(vec_snapshot_len(&b) == 0);
+  vec_snapshot_release(&b);
+  vec_snapshot_release(&a);
+  vec_snapshot_release(&c);
+  vec_destroy(&vec);
+}
+
+TEST_CASE("Clearing a shared vector leaves the snapshot alone", "[snapshot]") {
+  Vec vec = vec_new(8, nullptr);
+  for (uintptr_t i = 0; i < 8; i++) {
+    vec_push_back(&vec, as_ptr(i));
+  }
+  VecSnapshot snap = vec_snapshot(&vec);
+  vec_clear(&vec);
+  REQUIRE(vec_len(&vec) == 0);
+  REQUIRE(vec_capacity(&vec) == 8);
+  REQUIRE(vec.data != snap.data);
+  REQUIRE(vec_snapshot_len(&snap) == 8);
+  REQUIRE(vec_snapshot_get(&snap, 7) == as_ptr(7));
+
+  vec_push_back(&vec, as_ptr(42));
+  REQUIRE(vec_get(&vec, 0) == as_ptr(42));
+  REQUIRE(vec_snapshot_get(&snap, 0) == as_ptr(0));
+  vec_snapshot_release(&snap);
+  vec_destroy(&vec);
+}
+
+TEST_CASE("Snapshot of an empty vector", "[snapshot]") {
+  Vec vec = vec_new(0, nullptr);
+  VecSnapshot snap = vec_snapshot(&vec);
+  REQUIRE(vec_snapshot_len(&snap) == 0);
+  vec_push_back(&vec, as_ptr(1));
+  REQUIRE(vec_snapshot_len(&snap) == 0);
+  vec_snapshot_release(&snap);
+  vec_destroy(&vec);
+}
+
+TEST_CASE("Snapshot elements outlive their removal", "[snapshot]") {
+  destroyed = 0;
+  Vec vec = vec_new(0, count_free);
+  for (int i = 0; i < 10; i++) {
+    vec_push_back(&vec, new_int(i));
+  }
+
+  VecSnapshot old = vec_snapshot(&vec);
+  vec_erase(&vec, 0);
+  vec_set(&vec, 0, new_int(100));
+  vec_pop_back(&vec);
+  REQUIRE(destroyed == 0);
+
+  VecSnapshot mid = vec_snapshot(&vec);
+  vec_clear(&vec);
+  REQUIRE(destroyed == 0);
+  REQUIRE(int_at(&old, 0) == 0);
+  REQUIRE(int_at(&old, 9) == 9);
+  REQUIRE(int_at(&mid, 0) == 100);
+
+  // released newest first, the old snapshot still sees everything
+  vec_snapshot_release(&mid);
+  REQUIRE(destroyed == 0);
+  REQUIRE(int_at(&old, 1) == 1);
+  vec_snapshot_release(&old);
+  REQUIRE(destroyed == 3);
+
+  // the elements cleared after the newest snapshot go with the next
+  // removal, from then on removal destructs right away
+  vec_push_back(&vec, new_int(1));
+  vec_pop_back(&vec);
+  REQUIRE(destroyed == 12);
+  vec_push_back(&vec, new_int(2));
+  vec_pop_back(&vec);
+  REQUIRE(destroyed == 13);
+  vec_destroy(&vec);
+}
+
+TEST_CASE("Snapshots outlive the vector", "[snapshot]") {
+  destroyed = 0;
+  Vec vec = vec_new(0, count_free);
+  for (int i = 0; i < 5; i++) {
+    vec_push_back(&vec, new_int(i));
+  }
+  VecSnapshot first = vec_snapshot(&vec);
+  vec_push_back(&vec, new_int(5));
+  VecSnapshot second = vec_snapshot(&vec);
+  VecSnapshot copy = vec_snapshot_retain(&second);
+  vec_destroy(&vec);
+  REQUIRE(destroyed == 0);
+
+  vec_snapshot_release(&second);
+  REQUIRE(int_at(&copy, 5) == 5);
+  vec_snapshot_release(&first);
+  REQUIRE(destroyed == 0);
+  REQUIRE(int_at(&copy, 0) == 0);
+  vec_snapshot_release(&copy);
+  REQUIRE(destroyed == 6);
+}
+
+TEST_CASE("Batch destructors run on retired elements", "[snapshot]") {
+  destroyed = 0;
+  Vec vec = vec_new_batch(0, [](ptr_t* elems, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+      count_free(elems[i]);
+    }
+  });
+  vec_push_back(&vec, new_int(1));
+  vec_push_back(&vec, new_int(2));
+  VecSnapshot snap = vec_snapshot(&vec);
+  vec_clear(&vec);
+  REQUIRE(destroyed == 0);
+  vec_snapshot_release(&snap);
+  vec_destroy(&vec);
+  REQUIRE(destroyed == 2);
+}
+
+TEST_CASE("Readers see consistent snapshots", "[snapshot]") {
+  destroyed = 0;
+  constexpr int kReaders = 4;
+  constexpr int kVersions = 2000;
+  constexpr size_t kLen = 64;
+
+  // the writer hands each reader its newest snapshot through a slot
+  std::atomic<VecSnapshot*> slots[kReaders];
+  for (auto& slot : slots) {
+    slot = nullptr;
+  }
+  std::atomic<bool> done{false};
+  std::atomic<int> inconsistent{0};
+
+  std::vector<std::thread> readers;
+  for (int r = 0; r < kReaders; r++) {
+    readers.emplace_back([&, r] {
+      VecSnapshot mine = {nullptr, 0, nullptr};
+      int last = -1;
+      for (;;) {
+        bool finished = done.load();
+        VecSnapshot* fresh = slots[r].exchange(nullptr);
+        if (fresh != nullptr) {
+          vec_snapshot_release(&mine);
+          mine = *fresh;
+          delete fresh;
+        }
+        // every element of a snapshot comes from the same version
+        if (vec_snapshot_len(&mine) == kLen) {
+          int version = int_at(&mine, 0);
+          for (size_t i = 1; i < kLen; i++) {
+            inconsistent += int_at(&mine, i) != version;
+          }
+          inconsistent += version < last;
+          last = version;
+        }
+        if (finished && fresh == nullptr) {
+          break;
+        }
+      }
+      vec_snapshot_release(&mine);
+    });
+  }
+
+  Vec vec = vec_new(0, count_free);
+  for (size_t i = 0; i < kLen; i++) {
+    vec_push_back(&vec, new_int(0));
+  }
+  for (int version = 1; version <= kVersions; version++) {
+    for (size_t i = 0; i < kLen; i++) {
+      vec_set(&vec, i, new_int(version));
+    }
+    VecSnapshot snap = vec_snapshot(&vec);
+    for (auto& slot : slots) {
+      auto* mine = new VecSnapshot(vec_snapshot_retain(&snap));
+      VecSnapshot* old = slot.exchange(mine);
+      if (old != nullptr) {
+        vec_snapshot_release(old);
+        delete old;
+      }
+    }
+    vec_snapshot_release(&snap);
+  }
+  done = true;
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  for (auto& slot : slots) {
+    VecSnapshot* old = slot.exchange(nullptr);
+    if (old != nullptr) {
+      vec_snapshot_release(old);
+      delete old;
+    }
+  }
+  vec_destroy(&vec);
+
+  REQUIRE(inconsistent == 0);
+  REQUIRE(destroyed == static_cast<int>(kLen) * (kVersions + 1));
+}
@@ -0,0 +1,146 @@
+#include "catch.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+extern "C" {
+  #include "./Vec.h"
+  #include "./strvec.h"
+}
+
+using namespace std;
+
+static size_t append(StrVec* strs, const char* str) {
+  return str_vec_append(strs, str, strlen(str));
+}
+
+static string get(StrVec* strs, size_t index) {
+  StrView view = str_vec_get(strs, index);
+  REQUIRE(view.ptr[view.len] == '\0');
+  return string(view.ptr, view.len);
+}
+
+TEST_CASE("StrVec append and get", "[strvec]") {
+  StrVec strs = str_vec_new(0, 0, false);
+  REQUIRE(str_vec_len(&strs) == 0);
+
+  REQUIRE(append(&strs, "cat") == 0);
+  REQUIRE(append(&strs, "") == 1);
+  REQUIRE(append(&strs, "horse") == 2);
+  REQUIRE(append(&strs, "cat") == 3);
+
+  // a string with an embedded '\0' keeps its full length
+  REQUIRE(str_vec_append(&strs, "a\0b", 3) == 4);
+
+  REQUIRE(str_vec_len(&strs) == 5);
+  REQUIRE(str_vec_bytes(&strs) == 4 + 1 + 6 + 4 + 4);
+  REQUIRE(get(&strs, 0) == "cat");
+  REQUIRE(get(&strs, 1) == "");
+  REQUIRE(get(&strs, 2) == "horse");
+  REQUIRE(get(&strs, 3) == "cat");
+  REQUIRE(get(&strs, 4) == string("a\0b", 3));
+
+  REQUIRE(str_vec_find(&strs, "cat", 3) == 0);
+  REQUIRE(str_vec_find(&strs, "horse", 5) == 2);
+  REQUIRE(str_vec_find(&strs, "hor", 3) == VEC_NPOS);
+
+  str_vec_destroy(&strs);
+  REQUIRE(str_vec_len(&strs) == 0);
+}
+
+TEST_CASE("StrVec interning stores duplicates once", "[strvec]") {
+  StrVec strs = str_vec_new(2, 8, true);
+  REQUIRE(append(&strs, "red") == 0);
+  REQUIRE(append(&strs, "green") == 1);
+  REQUIRE(append(&strs, "red") == 0);
+  REQUIRE(append(&strs, "") == 2);
+  REQUIRE(append(&strs, "") == 2);
+  REQUIRE(str_vec_len(&strs) == 3);
+  REQUIRE(str_vec_find(&strs, "green", 5) == 1);
+  REQUIRE(str_vec_find(&strs, "blue", 4) == VEC_NPOS);
+  str_vec_destroy(&strs);
+}
+
+TEST_CASE("StrVec clear keeps the storage", "[strvec]") {
+  for (int intern = 0; intern <= 1; intern++) {
+    StrVec strs = str_vec_new(0, 0, intern);
+    char buf[32];
+
+    // clear and refill many times, with overlapping strings, so that an
+    // intern index left over from before a clear gets exercised
+    for (int round = 0; round < 50; round++) {
+      for (int i = 0; i < 200; i++) {
+        snprintf(buf, sizeof(buf), "s%d", (i * 7 + round * 13) % 300);
+        append(&strs, buf);
+      }
+      unordered_map<string, size_t> first;
+      for (size_t i = 0; i < str_vec_len(&strs); i++) {
+        first.emplace(get(&strs, i), i);
+      }
+      if (intern) {
+        REQUIRE(first.size() == str_vec_len(&strs));
+      }
+      for (int i = 0; i < 300; i++) {
+        snprintf(buf, sizeof(buf), "s%d", i);
+        auto it = first.find(buf);
+        size_t expected = it == first.end() ? VEC_NPOS : it->second;
+        REQUIRE(str_vec_find(&strs, buf, strlen(buf)) == expected);
+      }
+
+      size_t bytes_capacity = strs.bytes_capacity;
+      str_vec_clear(&strs);
+      REQUIRE(str_vec_len(&strs) == 0);
+      REQUIRE(str_vec_bytes(&strs) == 0);
+      REQUIRE(strs.bytes_capacity == bytes_capacity);
+      REQUIRE(str_vec_find(&strs, "s0", 2) == VEC_NPOS);
+    }
+    str_vec_destroy(&strs);
+  }
+}
+
+TEST_CASE("StrVec interning after many short clears", "[strvec]") {
+  StrVec strs = str_vec_new(0, 0, true);
+  unordered_map<string, size_t> ids;
+  char buf[32];
+  srand(1);
+
+  // a few appends of repeated strings between clears, so that most of
+  // the index was filled before the last clear
+  for (int cycle = 0; cycle < 20000; cycle++) {
+    int appends = rand() % 8;
+    for (int i = 0; i < appends; i++) {
+      snprintf(buf, sizeof(buf), "k%d", rand() % 16);
+      auto it = ids.emplace(buf, ids.size()).first;
+      REQUIRE(append(&strs, buf) == it->second);
+    }
+    REQUIRE(str_vec_len(&strs) == ids.size());
+    if (rand() % 2 == 0) {
+      str_vec_clear(&strs);
+      ids.clear();
+      REQUIRE(str_vec_find(&strs, "k0", 2) == VEC_NPOS);
+    }
+  }
+  str_vec_destroy(&strs);
+}
+
+TEST_CASE("StrVec matches a vector of strings", "[strvec]") {
+  StrVec strs = str_vec_new(0, 0, false);
+  std::vector<string> expected;
+  srand(32);
+
+  for (int i = 0; i < 5000; i++) {
+    string str(static_cast<size_t>(rand() % 40), 'a');
+    for (char& c : str) {
+      c = static_cast<char>('a' + rand() % 26);
+    }
+    REQUIRE(str_vec_append(&strs, str.data(), str.size()) == expected.size());
+    expected.push_back(str);
+  }
+  for (size_t i = 0; i < expected.size(); i++) {
+    REQUIRE(get(&strs, i) == expected[i]);
+  }
+  str_vec_destroy(&strs);
+}
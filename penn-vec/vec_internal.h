@@ -0,0 +1,36 @@
+#ifndef VEC_INTERNAL_H_
+#define VEC_INTERNAL_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "./Vec.h"
+
+// Hooks from the Vec functions into the snapshot code in vec_snapshot.c.
+// Not part of the public API.
+
+/* Gives the vector a buffer of its own before it is mutated, copying the
+ * buffer if it is still shared with a snapshot. Does nothing for a vector
+ * that was never snapshotted.
+ */
+void vec_unshare(Vec* self);
+
+/* Like vec_unshare(), for a vector whose elements are gone already: a
+ * buffer still shared with a snapshot is swapped for a new one of the same
+ * capacity, with nothing copied.
+ */
+void vec_unshare_empty(Vec* self);
+
+/* Hands the elements in [begin, end) over to the newest snapshot, which
+ * destructs them once it is released.
+ *
+ * @returns true if the elements were retired, false if no snapshot is left
+ * that could still see them, in which case the caller destructs them.
+ */
+bool vec_retire_range(Vec* self, size_t begin, size_t end);
+
+/* Drops the vector's reference to its newest snapshot. If the buffer is
+ * still shared, the snapshot keeps it and self->data is set to NULL.
+ */
+void vec_release_block(Vec* self);
+
+#endif  // VEC_INTERNAL_H_
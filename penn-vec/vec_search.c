@@ -0,0 +1,311 @@
+#include <stdint.h>
+#include "./Vec.h"
+#include "./panic.h"
+#include "./simd.h"
+#include "./vec_internal.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define VEC_SEARCH_X86 1
+#endif
+
+// every kernel works on a raw span of elements, the Vec functions at the
+// bottom of the file only check self and forward data/length.
+typedef size_t (*find_kernel_fn)(const ptr_t*, size_t, ptr_t);
+typedef size_t (*count_kernel_fn)(const ptr_t*, size_t, ptr_t);
+typedef size_t (*compact_kernel_fn)(ptr_t*, size_t);
+
+typedef struct search_kernels_st {
+  find_kernel_fn find;
+  count_kernel_fn count;
+  compact_kernel_fn compact;
+} search_kernels;
+
+// ===========================================================
+// Scalar kernels, also used for the tails of the SIMD ones
+// ===========================================================
+static size_t find_scalar(const ptr_t* data, size_t n, ptr_t needle) {
+  for (size_t i = 0; i < n; i++) {
+    if (data[i] == needle) {
+      return i;
+    }
+  }
+  return n;
+}
+
+static size_t count_scalar(const ptr_t* data, size_t n, ptr_t needle) {
+  size_t count = 0;
+  for (size_t i = 0; i < n; i++) {
+    count += (data[i] == needle);
+  }
+  return count;
+}
+
+// moves the non-NULL elements of data[read, n) down to data[write, ...)
+// and returns the new length
+static size_t compact_tail(ptr_t* data, size_t read, size_t write, size_t n) {
+  for (size_t i = read; i < n; i++) {
+    data[write] = data[i];
+    write += (data[i] != NULL);
+  }
+  return write;
+}
+
+static size_t compact_scalar(ptr_t* data, size_t n) {
+  size_t first = find_scalar(data, n, NULL);
+  return compact_tail(data, first, first, n);
+}
+
+#ifdef VEC_SEARCH_X86
+
+// ===========================================================
+// SSE2 kernels, 2 elements per vector.
+// SSE2 has no 64-bit compare, so the 32-bit halves are compared
+// and the result is and'ed with itself with the halves swapped.
+// ===========================================================
+__attribute__((target("sse2"))) static inline __m128i cmpeq64_sse2(__m128i a,
+                                                                  __m128i b) {
+  __m128i eq = _mm_cmpeq_epi32(a, b);
+  return _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+}
+
+__attribute__((target("sse2"))) static inline int mask64_sse2(__m128i eq) {
+  return _mm_movemask_pd(_mm_castsi128_pd(eq));
+}
+
+__attribute__((target("sse2"))) static size_t find_sse2(const ptr_t* data,
+                                                        size_t n,
+                                                        ptr_t needle) {
+  const __m128i key = _mm_set1_epi64x((long long)(uintptr_t)needle);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128i a = cmpeq64_sse2(_mm_loadu_si128((const __m128i*)(data + i)), key);
+    __m128i b =
+        cmpeq64_sse2(_mm_loadu_si128((const __m128i*)(data + i + 2)), key);
+    int mask = mask64_sse2(a) | (mask64_sse2(b) << 2);
+    if (mask != 0) {
+      return i + (size_t)__builtin_ctz((unsigned)mask);
+    }
+  }
+  return i + find_scalar(data + i, n - i, needle);
+}
+
+__attribute__((target("sse2"))) static size_t count_sse2(const ptr_t* data,
+                                                         size_t n,
+                                                         ptr_t needle) {
+  const __m128i key = _mm_set1_epi64x((long long)(uintptr_t)needle);
+  // equal lanes are all ones (-1), so subtracting them counts up
+  __m128i acc = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+    acc = _mm_sub_epi64(acc, cmpeq64_sse2(v, key));
+  }
+  uint64_t lanes[2];
+  _mm_storeu_si128((__m128i*)lanes, acc);
+  return (size_t)(lanes[0] + lanes[1]) + count_scalar(data + i, n - i, needle);
+}
+
+__attribute__((target("sse2"))) static size_t compact_sse2(ptr_t* data,
+                                                           size_t n) {
+  size_t write = find_sse2(data, n, NULL);
+  size_t i = write;
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 2 <= n; i += 2) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+    int nulls = mask64_sse2(cmpeq64_sse2(v, zero));
+    if (nulls == 0) {
+      _mm_storeu_si128((__m128i*)(data + write), v);
+      write += 2;
+    } else if (nulls != 0x3) {
+      data[write++] = (nulls & 0x1) ? data[i + 1] : data[i];
+    }
+  }
+  return compact_tail(data, i, write, n);
+}
+
+// ===========================================================
+// AVX2 kernels, 4 elements per vector.
+// ===========================================================
+__attribute__((target("avx2"))) static size_t find_avx2(const ptr_t* data,
+                                                        size_t n,
+                                                        ptr_t needle) {
+  const __m256i key = _mm256_set1_epi64x((long long)(uintptr_t)needle);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i a = _mm256_cmpeq_epi64(
+        _mm256_loadu_si256((const __m256i*)(data + i)), key);
+    __m256i b = _mm256_cmpeq_epi64(
+        _mm256_loadu_si256((const __m256i*)(data + i + 4)), key);
+    // check both halves with one branch, only split them on a hit
+    if (!_mm256_testz_si256(_mm256_or_si256(a, b), _mm256_or_si256(a, b))) {
+      int mask = _mm256_movemask_pd(_mm256_castsi256_pd(a)) |
+                 (_mm256_movemask_pd(_mm256_castsi256_pd(b)) << 4);
+      return i + (size_t)__builtin_ctz((unsigned)mask);
+    }
+  }
+  return i + find_scalar(data + i, n - i, needle);
+}
+
+__attribute__((target("avx2"))) static size_t count_avx2(const ptr_t* data,
+                                                         size_t n,
+                                                         ptr_t needle) {
+  const __m256i key = _mm256_set1_epi64x((long long)(uintptr_t)needle);
+  __m256i acc0 = _mm256_setzero_si256();
+  __m256i acc1 = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i a = _mm256_loadu_si256((const __m256i*)(data + i));
+    __m256i b = _mm256_loadu_si256((const __m256i*)(data + i + 4));
+    acc0 = _mm256_sub_epi64(acc0, _mm256_cmpeq_epi64(a, key));
+    acc1 = _mm256_sub_epi64(acc1, _mm256_cmpeq_epi64(b, key));
+  }
+  uint64_t lanes[4];
+  _mm256_storeu_si256((__m256i*)lanes, _mm256_add_epi64(acc0, acc1));
+  return (size_t)(lanes[0] + lanes[1] + lanes[2] + lanes[3]) +
+         count_scalar(data + i, n - i, needle);
+}
+
+// for each 4 bit "keep" mask, the 32-bit lane indices that move the kept
+// 64-bit elements to the front of the vector
+#define KEEP(a, b, c, d) \
+  { 2 * (a), 2 * (a) + 1, 2 * (b), 2 * (b) + 1, \
+    2 * (c), 2 * (c) + 1, 2 * (d), 2 * (d) + 1 }
+static const int32_t kCompactLut[16][8] = {
+    KEEP(0, 0, 0, 0), KEEP(0, 0, 0, 0), KEEP(1, 0, 0, 0), KEEP(0, 1, 0, 0),
+    KEEP(2, 0, 0, 0), KEEP(0, 2, 0, 0), KEEP(1, 2, 0, 0), KEEP(0, 1, 2, 0),
+    KEEP(3, 0, 0, 0), KEEP(0, 3, 0, 0), KEEP(1, 3, 0, 0), KEEP(0, 1, 3, 0),
+    KEEP(2, 3, 0, 0), KEEP(0, 2, 3, 0), KEEP(1, 2, 3, 0), KEEP(0, 1, 2, 3),
+};
+#undef KEEP
+
+__attribute__((target("avx2"))) static size_t compact_avx2(ptr_t* data,
+                                                           size_t n) {
+  size_t write = find_avx2(data, n, NULL);
+  size_t i = write;
+  const __m256i zero = _mm256_setzero_si256();
+  for (; i + 4 <= n; i += 4) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(data + i));
+    int keep = ~_mm256_movemask_pd(
+                   _mm256_castsi256_pd(_mm256_cmpeq_epi64(v, zero))) &
+               0xF;
+    // write <= i, so the full 4 lane store never passes the loaded block
+    __m256i idx = _mm256_loadu_si256((const __m256i*)kCompactLut[keep]);
+    _mm256_storeu_si256((__m256i*)(data + write),
+                        _mm256_permutevar8x32_epi32(v, idx));
+    write += (size_t)__builtin_popcount((unsigned)keep);
+  }
+  return compact_tail(data, i, write, n);
+}
+
+// ===========================================================
+// AVX-512 kernels, 8 elements per vector with mask registers.
+// ===========================================================
+__attribute__((target("avx512f,avx512bw,avx512vl"))) static size_t find_avx512(
+    const ptr_t* data,
+    size_t n,
+    ptr_t needle) {
+  const __m512i key = _mm512_set1_epi64((long long)(uintptr_t)needle);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __mmask8 a = _mm512_cmpeq_epi64_mask(_mm512_loadu_si512(data + i), key);
+    __mmask8 b = _mm512_cmpeq_epi64_mask(_mm512_loadu_si512(data + i + 8), key);
+    unsigned mask = (unsigned)a | ((unsigned)b << 8);
+    if (mask != 0) {
+      return i + (size_t)__builtin_ctz(mask);
+    }
+  }
+  // the tail is done with a masked load instead of the scalar loop
+  for (; i < n; i += 8) {
+    size_t left = n - i < 8 ? n - i : 8;
+    __mmask8 valid = (__mmask8)((1U << left) - 1);
+    __m512i v = _mm512_maskz_loadu_epi64(valid, data + i);
+    unsigned mask = _mm512_mask_cmpeq_epi64_mask(valid, v, key);
+    if (mask != 0) {
+      return i + (size_t)__builtin_ctz(mask);
+    }
+  }
+  return n;
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vl"))) static size_t
+count_avx512(const ptr_t* data, size_t n, ptr_t needle) {
+  const __m512i key = _mm512_set1_epi64((long long)(uintptr_t)needle);
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    count += (size_t)__builtin_popcount(
+        _mm512_cmpeq_epi64_mask(_mm512_loadu_si512(data + i), key));
+  }
+  return count + count_scalar(data + i, n - i, needle);
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vl"))) static size_t
+compact_avx512(ptr_t* data, size_t n) {
+  size_t write = find_avx512(data, n, NULL);
+  size_t i = write;
+  for (; i + 8 <= n; i += 8) {
+    __m512i v = _mm512_loadu_si512(data + i);
+    __mmask8 keep = _mm512_test_epi64_mask(v, v);
+    _mm512_mask_compressstoreu_epi64(data + write, keep, v);
+    write += (size_t)__builtin_popcount(keep);
+  }
+  return compact_tail(data, i, write, n);
+}
+
+#endif  // VEC_SEARCH_X86
+
+// ===========================================================
+// Dispatch table, indexed by simd_level
+// ===========================================================
+#ifdef VEC_SEARCH_X86
+static const search_kernels kKernels[SIMD_LEVEL_COUNT] = {
+    [SIMD_SCALAR] = {find_scalar, count_scalar, compact_scalar},
+    [SIMD_SSE2] = {find_sse2, count_sse2, compact_sse2},
+    [SIMD_SSE42] = {find_sse2, count_sse2, compact_sse2},
+    [SIMD_AVX2] = {find_avx2, count_avx2, compact_avx2},
+    [SIMD_AVX512] = {find_avx512, count_avx512, compact_avx512},
+};
+#else
+static const search_kernels kKernels[SIMD_LEVEL_COUNT] = {
+    [SIMD_SCALAR] = {find_scalar, count_scalar, compact_scalar},
+    [SIMD_SSE2] = {find_scalar, count_scalar, compact_scalar},
+    [SIMD_SSE42] = {find_scalar, count_scalar, compact_scalar},
+    [SIMD_AVX2] = {find_scalar, count_scalar, compact_scalar},
+    [SIMD_AVX512] = {find_scalar, count_scalar, compact_scalar},
+};
+#endif
+
+static inline const search_kernels* kernels(void) {
+  return &kKernels[simd_get_level()];
+}
+
+size_t vec_find(Vec* self, ptr_t needle) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  size_t index = kernels()->find(self->data, self->length, needle);
+  return index == self->length ? VEC_NPOS : index;
+}
+
+size_t vec_count(Vec* self, ptr_t needle) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  return kernels()->count(self->data, self->length, needle);
+}
+
+size_t vec_find_if_null(Vec* self) {
+  return vec_find(self, NULL);
+}
+
+size_t vec_compact_nulls(Vec* self) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  vec_unshare(self);
+  size_t new_length = kernels()->compact(self->data, self->length);
+  size_t removed = self->length - new_length;
+  self->length = new_length;
+  return removed;
+}
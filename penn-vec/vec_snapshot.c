@@ -0,0 +1,194 @@
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include "./Vec.h"
+#include "./panic.h"
+#include "./vec_internal.h"
+
+// ===========================================================
+// Blocks
+//
+// A block is the shared, reference counted state behind snapshots
+// of the same version of a Vec: the buffer it had when the snapshot
+// was taken, and the elements the Vec removed while that block was
+// its newest one ("retired" elements).
+//
+// The vector holds a reference to its newest block. As long as its
+// data pointer is the block's buffer, the buffer is shared and the
+// next mutation copies it (vec_unshare). Taking a snapshot of a
+// mutated vector makes a new block, and the old block takes a
+// reference to the new one through `next`, so blocks die oldest
+// first. An element removed while block B is the newest may still
+// be visible through B or any older block, but not through newer
+// ones, so retiring it to B destructs it only once no snapshot can
+// see it anymore.
+// ===========================================================
+typedef struct vec_block_st {
+  atomic_size_t refs;
+  ptr_t* data;
+  size_t length;
+  Vec retired;
+  struct vec_block_st* next;
+} vec_block;
+
+static inline bool is_shared(const Vec* self) {
+  return self->block != NULL && self->data == self->block->data;
+}
+
+// frees a block no one refers to anymore, along with its buffer unless
+// the vector took it back
+static void block_free(vec_block* block, bool free_data) {
+  if (free_data) {
+    free(block->data);
+  }
+  vec_destroy(&block->retired);
+  free(block);
+}
+
+static void block_release(vec_block* block) {
+  // the last release frees the block, which releases the next one
+  while (block != NULL &&
+         atomic_fetch_sub_explicit(&block->refs, 1, memory_order_acq_rel) ==
+             1) {
+    vec_block* next = block->next;
+    block_free(block, true);
+    block = next;
+  }
+}
+
+// true if no snapshot refers to the vector's newest block
+static inline bool block_unique(const vec_block* block) {
+  return atomic_load_explicit(&block->refs, memory_order_acquire) == 1;
+}
+
+// drops the newest block when no snapshot refers to it, the vector
+// takes back the buffer if it still shares it
+static void detach_block(Vec* self) {
+  block_free(self->block, !is_shared(self));
+  self->block = NULL;
+}
+
+// ===========================================================
+// Hooks for the Vec functions
+// ===========================================================
+// gives the vector a buffer of its own that starts with the first `keep`
+// elements of the shared one
+static void unshare(Vec* self, size_t keep) {
+  if (!is_shared(self) || self->data == NULL) {
+    return;
+  }
+  if (block_unique(self->block)) {
+    detach_block(self);
+    return;
+  }
+  ptr_t* data = (ptr_t*)malloc(self->capacity * sizeof(ptr_t));
+  if (data == NULL) {
+    panic("malloc failed");
+  }
+  memcpy(data, self->data, keep * sizeof(ptr_t));
+  self->data = data;
+}
+
+void vec_unshare(Vec* self) {
+  unshare(self, self->length);
+}
+
+void vec_unshare_empty(Vec* self) {
+  unshare(self, 0);
+}
+
+bool vec_retire_range(Vec* self, size_t begin, size_t end) {
+  if (block_unique(self->block)) {
+    detach_block(self);
+    return false;
+  }
+  for (size_t i = begin; i < end; i++) {
+    if (self->data[i] != NULL) {
+      vec_push_back(&self->block->retired, self->data[i]);
+    }
+  }
+  return true;
+}
+
+void vec_release_block(Vec* self) {
+  if (is_shared(self)) {
+    self->data = NULL;
+  }
+  block_release(self->block);
+  self->block = NULL;
+}
+
+// ===========================================================
+// Public functions
+// ===========================================================
+VecSnapshot vec_snapshot(Vec* self) {
+  if (self == NULL) {
+    panic("self is NULL");
+  }
+  if (self->slab != NULL) {
+    panic("can not snapshot a Vec bound to a slab");
+  }
+
+  // nothing changed since the last snapshot, share its block
+  if (is_shared(self) && self->length == self->block->length) {
+    atomic_fetch_add_explicit(&self->block->refs, 1, memory_order_relaxed);
+    VecSnapshot res = {self->data, self->length, self->block};
+    return res;
+  }
+
+  vec_block* block = (vec_block*)malloc(sizeof(vec_block));
+  if (block == NULL) {
+    panic("malloc failed");
+  }
+  // one reference for the vector and one for the snapshot
+  atomic_init(&block->refs, 2);
+  block->data = self->data;
+  block->length = self->length;
+  block->retired = self->batch_dtor_fn != NULL
+                       ? vec_new_batch(0, self->batch_dtor_fn)
+                       : vec_new(0, self->ele_dtor_fn);
+  block->next = NULL;
+
+  if (self->block != NULL) {
+    // the old block keeps the new one alive, see the comment at the top
+    atomic_fetch_add_explicit(&block->refs, 1, memory_order_relaxed);
+    self->block->next = block;
+    block_release(self->block);
+  }
+  self->block = block;
+
+  VecSnapshot res = {self->data, self->length, block};
+  return res;
+}
+
+ptr_t vec_snapshot_get(const VecSnapshot* snap, size_t index) {
+  if (snap == NULL) {
+    panic("snap is NULL");
+  }
+  if (index >= snap->length) {
+    panic("index out of bound");
+  }
+  return snap->data[index];
+}
+
+VecSnapshot vec_snapshot_retain(const VecSnapshot* snap) {
+  if (snap == NULL) {
+    panic("snap is NULL");
+  }
+  if (snap->block != NULL) {
+    atomic_fetch_add_explicit(&snap->block->refs, 1, memory_order_relaxed);
+  }
+  return *snap;
+}
+
+void vec_snapshot_release(VecSnapshot* snap) {
+  if (snap == NULL) {
+    panic("snap is NULL");
+  }
+  if (snap->block != NULL) {
+    block_release(snap->block);
+  }
+  snap->data = NULL;
+  snap->length = 0;
+  snap->block = NULL;
+}
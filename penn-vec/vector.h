@@ -57,6 +57,7 @@
 
 #include <stdbool.h>
 #include <stdlib.h>  // malloc, realloc, free
+#include <string.h>  // memmove
 #include "./panic.h"
 
 // the destroy function takes in a pointer
@@ -112,10 +113,18 @@ typedef struct vector_info_st {
 //
 // example:
 // vector(int) v = vector_new(int, 10, NULL);
-#define vector_new(T, init_capacity, dtor) \
-  ({                                       \
-    /* TODO */                             \
-    NULL;                                  \
+#define vector_new(T, init_capacity, dtor)                \
+  ({                                                      \
+    size_t __impl_vn_cap = (init_capacity);               \
+    vector_info* __impl_vn_info = (vector_info*)malloc(   \
+        sizeof(vector_info) + __impl_vn_cap * sizeof(T)); \
+    if (__impl_vn_info == NULL) {                         \
+      panic("malloc failed in vector_new\n");             \
+    }                                                     \
+    __impl_vn_info->len = 0;                              \
+    __impl_vn_info->capacity = __impl_vn_cap;             \
+    __impl_vn_info->ele_dtor = (destroy_fn)(dtor);        \
+    (T*)(__impl_vn_info + 1);                             \
   })
 
 // Synopsis:
@@ -134,10 +143,10 @@ typedef struct vector_info_st {
 // example:
 // vector(int) v = ...;
 // size_t len = vector_len(&v);
-#define vector_len(self) \
-  ({                     \
-    /* TODO */           \
-    0U;                  \
+#define vector_len(self)                                      \
+  ({                                                          \
+    vector_info* __impl_vl_info = get_vector_header(self);    \
+    __impl_vl_info == NULL ? (size_t)0 : __impl_vl_info->len; \
   })
 
 // Synopsis:
@@ -156,10 +165,10 @@ typedef struct vector_info_st {
 // example:
 // vector(int) v = ...;
 // size_t len = vector_capacity(&v);
-#define vector_capacity(self) \
-  ({                          \
-    /* TODO */                \
-    0U;                       \
+#define vector_capacity(self)                                      \
+  ({                                                               \
+    vector_info* __impl_vc_info = get_vector_header(self);         \
+    __impl_vc_info == NULL ? (size_t)0 : __impl_vc_info->capacity; \
   })
 
 // Synopsis:
@@ -179,7 +188,7 @@ typedef struct vector_info_st {
 // example:
 // vector(int) v = ...;
 // size_t ele_size = vector_element_size(&v); // same as sizeof(int)
-#define vector_element_size(self) (4 /* TODO */)
+#define vector_element_size(self) (sizeof(**(self)))
 
 // Synopsis:
 //   void vector_resize(vector(T)* self, size_t new_capacity);
@@ -199,10 +208,27 @@ typedef struct vector_info_st {
 // example:
 // vector(int) v = ...;
 // vector_resize(&v, vector_capacity(&v) * 2);
-#define vector_resize(self, n)                   \
-  ({                                             \
-    /* TODO */                                   \
-    ((void)0); /* (optional) return "nothing" */ \
+#define vector_resize(self, n)                                              \
+  ({                                                                        \
+    typeof(self) __impl_vr_self = (self);                                   \
+    size_t __impl_vr_n = (n);                                               \
+    vector_info* __impl_vr_info = get_vector_header(__impl_vr_self);        \
+    if (__impl_vr_info == NULL || __impl_vr_n > __impl_vr_info->capacity) { \
+      vector_info* __impl_vr_new = (vector_info*)realloc(                   \
+          __impl_vr_info,                                                   \
+          sizeof(vector_info) +                                             \
+              __impl_vr_n * vector_element_size(__impl_vr_self));           \
+      if (__impl_vr_new == NULL) {                                          \
+        panic("realloc failed in vector_resize\n");                         \
+      }                                                                     \
+      if (__impl_vr_info == NULL) {                                         \
+        __impl_vr_new->len = 0;                                             \
+        __impl_vr_new->ele_dtor = NULL;                                     \
+      }                                                                     \
+      __impl_vr_new->capacity = __impl_vr_n;                                \
+      *__impl_vr_self = (typeof(*__impl_vr_self))(__impl_vr_new + 1);       \
+    }                                                                       \
+    ((void)0); /* (optional) return "nothing" */                            \
   })
 
 // Synopsis:
@@ -220,9 +246,14 @@ typedef struct vector_info_st {
 // example:
 // vector(int) v = ...;
 // vector_get(&v, 0); // Same thing as doing: v[0]; but with bounds checking
-#define vector_get(self, index) \
-  ({                            \
-      /* TODO */                \
+#define vector_get(self, index)                          \
+  ({                                                     \
+    typeof(self) __impl_vg_self = (self);                \
+    size_t __impl_vg_index = (index);                    \
+    if (__impl_vg_index >= vector_len(__impl_vg_self)) { \
+      panic("index out of bound in vector_get\n");       \
+    }                                                    \
+    (*__impl_vg_self)[__impl_vg_index];                  \
   })
 
 // Synopsis:
@@ -243,10 +274,19 @@ typedef struct vector_info_st {
 // vector_set(&v, 0, 3);
 //
 // // Same thing as doing: v[0] = 3; but with bounds checking
-#define vector_set(self, index, ...)             \
-  ({                                             \
-    /* TODO */                                   \
-    ((void)0); /* (optional) return "nothing" */ \
+#define vector_set(self, index, ...)                                 \
+  ({                                                                 \
+    typeof(self) __impl_vs_self = (self);                            \
+    size_t __impl_vs_index = (index);                                \
+    if (__impl_vs_index >= vector_len(__impl_vs_self)) {             \
+      panic("index out of bound in vector_set\n");                   \
+    }                                                                \
+    vector_info* __impl_vs_info = get_vector_header(__impl_vs_self); \
+    if (__impl_vs_info->ele_dtor != NULL) {                          \
+      __impl_vs_info->ele_dtor(&(*__impl_vs_self)[__impl_vs_index]); \
+    }                                                                \
+    (*__impl_vs_self)[__impl_vs_index] = (__VA_ARGS__);              \
+    ((void)0); /* (optional) return "nothing" */                     \
   })
 
 // Synopsis:
@@ -266,10 +306,18 @@ typedef struct vector_info_st {
 // example:
 // vector(int) v = ...;
 // vector_push(&v, 3);
-#define vector_push(self, ...)                   \
-  ({                                             \
-    /* TODO */                                   \
-    ((void)0); /* (optional) return "nothing" */ \
+#define vector_push(self, ...)                                   \
+  ({                                                             \
+    typeof(self) __impl_vp_self = (self);                        \
+    size_t __impl_vp_len = vector_len(__impl_vp_self);           \
+    size_t __impl_vp_cap = vector_capacity(__impl_vp_self);      \
+    if (__impl_vp_len == __impl_vp_cap) {                        \
+      vector_resize(__impl_vp_self,                              \
+                    __impl_vp_cap == 0 ? 1 : __impl_vp_cap * 2); \
+    }                                                            \
+    (*__impl_vp_self)[__impl_vp_len] = (__VA_ARGS__);            \
+    get_vector_header(__impl_vp_self)->len++;                    \
+    ((void)0); /* (optional) return "nothing" */                 \
   })
 
 // Synopsis:
@@ -284,10 +332,20 @@ typedef struct vector_info_st {
 // example:
 // vector(int) v = ...;
 // bool success = vector_pop(&v);
-#define vector_pop(self)                         \
-  ({                                             \
-    /* TODO */                                   \
-    ((void)0); /* (optional) return "nothing" */ \
+#define vector_pop(self)                                                 \
+  ({                                                                     \
+    typeof(self) __impl_vpop_self = (self);                              \
+    vector_info* __impl_vpop_info = get_vector_header(__impl_vpop_self); \
+    bool __impl_vpop_res = false;                                        \
+    if (__impl_vpop_info != NULL && __impl_vpop_info->len > 0) {         \
+      __impl_vpop_info->len--;                                           \
+      if (__impl_vpop_info->ele_dtor != NULL) {                          \
+        __impl_vpop_info->ele_dtor(                                      \
+            &(*__impl_vpop_self)[__impl_vpop_info->len]);                \
+      }                                                                  \
+      __impl_vpop_res = true;                                            \
+    }                                                                    \
+    __impl_vpop_res;                                                     \
   })
 
 // Synopsis:
@@ -314,10 +372,26 @@ typedef struct vector_info_st {
 // /* if v = {3, 2, 4}; */
 // vector_insert(&v, 1, 6);
 // /* after: v = {3, 6, 2, 4}; */
-#define vector_insert(vec, index, ...)           \
-  ({                                             \
-    /* TODO */                                   \
-    ((void)0); /* (optional) return "nothing" */ \
+#define vector_insert(vec, index, ...)                           \
+  ({                                                             \
+    typeof(vec) __impl_vi_self = (vec);                          \
+    size_t __impl_vi_index = (index);                            \
+    size_t __impl_vi_len = vector_len(__impl_vi_self);           \
+    if (__impl_vi_index > __impl_vi_len) {                       \
+      panic("index out of bound in vector_insert\n");            \
+    }                                                            \
+    size_t __impl_vi_cap = vector_capacity(__impl_vi_self);      \
+    if (__impl_vi_len == __impl_vi_cap) {                        \
+      vector_resize(__impl_vi_self,                              \
+                    __impl_vi_cap == 0 ? 1 : __impl_vi_cap * 2); \
+    }                                                            \
+    memmove(&(*__impl_vi_self)[__impl_vi_index + 1],             \
+            &(*__impl_vi_self)[__impl_vi_index],                 \
+            (__impl_vi_len - __impl_vi_index) *                  \
+                vector_element_size(__impl_vi_self));            \
+    (*__impl_vi_self)[__impl_vi_index] = (__VA_ARGS__);          \
+    get_vector_header(__impl_vi_self)->len++;                    \
+    ((void)0); /* (optional) return "nothing" */                 \
   })
 
 // Synopsis:
@@ -338,10 +412,24 @@ typedef struct vector_info_st {
 // /* if v = {3, 2, 4}; */
 // vector_erase(&v, 2);
 // /* after: v = {3, 2}; */
-#define vector_erase(vec, index)                 \
-  ({                                             \
-    /* TODO */                                   \
-    ((void)0); /* (optional) return "nothing" */ \
+#define vector_erase(vec, index)                                     \
+  ({                                                                 \
+    typeof(vec) __impl_ve_self = (vec);                              \
+    size_t __impl_ve_index = (index);                                \
+    size_t __impl_ve_len = vector_len(__impl_ve_self);               \
+    if (__impl_ve_index >= __impl_ve_len) {                          \
+      panic("index out of bound in vector_erase\n");                 \
+    }                                                                \
+    vector_info* __impl_ve_info = get_vector_header(__impl_ve_self); \
+    if (__impl_ve_info->ele_dtor != NULL) {                          \
+      __impl_ve_info->ele_dtor(&(*__impl_ve_self)[__impl_ve_index]); \
+    }                                                                \
+    memmove(&(*__impl_ve_self)[__impl_ve_index],                     \
+            &(*__impl_ve_self)[__impl_ve_index + 1],                 \
+            (__impl_ve_len - __impl_ve_index - 1) *                  \
+                vector_element_size(__impl_ve_self));                \
+    __impl_ve_info->len--;                                           \
+    ((void)0); /* (optional) return "nothing" */                     \
   })
 
 // Synopsis:
@@ -357,9 +445,21 @@ typedef struct vector_info_st {
 // example:
 // vector(int) v = ...;
 // vector_free(&v);
-#define vector_free(self) \
-  ({                      \
-      /* TODO */          \
+#define vector_free(self)                                               \
+  ({                                                                    \
+    typeof(self) __impl_vf_self = (self);                               \
+    vector_info* __impl_vf_info = get_vector_header(__impl_vf_self);    \
+    if (__impl_vf_info != NULL) {                                       \
+      if (__impl_vf_info->ele_dtor != NULL) {                           \
+        for (size_t __impl_vf_i = 0; __impl_vf_i < __impl_vf_info->len; \
+             __impl_vf_i++) {                                           \
+          __impl_vf_info->ele_dtor(&(*__impl_vf_self)[__impl_vf_i]);    \
+        }                                                               \
+      }                                                                 \
+      free(__impl_vf_info);                                             \
+      *__impl_vf_self = NULL;                                           \
+    }                                                                   \
+    ((void)0);                                                          \
   })
 
 #endif  // VECTOR_H_
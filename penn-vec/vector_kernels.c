@@ -0,0 +1,639 @@
+#include "./vector_kernels.h"
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include "./panic.h"
+#include "./simd.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define VECTOR_KERNELS_X86 1
+#endif
+
+// ===========================================================
+// Scalar kernels. These are the reference the SIMD kernels
+// are tested against, and handle their heads and tails.
+// ===========================================================
+
+// puts x into its bin if it is inside of [lo, hi).
+// Every SIMD histogram kernel computes the bin with the same double
+// operations so that they agree with this exactly.
+static inline void hist_add(double x,
+                            double lo,
+                            double hi,
+                            double scale,
+                            size_t* counts,
+                            size_t nbins) {
+  if (x >= lo && x < hi) {
+    size_t bin = (size_t)((x - lo) * scale);
+    counts[bin < nbins ? bin : nbins - 1]++;
+  }
+}
+
+#define DEFINE_SCALAR_KERNELS(T, ACC, MIN_ID, MAX_ID)                      \
+  static ACC sum_##T##_scalar(const T* data, size_t n) {                   \
+    ACC total = 0;                                                         \
+    for (size_t i = 0; i < n; i++) {                                       \
+      total += data[i];                                                    \
+    }                                                                      \
+    return total;                                                          \
+  }                                                                        \
+  static T min_##T##_scalar(const T* data, size_t n) {                     \
+    T res = (MIN_ID);                                                      \
+    for (size_t i = 0; i < n; i++) {                                       \
+      res = data[i] < res ? data[i] : res;                                 \
+    }                                                                      \
+    return res;                                                            \
+  }                                                                        \
+  static T max_##T##_scalar(const T* data, size_t n) {                     \
+    T res = (MAX_ID);                                                      \
+    for (size_t i = 0; i < n; i++) {                                       \
+      res = data[i] > res ? data[i] : res;                                 \
+    }                                                                      \
+    return res;                                                            \
+  }                                                                        \
+  static ACC dot_##T##_scalar(const T* a, const T* b, size_t n) {          \
+    ACC total = 0;                                                         \
+    for (size_t i = 0; i < n; i++) {                                       \
+      total += (ACC)a[i] * (ACC)b[i];                                      \
+    }                                                                      \
+    return total;                                                          \
+  }                                                                        \
+  static void hist_##T##_scalar(const T* data, size_t n, double lo,        \
+                                double hi, size_t* counts, size_t nbins) { \
+    double scale = (double)nbins / (hi - lo);                              \
+    for (size_t i = 0; i < n; i++) {                                       \
+      hist_add((double)data[i], lo, hi, scale, counts, nbins);             \
+    }                                                                      \
+  }
+
+DEFINE_SCALAR_KERNELS(int, int64_t, INT_MAX, INT_MIN)
+DEFINE_SCALAR_KERNELS(float, float, INFINITY, -INFINITY)
+DEFINE_SCALAR_KERNELS(double, double, INFINITY, -INFINITY)
+
+#undef DEFINE_SCALAR_KERNELS
+
+// the number of leading elements to do one at a time so that
+// the rest of the array starts on an `align` byte boundary.
+// Arrays that are not even aligned to their element size are
+// left alone, the SIMD loops only use unaligned loads anyway.
+static inline size_t head_count(const void* data,
+                                size_t elem_size,
+                                size_t n,
+                                size_t align) {
+  uintptr_t addr = (uintptr_t)data;
+  if (addr % elem_size != 0) {
+    return 0;
+  }
+  size_t head = ((align - addr % align) % align) / elem_size;
+  return head < n ? head : n;
+}
+
+#ifdef VECTOR_KERNELS_X86
+
+// ===========================================================
+// Floating point kernels. The intrinsics only differ in their
+// prefix (_mm, _mm256, _mm512) and suffix (ps, pd) between
+// levels, so each level is stamped out from the same body.
+// Two accumulators are used to hide the latency of the adds.
+// ===========================================================
+#define DEFINE_FP_KERNELS(T, LEVEL, TARGET, VT, W, PFX, SFX)                \
+  __attribute__((target(TARGET))) static T sum_##T##_##LEVEL(const T* data, \
+                                                             size_t n) {    \
+    size_t i = head_count(data, sizeof(T), n, sizeof(VT));                  \
+    T total = sum_##T##_scalar(data, i);                                    \
+    VT acc0 = PFX##_setzero_##SFX();                                        \
+    VT acc1 = PFX##_setzero_##SFX();                                        \
+    for (; i + 2 * (W) <= n; i += 2 * (W)) {                                \
+      acc0 = PFX##_add_##SFX(acc0, PFX##_loadu_##SFX(data + i));            \
+      acc1 = PFX##_add_##SFX(acc1, PFX##_loadu_##SFX(data + i + (W)));      \
+    }                                                                       \
+    T lanes[W];                                                             \
+    PFX##_storeu_##SFX(lanes, PFX##_add_##SFX(acc0, acc1));                 \
+    return total + sum_##T##_scalar(lanes, (W)) +                           \
+           sum_##T##_scalar(data + i, n - i);                               \
+  }                                                                         \
+  __attribute__((target(TARGET))) static T min_##T##_##LEVEL(const T* data, \
+                                                             size_t n) {    \
+    size_t i = head_count(data, sizeof(T), n, sizeof(VT));                  \
+    T res = min_##T##_scalar(data, i);                                      \
+    VT acc = PFX##_set1_##SFX(res);                                         \
+    for (; i + (W) <= n; i += (W)) {                                        \
+      acc = PFX##_min_##SFX(acc, PFX##_loadu_##SFX(data + i));              \
+    }                                                                       \
+    T lanes[W];                                                             \
+    PFX##_storeu_##SFX(lanes, acc);                                         \
+    res = min_##T##_scalar(lanes, (W));                                     \
+    T tail = min_##T##_scalar(data + i, n - i);                             \
+    return tail < res ? tail : res;                                         \
+  }                                                                         \
+  __attribute__((target(TARGET))) static T max_##T##_##LEVEL(const T* data, \
+                                                             size_t n) {    \
+    size_t i = head_count(data, sizeof(T), n, sizeof(VT));                  \
+    T res = max_##T##_scalar(data, i);                                      \
+    VT acc = PFX##_set1_##SFX(res);                                         \
+    for (; i + (W) <= n; i += (W)) {                                        \
+      acc = PFX##_max_##SFX(acc, PFX##_loadu_##SFX(data + i));              \
+    }                                                                       \
+    T lanes[W];                                                             \
+    PFX##_storeu_##SFX(lanes, acc);                                         \
+    res = max_##T##_scalar(lanes, (W));                                     \
+    T tail = max_##T##_scalar(data + i, n - i);                             \
+    return tail > res ? tail : res;                                         \
+  }                                                                         \
+  __attribute__((target(TARGET))) static T dot_##T##_##LEVEL(               \
+      const T* a, const T* b, size_t n) {                                   \
+    size_t i = head_count(a, sizeof(T), n, sizeof(VT));                     \
+    T total = dot_##T##_scalar(a, b, i);                                    \
+    VT acc0 = PFX##_setzero_##SFX();                                        \
+    VT acc1 = PFX##_setzero_##SFX();                                        \
+    for (; i + 2 * (W) <= n; i += 2 * (W)) {                                \
+      acc0 = PFX##_add_##SFX(                                               \
+          acc0, PFX##_mul_##SFX(PFX##_loadu_##SFX(a + i),                   \
+                                PFX##_loadu_##SFX(b + i)));                 \
+      acc1 = PFX##_add_##SFX(                                               \
+          acc1, PFX##_mul_##SFX(PFX##_loadu_##SFX(a + i + (W)),             \
+                                PFX##_loadu_##SFX(b + i + (W))));           \
+    }                                                                       \
+    T lanes[W];                                                             \
+    PFX##_storeu_##SFX(lanes, PFX##_add_##SFX(acc0, acc1));                 \
+    return total + sum_##T##_scalar(lanes, (W)) +                           \
+           dot_##T##_scalar(a + i, b + i, n - i);                           \
+  }
+
+DEFINE_FP_KERNELS(float, sse42, "sse4.2", __m128, 4, _mm, ps)
+DEFINE_FP_KERNELS(double, sse42, "sse4.2", __m128d, 2, _mm, pd)
+DEFINE_FP_KERNELS(float, avx2, "avx2", __m256, 8, _mm256, ps)
+DEFINE_FP_KERNELS(double, avx2, "avx2", __m256d, 4, _mm256, pd)
+DEFINE_FP_KERNELS(float, avx512, "avx512f", __m512, 16, _mm512, ps)
+DEFINE_FP_KERNELS(double, avx512, "avx512f", __m512d, 8, _mm512, pd)
+
+#undef DEFINE_FP_KERNELS
+
+// ===========================================================
+// Integer kernels.
+// Sums and dot products widen to 64-bit lanes. _mul_epi32
+// multiplies the even 32-bit lanes into 64-bit products, the
+// odd lanes are shifted down into the even positions first.
+// ===========================================================
+__attribute__((target("sse4.2"))) static int64_t sum_int_sse42(
+    const int* data,
+    size_t n) {
+  size_t i = head_count(data, sizeof(int), n, sizeof(__m128i));
+  int64_t total = sum_int_scalar(data, i);
+  __m128i acc = _mm_setzero_si128();
+  for (; i + 4 <= n; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+    acc = _mm_add_epi64(acc, _mm_cvtepi32_epi64(v));
+    acc = _mm_add_epi64(acc, _mm_cvtepi32_epi64(_mm_srli_si128(v, 8)));
+  }
+  int64_t lanes[2];
+  _mm_storeu_si128((__m128i*)lanes, acc);
+  return total + lanes[0] + lanes[1] + sum_int_scalar(data + i, n - i);
+}
+
+__attribute__((target("sse4.2"))) static int min_int_sse42(const int* data,
+                                                           size_t n) {
+  size_t i = head_count(data, sizeof(int), n, sizeof(__m128i));
+  __m128i acc = _mm_set1_epi32(min_int_scalar(data, i));
+  for (; i + 4 <= n; i += 4) {
+    acc = _mm_min_epi32(acc, _mm_loadu_si128((const __m128i*)(data + i)));
+  }
+  int lanes[4];
+  _mm_storeu_si128((__m128i*)lanes, acc);
+  int res = min_int_scalar(lanes, 4);
+  int tail = min_int_scalar(data + i, n - i);
+  return tail < res ? tail : res;
+}
+
+__attribute__((target("sse4.2"))) static int max_int_sse42(const int* data,
+                                                           size_t n) {
+  size_t i = head_count(data, sizeof(int), n, sizeof(__m128i));
+  __m128i acc = _mm_set1_epi32(max_int_scalar(data, i));
+  for (; i + 4 <= n; i += 4) {
+    acc = _mm_max_epi32(acc, _mm_loadu_si128((const __m128i*)(data + i)));
+  }
+  int lanes[4];
+  _mm_storeu_si128((__m128i*)lanes, acc);
+  int res = max_int_scalar(lanes, 4);
+  int tail = max_int_scalar(data + i, n - i);
+  return tail > res ? tail : res;
+}
+
+__attribute__((target("sse4.2"))) static int64_t dot_int_sse42(const int* a,
+                                                               const int* b,
+                                                               size_t n) {
+  size_t i = head_count(a, sizeof(int), n, sizeof(__m128i));
+  int64_t total = dot_int_scalar(a, b, i);
+  __m128i acc = _mm_setzero_si128();
+  for (; i + 4 <= n; i += 4) {
+    __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+    __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+    acc = _mm_add_epi64(acc, _mm_mul_epi32(va, vb));
+    acc = _mm_add_epi64(acc, _mm_mul_epi32(_mm_srli_epi64(va, 32),
+                                           _mm_srli_epi64(vb, 32)));
+  }
+  int64_t lanes[2];
+  _mm_storeu_si128((__m128i*)lanes, acc);
+  return total + lanes[0] + lanes[1] + dot_int_scalar(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2"))) static int64_t sum_int_avx2(const int* data,
+                                                            size_t n) {
+  size_t i = head_count(data, sizeof(int), n, sizeof(__m256i));
+  int64_t total = sum_int_scalar(data, i);
+  __m256i acc = _mm256_setzero_si256();
+  for (; i + 8 <= n; i += 8) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(data + i));
+    acc = _mm256_add_epi64(
+        acc, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+    acc = _mm256_add_epi64(
+        acc, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+  }
+  int64_t lanes[4];
+  _mm256_storeu_si256((__m256i*)lanes, acc);
+  return total + lanes[0] + lanes[1] + lanes[2] + lanes[3] +
+         sum_int_scalar(data + i, n - i);
+}
+
+__attribute__((target("avx2"))) static int min_int_avx2(const int* data,
+                                                        size_t n) {
+  size_t i = head_count(data, sizeof(int), n, sizeof(__m256i));
+  __m256i acc = _mm256_set1_epi32(min_int_scalar(data, i));
+  for (; i + 8 <= n; i += 8) {
+    acc = _mm256_min_epi32(acc,
+                           _mm256_loadu_si256((const __m256i*)(data + i)));
+  }
+  int lanes[8];
+  _mm256_storeu_si256((__m256i*)lanes, acc);
+  int res = min_int_scalar(lanes, 8);
+  int tail = min_int_scalar(data + i, n - i);
+  return tail < res ? tail : res;
+}
+
+__attribute__((target("avx2"))) static int max_int_avx2(const int* data,
+                                                        size_t n) {
+  size_t i = head_count(data, sizeof(int), n, sizeof(__m256i));
+  __m256i acc = _mm256_set1_epi32(max_int_scalar(data, i));
+  for (; i + 8 <= n; i += 8) {
+    acc = _mm256_max_epi32(acc,
+                           _mm256_loadu_si256((const __m256i*)(data + i)));
+  }
+  int lanes[8];
+  _mm256_storeu_si256((__m256i*)lanes, acc);
+  int res = max_int_scalar(lanes, 8);
+  int tail = max_int_scalar(data + i, n - i);
+  return tail > res ? tail : res;
+}
+
+__attribute__((target("avx2"))) static int64_t dot_int_avx2(const int* a,
+                                                            const int* b,
+                                                            size_t n) {
+  size_t i = head_count(a, sizeof(int), n, sizeof(__m256i));
+  int64_t total = dot_int_scalar(a, b, i);
+  __m256i acc = _mm256_setzero_si256();
+  for (; i + 8 <= n; i += 8) {
+    __m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+    __m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+    acc = _mm256_add_epi64(acc, _mm256_mul_epi32(va, vb));
+    acc = _mm256_add_epi64(acc, _mm256_mul_epi32(_mm256_srli_epi64(va, 32),
+                                                 _mm256_srli_epi64(vb, 32)));
+  }
+  int64_t lanes[4];
+  _mm256_storeu_si256((__m256i*)lanes, acc);
+  return total + lanes[0] + lanes[1] + lanes[2] + lanes[3] +
+         dot_int_scalar(a + i, b + i, n - i);
+}
+
+// the AVX-512 integer kernels finish with a masked load instead of a
+// scalar tail, filling the missing lanes with the reduction's identity
+static inline __mmask16 tail_mask16(size_t left) {
+  return (__mmask16)(left >= 16 ? 0xFFFF : (1U << left) - 1);
+}
+
+__attribute__((target("avx512f"))) static int64_t sum_int_avx512(
+    const int* data,
+    size_t n) {
+  size_t i = head_count(data, sizeof(int), n, sizeof(__m512i));
+  int64_t total = sum_int_scalar(data, i);
+  __m512i acc = _mm512_setzero_si512();
+  for (; i < n; i += 16) {
+    __m512i v = _mm512_maskz_loadu_epi32(tail_mask16(n - i), data + i);
+    acc = _mm512_add_epi64(
+        acc, _mm512_cvtepi32_epi64(_mm512_castsi512_si256(v)));
+    acc = _mm512_add_epi64(
+        acc, _mm512_cvtepi32_epi64(_mm512_extracti64x4_epi64(v, 1)));
+  }
+  return total + _mm512_reduce_add_epi64(acc);
+}
+
+__attribute__((target("avx512f"))) static int min_int_avx512(const int* data,
+                                                             size_t n) {
+  size_t i = head_count(data, sizeof(int), n, sizeof(__m512i));
+  __m512i acc = _mm512_set1_epi32(min_int_scalar(data, i));
+  for (; i < n; i += 16) {
+    acc = _mm512_min_epi32(
+        acc, _mm512_mask_loadu_epi32(acc, tail_mask16(n - i), data + i));
+  }
+  return _mm512_reduce_min_epi32(acc);
+}
+
+__attribute__((target("avx512f"))) static int max_int_avx512(const int* data,
+                                                             size_t n) {
+  size_t i = head_count(data, sizeof(int), n, sizeof(__m512i));
+  __m512i acc = _mm512_set1_epi32(max_int_scalar(data, i));
+  for (; i < n; i += 16) {
+    acc = _mm512_max_epi32(
+        acc, _mm512_mask_loadu_epi32(acc, tail_mask16(n - i), data + i));
+  }
+  return _mm512_reduce_max_epi32(acc);
+}
+
+__attribute__((target("avx512f"))) static int64_t dot_int_avx512(const int* a,
+                                                                 const int* b,
+                                                                 size_t n) {
+  size_t i = head_count(a, sizeof(int), n, sizeof(__m512i));
+  int64_t total = dot_int_scalar(a, b, i);
+  __m512i acc = _mm512_setzero_si512();
+  for (; i < n; i += 16) {
+    __mmask16 mask = tail_mask16(n - i);
+    __m512i va = _mm512_maskz_loadu_epi32(mask, a + i);
+    __m512i vb = _mm512_maskz_loadu_epi32(mask, b + i);
+    acc = _mm512_add_epi64(acc, _mm512_mul_epi32(va, vb));
+    acc = _mm512_add_epi64(acc, _mm512_mul_epi32(_mm512_srli_epi64(va, 32),
+                                                 _mm512_srli_epi64(vb, 32)));
+  }
+  return total + _mm512_reduce_add_epi64(acc);
+}
+
+// ===========================================================
+// Histogram kernels. The bins of W elements are computed at
+// once in double precision, then the counts are incremented
+// one at a time since x86 has no conflict free scatter-add.
+// ===========================================================
+#define DEFINE_HIST_SSE42(T, LOAD)                                     \
+  __attribute__((target("sse4.2"))) static void hist_##T##_sse42(      \
+      const T* data, size_t n, double lo, double hi, size_t* counts,   \
+      size_t nbins) {                                                  \
+    double scale = (double)nbins / (hi - lo);                          \
+    const __m128d vlo = _mm_set1_pd(lo);                               \
+    const __m128d vhi = _mm_set1_pd(hi);                               \
+    const __m128d vscale = _mm_set1_pd(scale);                         \
+    size_t i = 0;                                                      \
+    for (; i + 2 <= n; i += 2) {                                       \
+      __m128d x = LOAD(data + i);                                      \
+      int in_range = _mm_movemask_pd(                                  \
+          _mm_and_pd(_mm_cmpge_pd(x, vlo), _mm_cmplt_pd(x, vhi)));     \
+      int32_t bins[4];                                                 \
+      _mm_storeu_si128((__m128i*)bins,                                 \
+                       _mm_cvttpd_epi32(_mm_mul_pd(_mm_sub_pd(x, vlo), \
+                                                   vscale)));          \
+      for (int lane = 0; lane < 2; lane++) {                           \
+        if (in_range & (1 << lane)) {                                  \
+          size_t bin = (size_t)bins[lane];                             \
+          counts[bin < nbins ? bin : nbins - 1]++;                     \
+        }                                                              \
+      }                                                                \
+    }                                                                  \
+    hist_##T##_scalar(data + i, n - i, lo, hi, counts, nbins);         \
+  }
+
+#define DEFINE_HIST_AVX2(T, LOAD)                                             \
+  __attribute__((target("avx2"))) static void hist_##T##_avx2(                \
+      const T* data, size_t n, double lo, double hi, size_t* counts,          \
+      size_t nbins) {                                                         \
+    double scale = (double)nbins / (hi - lo);                                 \
+    const __m256d vlo = _mm256_set1_pd(lo);                                   \
+    const __m256d vhi = _mm256_set1_pd(hi);                                   \
+    const __m256d vscale = _mm256_set1_pd(scale);                             \
+    size_t i = 0;                                                             \
+    for (; i + 4 <= n; i += 4) {                                              \
+      __m256d x = LOAD(data + i);                                             \
+      int in_range = _mm256_movemask_pd(                                      \
+          _mm256_and_pd(_mm256_cmp_pd(x, vlo, _CMP_GE_OQ),                    \
+                        _mm256_cmp_pd(x, vhi, _CMP_LT_OQ)));                  \
+      int32_t bins[4];                                                        \
+      _mm_storeu_si128(                                                       \
+          (__m128i*)bins,                                                     \
+          _mm256_cvttpd_epi32(_mm256_mul_pd(_mm256_sub_pd(x, vlo), vscale))); \
+      for (int lane = 0; lane < 4; lane++) {                                  \
+        if (in_range & (1 << lane)) {                                         \
+          size_t bin = (size_t)bins[lane];                                    \
+          counts[bin < nbins ? bin : nbins - 1]++;                            \
+        }                                                                     \
+      }                                                                       \
+    }                                                                         \
+    hist_##T##_scalar(data + i, n - i, lo, hi, counts, nbins);                \
+  }
+
+#define DEFINE_HIST_AVX512(T, LOAD)                                           \
+  __attribute__((target("avx512f"))) static void hist_##T##_avx512(           \
+      const T* data, size_t n, double lo, double hi, size_t* counts,          \
+      size_t nbins) {                                                         \
+    double scale = (double)nbins / (hi - lo);                                 \
+    const __m512d vlo = _mm512_set1_pd(lo);                                   \
+    const __m512d vhi = _mm512_set1_pd(hi);                                   \
+    const __m512d vscale = _mm512_set1_pd(scale);                             \
+    size_t i = 0;                                                             \
+    for (; i + 8 <= n; i += 8) {                                              \
+      __m512d x = LOAD(data + i);                                             \
+      unsigned in_range =                                                     \
+          _mm512_cmp_pd_mask(x, vlo, _CMP_GE_OQ) &                            \
+          _mm512_cmp_pd_mask(x, vhi, _CMP_LT_OQ);                             \
+      int32_t bins[8];                                                        \
+      _mm256_storeu_si256(                                                    \
+          (__m256i*)bins,                                                     \
+          _mm512_cvttpd_epi32(_mm512_mul_pd(_mm512_sub_pd(x, vlo), vscale))); \
+      while (in_range != 0) {                                                 \
+        size_t bin = (size_t)bins[__builtin_ctz(in_range)];                   \
+        counts[bin < nbins ? bin : nbins - 1]++;                              \
+        in_range &= in_range - 1;                                             \
+      }                                                                       \
+    }                                                                         \
+    hist_##T##_scalar(data + i, n - i, lo, hi, counts, nbins);                \
+  }
+
+// loaders that widen W elements of each type to doubles
+#define LOAD2_INT(p) _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i*)(p)))
+#define LOAD2_FLOAT(p) \
+  _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)(p))))
+#define LOAD2_DOUBLE(p) _mm_loadu_pd(p)
+#define LOAD4_INT(p) _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)(p)))
+#define LOAD4_FLOAT(p) _mm256_cvtps_pd(_mm_loadu_ps(p))
+#define LOAD4_DOUBLE(p) _mm256_loadu_pd(p)
+#define LOAD8_INT(p) \
+  _mm512_cvtepi32_pd(_mm256_loadu_si256((const __m256i*)(p)))
+#define LOAD8_FLOAT(p) _mm512_cvtps_pd(_mm256_loadu_ps(p))
+#define LOAD8_DOUBLE(p) _mm512_loadu_pd(p)
+
+DEFINE_HIST_SSE42(int, LOAD2_INT)
+DEFINE_HIST_SSE42(float, LOAD2_FLOAT)
+DEFINE_HIST_SSE42(double, LOAD2_DOUBLE)
+DEFINE_HIST_AVX2(int, LOAD4_INT)
+DEFINE_HIST_AVX2(float, LOAD4_FLOAT)
+DEFINE_HIST_AVX2(double, LOAD4_DOUBLE)
+DEFINE_HIST_AVX512(int, LOAD8_INT)
+DEFINE_HIST_AVX512(float, LOAD8_FLOAT)
+DEFINE_HIST_AVX512(double, LOAD8_DOUBLE)
+
+#endif  // VECTOR_KERNELS_X86
+
+// ===========================================================
+// Dispatch table, indexed by simd_level
+// ===========================================================
+typedef struct vector_kernels_st {
+  int64_t (*sum_int)(const int*, size_t);
+  float (*sum_float)(const float*, size_t);
+  double (*sum_double)(const double*, size_t);
+  int (*min_int)(const int*, size_t);
+  float (*min_float)(const float*, size_t);
+  double (*min_double)(const double*, size_t);
+  int (*max_int)(const int*, size_t);
+  float (*max_float)(const float*, size_t);
+  double (*max_double)(const double*, size_t);
+  int64_t (*dot_int)(const int*, const int*, size_t);
+  float (*dot_float)(const float*, const float*, size_t);
+  double (*dot_double)(const double*, const double*, size_t);
+  void (*hist_int)(const int*, size_t, double, double, size_t*, size_t);
+  void (*hist_float)(const float*, size_t, double, double, size_t*, size_t);
+  void (*hist_double)(const double*, size_t, double, double, size_t*, size_t);
+} vector_kernels;
+
+#define KERNEL_ENTRY(LEVEL)                                                  \
+  {                                                                          \
+    sum_int_##LEVEL, sum_float_##LEVEL, sum_double_##LEVEL, min_int_##LEVEL, \
+        min_float_##LEVEL, min_double_##LEVEL, max_int_##LEVEL,              \
+        max_float_##LEVEL, max_double_##LEVEL, dot_int_##LEVEL,              \
+        dot_float_##LEVEL, dot_double_##LEVEL, hist_int_##LEVEL,             \
+        hist_float_##LEVEL, hist_double_##LEVEL,                             \
+  }
+
+// SSE2 alone lacks the 32-bit min/max and widening multiplies,
+// so that level stays on the scalar kernels
+static const vector_kernels kKernels[SIMD_LEVEL_COUNT] = {
+    [SIMD_SCALAR] = KERNEL_ENTRY(scalar),
+    [SIMD_SSE2] = KERNEL_ENTRY(scalar),
+#ifdef VECTOR_KERNELS_X86
+    [SIMD_SSE42] = KERNEL_ENTRY(sse42),
+    [SIMD_AVX2] = KERNEL_ENTRY(avx2),
+    [SIMD_AVX512] = KERNEL_ENTRY(avx512),
+#else
+    [SIMD_SSE42] = KERNEL_ENTRY(scalar),
+    [SIMD_AVX2] = KERNEL_ENTRY(scalar),
+    [SIMD_AVX512] = KERNEL_ENTRY(scalar),
+#endif
+};
+
+#undef KERNEL_ENTRY
+
+static inline const vector_kernels* kernels(void) {
+  return &kKernels[simd_get_level()];
+}
+
+// ===========================================================
+// Public entry points
+// ===========================================================
+int64_t vk_sum_int(const int* data, size_t n) {
+  return kernels()->sum_int(data, n);
+}
+
+float vk_sum_float(const float* data, size_t n) {
+  return kernels()->sum_float(data, n);
+}
+
+double vk_sum_double(const double* data, size_t n) {
+  return kernels()->sum_double(data, n);
+}
+
+int vk_min_int(const int* data, size_t n) {
+  return kernels()->min_int(data, n);
+}
+
+float vk_min_float(const float* data, size_t n) {
+  return kernels()->min_float(data, n);
+}
+
+double vk_min_double(const double* data, size_t n) {
+  return kernels()->min_double(data, n);
+}
+
+int vk_max_int(const int* data, size_t n) {
+  return kernels()->max_int(data, n);
+}
+
+float vk_max_float(const float* data, size_t n) {
+  return kernels()->max_float(data, n);
+}
+
+double vk_max_double(const double* data, size_t n) {
+  return kernels()->max_double(data, n);
+}
+
+int64_t vk_dot_int(const int* a, const int* b, size_t n) {
+  return kernels()->dot_int(a, b, n);
+}
+
+float vk_dot_float(const float* a, const float* b, size_t n) {
+  return kernels()->dot_float(a, b, n);
+}
+
+double vk_dot_double(const double* a, const double* b, size_t n) {
+  return kernels()->dot_double(a, b, n);
+}
+
+// checks the histogram arguments and zeroes the counts.
+// The SIMD kernels convert bins to 32-bit ints, so more bins than
+// that are left to the scalar kernel.
+static bool hist_prepare(double lo,
+                         double hi,
+                         size_t* counts,
+                         size_t nbins) {
+  if (nbins == 0 || !(hi > lo)) {
+    panic("invalid histogram range or bin count\n");
+  }
+  if (counts == NULL) {
+    panic("counts is NULL\n");
+  }
+  memset(counts, 0, nbins * sizeof(size_t));
+  return nbins <= (size_t)INT32_MAX;
+}
+
+void vk_histogram_int(const int* data,
+                      size_t n,
+                      double lo,
+                      double hi,
+                      size_t* counts,
+                      size_t nbins) {
+  if (hist_prepare(lo, hi, counts, nbins)) {
+    kernels()->hist_int(data, n, lo, hi, counts, nbins);
+  } else {
+    hist_int_scalar(data, n, lo, hi, counts, nbins);
+  }
+}
+
+void vk_histogram_float(const float* data,
+                        size_t n,
+                        double lo,
+                        double hi,
+                        size_t* counts,
+                        size_t nbins) {
+  if (hist_prepare(lo, hi, counts, nbins)) {
+    kernels()->hist_float(data, n, lo, hi, counts, nbins);
+  } else {
+    hist_float_scalar(data, n, lo, hi, counts, nbins);
+  }
+}
+
+void vk_histogram_double(const double* data,
+                         size_t n,
+                         double lo,
+                         double hi,
+                         size_t* counts,
+                         size_t nbins) {
+  if (hist_prepare(lo, hi, counts, nbins)) {
+    kernels()->hist_double(data, n, lo, hi, counts, nbins);
+  } else {
+    hist_double_scalar(data, n, lo, hi, counts, nbins);
+  }
+}
@@ -0,0 +1,130 @@
+#ifndef VECTOR_KERNELS_H_
+#define VECTOR_KERNELS_H_
+
+/*!
+ * Numeric reductions over vector(int), vector(float) and vector(double).
+ *
+ * The typed vector is just a T* as far as the compiler can see, so loops
+ * written against it with vector_get() stay scalar. These kernels work on
+ * the raw element array instead and come in SSE4.2, AVX2 and AVX-512
+ * variants plus a scalar fallback. The variant is picked once at startup
+ * (see simd.h), so calling a kernel costs one indirect call.
+ *
+ * All kernels accept arrays with any alignment and any length. The
+ * vector(T) macros at the bottom of the file pass `*self` and
+ * vector_len(self) along, for example:
+ *
+ * vector(int) v = vector_new(int, 10, NULL);
+ * ...
+ * int64_t total = vector_sum(&v, int);
+ * int smallest = vector_min(&v, int);
+ *
+ * The floating point kernels reassociate the additions, so their results
+ * can differ from a left to right scalar loop by rounding error.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "./vector.h"
+
+// Synopsis:
+//   int64_t vk_sum_int(const int* data, size_t n);
+//   float vk_sum_float(const float* data, size_t n);
+//   double vk_sum_double(const double* data, size_t n);
+//
+// Returns the sum of the n elements starting at data, 0 if n is 0.
+// Integer sums are accumulated in 64 bits so they do not overflow.
+int64_t vk_sum_int(const int* data, size_t n);
+float vk_sum_float(const float* data, size_t n);
+double vk_sum_double(const double* data, size_t n);
+
+// Synopsis:
+//   T vk_min_T(const T* data, size_t n);
+//   T vk_max_T(const T* data, size_t n);
+//
+// Returns the smallest/largest of the n elements starting at data.
+// If n is 0, the identity of the reduction is returned: INT_MAX / INT_MIN
+// for int and +/- infinity for float and double.
+// Which element is returned when the data contains NaN is unspecified.
+int vk_min_int(const int* data, size_t n);
+float vk_min_float(const float* data, size_t n);
+double vk_min_double(const double* data, size_t n);
+int vk_max_int(const int* data, size_t n);
+float vk_max_float(const float* data, size_t n);
+double vk_max_double(const double* data, size_t n);
+
+// Synopsis:
+//   T vk_dot_T(const T* a, const T* b, size_t n);
+//
+// Returns the dot product of the n elements starting at a and b.
+// Integer products are accumulated in 64 bits.
+int64_t vk_dot_int(const int* a, const int* b, size_t n);
+float vk_dot_float(const float* a, const float* b, size_t n);
+double vk_dot_double(const double* a, const double* b, size_t n);
+
+// Synopsis:
+//   void vk_histogram_T(const T* data, size_t n, double lo, double hi,
+//                       size_t* counts, size_t nbins);
+//
+// Counts the elements into nbins equal width bins covering [lo, hi).
+// Element x goes into bin (size_t)((x - lo) * (nbins / (hi - lo))),
+// computed in double precision. Elements outside of [lo, hi) and NaN are
+// not counted. counts must have room for nbins entries and is overwritten.
+// panic()'s if nbins is 0 or hi <= lo.
+void vk_histogram_int(const int* data,
+                      size_t n,
+                      double lo,
+                      double hi,
+                      size_t* counts,
+                      size_t nbins);
+void vk_histogram_float(const float* data,
+                        size_t n,
+                        double lo,
+                        double hi,
+                        size_t* counts,
+                        size_t nbins);
+void vk_histogram_double(const double* data,
+                         size_t n,
+                         double lo,
+                         double hi,
+                         size_t* counts,
+                         size_t nbins);
+
+// Synopsis:
+//   vector_sum(vector(T)* self, T);
+//   vector_min(vector(T)* self, T);
+//   vector_max(vector(T)* self, T);
+//
+// Runs the matching vk_ kernel over the whole vector.
+// T must be one of int, float or double.
+//
+// example:
+// vector(double) v = ...;
+// double total = vector_sum(&v, double);
+#define vector_sum(self, T) vk_sum_##T(*(self), vector_len(self))
+#define vector_min(self, T) vk_min_##T(*(self), vector_len(self))
+#define vector_max(self, T) vk_max_##T(*(self), vector_len(self))
+
+// Synopsis:
+//   vector_dot(vector(T)* a, vector(T)* b, T);
+//
+// Returns the dot product of two vectors of the same length.
+// panic()'s if the lengths differ.
+#define vector_dot(a, b, T)                            \
+  ({                                                   \
+    size_t __impl_vdot_len = vector_len(a);            \
+    if (__impl_vdot_len != vector_len(b)) {            \
+      panic("vector length mismatch in vector_dot\n"); \
+    }                                                  \
+    vk_dot_##T(*(a), *(b), __impl_vdot_len);           \
+  })
+
+// Synopsis:
+//   void vector_histogram(vector(T)* self, T, double lo, double hi,
+//                         size_t* counts, size_t nbins);
+//
+// Runs vk_histogram_T over the whole vector.
+#define vector_histogram(self, T, lo, hi, counts, nbins) \
+  vk_histogram_##T(*(self), vector_len(self), (lo), (hi), (counts), (nbins))
+
+#endif  // VECTOR_KERNELS_H_